@@ -0,0 +1,59 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_BENCHMARK_HPP_
+#define AFC_BENCHMARK_HPP_
+
+#include <chrono>
+#include <utility>
+#include <vector>
+
+namespace afc
+{
+namespace bench
+{
+	typedef void (*BenchmarkFunction)();
+
+	inline std::vector<std::pair<const char *, BenchmarkFunction>> &benchmarks()
+	{
+		static std::vector<std::pair<const char *, BenchmarkFunction>> registry;
+		return registry;
+	}
+
+	struct BenchmarkRegistration
+	{
+		BenchmarkRegistration(const char * const name, const BenchmarkFunction f) { benchmarks().emplace_back(name, f); }
+	};
+
+	typedef std::chrono::steady_clock Clock;
+
+	inline double secondsSince(const Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// Prevents the optimiser from discarding the computation of the value.
+	template<typename T>
+	inline void doNotOptimise(const T &value) { asm volatile("" : : "g"(&value) : "memory"); }
+}
+}
+
+// Defines a benchmark that is run by libafc_bench if its name matches one of the command line filters.
+#define AFC_BENCHMARK(name) \
+	static void name(); \
+	static const afc::bench::BenchmarkRegistration name##Registration(#name, name); \
+	static void name()
+
+#endif /* AFC_BENCHMARK_HPP_ */
@@ -0,0 +1,94 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include <afc/calendar.h>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::Timestamp;
+	using afc::bench::Clock;
+	using afc::bench::doNotOptimise;
+	using afc::bench::secondsSince;
+
+	const std::size_t defaultTimestampCount = 100000000;
+
+	// The environment variable AFC_BENCH_TIMESTAMPS overrides the number of timestamps.
+	std::size_t timestampCount()
+	{
+		const char * const count = std::getenv("AFC_BENCH_TIMESTAMPS");
+		return count == nullptr ? defaultTimestampCount : std::strtoull(count, nullptr, 10);
+	}
+
+	// Event-like timestamps within 2000-2030.
+	std::vector<Timestamp::time_type> generateTimestamps()
+	{
+		const std::size_t n = timestampCount();
+		std::vector<Timestamp::time_type> millis(n);
+		std::uint64_t seed = 12345;
+		for (std::size_t i = 0; i < n; ++i) {
+			seed = seed * 6364136223846793005 + 1442695040888963407;
+			millis[i] = Timestamp::time_type(946684800000) + Timestamp::time_type((seed >> 20) % (std::uint64_t(30) * 365 * 86400000));
+		}
+		return millis;
+	}
+
+	void report(const char * const name, const double seconds, const std::size_t n)
+	{
+		std::printf("%-34s %8.2f ns/timestamp %10.1f M timestamps/s\n", name, seconds * 1e9 / n, n / seconds / 1e6);
+	}
+
+	typedef void (*KeyFunction)(const Timestamp::time_type *, std::size_t, std::int32_t *, long);
+
+	void benchmarkBatch(const char * const name, const KeyFunction f,
+			const std::vector<Timestamp::time_type> &millis, std::vector<std::int32_t> &keys)
+	{
+		const Clock::time_point start = Clock::now();
+		f(millis.data(), millis.size(), keys.data(), 3 * 3600);
+		const double seconds = secondsSince(start);
+		doNotOptimise(keys[keys.size() / 2]);
+		report(name, seconds, millis.size());
+	}
+}
+
+AFC_BENCHMARK(calendarBucketing)
+{
+	const std::vector<Timestamp::time_type> millis = generateTimestamps();
+	std::vector<std::int32_t> keys(millis.size());
+	std::printf("timestamps: %zu\n", millis.size());
+
+	Clock::time_point start = Clock::now();
+	for (std::size_t i = 0; i < millis.size(); ++i) {
+		const std::time_t t = static_cast<std::time_t>(millis[i] / 1000 + 3 * 3600);
+		std::tm dateTime;
+		::gmtime_r(&t, &dateTime);
+		keys[i] = (dateTime.tm_year + 1900) * 100 + dateTime.tm_mon + 1;
+	}
+	doNotOptimise(keys[keys.size() / 2]);
+	report("gmtime_r year-month", secondsSince(start), millis.size());
+
+	benchmarkBatch("afc::epochDayKeys", afc::epochDayKeys, millis, keys);
+	benchmarkBatch("afc::epochHourKeys", afc::epochHourKeys, millis, keys);
+	benchmarkBatch("afc::yearMonthKeys", afc::yearMonthKeys, millis, keys);
+	benchmarkBatch("afc::isoWeekKeys", afc::isoWeekKeys, millis, keys);
+}
@@ -0,0 +1,77 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <afc/chunker.h>
+#include <afc/crc.hpp>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::bench::Clock;
+	using afc::bench::doNotOptimise;
+	using afc::bench::secondsSince;
+
+	const std::size_t dataSize = 256 * 1024 * 1024;
+
+	std::vector<unsigned char> randomData()
+	{
+		std::vector<unsigned char> data(dataSize);
+		std::uint64_t seed = 12345;
+		for (unsigned char &c : data) {
+			seed = seed * 6364136223846793005 + 1442695040888963407;
+			c = static_cast<unsigned char>(seed >> 56);
+		}
+		return data;
+	}
+
+	void report(const char * const name, const double seconds, const std::size_t chunkCount)
+	{
+		std::printf("%-32s %8.1f MB/s  %zu chunks\n", name, dataSize / (1024.0 * 1024.0) / seconds, chunkCount);
+	}
+}
+
+AFC_BENCHMARK(contentDefinedChunking)
+{
+	const std::vector<unsigned char> data = randomData();
+	const afc::ContentChunker chunker;
+
+	Clock::time_point start = Clock::now();
+	doNotOptimise(afc::crc64Reversed(data.data(), data.size()));
+	report("crc64Reversed only", secondsSince(start), 0);
+
+	std::size_t chunkCount = 0;
+	std::uint64_t crc = 0;
+	const afc::ChunkHandler handler = [&](const afc::Chunk &chunk) { ++chunkCount; crc ^= chunk.crc; };
+
+	start = Clock::now();
+	chunker.split(data.data(), data.size(), handler);
+	report("ContentChunker::split", secondsSince(start), chunkCount);
+
+	for (const unsigned threadCount : {2, 4}) {
+		chunkCount = 0;
+		start = Clock::now();
+		chunker.splitParallel(data.data(), data.size(), handler, threadCount);
+		const std::string name = "ContentChunker::splitParallel/" + std::to_string(threadCount);
+		report(name.c_str(), secondsSince(start), chunkCount);
+	}
+	doNotOptimise(crc);
+}
@@ -0,0 +1,155 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <afc/stream.h>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::bench::Clock;
+	using afc::bench::secondsSince;
+
+	const std::size_t syntheticCorpusSize = 32 * 1024 * 1024;
+	const std::size_t writeChunkSize = 1024 * 1024;
+
+	/* Either the file the environment variable AFC_BENCH_CORPUS points to or
+	 * synthetic log-like text that compresses moderately well.
+	 */
+	std::vector<unsigned char> loadCorpus()
+	{
+		std::vector<unsigned char> corpus;
+		const char * const file = std::getenv("AFC_BENCH_CORPUS");
+		if (file != nullptr) {
+			afc::FileInputStream in(file);
+			unsigned char buf[64 * 1024];
+			std::size_t n;
+			while ((n = in.read(buf, sizeof(buf))) > 0) {
+				corpus.insert(corpus.end(), buf, buf + n);
+			}
+			return corpus;
+		}
+
+		static const char * const levels[] = {"INFO", "WARN", "DEBUG", "ERROR"};
+		static const char * const events[] = {"request served", "cache miss", "connection reset", "retrying call"};
+		unsigned seed = 12345;
+		char line[256];
+		corpus.reserve(syntheticCorpusSize + sizeof(line));
+		while (corpus.size() < syntheticCorpusSize) {
+			seed = seed * 1103515245 + 12345;
+			const int n = std::snprintf(line, sizeof(line),
+					"2019-03-%02u 12:%02u:%02u %s [worker-%u] %s user=%u latency_us=%u\n",
+					seed % 28 + 1, (seed >> 5) % 60, (seed >> 11) % 60, levels[(seed >> 3) & 3],
+					(seed >> 17) % 16, events[(seed >> 7) & 3], (seed >> 9) % 100000, (seed >> 13) % 5000);
+			corpus.insert(corpus.end(), line, line + n);
+		}
+		return corpus;
+	}
+
+	struct Codec
+	{
+		const char *name;
+		int level;
+		std::function<afc::OutputStream *(const char *)> output;
+		std::function<afc::InputStream *(const char *)> input;
+	};
+
+	std::vector<Codec> codecs()
+	{
+		std::vector<Codec> result;
+		for (const int level : {1, 6, 9}) {
+			result.push_back({"gzip", level,
+					[level](const char * const file) { return new afc::GZipFileOutputStream(file, level); },
+					[](const char * const file) { return new afc::GZipFileInputStream(file); }});
+		}
+#ifdef AFC_USE_LZ4
+		for (const int level : {0, 9}) {
+			result.push_back({"lz4", level,
+					[level](const char * const file) { return new afc::LZ4FrameOutputStream(file, level); },
+					[](const char * const file) { return new afc::LZ4FrameInputStream(file); }});
+		}
+#endif
+#ifdef AFC_USE_ZSTD
+		for (const int level : {1, 3, 9, 19}) {
+			result.push_back({"zstd", level,
+					[level](const char * const file)
+					{
+						afc::ZstdOptions options;
+						options.level = level;
+						return new afc::ZstdOutputStream(file, options);
+					},
+					[](const char * const file) { return new afc::ZstdInputStream(file); }});
+		}
+#endif
+		return result;
+	}
+}
+
+AFC_BENCHMARK(codecRatioAndThroughput)
+{
+	const std::vector<unsigned char> corpus = loadCorpus();
+	const double megabytes = corpus.size() / (1024.0 * 1024.0);
+	char file[] = "/tmp/libafc_bench_XXXXXX";
+	::close(::mkstemp(file));
+
+	std::printf("corpus: %zu octets\n", corpus.size());
+	std::printf("%-6s %5s %8s %14s %14s\n", "codec", "level", "ratio", "compress MB/s", "decompress MB/s");
+	for (const Codec &codec : codecs()) {
+		Clock::time_point start = Clock::now();
+		{
+			std::unique_ptr<afc::OutputStream> out(codec.output(file));
+			for (std::size_t i = 0; i < corpus.size(); i += writeChunkSize) {
+				out->write(corpus.data() + i, std::min(writeChunkSize, corpus.size() - i));
+			}
+			// The stream is finalised by its destructor.
+		}
+		const double compressTime = secondsSince(start);
+
+		struct stat fileStat;
+		::stat(file, &fileStat);
+
+		std::vector<unsigned char> decoded(corpus.size());
+		start = Clock::now();
+		std::size_t decodedSize = 0;
+		{
+			std::unique_ptr<afc::InputStream> in(codec.input(file));
+			std::size_t n;
+			while ((n = in->read(decoded.data() + decodedSize, std::min(writeChunkSize, decoded.size() - decodedSize))) > 0) {
+				decodedSize += n;
+			}
+		}
+		const double decompressTime = secondsSince(start);
+
+		if (decodedSize != corpus.size() || !std::equal(corpus.begin(), corpus.end(), decoded.begin())) {
+			std::printf("%-6s %5d  round trip FAILED\n", codec.name, codec.level);
+			continue;
+		}
+		std::printf("%-6s %5d %8.2f %14.1f %14.1f\n", codec.name, codec.level,
+				double(corpus.size()) / fileStat.st_size, megabytes / compressTime, megabytes / decompressTime);
+	}
+	::unlink(file);
+}
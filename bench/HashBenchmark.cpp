@@ -0,0 +1,132 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <openssl/evp.h>
+
+#include <afc/md5.hpp>
+#include <afc/multi_hash.h>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::bench::Clock;
+	using afc::bench::doNotOptimise;
+	using afc::bench::secondsSince;
+
+	const std::size_t keyCount = 100000;
+	const unsigned repetitions = 10;
+
+	// Cache-key-like messages of 20 to 200 octets.
+	std::vector<std::string> generateKeys()
+	{
+		std::vector<std::string> keys;
+		keys.reserve(keyCount);
+		unsigned seed = 12345;
+		for (std::size_t i = 0; i < keyCount; ++i) {
+			seed = seed * 1103515245 + 12345;
+			std::string key = "user:" + std::to_string(seed % 1000000) + ":session:";
+			key.resize(20 + (seed >> 8) % 181, 'k');
+			keys.push_back(std::move(key));
+		}
+		return keys;
+	}
+
+	std::vector<afc::HashInput> inputsOf(const std::vector<std::string> &keys)
+	{
+		std::vector<afc::HashInput> inputs;
+		for (const std::string &key : keys) {
+			inputs.push_back(afc::HashInput{reinterpret_cast<const unsigned char *>(key.data()), key.size()});
+		}
+		return inputs;
+	}
+
+	void report(const char * const name, const double seconds)
+	{
+		std::printf("%-34s %10.1f ns/message\n", name, seconds * 1e9 / (double(keyCount) * repetitions));
+	}
+}
+
+AFC_BENCHMARK(multiBufferMd5)
+{
+	const std::vector<std::string> keys = generateKeys();
+	const std::vector<afc::HashInput> inputs = inputsOf(keys);
+	std::printf("lanes: %u\n", afc::multiBufferLanes());
+
+	Clock::time_point start = Clock::now();
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	for (unsigned r = 0; r < repetitions; ++r) {
+		for (const afc::HashInput &input : inputs) {
+			::EVP_Digest(input.data, input.size, digest, nullptr, ::EVP_md5(), nullptr);
+			doNotOptimise(digest[0]);
+		}
+	}
+	report("OpenSSL MD5 per message", secondsSince(start));
+
+	start = Clock::now();
+	char hex[2 * afc::md5DigestSize];
+	for (unsigned r = 0; r < repetitions; ++r) {
+		for (const afc::HashInput &input : inputs) {
+			afc::md5String(input.data, input.size, hex);
+			doNotOptimise(hex[0]);
+		}
+	}
+	report("afc::md5String per message", secondsSince(start));
+
+	std::vector<unsigned char> digests(keyCount * afc::md5DigestSize);
+	start = Clock::now();
+	for (unsigned r = 0; r < repetitions; ++r) {
+		afc::md5Batch(inputs.data(), inputs.size(), reinterpret_cast<unsigned char (*)[afc::md5DigestSize]>(digests.data()));
+	}
+	doNotOptimise(digests[0]);
+	report("afc::md5Batch", secondsSince(start));
+
+	std::vector<char> hexDigests(keyCount * 2 * afc::md5DigestSize);
+	start = Clock::now();
+	for (unsigned r = 0; r < repetitions; ++r) {
+		afc::md5HexBatch(inputs.data(), inputs.size(), hexDigests.data());
+	}
+	doNotOptimise(hexDigests[0]);
+	report("afc::md5HexBatch", secondsSince(start));
+}
+
+AFC_BENCHMARK(multiBufferSha256)
+{
+	const std::vector<std::string> keys = generateKeys();
+	const std::vector<afc::HashInput> inputs = inputsOf(keys);
+
+	Clock::time_point start = Clock::now();
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	for (unsigned r = 0; r < repetitions; ++r) {
+		for (const afc::HashInput &input : inputs) {
+			::EVP_Digest(input.data, input.size, digest, nullptr, ::EVP_sha256(), nullptr);
+			doNotOptimise(digest[0]);
+		}
+	}
+	report("OpenSSL SHA256 per message", secondsSince(start));
+
+	std::vector<unsigned char> digests(keyCount * afc::sha256DigestSize);
+	start = Clock::now();
+	for (unsigned r = 0; r < repetitions; ++r) {
+		afc::sha256Batch(inputs.data(), inputs.size(), reinterpret_cast<unsigned char (*)[afc::sha256DigestSize]>(digests.data()));
+	}
+	doNotOptimise(digests[0]);
+	report("afc::sha256Batch", secondsSince(start));
+}
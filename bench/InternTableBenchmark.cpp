@@ -0,0 +1,99 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <afc/intern_table.h>
+#include <afc/Repository.h>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::bench::Clock;
+	using afc::bench::doNotOptimise;
+	using afc::bench::secondsSince;
+
+	const std::size_t defaultIdentifierCount = 1000000;
+	const std::size_t lookupCount = 1000;
+
+	// The environment variable AFC_BENCH_IDENTIFIERS overrides the number of identifiers.
+	std::vector<std::string> identifiers()
+	{
+		const char * const count = std::getenv("AFC_BENCH_IDENTIFIERS");
+		const std::size_t n = count == nullptr ? defaultIdentifierCount : std::strtoul(count, nullptr, 10);
+		std::vector<std::string> result;
+		result.reserve(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			result.push_back("module" + std::to_string(i % 97) + "::symbol_" + std::to_string(i * 2654435761u % 1000003));
+		}
+		return result;
+	}
+}
+
+/* Startup cost: interning all the identifiers at run time versus mapping a table built
+ * in advance, followed by a few lookups as a process would do right after start.
+ */
+AFC_BENCHMARK(internTableStartup)
+{
+	const std::vector<std::string> strings = identifiers();
+	char file[] = "/tmp/libafc_bench_XXXXXX";
+	::close(::mkstemp(file));
+
+	Clock::time_point start = Clock::now();
+	{
+		afc::InternTableBuilder builder;
+		for (const std::string &s : strings) {
+			builder.add(afc::stringRef(s.data(), s.size()));
+		}
+		builder.write(file);
+	}
+	std::printf("identifiers: %zu\n", strings.size());
+	std::printf("%-28s %10.2f ms\n", "build and write table", secondsSince(start) * 1e3);
+
+	start = Clock::now();
+	{
+		afc::Repository<std::string> repository;
+		for (const std::string &s : strings) {
+			doNotOptimise(&repository.get(s));
+		}
+		std::printf("%-28s %10.2f ms\n", "afc::Repository (startup)", secondsSince(start) * 1e3);
+	}
+
+	for (const bool verify : {false, true}) {
+		start = Clock::now();
+		afc::InternTable table(file, verify);
+		for (std::size_t i = 0; i < lookupCount; ++i) {
+			const std::string &s = strings[i * 7919 % strings.size()];
+			doNotOptimise(table.find(afc::stringRef(s.data(), s.size())));
+		}
+		std::printf("%-28s %10.2f ms\n", verify ? "map table (verified)" : "map table", secondsSince(start) * 1e3);
+	}
+
+	afc::InternTable table(file);
+	start = Clock::now();
+	for (const std::string &s : strings) {
+		doNotOptimise(table.find(afc::stringRef(s.data(), s.size())));
+	}
+	std::printf("%-28s %10.1f ns/lookup\n", "afc::InternTable::find", secondsSince(start) * 1e9 / strings.size());
+
+	::unlink(file);
+}
@@ -0,0 +1,115 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <afc/membership_filter.h>
+#include <afc/Repository.h>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::bench::Clock;
+	using afc::bench::doNotOptimise;
+	using afc::bench::secondsSince;
+
+	const std::size_t elementCount = 1000000;
+	const std::size_t probeCount = 4000000;
+	const std::size_t repositorySize = 200000;
+	const std::size_t repositoryProbeCount = 1000000;
+
+	std::vector<std::uint64_t> hashes(const std::uint64_t from, const std::size_t n)
+	{
+		std::vector<std::uint64_t> result(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			result[i] = afc::mixHash(from + i);
+		}
+		return result;
+	}
+
+	// Probes hashes of elements absent from the filter, so the positives are false ones.
+	template<typename Filter>
+	void benchmarkFilter(const char * const name, const Filter &filter)
+	{
+		const std::vector<std::uint64_t> probes = hashes(std::uint64_t(1) << 40, probeCount);
+
+		Clock::time_point start = Clock::now();
+		std::size_t positives = 0;
+		for (const std::uint64_t h : probes) {
+			positives += filter.contains(h);
+		}
+		const double single = secondsSince(start) * 1e9 / probes.size();
+
+		std::unique_ptr<bool[]> results(new bool[probes.size()]);
+		start = Clock::now();
+		filter.contains(probes.data(), probes.size(), results.get());
+		const double batch = secondsSince(start) * 1e9 / probes.size();
+		doNotOptimise(results[probes.size() / 2]);
+
+		std::printf("%-26s %6.2f bits/element  FPR %7.4f%%  %6.2f ns/op  %6.2f ns/op (batch)\n", name,
+				filter.sizeInBytes() * 8.0 / elementCount, positives * 100.0 / probes.size(), single, batch);
+	}
+
+	template<typename Repository>
+	void benchmarkMisses(const char * const name)
+	{
+		Repository repository;
+		for (std::size_t i = 0; i < repositorySize; ++i) {
+			repository.get("message #" + std::to_string(i));
+		}
+		std::vector<std::string> probes;
+		for (std::size_t i = 0; i < repositoryProbeCount; ++i) {
+			probes.push_back("message #" + std::to_string(repositorySize + i));
+		}
+
+		const Clock::time_point start = Clock::now();
+		for (const std::string &s : probes) {
+			doNotOptimise(repository.find(s));
+		}
+		std::printf("%-34s %8.1f ns/miss\n", name, secondsSince(start) * 1e9 / probes.size());
+	}
+}
+
+AFC_BENCHMARK(membershipFilters)
+{
+	const std::vector<std::uint64_t> elements = hashes(0, elementCount);
+	std::printf("elements: %zu\n", elementCount);
+
+	for (const unsigned bits : {8, 12, 16}) {
+		afc::BlockedBloomFilter filter(elementCount, bits);
+		for (const std::uint64_t h : elements) {
+			filter.add(h);
+		}
+		const std::string name = "BlockedBloomFilter/" + std::to_string(bits);
+		benchmarkFilter(name.c_str(), filter);
+	}
+
+	const Clock::time_point start = Clock::now();
+	const afc::BinaryFuseFilter filter(elements.data(), elements.size());
+	std::printf("BinaryFuseFilter construction: %.1f ns/element\n", secondsSince(start) * 1e9 / elementCount);
+	benchmarkFilter("BinaryFuseFilter", filter);
+}
+
+AFC_BENCHMARK(prefilteredRepositoryMisses)
+{
+	benchmarkMisses<afc::Repository<std::string>>("afc::Repository");
+	benchmarkMisses<afc::PrefilteredRepository<std::string>>("afc::PrefilteredRepository");
+}
@@ -0,0 +1,102 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <afc/algo/search.h>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::bench::Clock;
+	using afc::bench::doNotOptimise;
+	using afc::bench::secondsSince;
+
+	const unsigned dimensionCount = 4;
+	const int maxCoordinate = 31;
+
+	// A weighted sum of squares evaluated one state at a time.
+	class Objective : public afc::SearchSpace<int, float>
+	{
+	public:
+		Objective() : m_weights{0.5f, -1.25f, 2.0f, -0.75f} {}
+
+		virtual unsigned dimensionCount() const throw() { return ::dimensionCount; }
+		virtual int lowerBound(unsigned) const throw() { return 0; }
+		virtual int upperBound(unsigned) const throw() { return maxCoordinate; }
+
+		virtual float value(const std::vector<int> &state) const throw()
+		{
+			float result = 0;
+			for (unsigned d = 0; d < ::dimensionCount; ++d) {
+				const float x = state[d] - 16.0f;
+				result += m_weights[d] * x * x;
+			}
+			return result;
+		}
+	protected:
+		const float m_weights[::dimensionCount];
+	};
+
+	// The same objective evaluated dimension by dimension over the batch, which is vectorised.
+	class BatchedObjective : public Objective
+	{
+	public:
+		virtual void values(const afc::StateBatch<int> &states, float * const result) const
+		{
+			std::fill_n(result, states.size, 0.0f);
+			for (unsigned d = 0; d < ::dimensionCount; ++d) {
+				const int * const coordinates = states.dimension(d);
+				const float weight = m_weights[d];
+				for (std::size_t i = 0; i < states.size; ++i) {
+					const float x = coordinates[i] - 16.0f;
+					result[i] += weight * x * x;
+				}
+			}
+		}
+	};
+
+	template<typename Algorithm>
+	void benchmark(const char * const name, Algorithm algorithm, const std::size_t stateCount)
+	{
+		for (const bool batched : {false, true}) {
+			const Objective scalarObjective;
+			const BatchedObjective batchedObjective;
+			const Objective &objective = batched ? batchedObjective : scalarObjective;
+			std::vector<int> solution;
+			std::srand(1);
+
+			const Clock::time_point start = Clock::now();
+			algorithm.solve(objective, solution);
+			std::printf("%-24s %-10s %6.2f ns/state\n", name, batched ? "values()" : "value()",
+					secondsSince(start) * 1e9 / stateCount);
+			doNotOptimise(solution[0]);
+		}
+	}
+}
+
+AFC_BENCHMARK(searchSpaceEvaluation)
+{
+	const std::size_t stateCount = std::size_t(1) << (5 * dimensionCount);
+	benchmark("ExhaustiveSearch", afc::ExhaustiveSearch<int, float>(), stateCount);
+
+	const unsigned attempts = 100, steps = 100;
+	benchmark("RandomStartHillClimbing", afc::RandomStartHillClimbing<int, float>(attempts, steps),
+			std::size_t(attempts) * steps * dimensionCount * (maxCoordinate + 1));
+}
@@ -0,0 +1,110 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <afc/slab.h>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::bench::Clock;
+	using afc::bench::doNotOptimise;
+	using afc::bench::secondsSince;
+
+	const std::size_t objectCount = 1000000;
+	const unsigned threadCounts[] = {1, 4};
+
+	struct Element
+	{
+		void *address;
+		std::string function;
+		int offset;
+		unsigned line;
+	};
+
+	// Allocates objectCount objects in each thread in rounds of 1000 and frees them.
+	template<typename Allocate, typename Free>
+	void benchmarkChurn(const char * const name, Allocate allocate, Free free)
+	{
+		for (const unsigned threadCount : threadCounts) {
+			std::vector<std::thread> threads;
+			const Clock::time_point start = Clock::now();
+			for (unsigned t = 0; t < threadCount; ++t) {
+				threads.emplace_back([&]()
+				{
+					std::vector<Element *> objects(1000);
+					for (std::size_t i = 0; i < objectCount; i += objects.size()) {
+						for (Element *&object : objects) {
+							object = allocate();
+						}
+						doNotOptimise(objects[objects.size() / 2]);
+						free(objects);
+					}
+				});
+			}
+			for (std::thread &thread : threads) {
+				thread.join();
+			}
+			std::printf("%-34s %u threads %8.1f ns/object\n", name, threadCount,
+					secondsSince(start) * 1e9 / (double(objectCount) * threadCount));
+		}
+	}
+
+	template<typename Set>
+	void benchmarkSet(const char * const name)
+	{
+		const Clock::time_point start = Clock::now();
+		Set set;
+		for (std::size_t i = 0; i < objectCount; ++i) {
+			set.insert(int((i * 2654435761u) % objectCount));
+			if (set.size() > 1000) {
+				set.erase(set.begin());
+			}
+		}
+		doNotOptimise(set.size());
+		std::printf("%-34s %8.1f ns/insert\n", name, secondsSince(start) * 1e9 / objectCount);
+	}
+}
+
+AFC_BENCHMARK(objectPoolChurn)
+{
+	benchmarkChurn("new/delete",
+			[]() { return new Element(); },
+			[](const std::vector<Element *> &objects) { for (Element * const object : objects) { delete object; } });
+	benchmarkChurn("afc::ObjectPool",
+			[]() { return afc::ObjectPool<Element>::create(); },
+			[](const std::vector<Element *> &objects)
+			{
+				for (Element * const object : objects) {
+					afc::ObjectPool<Element>::destroy(object);
+				}
+			});
+	benchmarkChurn("afc::ObjectPool batch destroy",
+			[]() { return afc::ObjectPool<Element>::create(); },
+			[](const std::vector<Element *> &objects) { afc::ObjectPool<Element>::destroy(objects.data(), objects.size()); });
+}
+
+AFC_BENCHMARK(slabAllocatorSet)
+{
+	benchmarkSet<std::set<int>>("std::set std::allocator");
+	benchmarkSet<std::set<int, std::less<int>, afc::SlabAllocator<int>>>("std::set afc::SlabAllocator");
+}
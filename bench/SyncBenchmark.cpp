@@ -0,0 +1,123 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <afc/sync.hpp>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::bench::Clock;
+	using afc::bench::doNotOptimise;
+	using afc::bench::secondsSince;
+
+	const std::size_t operationCount = 2000000;
+	const unsigned threadCounts[] = {1, 2, 4, 8};
+
+	struct Snapshot
+	{
+		std::uint64_t values[4];
+	};
+
+	// Runs f(threadIndex, operationsPerThread) in each thread and reports the time per operation.
+	template<typename F>
+	void run(const char * const name, const unsigned threadCount, F f)
+	{
+		const std::size_t operationsPerThread = operationCount / threadCount;
+		std::vector<std::thread> threads;
+		const Clock::time_point start = Clock::now();
+		for (unsigned t = 0; t < threadCount; ++t) {
+			threads.emplace_back(f, t, operationsPerThread);
+		}
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+		std::printf("%-22s %2u threads %8.1f ns/operation\n", name, threadCount,
+				secondsSince(start) * 1e9 / (operationsPerThread * threadCount));
+	}
+
+	// Increments a shared counter under the lock, as metrics do.
+	template<typename Lock>
+	void benchmarkExclusive(const char * const name)
+	{
+		for (const unsigned threadCount : threadCounts) {
+			Lock lock;
+			std::uint64_t counter = 0;
+			run(name, threadCount, [&](unsigned, const std::size_t n)
+			{
+				for (std::size_t i = 0; i < n; ++i) {
+					std::lock_guard<Lock> guard(lock);
+					++counter;
+				}
+			});
+			doNotOptimise(counter);
+		}
+	}
+
+	// Thread 0 writes the snapshot each 64th operation; the other threads read it.
+	template<typename Read, typename Write>
+	void benchmarkReadMostly(const char * const name, Read read, Write write)
+	{
+		for (const unsigned threadCount : threadCounts) {
+			run(name, threadCount, [&](const unsigned threadIndex, const std::size_t n)
+			{
+				std::uint64_t sum = 0;
+				for (std::size_t i = 0; i < n; ++i) {
+					if (threadIndex == 0 && i % 64 == 0) {
+						write(i);
+					} else {
+						sum += read();
+					}
+				}
+				doNotOptimise(sum);
+			});
+		}
+	}
+}
+
+AFC_BENCHMARK(lockContention)
+{
+	benchmarkExclusive<std::mutex>("std::mutex");
+	benchmarkExclusive<afc::SpinLock>("afc::SpinLock");
+	benchmarkExclusive<afc::TicketLock>("afc::TicketLock");
+	benchmarkExclusive<afc::RWSpinLock>("afc::RWSpinLock");
+}
+
+AFC_BENCHMARK(readMostlySnapshot)
+{
+	Snapshot snapshot = Snapshot();
+
+	std::mutex mutex;
+	benchmarkReadMostly("std::mutex",
+			[&]() { std::lock_guard<std::mutex> lock(mutex); return snapshot.values[0] + snapshot.values[3]; },
+			[&](const std::uint64_t i) { std::lock_guard<std::mutex> lock(mutex); snapshot.values[0] = i; snapshot.values[3] = i; });
+
+	afc::RWSpinLock rwLock;
+	benchmarkReadMostly("afc::RWSpinLock",
+			[&]() { afc::SharedLockGuard<afc::RWSpinLock> lock(rwLock); return snapshot.values[0] + snapshot.values[3]; },
+			[&](const std::uint64_t i) { std::lock_guard<afc::RWSpinLock> lock(rwLock); snapshot.values[0] = i; snapshot.values[3] = i; });
+
+	afc::SeqLock<Snapshot> seqLock;
+	benchmarkReadMostly("afc::SeqLock",
+			[&]() { const Snapshot s = seqLock.load(); return s.values[0] + s.values[3]; },
+			[&](const std::uint64_t i) { seqLock.store(Snapshot{{i, 0, 0, i}}); });
+}
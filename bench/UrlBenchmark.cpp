@@ -0,0 +1,209 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <afc/UrlBuilder.hpp>
+#include <afc/UrlParser.hpp>
+
+#include "Benchmark.hpp"
+
+namespace
+{
+	using afc::bench::Clock;
+	using afc::bench::doNotOptimise;
+	using afc::bench::secondsSince;
+
+	const std::size_t urlCount = 100000;
+	const unsigned repetitions = 20;
+
+	std::vector<std::string> generateUrls()
+	{
+		static const char * const hosts[] = {"example.com", "api.example.org:8080", "[2001:db8::1]:443", "cdn.example.net"};
+		static const char * const paths[] = {"/", "/v1/users", "/static/js/app.min.js", "/search/results/page"};
+		std::vector<std::string> urls;
+		urls.reserve(urlCount);
+		unsigned seed = 12345;
+		char buf[512];
+		for (std::size_t i = 0; i < urlCount; ++i) {
+			seed = seed * 1103515245 + 12345;
+			const int n = std::snprintf(buf, sizeof(buf), "https://%s%s/%u?id=%u&q=hello%%20world+%u&lang=en&sort=desc#s%u",
+					hosts[(seed >> 3) & 3], paths[(seed >> 7) & 3], (seed >> 9) % 100000, seed % 1000,
+					(seed >> 13) % 100, (seed >> 5) % 10);
+			urls.emplace_back(buf, n);
+		}
+		return urls;
+	}
+
+	// What one writes without a parser: std::string::find() and substrings.
+	struct NaiveUrl
+	{
+		std::string scheme, host, port, path, query, fragment;
+	};
+
+	void parseNaively(const std::string &url, NaiveUrl &dest)
+	{
+		std::size_t p = 0;
+		const std::size_t schemeEnd = url.find("://");
+		if (schemeEnd != std::string::npos) {
+			dest.scheme = url.substr(0, schemeEnd);
+			p = schemeEnd + 3;
+		}
+		const std::size_t authorityEnd = std::min(url.find_first_of("/?#", p), url.size());
+		const std::string authority = url.substr(p, authorityEnd - p);
+		const std::size_t colon = authority.rfind(':');
+		if (colon != std::string::npos && authority.find(']', colon) == std::string::npos) {
+			dest.host = authority.substr(0, colon);
+			dest.port = authority.substr(colon + 1);
+		} else {
+			dest.host = authority;
+			dest.port.clear();
+		}
+		p = authorityEnd;
+		const std::size_t pathEnd = std::min(url.find_first_of("?#", p), url.size());
+		dest.path = url.substr(p, pathEnd - p);
+		p = pathEnd;
+		dest.query.clear();
+		dest.fragment.clear();
+		if (p < url.size() && url[p] == '?') {
+			const std::size_t queryEnd = std::min(url.find('#', p), url.size());
+			dest.query = url.substr(p + 1, queryEnd - p - 1);
+			p = queryEnd;
+		}
+		if (p < url.size()) {
+			dest.fragment = url.substr(p + 1);
+		}
+	}
+
+	void report(const char * const name, const double seconds)
+	{
+		std::printf("%-34s %10.1f ns/url\n", name, seconds * 1e9 / (double(urlCount) * repetitions));
+	}
+}
+
+AFC_BENCHMARK(urlParsing)
+{
+	const std::vector<std::string> urls = generateUrls();
+
+	Clock::time_point start = Clock::now();
+	NaiveUrl naive;
+	for (unsigned r = 0; r < repetitions; ++r) {
+		for (const std::string &url : urls) {
+			parseNaively(url, naive);
+			doNotOptimise(naive);
+		}
+	}
+	report("naive std::string parser", secondsSince(start));
+
+	start = Clock::now();
+	afc::url::UrlView view;
+	for (unsigned r = 0; r < repetitions; ++r) {
+		for (const std::string &url : urls) {
+			afc::url::parseUrl(url.data(), url.data() + url.size(), view, [](const char *) {});
+			doNotOptimise(view);
+		}
+	}
+	report("afc::url::parseUrl", secondsSince(start));
+}
+
+AFC_BENCHMARK(queryParameterIteration)
+{
+	const std::vector<std::string> urls = generateUrls();
+
+	Clock::time_point start = Clock::now();
+	std::size_t total = 0;
+	for (unsigned r = 0; r < repetitions; ++r) {
+		for (const std::string &url : urls) {
+			const std::size_t q = url.find('?');
+			const std::string query = url.substr(q + 1, url.find('#') - q - 1);
+			std::size_t p = 0;
+			while (p <= query.size()) {
+				const std::size_t amp = std::min(query.find('&', p), query.size());
+				const std::string pair = query.substr(p, amp - p);
+				const std::size_t eq = pair.find('=');
+				total += pair.substr(0, eq).size() + (eq == std::string::npos ? 0 : pair.substr(eq + 1).size());
+				p = amp + 1;
+			}
+		}
+	}
+	doNotOptimise(total);
+	report("naive query splitting", secondsSince(start));
+
+	start = Clock::now();
+	total = 0;
+	char decoded[512];
+	afc::url::UrlView view;
+	for (unsigned r = 0; r < repetitions; ++r) {
+		for (const std::string &url : urls) {
+			afc::url::parseUrl(url.data(), url.data() + url.size(), view, [](const char *) {});
+			for (afc::url::QueryParser parser(view.query()); parser.hasNext();) {
+				const afc::url::QueryParameter param = parser.next();
+				total += param.name.size() + param.value.size();
+			}
+		}
+	}
+	doNotOptimise(total);
+	report("parseUrl + QueryParser", secondsSince(start));
+
+	start = Clock::now();
+	total = 0;
+	for (unsigned r = 0; r < repetitions; ++r) {
+		for (const std::string &url : urls) {
+			afc::url::parseUrl(url.data(), url.data() + url.size(), view, [](const char *) {});
+			for (afc::url::QueryParser parser(view.query()); parser.hasNext();) {
+				const afc::url::QueryParameter param = parser.next();
+				total += param.decodeValue(decoded) - decoded;
+			}
+		}
+	}
+	doNotOptimise(total);
+	report("parseUrl + QueryParser + decoding", secondsSince(start));
+}
+
+AFC_BENCHMARK(urlBatchBuilding)
+{
+	using afc::url::UrlPart;
+
+	const char * const base = "https://api.example.com/v1/accounts/12345/transactions";
+	char page[16];
+
+	Clock::time_point start = Clock::now();
+	for (unsigned r = 0; r < repetitions; ++r) {
+		for (std::size_t i = 0; i < urlCount; ++i) {
+			std::snprintf(page, sizeof(page), "%zu", i);
+			afc::url::UrlBuilder<afc::url::webForm> builder(base, UrlPart<>("sort"), UrlPart<>("date desc"),
+					UrlPart<>("filter"), UrlPart<>("status:settled,type:card"), UrlPart<>("page"), UrlPart<>(page));
+			doNotOptimise(builder);
+		}
+	}
+	report("UrlBuilder per URL", secondsSince(start));
+
+	start = Clock::now();
+	afc::url::UrlBatchBuilder batch(afc::stringRef(base, std::strlen(base)), UrlPart<>("sort"), UrlPart<>("date desc"),
+			UrlPart<>("filter"), UrlPart<>("status:settled,type:card"));
+	for (unsigned r = 0; r < repetitions; ++r) {
+		batch.clear();
+		for (std::size_t i = 0; i < urlCount; ++i) {
+			std::snprintf(page, sizeof(page), "%zu", i);
+			const afc::ConstStringRef url = batch.add(UrlPart<>("page"), UrlPart<>(page));
+			doNotOptimise(url);
+		}
+	}
+	report("UrlBatchBuilder", secondsSince(start));
+}
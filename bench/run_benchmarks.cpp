@@ -0,0 +1,36 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include <cstdio>
+#include <cstring>
+
+#include "Benchmark.hpp"
+
+// Runs all the benchmarks or only those whose names contain one of the arguments.
+int main(const int argc, char ** const argv)
+{
+	for (const auto &benchmark : afc::bench::benchmarks()) {
+		bool selected = argc == 1;
+		for (int i = 1; i < argc && !selected; ++i) {
+			selected = std::strstr(benchmark.first, argv[i]) != nullptr;
+		}
+		if (selected) {
+			std::printf("== %s\n", benchmark.first);
+			std::fflush(stdout);
+			benchmark.second();
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,230 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_CONCURRENT_REPOSITORY_H_
+#define AFC_CONCURRENT_REPOSITORY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "builtin.hpp"
+#include "reclamation.h"
+#include "sync.hpp"
+
+namespace afc
+{
+	/* A thread-safe Repository. Looking up the values interned already is lock-free; inserting
+	 * and removing values is serialised. The values are stored in a hash table whose nodes and
+	 * bucket arrays are reclaimed via the EpochDomain, so readers never see them freed.
+	 *
+	 * A reference returned by get() stays valid until the value is removed.
+	 */
+	template<typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<T>>
+	class ConcurrentRepository
+	{
+		ConcurrentRepository(const ConcurrentRepository &) = delete;
+		ConcurrentRepository(ConcurrentRepository &&) = delete;
+		ConcurrentRepository &operator=(const ConcurrentRepository &) = delete;
+		ConcurrentRepository &operator=(ConcurrentRepository &&) = delete;
+	public:
+		explicit ConcurrentRepository(EpochDomain &domain = EpochDomain::global())
+			: m_domain(domain), m_table(new Table(initialBucketCount)), m_size(0) {}
+		// Must not be called concurrently with other operations.
+		~ConcurrentRepository() { Table::destroy(m_table.load(std::memory_order_relaxed), true); }
+
+		inline const T &get(const T &val);
+		// Lock-free. Returns nullptr if the value is not interned.
+		inline const T *find(const T &val) const;
+		inline bool remove(const T &val);
+
+		std::size_t size() const noexcept { return m_size.load(std::memory_order_relaxed); }
+		bool empty() const noexcept { return size() == 0; }
+		inline void clear();
+	private:
+		static const std::size_t initialBucketCount = 16;
+
+		struct Node
+		{
+			Node(const T * const value, const std::size_t hash) noexcept : value(value), hash(hash), next(nullptr) {}
+
+			const T * const value;
+			const std::size_t hash;
+			std::atomic<Node *> next;
+		};
+
+		struct Table
+		{
+			explicit Table(const std::size_t bucketCount)
+				: mask(bucketCount - 1), buckets(new std::atomic<Node *>[bucketCount])
+			{
+				for (std::size_t i = 0; i < bucketCount; ++i) {
+					buckets[i].store(nullptr, std::memory_order_relaxed);
+				}
+			}
+
+			std::size_t bucketCount() const noexcept { return mask + 1; }
+			std::atomic<Node *> &bucket(const std::size_t hash) noexcept { return buckets[hash & mask]; }
+
+			// Deletes the nodes linked and optionally the values they refer to.
+			static void destroy(Table * const table, const bool deleteValues) noexcept
+			{
+				for (std::size_t i = 0; i < table->bucketCount(); ++i) {
+					Node *node = table->buckets[i].load(std::memory_order_relaxed);
+					while (node != nullptr) {
+						Node * const next = node->next.load(std::memory_order_relaxed);
+						if (deleteValues) {
+							delete node->value;
+						}
+						delete node;
+						node = next;
+					}
+				}
+				delete table;
+			}
+
+			static void destroyWithValues(void * const table) { destroy(static_cast<Table *>(table), true); }
+			static void destroyWithoutValues(void * const table) { destroy(static_cast<Table *>(table), false); }
+
+			const std::size_t mask;
+			const std::unique_ptr<std::atomic<Node *>[]> buckets;
+		};
+
+		static void destroyNode(void * const p)
+		{
+			Node * const node = static_cast<Node *>(p);
+			delete node->value;
+			delete node;
+		}
+
+		const T *lookup(const T &val, std::size_t hash) const;
+		void grow();
+
+		EpochDomain &m_domain;
+		std::atomic<Table *> m_table;
+		std::atomic<std::size_t> m_size;
+		SpinLock m_writeLock;
+		Hash m_hash;
+		Equal m_equal;
+	};
+}
+
+template<typename T, typename Hash, typename Equal>
+const T *afc::ConcurrentRepository<T, Hash, Equal>::lookup(const T &val, const std::size_t hash) const
+{
+	Table &table = *m_table.load(std::memory_order_acquire);
+	for (const Node *node = table.bucket(hash).load(std::memory_order_acquire); node != nullptr;
+			node = node->next.load(std::memory_order_acquire)) {
+		if (node->hash == hash && m_equal(*node->value, val)) {
+			return node->value;
+		}
+	}
+	return nullptr;
+}
+
+template<typename T, typename Hash, typename Equal>
+const T *afc::ConcurrentRepository<T, Hash, Equal>::find(const T &val) const
+{
+	EpochGuard guard(m_domain);
+	return lookup(val, m_hash(val));
+}
+
+template<typename T, typename Hash, typename Equal>
+const T &afc::ConcurrentRepository<T, Hash, Equal>::get(const T &val)
+{
+	const std::size_t hash = m_hash(val);
+	{
+		EpochGuard guard(m_domain);
+		const T * const value = lookup(val, hash);
+		if (likely(value != nullptr)) {
+			return *value;
+		}
+	}
+
+	std::lock_guard<SpinLock> lock(m_writeLock);
+	// The value could be inserted by another writer meanwhile. Writers do not need the guard.
+	const T * const value = lookup(val, hash);
+	if (value != nullptr) {
+		return *value;
+	}
+	if (m_size.load(std::memory_order_relaxed) >= m_table.load(std::memory_order_relaxed)->bucketCount()) {
+		grow();
+	}
+	std::unique_ptr<T> entry(new T(val));
+	Node * const node = new Node(entry.get(), hash);
+	std::atomic<Node *> &bucket = m_table.load(std::memory_order_relaxed)->bucket(hash);
+	node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	bucket.store(node, std::memory_order_release);
+	m_size.fetch_add(1, std::memory_order_relaxed);
+	return *entry.release();
+}
+
+template<typename T, typename Hash, typename Equal>
+void afc::ConcurrentRepository<T, Hash, Equal>::grow()
+{
+	// Readers can traverse the old table, so its nodes are copied rather than relinked.
+	Table * const oldTable = m_table.load(std::memory_order_relaxed);
+	std::unique_ptr<Table> newTable(new Table(oldTable->bucketCount() * 2));
+	for (std::size_t i = 0; i < oldTable->bucketCount(); ++i) {
+		for (const Node *node = oldTable->buckets[i].load(std::memory_order_relaxed); node != nullptr;
+				node = node->next.load(std::memory_order_relaxed)) {
+			std::atomic<Node *> &bucket = newTable->bucket(node->hash);
+			Node * const copy = new Node(node->value, node->hash);
+			copy->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			bucket.store(copy, std::memory_order_relaxed);
+		}
+	}
+	m_table.store(newTable.release(), std::memory_order_release);
+	m_domain.retire(oldTable, Table::destroyWithoutValues);
+	/* A table is as large as all the nodes retired before it, so it is not left until the number
+	 * of objects retired reaches the collection threshold, which can never happen if nothing is removed.
+	 */
+	m_domain.collect();
+}
+
+template<typename T, typename Hash, typename Equal>
+bool afc::ConcurrentRepository<T, Hash, Equal>::remove(const T &val)
+{
+	const std::size_t hash = m_hash(val);
+	std::lock_guard<SpinLock> lock(m_writeLock);
+	std::atomic<Node *> *link = &m_table.load(std::memory_order_relaxed)->bucket(hash);
+	for (Node *node = link->load(std::memory_order_relaxed); node != nullptr; node = link->load(std::memory_order_relaxed)) {
+		if (node->hash == hash && m_equal(*node->value, val)) {
+			// Readers at the node continue the traversal through its link that is kept intact.
+			link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+			m_size.fetch_sub(1, std::memory_order_relaxed);
+			m_domain.retire(node, destroyNode);
+			return true;
+		}
+		link = &node->next;
+	}
+	return false;
+}
+
+template<typename T, typename Hash, typename Equal>
+void afc::ConcurrentRepository<T, Hash, Equal>::clear()
+{
+	std::lock_guard<SpinLock> lock(m_writeLock);
+	Table * const oldTable = m_table.load(std::memory_order_relaxed);
+	m_table.store(new Table(initialBucketCount), std::memory_order_release);
+	m_size.store(0, std::memory_order_relaxed);
+	m_domain.retire(oldTable, Table::destroyWithValues);
+	// The whole table is freed as soon as no reader can reference it, as in grow().
+	m_domain.collect();
+}
+
+#endif /*AFC_CONCURRENT_REPOSITORY_H_*/
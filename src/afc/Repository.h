@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <memory>
 #include <functional>
 
+#include "slab.h"
+
 namespace afc
 {
 	template<typename T, typename Less = std::less<T>> class Repository
@@ -34,6 +36,9 @@ namespace afc
 
 		inline const T &get(const T &val);
 		inline bool remove(const T &val);
+		// nullptr if the value is not in the repository.
+		inline const T *find(const T &val) const;
+		template<typename Visitor> void forEach(Visitor visitor) const { for (const T * const val : m_values) visitor(*val); }
 
 		const size_t size() const throw() { return m_values.size(); }
 		const bool empty() const throw() { return m_values.empty(); }
@@ -41,11 +46,13 @@ namespace afc
 	private:
 		struct RealLess
 		{
-			bool operator()(const T * const o1, const T * const o2) throw() { return less(*o1, *o2); }
+			bool operator()(const T * const o1, const T * const o2) const throw() { return less(*o1, *o2); }
 
-			Less less;
+			// Non-const comparators are allowed.
+			mutable Less less;
 		};
-		typedef std::set<const T *, RealLess> Set;
+		// Both the values and the set nodes are allocated from the slab allocator.
+		typedef std::set<const T *, RealLess, SlabAllocator<const T *>> Set;
 		Set m_values;
 	};
 }
@@ -54,7 +61,7 @@ template<typename T, typename Less> const T &afc::Repository<T, Less>::get(const
 {
 	typename Set::const_iterator p = m_values.find(&val);
 	if (p == m_values.end()) {
-		std::auto_ptr<T> entry(new T(val));
+		std::unique_ptr<T, typename ObjectPool<T>::Deleter> entry(ObjectPool<T>::create(val));
 		m_values.insert(entry.get());
 		return *entry.release();
 	} else {
@@ -68,15 +75,21 @@ template<typename T, typename Less> bool afc::Repository<T, Less>::remove(const
 	if (p == m_values.end()) {
 		return false;
 	}
-	delete *p;
+	ObjectPool<T>::destroy(*p);
 	m_values.erase(p);
 	return true;
 }
 
+template<typename T, typename Less> const T *afc::Repository<T, Less>::find(const T &val) const
+{
+	typename Set::const_iterator p = m_values.find(&val);
+	return p == m_values.end() ? nullptr : *p;
+}
+
 template<typename T, typename Less> void afc::Repository<T, Less>::clear()
 {
 	for (const T * const val : m_values) {
-		delete val;
+		ObjectPool<T>::destroy(val);
 	}
 	m_values.clear();
 }
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "platform.h"
 #include "_demangle.h"
+#include "slab.h"
 
 // TODO remove
 #include <iostream>
@@ -47,6 +48,7 @@ using std::free;
 using std::strlen;
 using std::map;
 using std::auto_ptr;
+using std::unique_ptr;
 using std::endl;
 using std::pair;
 using std::ios_base;
@@ -99,11 +101,11 @@ namespace afc
 		backtraceSymbols(rawStackTrace, actualDepth, symbols);
 		for (size_t i = 0; i < actualDepth; ++i) {
 			const AddrStatus elem = symbols[i];
-			auto_ptr<StackTraceElement> entry;
+			unique_ptr<StackTraceElement, ObjectPool<StackTraceElement>::Deleter> entry;
 			if (elem.success) {
-				entry.reset(new StackTraceElement(elem.functionName, rawStackTrace[i], 0, elem.fileName, elem.line));
+				entry.reset(ObjectPool<StackTraceElement>::create(elem.functionName, rawStackTrace[i], 0, elem.fileName, elem.line));
 			} else {
-				entry.reset(new StackTraceElement("", rawStackTrace[i], 0, 0, StackTraceElement::NO_LINE));
+				entry.reset(ObjectPool<StackTraceElement>::create("", rawStackTrace[i], 0, nullptr, StackTraceElement::NO_LINE));
 			}
 			m_elements.push_back(entry.get());
 			entry.release();
@@ -116,9 +118,7 @@ namespace afc
 
 	StackTrace::~StackTrace(void) throw()
 	{
-		for (size_t i = 0, n = m_elements.size(); i < n; ++i) {
-			delete m_elements[i];
-		}
+		ObjectPool<StackTraceElement>::destroy(m_elements.data(), m_elements.size());
 	}
 
 	void StackTrace::print(ostream &out, const char * const linePrefix) const
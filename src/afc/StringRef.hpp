@@ -21,11 +21,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 namespace afc
 {
+	class ConstStringRef;
+
+	/* Refers to a character sequence that is not a string literal (e.g. a part of a parsed URL).
+	 * The characters must outlive the reference.
+	 */
+	constexpr ConstStringRef stringRef(const char *str, std::size_t size) noexcept;
+
 	// Allows for efficient processing of string literals by resolving their size at compile time.
 	class ConstStringRef
 	{
 	private:
 		friend constexpr ConstStringRef operator"" _s(const char *, std::size_t) noexcept;
+		friend constexpr ConstStringRef stringRef(const char *, std::size_t) noexcept;
 
 		constexpr ConstStringRef(const char * const str, const std::size_t size) noexcept : m_str(str), m_size(size) {}
 	public:
@@ -51,6 +59,8 @@ namespace afc
 
 	constexpr ConstStringRef operator"" _s(const char * const str, const std::size_t n) noexcept { return ConstStringRef(str, n); };
 
+	constexpr ConstStringRef stringRef(const char * const str, const std::size_t size) noexcept { return ConstStringRef(str, size); }
+
 	template<typename Iterator>
 	inline Iterator copy(ConstStringRef s, Iterator dest) { return std::copy_n(s.value(), s.size(), dest); }
 }
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <cstddef>
 #include <type_traits>
 #include <utility>
+#include "ascii.hpp"
 #include "platform.h"
 #ifdef AFC_EXCEPTIONS_ENABLED
 	#include "Exception.h"
@@ -28,6 +29,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 namespace afc
 {
+	namespace _impl
+	{
+		template<typename Iterator, typename CharType>
+		inline Iterator findDelimiter(Iterator begin, Iterator end, const CharType &delimiter)
+		{
+			return std::find(begin, end, delimiter);
+		}
+
+		// Character sequences in memory are scanned sixteen characters at once.
+		inline const char *findDelimiter(const char * const begin, const char * const end, const char delimiter) noexcept
+		{
+			return afc::ascii::find(begin, end, delimiter);
+		}
+
+		inline char *findDelimiter(char * const begin, char * const end, const char delimiter) noexcept
+		{
+			return const_cast<char *>(afc::ascii::find(begin, end, delimiter));
+		}
+	}
+
 	template<typename CharType, typename Iterator>
 	class Tokeniser
 	{
@@ -66,7 +87,7 @@ inline std::pair<Iterator, Iterator> afc::Tokeniser<CharType, Iterator>::next()
 	// Trying to keep all variables be read from memory once.
 	register Iterator p = m_curr;
 	register Iterator q = m_end;
-	register Iterator r = std::find(p, q, m_delimiter);
+	register Iterator r = _impl::findDelimiter(p, q, m_delimiter);
 	std::pair<Iterator, Iterator> result(p, r);
 	if (r != q) {
 		m_curr = ++r;
@@ -89,7 +110,7 @@ inline void afc::Tokeniser<CharType, Iterator>::next(Iterator &begin, Iterator &
 	register Iterator p = m_curr;
 	register Iterator q = m_end;
 	begin = p;
-	end = p = std::find(p, q, m_delimiter);
+	end = p = _impl::findDelimiter(p, q, m_delimiter);
 	if (p != q) {
 		m_curr = ++p;
 	} else {
@@ -106,7 +127,7 @@ inline void afc::Tokeniser<CharType, Iterator>::skip()
 	}
 #endif
 
-	m_curr = std::find(m_curr, m_end, m_delimiter);
+	m_curr = _impl::findDelimiter(m_curr, m_end, m_delimiter);
 	if (m_curr != m_end) {
 		++m_curr;
 	}
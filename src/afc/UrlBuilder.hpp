@@ -20,11 +20,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <memory>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <afc/ensure_ascii.hpp>
 #include <cstddef>
+#include <cstdint>
 
+#include "ascii.hpp"
 #include "StringRef.hpp"
 #include "FastStringBuffer.hpp"
 #include "number.h"
@@ -312,15 +316,156 @@ namespace afc
 			QueryState m_queryState;
 		};
 
+		/* Builds many URLs that share the URL base and the leading (common) query parameters,
+		 * e.g. pages of a paginated API. The base and the common parameters are encoded once;
+		 * each add() only encodes its own parameters and copies the encoded prefix.
+		 *
+		 * URLs are stored contiguously and null-terminated in blocks of an arena owned by the
+		 * builder. The references returned stay valid until clear() or the builder is destroyed.
+		 */
+		class UrlBatchBuilder
+		{
+		private:
+			UrlBatchBuilder(const UrlBatchBuilder &) = delete;
+			UrlBatchBuilder &operator=(const UrlBatchBuilder &) = delete;
+		public:
+			template<typename... Parts>
+			explicit UrlBatchBuilder(const afc::ConstStringRef urlBase, Parts &&...commonParamParts)
+					: UrlBatchBuilder(urlBase.value(), urlBase.size(), std::forward<Parts>(commonParamParts)...) {}
+
+			template<typename... Parts>
+			UrlBatchBuilder(const char * const urlBase, const std::size_t n, Parts &&...commonParamParts)
+					: m_prefix(urlBase, n, std::forward<Parts>(commonParamParts)...), m_hasQuery(sizeof...(Parts) > 0),
+					  m_blockIndex(0), m_current(nullptr), m_currentEnd(nullptr), m_urlCount(0) {}
+
+			UrlBatchBuilder(UrlBatchBuilder &&) = default;
+			~UrlBatchBuilder() = default;
+
+			UrlBatchBuilder &operator=(UrlBatchBuilder &&) = default;
+
+			// Builds a URL with the varying parameters given (name/value parts) appended.
+			template<typename... Parts>
+			afc::ConstStringRef add(Parts &&...paramParts)
+			{
+				static_assert((sizeof...(Parts) % 2) == 0,
+						"The number of URL parameter parts must be even for the web-form query.");
+
+				// One of {'?', '&', '='} per part plus the C-string terminator.
+				const std::size_t maxSize = m_prefix.size() + maxEncodedSize(paramParts...) + sizeof...(Parts) + 1;
+				char * const begin = allocate(maxSize);
+				char *p = std::copy_n(m_prefix.data(), m_prefix.size(), begin);
+				p = appendParamName(p, m_hasQuery ? '&' : '?', paramParts...);
+				*p = '\0';
+				m_current = p + 1;
+				++m_urlCount;
+				return afc::stringRef(begin, static_cast<std::size_t>(p - begin));
+			}
+
+			// The encoded URL base and common parameters.
+			afc::ConstStringRef prefix() const noexcept { return afc::stringRef(m_prefix.data(), m_prefix.size()); }
+			std::size_t urlCount() const noexcept { return m_urlCount; }
+
+			// Invalidates the URLs built so far. The memory of the arena is kept for the next batch.
+			void clear() noexcept
+			{
+				m_blockIndex = 0;
+				if (m_blocks.empty()) {
+					m_current = m_currentEnd = nullptr;
+				} else {
+					m_current = m_blocks[0].data.get();
+					m_currentEnd = m_current + m_blocks[0].size;
+				}
+				m_urlCount = 0;
+			}
+		private:
+			struct Block
+			{
+				std::unique_ptr<char[]> data;
+				std::size_t size;
+			};
+
+			/* Many batches consist of hundreds of URLs that are shorter than 128 characters.
+			 *
+			 * This function emulates normal inlinable constants.
+			 */
+			static constexpr std::size_t defaultBlockSize() { return 64 * 1024; }
+
+			static constexpr std::size_t maxEncodedSize() noexcept { return 0; }
+
+			template<typename Part, typename... Parts>
+			static constexpr std::size_t maxEncodedSize(const Part &part, const Parts &...parts) noexcept
+			{
+				return part.maxEncodedSize() + maxEncodedSize(parts...);
+			}
+
+			static char *appendParamName(char * const dest, char) noexcept { return dest; }
+
+			template<typename ParamName, typename ParamValue, typename... Parts>
+			static char *appendParamName(char *dest, const char separator, const ParamName &name, const ParamValue &value,
+					const Parts &...parts) noexcept
+			{
+				*dest++ = separator;
+				dest = name.appendTo(dest);
+				*dest++ = '=';
+				dest = value.appendTo(dest);
+				return appendParamName(dest, '&', parts...);
+			}
+
+			char *allocate(const std::size_t n)
+			{
+				if (likely(static_cast<std::size_t>(m_currentEnd - m_current) >= n)) {
+					return m_current;
+				}
+				// Blocks left from the previous batches are reused first.
+				while (m_blockIndex + 1 < m_blocks.size()) {
+					const Block &block = m_blocks[++m_blockIndex];
+					if (block.size >= n) {
+						m_current = block.data.get();
+						m_currentEnd = m_current + block.size;
+						return m_current;
+					}
+				}
+				const std::size_t size = std::max(defaultBlockSize(), n);
+				m_blocks.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+				m_blockIndex = m_blocks.size() - 1;
+				m_current = m_blocks.back().data.get();
+				m_currentEnd = m_current + size;
+				return m_current;
+			}
+
+			UrlBuilder<webForm> m_prefix;
+			bool m_hasQuery;
+			std::vector<Block> m_blocks;
+			std::size_t m_blockIndex;
+			char *m_current;
+			char *m_currentEnd;
+			std::size_t m_urlCount;
+		};
+
 		template<typename Iterator>
 		Iterator appendUrlEncoded(const char * const src, const std::size_t n, Iterator dest)
 		{
-			if (n == 0) {
-				return dest;
+			std::size_t i = 0;
+			// Runs of unreserved characters are copied as a whole.
+			while (n - i >= 16) {
+				const std::uint32_t unreserved = afc::ascii::classify16<afc::ascii::urlUnreserved>(src + i);
+				if (unreserved == 0xffff) {
+					dest = std::copy_n(src + i, 16, dest);
+					i += 16;
+					continue;
+				}
+				const unsigned runSize = static_cast<unsigned>(__builtin_ctz(~unreserved));
+				dest = std::copy_n(src + i, runSize, dest);
+				i += runSize;
+
+				char c[3];
+				c[0] = '%';
+				afc::octetToHex(static_cast<unsigned char>(src[i]) & 0xff, &c[1]);
+				dest = std::copy_n(c, 3, dest);
+				++i;
 			}
 
-			std::size_t i = 0;
-			do {
+			for (; i < n; ++i) {
 				const char c = src[i];
 
 				/* Casting to unsigned since bitwise operators are defined well for them
@@ -330,8 +475,7 @@ namespace afc
 				 */
 				const unsigned char uc = static_cast<unsigned char>(c) & 0xff;
 
-				if ((uc >= 'A' && uc <= 'Z') || (uc >= 'a' && uc <= 'z') || (uc >= '0' && uc <= '9') ||
-						uc == '-' || uc == '_' || uc == '.') {
+				if (afc::ascii::is<afc::ascii::urlUnreserved>(uc)) {
 					// An unreserved character. No escaping is needed.
 					*dest++ = c;
 				} else {
@@ -342,7 +486,7 @@ namespace afc
 					afc::octetToHex(uc, &c[1]);
 					dest = std::copy_n(c, 3, dest);
 				}
-			} while (++i < n);
+			}
 
 			return dest;
 		}
@@ -0,0 +1,281 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_URLPARSER_HPP_
+#define AFC_URLPARSER_HPP_
+
+#include <cstddef>
+#include <cstring>
+
+#include "ascii.hpp"
+#include "builtin.hpp"
+#include "number.h"
+#include "StringRef.hpp"
+
+namespace afc
+{
+	namespace url
+	{
+		/* Parts of a URL (RFC 3986) that refer to the characters of the URL itself.
+		 * Nothing is copied or decoded; the URL must outlive its view.
+		 */
+		class UrlView
+		{
+			template<typename ErrorHandler>
+			friend const char *parseUrl(const char *, const char *, UrlView &, ErrorHandler);
+		public:
+			UrlView() noexcept { clear(); }
+
+			ConstStringRef scheme() const noexcept { return m_scheme.ref(); }
+			// userInfo@host:port
+			ConstStringRef authority() const noexcept { return m_authority.ref(); }
+			ConstStringRef userInfo() const noexcept { return m_userInfo.ref(); }
+			// IPv6 addresses are returned with the enclosing brackets.
+			ConstStringRef host() const noexcept { return m_host.ref(); }
+			ConstStringRef port() const noexcept { return m_port.ref(); }
+			ConstStringRef path() const noexcept { return m_path.ref(); }
+			// Without the leading '?'.
+			ConstStringRef query() const noexcept { return m_query.ref(); }
+			// Without the leading '#'.
+			ConstStringRef fragment() const noexcept { return m_fragment.ref(); }
+
+			bool hasScheme() const noexcept { return m_scheme.defined(); }
+			bool hasAuthority() const noexcept { return m_authority.defined(); }
+			bool hasUserInfo() const noexcept { return m_userInfo.defined(); }
+			bool hasPort() const noexcept { return m_port.size != 0; }
+			// True for 'path?' with the empty query as well.
+			bool hasQuery() const noexcept { return m_query.defined(); }
+			bool hasFragment() const noexcept { return m_fragment.defined(); }
+
+			// -1 if there is no port.
+			int portNumber() const noexcept { return m_portNumber; }
+		private:
+			struct Part
+			{
+				const char *data;
+				std::size_t size;
+
+				bool defined() const noexcept { return data != nullptr; }
+				ConstStringRef ref() const noexcept { return afc::stringRef(data == nullptr ? "" : data, size); }
+				void set(const char * const begin, const char * const end) noexcept { data = begin; size = end - begin; }
+			};
+
+			void clear() noexcept
+			{
+				m_scheme = m_authority = m_userInfo = m_host = m_port = m_path = m_query = m_fragment = Part{nullptr, 0};
+				m_portNumber = -1;
+			}
+
+			Part m_scheme;
+			Part m_authority;
+			Part m_userInfo;
+			Part m_host;
+			Part m_port;
+			Part m_path;
+			Part m_query;
+			Part m_fragment;
+			int m_portNumber;
+		};
+
+		/* Splits the URL [begin, end) into its parts. Both absolute URLs and relative references
+		 * (e.g. '/path?query' in HTTP request lines) are accepted.
+		 *
+		 * The characters are not validated except for the port and IPv6 host brackets. In case
+		 * of a malformed URL errorHandler(const char *position) is invoked, dest is left empty, and
+		 * the position is returned. Otherwise end is returned.
+		 */
+		template<typename ErrorHandler>
+		const char *parseUrl(const char *begin, const char *end, UrlView &dest, ErrorHandler errorHandler);
+
+		/* Writes [begin, end) to dest with the %XX sequences decoded. '+' is decoded as space if
+		 * plusAsSpace is true (as in HTML form data). Malformed %-sequences are copied as is.
+		 *
+		 * dest must have space for end - begin characters. Returns the end of the decoded characters.
+		 */
+		inline char *percentDecode(const char *begin, const char *end, char *dest, bool plusAsSpace = true) noexcept;
+
+		struct QueryParameter
+		{
+			// Both are not decoded.
+			ConstStringRef name;
+			ConstStringRef value;
+			// False for 'name' and true for 'name=' and 'name=value'.
+			bool hasValue;
+
+			// dest must have space for name.size() characters.
+			char *decodeName(char * const dest) const noexcept { return percentDecode(name.begin(), name.end(), dest); }
+			// dest must have space for value.size() characters.
+			char *decodeValue(char * const dest) const noexcept { return percentDecode(value.begin(), value.end(), dest); }
+		};
+
+		/* Iterates over 'name=value' pairs of a query string delimited with '&'. Empty pairs are skipped.
+		 * Parameters are split lazily by each call to next(); nothing is decoded unless requested.
+		 */
+		class QueryParser
+		{
+		public:
+			explicit QueryParser(const ConstStringRef query) noexcept
+					: QueryParser(query.begin(), query.end()) {}
+			QueryParser(const char * const begin, const char * const end) noexcept
+					: m_curr(skipDelimiters(begin, end)), m_end(end) {}
+
+			bool hasNext() const noexcept { return m_curr != m_end; }
+			// Must be called only if hasNext() returns true.
+			QueryParameter next() noexcept;
+		private:
+			static const char *skipDelimiters(const char *p, const char * const end) noexcept
+			{
+				for (; p != end && *p == '&'; ++p) {}
+				return p;
+			}
+
+			const char *m_curr;
+			const char * const m_end;
+		};
+	}
+}
+
+template<typename ErrorHandler>
+const char *afc::url::parseUrl(const char * const begin, const char * const end, UrlView &dest, ErrorHandler errorHandler)
+{
+	using namespace afc::ascii;
+
+	dest.clear();
+	const char *p = begin;
+
+	// scheme = ALPHA *( ALPHA / DIGIT / "+" / "-" / "." ) ":"
+	if (p != end && is<alpha>(*p)) {
+		const char *q = p + 1;
+		for (; q != end && (is<alpha | digit>(*q) || *q == '+' || *q == '-' || *q == '.'); ++q) {}
+		if (q != end && *q == ':') {
+			dest.m_scheme.set(p, q);
+			p = q + 1;
+		}
+	}
+
+	if (end - p >= 2 && p[0] == '/' && p[1] == '/') {
+		const char * const authorityBegin = p + 2;
+		const char * const authorityEnd = findAnyOf<'/', '?', '#'>(authorityBegin, end);
+		dest.m_authority.set(authorityBegin, authorityEnd);
+
+		const char *hostBegin = authorityBegin;
+		const char * const at = static_cast<const char *>(
+				::memrchr(authorityBegin, '@', static_cast<std::size_t>(authorityEnd - authorityBegin)));
+		if (at != nullptr) {
+			dest.m_userInfo.set(authorityBegin, at);
+			hostBegin = at + 1;
+		}
+
+		const char *hostEnd;
+		if (hostBegin != authorityEnd && *hostBegin == '[') {
+			hostEnd = find(hostBegin, authorityEnd, ']');
+			if (unlikely(hostEnd == authorityEnd)) {
+				dest.clear();
+				errorHandler(hostEnd);
+				return hostEnd;
+			}
+			++hostEnd;
+			if (unlikely(hostEnd != authorityEnd && *hostEnd != ':')) {
+				dest.clear();
+				errorHandler(hostEnd);
+				return hostEnd;
+			}
+		} else {
+			hostEnd = find(hostBegin, authorityEnd, ':');
+		}
+		dest.m_host.set(hostBegin, hostEnd);
+
+		// An empty port is allowed by RFC 3986 and is equivalent to no port.
+		if (hostEnd != authorityEnd && hostEnd + 1 != authorityEnd) {
+			const char * const portBegin = hostEnd + 1;
+			unsigned port = 0;
+			for (const char *q = portBegin; q != authorityEnd; ++q) {
+				if (unlikely(!is<digit>(*q))) {
+					dest.clear();
+					errorHandler(q);
+					return q;
+				}
+				port = port * 10 + static_cast<unsigned>(*q - '0');
+				if (unlikely(port > 65535)) {
+					dest.clear();
+					errorHandler(q);
+					return q;
+				}
+			}
+			dest.m_port.set(portBegin, authorityEnd);
+			dest.m_portNumber = static_cast<int>(port);
+		}
+		p = authorityEnd;
+	}
+
+	const char * const pathEnd = findAnyOf<'?', '#'>(p, end);
+	dest.m_path.set(p, pathEnd);
+	p = pathEnd;
+
+	if (p != end && *p == '?') {
+		const char * const queryEnd = find(p + 1, end, '#');
+		dest.m_query.set(p + 1, queryEnd);
+		p = queryEnd;
+	}
+	if (p != end) {
+		// *p == '#'
+		dest.m_fragment.set(p + 1, end);
+	}
+	return end;
+}
+
+inline char *afc::url::percentDecode(const char *begin, const char * const end, char *dest, const bool plusAsSpace) noexcept
+{
+	for (;;) {
+		const char * const special = plusAsSpace ? afc::ascii::findAnyOf<'%', '+'>(begin, end) :
+				afc::ascii::find(begin, end, '%');
+		const std::size_t n = static_cast<std::size_t>(special - begin);
+		std::memcpy(dest, begin, n);
+		dest += n;
+		if (special == end) {
+			return dest;
+		}
+		if (*special == '+') {
+			*dest++ = ' ';
+			begin = special + 1;
+			continue;
+		}
+		if (end - special >= 3) {
+			const unsigned char hi = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(special[1])];
+			const unsigned char lo = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(special[2])];
+			if (likely(hi < 16 && lo < 16)) {
+				*dest++ = static_cast<char>((hi << 4) | lo);
+				begin = special + 3;
+				continue;
+			}
+		}
+		// A malformed %-sequence.
+		*dest++ = '%';
+		begin = special + 1;
+	}
+}
+
+inline afc::url::QueryParameter afc::url::QueryParser::next() noexcept
+{
+	const char * const pairEnd = afc::ascii::find(m_curr, m_end, '&');
+	const char * const eq = afc::ascii::find(m_curr, pairEnd, '=');
+	const bool hasValue = eq != pairEnd;
+	QueryParameter result{afc::stringRef(m_curr, static_cast<std::size_t>(eq - m_curr)),
+			hasValue ? afc::stringRef(eq + 1, static_cast<std::size_t>(pairEnd - eq - 1)) : ""_s, hasValue};
+	m_curr = skipDelimiters(pairEnd, m_end);
+	return result;
+}
+
+#endif /* AFC_URLPARSER_HPP_ */
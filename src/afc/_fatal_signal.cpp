@@ -0,0 +1,142 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "_fatal_signal.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+
+// POSIX and GNU API.
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Exception.h"
+#include "StringRef.hpp"
+
+using namespace afc;
+using namespace std;
+
+using afc::_impl::FatalSignalCallback;
+
+namespace
+{
+	const int fatalSignals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+	const size_t fatalSignalCount = sizeof(fatalSignals) / sizeof(fatalSignals[0]);
+	const size_t maxCallbacks = 8;
+
+	// Guards the registration of callbacks; the handler reads the callbacks without it.
+	mutex registrationLock;
+	atomic<FatalSignalCallback> callbacks[maxCallbacks];
+	size_t callbackCount = 0;
+	// The actions that were installed before the handler.
+	struct sigaction previousActions[fatalSignalCount];
+	// The thread that runs the callbacks.
+	atomic<pid_t> crashingThread(0);
+
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	void restorePreviousActions() noexcept
+	{
+		for (size_t i = 0; i < fatalSignalCount; ++i) {
+			::sigaction(fatalSignals[i], &previousActions[i], nullptr);
+		}
+	}
+
+	void handleFatalSignal(const int sig, siginfo_t * const info, void *)
+	{
+		const int savedErrno = errno;
+		const pid_t thread = static_cast<pid_t>(::syscall(SYS_gettid));
+		pid_t crashing = 0;
+		if (crashingThread.compare_exchange_strong(crashing, thread)) {
+			for (size_t i = 0; i < maxCallbacks; ++i) {
+				const FatalSignalCallback callback = callbacks[i].load();
+				if (callback == nullptr) {
+					break;
+				}
+				callback(sig, info);
+			}
+		} else if (crashing != thread) {
+			// The other crashing threads wait for the process to be terminated.
+			for (;;) {
+				::pause();
+			}
+		}
+		errno = savedErrno;
+
+		/* The previous action gets the signal when the handler returns since the signal
+		 * is blocked while it is handled.
+		 */
+		for (size_t i = 0; i < fatalSignalCount; ++i) {
+			if (fatalSignals[i] == sig) {
+				::sigaction(sig, &previousActions[i], nullptr);
+			}
+		}
+		::raise(sig);
+	}
+}
+
+void afc::_impl::addFatalSignalCallback(const FatalSignalCallback callback)
+{
+	lock_guard<mutex> lock(registrationLock);
+	for (size_t i = 0; i < callbackCount; ++i) {
+		if (callbacks[i].load(memory_order_relaxed) == callback) {
+			return;
+		}
+	}
+	if (callbackCount == maxCallbacks) {
+		throwException("too many fatal signal callbacks"_s);
+	}
+
+	if (callbackCount == 0) {
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_sigaction = handleFatalSignal;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+		for (size_t i = 0; i < fatalSignalCount; ++i) {
+			if (::sigaction(fatalSignals[i], &action, &previousActions[i]) == -1) {
+				// The signals the handler is installed for get their previous actions back.
+				for (size_t j = 0; j < i; ++j) {
+					::sigaction(fatalSignals[j], &previousActions[j], nullptr);
+				}
+				throwException("unable to install the fatal signal handler"_s);
+			}
+		}
+	}
+	callbacks[callbackCount++].store(callback);
+}
+
+void afc::_impl::removeFatalSignalCallback(const FatalSignalCallback callback) noexcept
+{
+	lock_guard<mutex> lock(registrationLock);
+	for (size_t i = 0; i < callbackCount; ++i) {
+		if (callbacks[i].load(memory_order_relaxed) == callback) {
+			for (size_t j = i + 1; j < callbackCount; ++j) {
+				callbacks[j - 1].store(callbacks[j].load(memory_order_relaxed));
+			}
+			callbacks[--callbackCount].store(nullptr);
+			if (callbackCount == 0) {
+				restorePreviousActions();
+			}
+			return;
+		}
+	}
+}
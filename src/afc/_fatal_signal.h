@@ -0,0 +1,46 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC__FATAL_SIGNAL_H_
+#define AFC__FATAL_SIGNAL_H_
+
+#include <csignal>
+
+namespace afc
+{
+	namespace _impl
+	{
+		// Is called from within the signal handler, so it should be async-signal-safe.
+		typedef void (*FatalSignalCallback)(int sig, siginfo_t *info);
+
+		/* Registers the callback to be run on SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT. The handler
+		 * of these signals is installed when the first callback is registered; it runs on the alternate
+		 * signal stack of the thread, if any. It runs the callbacks in the order they are registered
+		 * and then re-raises the signal with the action that was installed before the handler
+		 * (the default action if there was none), so other crash handlers still run.
+		 *
+		 * Only the first crashing thread runs the callbacks. A fatal signal raised by a callback
+		 * goes to the previous action straight away.
+		 *
+		 * Registering the callback again has no effect.
+		 */
+		void addFatalSignalCallback(FatalSignalCallback callback);
+
+		// The actions that were installed before the handler are restored when no callback is left.
+		void removeFatalSignalCallback(FatalSignalCallback callback) noexcept;
+	}
+}
+
+#endif /*AFC__FATAL_SIGNAL_H_*/
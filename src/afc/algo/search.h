@@ -16,10 +16,29 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #ifndef AFC_SEARCH_H_
 #define AFC_SEARCH_H_
 
+#include <cstddef>
 #include <vector>
 
 namespace afc
 {
+	// The number of states the search algorithms pass to SearchSpace::values() at once.
+	const std::size_t searchBatchSize = 64;
+
+	/* States in the struct-of-arrays layout: the coordinates of all the states along a dimension
+	 * are contiguous, so that an objective can evaluate several states at once with SIMD.
+	 */
+	template<typename T> struct StateBatch
+	{
+		// The coordinate d of the state i is coordinates[d * stride + i].
+		const T *coordinates;
+		std::size_t stride;
+		// The number of states.
+		std::size_t size;
+
+		const T *dimension(const unsigned d) const throw() { return coordinates + d * stride; }
+		T operator()(const std::size_t state, const unsigned d) const throw() { return dimension(d)[state]; }
+	};
+
 	template<typename T, typename F> struct SearchSpace
 	{
 		virtual ~SearchSpace() {};
@@ -29,6 +48,11 @@ namespace afc
 		virtual T upperBound(const unsigned dimension) const throw() = 0;
 
 		virtual F value(const std::vector<T> &state) const throw() = 0;
+
+		/* Sets result[i] to the value of the state i of the batch. The default implementation
+		 * calls value() for each state; objectives override it to evaluate the batch at once.
+		 */
+		virtual void values(const StateBatch<T> &states, F *result) const;
 	};
 
 	template<typename T, typename F> struct SearchAlgorithm
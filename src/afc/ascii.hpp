@@ -0,0 +1,322 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_ASCII_HPP_
+#define AFC_ASCII_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+	#include <immintrin.h>
+#endif
+
+#include "builtin.hpp"
+
+namespace afc
+{
+namespace ascii
+{
+	/* Character classes of ASCII characters. Octets 0x80-0xff belong to none of them.
+	 * The classification does not depend on the current locale.
+	 */
+	enum CharClass : unsigned
+	{
+		// ' ', '\t', '\n', '\v', '\f', '\r' (as std::isspace() in the "C" locale).
+		space = 1,
+		digit = 1 << 1,
+		hexDigit = 1 << 2,
+		alpha = 1 << 3,
+		/* Characters that are not percent-encoded by UrlBuilder: alphanumeric ones, '-', '_' and '.'.
+		 * Note that '~' is not included even though RFC 3986 treats it as unreserved.
+		 */
+		urlUnreserved = 1 << 4,
+		// '{', '}', '[', ']', ':' and ','.
+		jsonStructural = 1 << 5,
+		// Characters that must be escaped within JSON string literals: '"', '\\' and control ones.
+		jsonEscaped = 1 << 6
+	};
+
+	namespace _impl
+	{
+		constexpr bool inRange(const unsigned c, const char lo, const char hi) noexcept
+		{
+			return c >= static_cast<unsigned char>(lo) && c <= static_cast<unsigned char>(hi);
+		}
+
+		constexpr unsigned char classOf(const unsigned c) noexcept
+		{
+			return static_cast<unsigned char>(
+					(c == ' ' || inRange(c, '\t', '\r') ? unsigned(space) : 0u) |
+					(inRange(c, '0', '9') ? unsigned(digit | hexDigit | urlUnreserved) : 0u) |
+					(inRange(c, 'a', 'f') || inRange(c, 'A', 'F') ? unsigned(hexDigit) : 0u) |
+					(inRange(c, 'a', 'z') || inRange(c, 'A', 'Z') ? unsigned(alpha | urlUnreserved) : 0u) |
+					(c == '-' || c == '_' || c == '.' ? unsigned(urlUnreserved) : 0u) |
+					(c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',' ? unsigned(jsonStructural) : 0u) |
+					(c < 0x20 || c == '"' || c == '\\' ? unsigned(jsonEscaped) : 0u));
+		}
+	}
+
+	template<typename T = void>
+	struct asciidata
+	{
+		// Bitwise OR of CharClass values for each octet.
+		static const unsigned char classTable[256];
+	};
+
+	inline unsigned classesOf(const unsigned char c) noexcept { return asciidata<>::classTable[c]; }
+
+	template<unsigned classes>
+	inline bool is(const char c) noexcept
+	{
+		return (asciidata<>::classTable[static_cast<unsigned char>(c)] & classes) != 0;
+	}
+
+	namespace _impl
+	{
+#ifdef __SSE2__
+		struct SSE2
+		{
+			typedef __m128i Vector;
+			static const std::size_t width = 16;
+
+			static Vector load(const char * const p) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+			static Vector broadcast(const char c) noexcept { return _mm_set1_epi8(c); }
+			static Vector eq(const Vector a, const Vector b) noexcept { return _mm_cmpeq_epi8(a, b); }
+			static Vector or_(const Vector a, const Vector b) noexcept { return _mm_or_si128(a, b); }
+			static Vector sub(const Vector a, const Vector b) noexcept { return _mm_sub_epi8(a, b); }
+			static Vector minU(const Vector a, const Vector b) noexcept { return _mm_min_epu8(a, b); }
+			static std::uint32_t mask(const Vector v) noexcept { return static_cast<std::uint32_t>(_mm_movemask_epi8(v)); }
+		};
+#endif
+#ifdef __AVX2__
+		struct AVX2
+		{
+			typedef __m256i Vector;
+			static const std::size_t width = 32;
+
+			static Vector load(const char * const p) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+			static Vector broadcast(const char c) noexcept { return _mm256_set1_epi8(c); }
+			static Vector eq(const Vector a, const Vector b) noexcept { return _mm256_cmpeq_epi8(a, b); }
+			static Vector or_(const Vector a, const Vector b) noexcept { return _mm256_or_si256(a, b); }
+			static Vector sub(const Vector a, const Vector b) noexcept { return _mm256_sub_epi8(a, b); }
+			static Vector minU(const Vector a, const Vector b) noexcept { return _mm256_min_epu8(a, b); }
+			static std::uint32_t mask(const Vector v) noexcept { return static_cast<std::uint32_t>(_mm256_movemask_epi8(v)); }
+		};
+#endif
+
+		// All bits of an octet are set if lo <= c <= hi (unsigned comparison).
+		template<typename Simd>
+		inline typename Simd::Vector inRange(const typename Simd::Vector chars, const char lo, const char hi) noexcept
+		{
+			const typename Simd::Vector offset = Simd::sub(chars, Simd::broadcast(lo));
+			return Simd::eq(Simd::minU(offset, Simd::broadcast(static_cast<char>(hi - lo))), offset);
+		}
+
+		template<typename Simd>
+		inline typename Simd::Vector equals(const typename Simd::Vector chars, const char c) noexcept
+		{
+			return Simd::eq(chars, Simd::broadcast(c));
+		}
+
+		// The branches are resolved at compile time.
+		template<typename Simd, unsigned classes>
+		inline std::uint32_t classify(const char * const p) noexcept
+		{
+			typedef typename Simd::Vector Vector;
+			const Vector chars = Simd::load(p);
+			const Vector lowerCase = Simd::or_(chars, Simd::broadcast(0x20));
+			Vector result = Simd::broadcast(0);
+			if (classes & space) {
+				result = Simd::or_(result, Simd::or_(equals<Simd>(chars, ' '), inRange<Simd>(chars, '\t', '\r')));
+			}
+			if (classes & (digit | hexDigit | urlUnreserved)) {
+				result = Simd::or_(result, inRange<Simd>(chars, '0', '9'));
+			}
+			if (classes & hexDigit) {
+				result = Simd::or_(result, inRange<Simd>(lowerCase, 'a', 'f'));
+			}
+			if (classes & (alpha | urlUnreserved)) {
+				result = Simd::or_(result, inRange<Simd>(lowerCase, 'a', 'z'));
+			}
+			if (classes & urlUnreserved) {
+				result = Simd::or_(result, Simd::or_(equals<Simd>(chars, '-'),
+						Simd::or_(equals<Simd>(chars, '_'), equals<Simd>(chars, '.'))));
+			}
+			if (classes & jsonStructural) {
+				// '[' | 0x20 == '{' and ']' | 0x20 == '}'.
+				result = Simd::or_(result, Simd::or_(Simd::or_(equals<Simd>(lowerCase, '{'), equals<Simd>(lowerCase, '}')),
+						Simd::or_(equals<Simd>(chars, ':'), equals<Simd>(chars, ','))));
+			}
+			if (classes & jsonEscaped) {
+				result = Simd::or_(result, Simd::or_(inRange<Simd>(chars, '\0', '\x1f'),
+						Simd::or_(equals<Simd>(chars, '"'), equals<Simd>(chars, '\\'))));
+			}
+			return Simd::mask(result);
+		}
+
+		template<char c>
+		constexpr bool isAnyOf(const char x) noexcept { return x == c; }
+
+		template<char c1, char c2, char... rest>
+		constexpr bool isAnyOf(const char x) noexcept { return x == c1 || isAnyOf<c2, rest...>(x); }
+
+#ifdef __SSE2__
+		template<typename Simd, char c>
+		inline typename Simd::Vector equalsAnyOf(const typename Simd::Vector chars) noexcept
+		{
+			return equals<Simd>(chars, c);
+		}
+
+		template<typename Simd, char c1, char c2, char... rest>
+		inline typename Simd::Vector equalsAnyOf(const typename Simd::Vector chars) noexcept
+		{
+			return Simd::or_(equals<Simd>(chars, c1), equalsAnyOf<Simd, c2, rest...>(chars));
+		}
+
+	#ifdef __AVX2__
+		typedef AVX2 WidestSimd;
+	#else
+		typedef SSE2 WidestSimd;
+	#endif
+#endif
+
+		template<unsigned classes>
+		inline std::uint32_t classifyScalar(const char * const p, const std::size_t n) noexcept
+		{
+			std::uint32_t result = 0;
+			for (std::size_t i = 0; i < n; ++i) {
+				result |= static_cast<std::uint32_t>(is<classes>(p[i])) << i;
+			}
+			return result;
+		}
+	}
+
+	/* Returns the bitmask where bit i is set if p[i] belongs to any of the classes given,
+	 * for the sixteen characters starting at p.
+	 */
+	template<unsigned classes>
+	inline std::uint32_t classify16(const char * const p) noexcept
+	{
+#ifdef __SSE2__
+		return _impl::classify<_impl::SSE2, classes>(p);
+#else
+		return _impl::classifyScalar<classes>(p, 16);
+#endif
+	}
+
+	// The same as classify16() but for the thirty two characters starting at p.
+	template<unsigned classes>
+	inline std::uint32_t classify32(const char * const p) noexcept
+	{
+#if defined __AVX2__
+		return _impl::classify<_impl::AVX2, classes>(p);
+#else
+		return classify16<classes>(p) | (classify16<classes>(p + 16) << 16);
+#endif
+	}
+
+	// Returns the first character in [begin, end) that belongs to any of the classes given, or end.
+	template<unsigned classes>
+	inline const char *findFirstOf(const char *begin, const char * const end) noexcept
+	{
+		for (; end - begin >= 32; begin += 32) {
+			const std::uint32_t mask = classify32<classes>(begin);
+			if (mask != 0) {
+				return begin + __builtin_ctz(mask);
+			}
+		}
+		for (; begin != end && !is<classes>(*begin); ++begin) {}
+		return begin;
+	}
+
+	// Returns the first character in [begin, end) that belongs to none of the classes given, or end.
+	template<unsigned classes>
+	inline const char *findFirstNotOf(const char *begin, const char * const end) noexcept
+	{
+		// Short runs are typical (e.g. JSON whitespace) so they are checked before any vector loads.
+		for (int i = 0; i < 4; ++i, ++begin) {
+			if (begin == end || !is<classes>(*begin)) {
+				return begin;
+			}
+		}
+		for (; end - begin >= 32; begin += 32) {
+			const std::uint32_t mask = ~classify32<classes>(begin);
+			if (mask != 0) {
+				return begin + __builtin_ctz(mask);
+			}
+		}
+		for (; begin != end && is<classes>(*begin); ++begin) {}
+		return begin;
+	}
+
+	// Returns the first character in [begin, end) that is equal to any of the characters given, or end.
+	template<char... chars>
+	inline const char *findAnyOf(const char *begin, const char * const end) noexcept
+	{
+#ifdef __SSE2__
+		typedef _impl::WidestSimd Simd;
+		for (; static_cast<std::size_t>(end - begin) >= Simd::width; begin += Simd::width) {
+			const std::uint32_t mask = Simd::mask(_impl::equalsAnyOf<Simd, chars...>(Simd::load(begin)));
+			if (mask != 0) {
+				return begin + __builtin_ctz(mask);
+			}
+		}
+#endif
+		for (; begin != end && !_impl::isAnyOf<chars...>(*begin); ++begin) {}
+		return begin;
+	}
+
+	// Returns the first occurrence of c in [begin, end), or end.
+	inline const char *find(const char *begin, const char * const end, const char c) noexcept
+	{
+#ifdef __SSE2__
+		const __m128i pattern = _mm_set1_epi8(c);
+		for (; end - begin >= 16; begin += 16) {
+			const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+					_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin)), pattern)));
+			if (mask != 0) {
+				return begin + __builtin_ctz(mask);
+			}
+		}
+#endif
+		for (; begin != end && *begin != c; ++begin) {}
+		return begin;
+	}
+}
+}
+
+#define AFC_ASCII_CLASS_ROW(n) \
+		afc::ascii::_impl::classOf(n), afc::ascii::_impl::classOf(n + 1), afc::ascii::_impl::classOf(n + 2), \
+		afc::ascii::_impl::classOf(n + 3), afc::ascii::_impl::classOf(n + 4), afc::ascii::_impl::classOf(n + 5), \
+		afc::ascii::_impl::classOf(n + 6), afc::ascii::_impl::classOf(n + 7), afc::ascii::_impl::classOf(n + 8), \
+		afc::ascii::_impl::classOf(n + 9), afc::ascii::_impl::classOf(n + 10), afc::ascii::_impl::classOf(n + 11), \
+		afc::ascii::_impl::classOf(n + 12), afc::ascii::_impl::classOf(n + 13), afc::ascii::_impl::classOf(n + 14), \
+		afc::ascii::_impl::classOf(n + 15)
+
+// Generated at compile time.
+template<typename T>
+const unsigned char afc::ascii::asciidata<T>::classTable[256] = {
+		AFC_ASCII_CLASS_ROW(0x00), AFC_ASCII_CLASS_ROW(0x10), AFC_ASCII_CLASS_ROW(0x20), AFC_ASCII_CLASS_ROW(0x30),
+		AFC_ASCII_CLASS_ROW(0x40), AFC_ASCII_CLASS_ROW(0x50), AFC_ASCII_CLASS_ROW(0x60), AFC_ASCII_CLASS_ROW(0x70),
+		AFC_ASCII_CLASS_ROW(0x80), AFC_ASCII_CLASS_ROW(0x90), AFC_ASCII_CLASS_ROW(0xa0), AFC_ASCII_CLASS_ROW(0xb0),
+		AFC_ASCII_CLASS_ROW(0xc0), AFC_ASCII_CLASS_ROW(0xd0), AFC_ASCII_CLASS_ROW(0xe0), AFC_ASCII_CLASS_ROW(0xf0)
+};
+
+#undef AFC_ASCII_CLASS_ROW
+
+#endif /*AFC_ASCII_HPP_*/
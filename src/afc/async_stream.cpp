@@ -0,0 +1,722 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "async_stream.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// POSIX and Linux API.
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "builtin.hpp"
+#include "Exception.h"
+#include "FastStringBuffer.hpp"
+#include "StringRef.hpp"
+
+using namespace afc;
+using namespace std;
+
+namespace
+{
+	// Direct I/O is not used but page-aligned blocks are still friendlier to the page cache.
+	static const size_t blockAlignment = 4096;
+
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	void throwCannotOpenFileIOException(const char * const file)
+	{
+		const std::size_t fileSize = std::strlen(file);
+		const std::size_t bufSize = "unable to open file '"_s.size() + fileSize + 1;
+
+		afc::FastStringBuffer<char, afc::AllocMode::accurate> buf(bufSize);
+		buf.append("unable to open file '"_s);
+		buf.append(file, fileSize);
+		buf.append('\'');
+
+		assert(bufSize == buf.size());
+
+		throw Exception(afc::String::move(buf));
+	}
+
+	inline int sysIoUringSetup(const unsigned entries, io_uring_params * const params) noexcept
+	{
+		return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+	}
+
+	inline int sysIoUringEnter(const int fd, const unsigned toSubmit, const unsigned minComplete,
+			const unsigned flags) noexcept
+	{
+		return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+	}
+
+	inline int sysIoUringRegister(const int fd, const unsigned opcode, const void * const arg,
+			const unsigned argCount) noexcept
+	{
+		return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, argCount));
+	}
+
+	unsigned char *allocateBlocks(const size_t blockCount, const size_t blockSize)
+	{
+		void *storage;
+		if (unlikely(::posix_memalign(&storage, blockAlignment, blockCount * blockSize) != 0)) {
+			throw std::bad_alloc();
+		}
+		return static_cast<unsigned char *>(storage);
+	}
+
+	AsyncIOOptions validate(const AsyncIOOptions &options)
+	{
+		if (options.queueDepth == 0 || options.blockSize == 0 || options.blockSize > 0x7fffffff) {
+			throwException("invalid asynchronous I/O options"_s);
+		}
+		return options;
+	}
+}
+
+struct afc::AsyncFile::Ring
+{
+	int fd;
+
+	unsigned *sqHead;
+	unsigned *sqTail;
+	unsigned sqMask;
+	unsigned *sqArray;
+	io_uring_sqe *sqes;
+
+	unsigned *cqHead;
+	unsigned *cqTail;
+	unsigned cqMask;
+	io_uring_cqe *cqes;
+
+	void *sqRing;
+	size_t sqRingSize;
+	void *cqRing;
+	size_t cqRingSize;
+	size_t sqesSize;
+
+	// SQEs that are filled in but not passed to the kernel yet.
+	unsigned toSubmit;
+
+	// Returns nullptr if io_uring is not available.
+	static Ring *create(unsigned entries) noexcept;
+	void destroy() noexcept;
+};
+
+afc::AsyncFile::Ring *afc::AsyncFile::Ring::create(const unsigned entries) noexcept
+{
+	io_uring_params params;
+	std::memset(&params, 0, sizeof(params));
+
+	const int fd = sysIoUringSetup(entries, &params);
+	if (fd < 0) {
+		// ENOSYS, EPERM (seccomp or sysctl io_uring_disabled) etc. The caller falls back to pread/pwrite.
+		return nullptr;
+	}
+
+	Ring * const ring = new (std::nothrow) Ring();
+	if (ring == nullptr) {
+		::close(fd);
+		return nullptr;
+	}
+	ring->fd = fd;
+	ring->toSubmit = 0;
+
+	ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMmap) {
+		ring->sqRingSize = ring->cqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+	}
+
+	ring->sqRing = ::mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			fd, IORING_OFF_SQ_RING);
+	if (ring->sqRing == MAP_FAILED) {
+		::close(fd);
+		delete ring;
+		return nullptr;
+	}
+	if (singleMmap) {
+		ring->cqRing = ring->sqRing;
+	} else {
+		ring->cqRing = ::mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				fd, IORING_OFF_CQ_RING);
+		if (ring->cqRing == MAP_FAILED) {
+			::munmap(ring->sqRing, ring->sqRingSize);
+			::close(fd);
+			delete ring;
+			return nullptr;
+		}
+	}
+
+	ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	void * const sqes = ::mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		if (!singleMmap) {
+			::munmap(ring->cqRing, ring->cqRingSize);
+		}
+		::munmap(ring->sqRing, ring->sqRingSize);
+		::close(fd);
+		delete ring;
+		return nullptr;
+	}
+	ring->sqes = static_cast<io_uring_sqe *>(sqes);
+
+	unsigned char * const sq = static_cast<unsigned char *>(ring->sqRing);
+	ring->sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+	ring->sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+	ring->sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+	ring->sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+	unsigned char * const cq = static_cast<unsigned char *>(ring->cqRing);
+	ring->cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+	ring->cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+	ring->cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+	ring->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+	return ring;
+}
+
+void afc::AsyncFile::Ring::destroy() noexcept
+{
+	::munmap(sqes, sqesSize);
+	if (cqRing != sqRing) {
+		::munmap(cqRing, cqRingSize);
+	}
+	::munmap(sqRing, sqRingSize);
+	::close(fd);
+}
+
+afc::AsyncFile::AsyncFile(const char * const file, const Mode mode, const unsigned queueDepth, const bool useIoUring)
+		: m_ring(nullptr), m_requests(queueDepth), m_pending(0), m_buffersRegistered(false)
+{
+	assert(queueDepth > 0);
+
+	const int flags = mode == readOnly ? O_RDONLY | O_CLOEXEC : O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+	m_fd = ::open(file, flags, 0666);
+	if (m_fd < 0) {
+		throwCannotOpenFileIOException(file);
+	}
+
+	if (useIoUring) {
+		m_ring = Ring::create(queueDepth);
+	}
+
+	m_freeRequests.reserve(queueDepth);
+	for (unsigned i = queueDepth; i > 0; --i) {
+		m_freeRequests.push_back(i - 1);
+	}
+	m_doneRequests.reserve(queueDepth);
+}
+
+afc::AsyncFile::~AsyncFile()
+{
+	try {
+		while (m_pending > 0) {
+			poll(1);
+		}
+	} catch (...) {
+		// Ignoring both I/O errors and handler errors.
+	}
+	destroy();
+}
+
+bool afc::AsyncFile::registerBuffers(unsigned char * const * const buffers, const size_t count,
+		const size_t bufferSize)
+{
+	if (m_ring == nullptr || m_buffersRegistered) {
+		return false;
+	}
+
+	std::vector<iovec> iovecs(count);
+	for (size_t i = 0; i < count; ++i) {
+		iovecs[i].iov_base = buffers[i];
+		iovecs[i].iov_len = bufferSize;
+	}
+	m_buffersRegistered = sysIoUringRegister(m_ring->fd, IORING_REGISTER_BUFFERS, iovecs.data(), count) == 0;
+	return m_buffersRegistered;
+}
+
+unsigned afc::AsyncFile::acquireRequest()
+{
+	if (m_freeRequests.empty()) {
+		// The queue is full. Waiting for at least one request to complete.
+		assert(m_pending > 0);
+		do {
+			poll(1);
+		} while (m_freeRequests.empty());
+	}
+	const unsigned requestIndex = m_freeRequests.back();
+	m_freeRequests.pop_back();
+	return requestIndex;
+}
+
+void afc::AsyncFile::enqueue(const Operation op, const uint64_t offset, unsigned char * const data, const size_t n,
+		IOCompletionHandler &&handler, const int bufferIndex)
+{
+	if (unlikely(m_fd < 0)) {
+		throwException("Stream is closed"_s);
+	}
+	assert(n <= 0xffffffff);
+
+	const unsigned requestIndex = acquireRequest();
+	Request &request = m_requests[requestIndex];
+	request.handler = std::move(handler);
+	++m_pending;
+
+	if (m_ring == nullptr) {
+		const ssize_t result = op == opRead ?
+				::pread(m_fd, data, n, static_cast<off_t>(offset)) :
+				::pwrite(m_fd, data, n, static_cast<off_t>(offset));
+		request.result = result < 0 ? -errno : static_cast<long>(result);
+		m_doneRequests.push_back(requestIndex);
+		return;
+	}
+
+	Ring &ring = *m_ring;
+	// Only this thread produces SQEs so the tail can be read without synchronisation.
+	const unsigned tail = *ring.sqTail;
+	const unsigned index = tail & ring.sqMask;
+	io_uring_sqe &sqe = ring.sqes[index];
+	std::memset(&sqe, 0, sizeof(sqe));
+
+	const bool fixed = bufferIndex >= 0 && m_buffersRegistered;
+	if (op == opRead) {
+		sqe.opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	} else {
+		sqe.opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+	}
+	sqe.fd = m_fd;
+	sqe.off = offset;
+	sqe.addr = reinterpret_cast<std::uintptr_t>(data);
+	sqe.len = static_cast<std::uint32_t>(n);
+	if (fixed) {
+		sqe.buf_index = static_cast<std::uint16_t>(bufferIndex);
+	}
+	sqe.user_data = requestIndex;
+
+	ring.sqArray[index] = index;
+	// Publishing the SQE to the kernel.
+	__atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+	++ring.toSubmit;
+}
+
+void afc::AsyncFile::read(const uint64_t offset, unsigned char * const data, const size_t n,
+		IOCompletionHandler handler, const int bufferIndex)
+{
+	enqueue(opRead, offset, data, n, std::move(handler), bufferIndex);
+}
+
+void afc::AsyncFile::write(const uint64_t offset, const unsigned char * const data, const size_t n,
+		IOCompletionHandler handler, const int bufferIndex)
+{
+	// The data is never modified by write requests.
+	enqueue(opWrite, offset, const_cast<unsigned char *>(data), n, std::move(handler), bufferIndex);
+}
+
+void afc::AsyncFile::submit()
+{
+	if (m_ring == nullptr || m_ring->toSubmit == 0) {
+		return;
+	}
+	for (;;) {
+		const int submitted = sysIoUringEnter(m_ring->fd, m_ring->toSubmit, 0, 0);
+		if (likely(submitted >= 0)) {
+			m_ring->toSubmit -= static_cast<unsigned>(submitted);
+			if (m_ring->toSubmit == 0) {
+				return;
+			}
+		} else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+			throwException("unable to submit I/O requests"_s);
+		}
+	}
+}
+
+void afc::AsyncFile::complete(const unsigned requestIndex, const long result)
+{
+	/* The request is released before the handler is invoked so that the handler
+	 * is able to submit the next request without blocking.
+	 */
+	IOCompletionHandler handler(std::move(m_requests[requestIndex].handler));
+	m_requests[requestIndex].handler = nullptr;
+	m_freeRequests.push_back(requestIndex);
+	--m_pending;
+	handler(result);
+}
+
+unsigned afc::AsyncFile::poll(const unsigned minCompletions)
+{
+	unsigned completed = 0;
+
+	if (m_ring == nullptr) {
+		// The requests are executed at submission time so there is nothing to wait for.
+		std::vector<unsigned> done;
+		done.swap(m_doneRequests);
+		m_doneRequests.reserve(m_requests.size());
+		for (const unsigned requestIndex : done) {
+			complete(requestIndex, m_requests[requestIndex].result);
+			++completed;
+		}
+		return completed;
+	}
+
+	Ring &ring = *m_ring;
+	const unsigned toWait = static_cast<unsigned>(std::min<size_t>(minCompletions, m_pending));
+	for (;;) {
+		unsigned head = *ring.cqHead;
+		const unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+		while (head != tail) {
+			const io_uring_cqe &cqe = ring.cqes[head & ring.cqMask];
+			const unsigned requestIndex = static_cast<unsigned>(cqe.user_data);
+			const long result = cqe.res;
+			++head;
+			// The CQE slot is returned to the kernel before the handler can enqueue more requests.
+			__atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+			complete(requestIndex, result);
+			++completed;
+		}
+		if (completed >= toWait && ring.toSubmit == 0) {
+			return completed;
+		}
+
+		const unsigned minComplete = completed >= toWait ? 0 : 1;
+		const int submitted = sysIoUringEnter(ring.fd, ring.toSubmit, minComplete,
+				minComplete > 0 ? IORING_ENTER_GETEVENTS : 0);
+		if (likely(submitted >= 0)) {
+			ring.toSubmit -= static_cast<unsigned>(submitted);
+		} else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+			throwException("unable to wait for I/O completion"_s);
+		}
+	}
+}
+
+uint64_t afc::AsyncFile::size() const
+{
+	struct stat fileStat;
+	if (unlikely(m_fd < 0)) {
+		throwException("Stream is closed"_s);
+	}
+	if (::fstat(m_fd, &fileStat) != 0) {
+		throwException("unable to obtain file size"_s);
+	}
+	return static_cast<uint64_t>(fileStat.st_size);
+}
+
+void afc::AsyncFile::close()
+{
+	if (m_fd < 0) {
+		return;
+	}
+	while (m_pending > 0) {
+		poll(1);
+	}
+	destroy();
+}
+
+void afc::AsyncFile::destroy() noexcept
+{
+	if (m_ring != nullptr) {
+		m_ring->destroy();
+		delete m_ring;
+		m_ring = nullptr;
+	}
+	if (m_fd >= 0) {
+		::close(m_fd); // ignoring any potential close failure
+		m_fd = -1;
+	}
+}
+
+afc::AsyncFileInputStream::AsyncFileInputStream(const char * const file, const AsyncIOOptions &options)
+		: m_file(file, AsyncFile::readOnly, validate(options).queueDepth, options.useIoUring),
+		  m_storage(allocateBlocks(options.queueDepth, options.blockSize)),
+		  m_blocks(options.queueDepth),
+		  m_blockSize(options.blockSize),
+		  m_closed(false)
+{
+	std::vector<unsigned char *> buffers(m_blocks.size());
+	for (size_t i = 0; i < m_blocks.size(); ++i) {
+		buffers[i] = m_blocks[i].data = m_storage.get() + i * m_blockSize;
+		m_blocks[i].inFlight = false;
+	}
+	m_fixedBuffers = options.registerBuffers && m_file.registerBuffers(buffers.data(), buffers.size(), m_blockSize);
+
+	try {
+		restartFrom(0);
+	} catch (...) {
+		// The requests submitted refer to the blocks, which are destroyed before the file.
+		try {
+			drain();
+		} catch (...) {
+			// Ignoring I/O errors.
+		}
+		throw;
+	}
+}
+
+afc::AsyncFileInputStream::~AsyncFileInputStream()
+{
+	try {
+		drain();
+	} catch (...) {
+		// Ignoring I/O errors.
+	}
+}
+
+void afc::AsyncFileInputStream::issue(const size_t blockIndex, const uint64_t offset)
+{
+	Block &block = m_blocks[blockIndex];
+	block.offset = offset;
+	block.size = 0;
+	block.pos = 0;
+	requestRest(blockIndex);
+}
+
+void afc::AsyncFileInputStream::requestRest(const size_t blockIndex)
+{
+	Block &block = m_blocks[blockIndex];
+	block.result = 0;
+	block.inFlight = true;
+	m_file.read(block.offset + block.size, block.data + block.size, m_blockSize - block.size,
+			[&block](const long result)
+	{
+		block.result = result;
+		if (result > 0) {
+			block.size += static_cast<size_t>(result);
+		}
+		block.inFlight = false;
+	}, m_fixedBuffers ? static_cast<int>(blockIndex) : -1);
+}
+
+void afc::AsyncFileInputStream::restartFrom(const uint64_t offset)
+{
+	// Reading ahead as many blocks as the queue allows.
+	for (size_t i = 0; i < m_blocks.size(); ++i) {
+		issue(i, offset + i * m_blockSize);
+	}
+	m_current = 0;
+	m_nextOffset = offset + m_blocks.size() * m_blockSize;
+	m_file.submit();
+}
+
+void afc::AsyncFileInputStream::drain()
+{
+	while (m_file.pending() > 0) {
+		m_file.poll(1);
+	}
+}
+
+size_t afc::AsyncFileInputStream::read(unsigned char * const data, const size_t n)
+{
+	if (unlikely(m_closed)) {
+		throwException("Stream is closed"_s);
+	}
+
+	size_t count = 0;
+	while (count < n) {
+		Block &block = m_blocks[m_current];
+		while (block.inFlight) {
+			m_file.poll(1);
+		}
+		if (unlikely(block.result < 0)) {
+			throwException("error encountered while reading from file"_s);
+		}
+
+		const size_t available = block.size - block.pos;
+		if (available == 0) {
+			if (block.size < m_blockSize) {
+				if (block.result == 0) {
+					// The end of the file is reached.
+					break;
+				}
+				// A short read, which is allowed in the middle of the file too. The rest of the block is requested.
+				requestRest(m_current);
+				m_file.submit();
+				continue;
+			}
+			// The block is consumed. Re-using it to read ahead the next part of the file.
+			issue(m_current, m_nextOffset);
+			m_nextOffset += m_blockSize;
+			m_file.submit();
+			m_current = (m_current + 1) % m_blocks.size();
+			continue;
+		}
+
+		const size_t chunkSize = std::min(available, n - count);
+		std::memcpy(data + count, block.data + block.pos, chunkSize);
+		block.pos += chunkSize;
+		count += chunkSize;
+	}
+	return count;
+}
+
+void afc::AsyncFileInputStream::reset()
+{
+	if (unlikely(m_closed)) {
+		throwException("Stream is closed"_s);
+	}
+	drain();
+	restartFrom(0);
+}
+
+size_t afc::AsyncFileInputStream::skip(const size_t n)
+{
+	if (unlikely(m_closed)) {
+		throwException("Stream is closed"_s);
+	}
+	const Block &block = m_blocks[m_current];
+	const uint64_t currPos = block.offset + block.pos;
+	const uint64_t endPos = std::max(m_file.size(), currPos);
+	const uint64_t newPos = endPos - currPos > n ? currPos + n : endPos;
+
+	drain();
+	restartFrom(newPos);
+	return static_cast<size_t>(newPos - currPos);
+}
+
+void afc::AsyncFileInputStream::close()
+{
+	if (m_closed) {
+		return;
+	}
+	drain();
+	m_file.close();
+	m_closed = true;
+}
+
+afc::AsyncFileOutputStream::AsyncFileOutputStream(const char * const file, const AsyncIOOptions &options)
+		: m_file(file, AsyncFile::writeOnly, validate(options).queueDepth, options.useIoUring),
+		  m_storage(allocateBlocks(options.queueDepth, options.blockSize)),
+		  m_blocks(options.queueDepth),
+		  m_blockSize(options.blockSize),
+		  m_current(0),
+		  m_offset(0),
+		  m_error(0),
+		  m_closed(false)
+{
+	std::vector<unsigned char *> buffers(m_blocks.size());
+	for (size_t i = 0; i < m_blocks.size(); ++i) {
+		buffers[i] = m_blocks[i].data = m_storage.get() + i * m_blockSize;
+		m_blocks[i].size = 0;
+		m_blocks[i].inFlight = false;
+	}
+	m_fixedBuffers = options.registerBuffers && m_file.registerBuffers(buffers.data(), buffers.size(), m_blockSize);
+}
+
+afc::AsyncFileOutputStream::~AsyncFileOutputStream()
+{
+	try {
+		close();
+	} catch (...) {
+		// Ignoring I/O errors.
+	}
+}
+
+void afc::AsyncFileOutputStream::issue(const size_t blockIndex)
+{
+	Block &block = m_blocks[blockIndex];
+	const size_t expected = block.size;
+	block.inFlight = true;
+	m_file.write(m_offset, block.data, block.size, [this, &block, expected](const long result)
+	{
+		block.inFlight = false;
+		block.size = 0;
+		if (unlikely(result != static_cast<long>(expected)) && m_error == 0) {
+			// Short writes are not expected for regular files; they are reported as errors.
+			m_error = result < 0 ? result : -EIO;
+		}
+	}, m_fixedBuffers ? static_cast<int>(blockIndex) : -1);
+	m_offset += expected;
+	m_file.submit();
+}
+
+void afc::AsyncFileOutputStream::waitFor(Block &block)
+{
+	while (block.inFlight) {
+		m_file.poll(1);
+	}
+}
+
+void afc::AsyncFileOutputStream::checkError()
+{
+	if (unlikely(m_error != 0)) {
+		throwException("error encountered while writing to file"_s);
+	}
+}
+
+void afc::AsyncFileOutputStream::write(const unsigned char * const data, const size_t n)
+{
+	if (unlikely(m_closed)) {
+		throwException("Stream is closed"_s);
+	}
+	checkError();
+
+	size_t written = 0;
+	while (written < n) {
+		Block &block = m_blocks[m_current];
+		waitFor(block);
+		checkError();
+
+		const size_t chunkSize = std::min(m_blockSize - block.size, n - written);
+		std::memcpy(block.data + block.size, data + written, chunkSize);
+		block.size += chunkSize;
+		written += chunkSize;
+
+		if (block.size == m_blockSize) {
+			// Writing the block behind while the next one is being filled in.
+			issue(m_current);
+			m_current = (m_current + 1) % m_blocks.size();
+		}
+	}
+}
+
+void afc::AsyncFileOutputStream::flush()
+{
+	if (unlikely(m_closed)) {
+		throwException("Stream is closed"_s);
+	}
+	Block &block = m_blocks[m_current];
+	if (!block.inFlight && block.size > 0) {
+		issue(m_current);
+		m_current = (m_current + 1) % m_blocks.size();
+	}
+	while (m_file.pending() > 0) {
+		m_file.poll(1);
+	}
+	checkError();
+}
+
+void afc::AsyncFileOutputStream::close()
+{
+	if (m_closed) {
+		return;
+	}
+	flush();
+	m_file.close();
+	m_closed = true;
+}
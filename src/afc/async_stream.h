@@ -0,0 +1,211 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_ASYNC_STREAM_H_
+#define AFC_ASYNC_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "stream.h"
+
+namespace afc
+{
+	struct AsyncIOOptions
+	{
+		// The maximal number of I/O requests in flight.
+		unsigned queueDepth = 8;
+		// The size of each read-ahead (write-behind) block.
+		std::size_t blockSize = 128 * 1024;
+		// Blocks are registered within the kernel once if true (io_uring only).
+		bool registerBuffers = true;
+		// pread/pwrite are used if false even if io_uring is available.
+		bool useIoUring = true;
+	};
+
+	namespace _impl
+	{
+		struct FreeDeleter
+		{
+			void operator()(unsigned char * const p) const noexcept { std::free(p); }
+		};
+	}
+
+	/* Receives either the number of octets transferred or the negated errno value.
+	 *
+	 * Handlers are invoked only from within AsyncFile::poll(), never from the submitting call.
+	 */
+	typedef std::function<void (long result)> IOCompletionHandler;
+
+	/* A file with the completion-based I/O interface.
+	 *
+	 * io_uring is used if it is available in the kernel. Otherwise pread/pwrite are executed
+	 * at submission time and their completions are delivered by the next AsyncFile::poll().
+	 * The instance is not thread-safe.
+	 */
+	class AsyncFile
+	{
+	public:
+		enum Mode
+		{
+			readOnly,
+			writeOnly
+		};
+
+		AsyncFile(const char *file, Mode mode, unsigned queueDepth, bool useIoUring = true);
+		AsyncFile(const AsyncFile &) = delete;
+		~AsyncFile();
+
+		AsyncFile &operator=(const AsyncFile &) = delete;
+
+		bool usesIoUring() const noexcept { return m_ring != nullptr; }
+
+		/* Registers fixed buffers of equal size. Returns false if the kernel refuses them
+		 * (e.g. due to RLIMIT_MEMLOCK), in which case ordinary buffers are to be used.
+		 */
+		bool registerBuffers(unsigned char * const *buffers, std::size_t count, std::size_t bufferSize);
+
+		// bufferIndex is an index of a registered buffer that contains [data, data + n) or -1.
+		void read(std::uint64_t offset, unsigned char *data, std::size_t n, IOCompletionHandler handler,
+				int bufferIndex = -1);
+		void write(std::uint64_t offset, const unsigned char *data, std::size_t n, IOCompletionHandler handler,
+				int bufferIndex = -1);
+
+		// Passes all the requests queued to the kernel without waiting for their completion.
+		void submit();
+		// Submits queued requests and invokes handlers of completed ones. Blocks until minCompletions are done.
+		unsigned poll(unsigned minCompletions = 0);
+		// The number of requests submitted whose handlers are not invoked yet.
+		std::size_t pending() const noexcept { return m_pending; }
+
+		std::uint64_t size() const;
+
+		// Waits for all pending requests and closes the file.
+		void close();
+	private:
+		struct Ring;
+
+		struct Request
+		{
+			IOCompletionHandler handler;
+			long result;
+		};
+
+		enum Operation
+		{
+			opRead,
+			opWrite
+		};
+
+		void enqueue(Operation op, std::uint64_t offset, unsigned char *data, std::size_t n,
+				IOCompletionHandler &&handler, int bufferIndex);
+		unsigned acquireRequest();
+		void complete(unsigned requestIndex, long result);
+		void destroy() noexcept;
+
+		int m_fd;
+		Ring *m_ring;
+		std::vector<Request> m_requests;
+		std::vector<unsigned> m_freeRequests;
+		// Requests executed synchronously whose completion is not delivered yet (no io_uring only).
+		std::vector<unsigned> m_doneRequests;
+		std::size_t m_pending;
+		bool m_buffersRegistered;
+	};
+
+	class AsyncFileInputStream : public InputStream
+	{
+	public:
+		explicit AsyncFileInputStream(const char * const file, const AsyncIOOptions &options = AsyncIOOptions());
+		AsyncFileInputStream(AsyncFileInputStream &) = delete;
+		~AsyncFileInputStream();
+
+		void operator=(AsyncFileInputStream &) = delete;
+
+		virtual std::size_t read(unsigned char * const data, const std::size_t n);
+		virtual void reset();
+		virtual std::size_t skip(const std::size_t n);
+		virtual void close();
+	private:
+		struct Block
+		{
+			unsigned char *data;
+			std::uint64_t offset;
+			// Of the last request; zero means the end of the file.
+			long result;
+			// The number of octets read into the block.
+			std::size_t size;
+			std::size_t pos;
+			bool inFlight;
+		};
+
+		void issue(std::size_t blockIndex, std::uint64_t offset);
+		// Requests the part of the block that is not read yet.
+		void requestRest(std::size_t blockIndex);
+		void restartFrom(std::uint64_t offset);
+		void drain();
+
+		AsyncFile m_file;
+		std::unique_ptr<unsigned char, _impl::FreeDeleter> m_storage;
+		std::vector<Block> m_blocks;
+		const std::size_t m_blockSize;
+		std::size_t m_current;
+		std::uint64_t m_nextOffset;
+		bool m_fixedBuffers;
+		bool m_closed;
+	};
+
+	class AsyncFileOutputStream : public OutputStream
+	{
+	public:
+		explicit AsyncFileOutputStream(const char * const file, const AsyncIOOptions &options = AsyncIOOptions());
+		AsyncFileOutputStream(AsyncFileOutputStream &) = delete;
+		~AsyncFileOutputStream();
+
+		void operator=(AsyncFileOutputStream &) = delete;
+
+		virtual void write(const unsigned char * const data, const std::size_t n);
+		// Waits until all the data written is passed to the kernel.
+		void flush();
+		void close();
+	private:
+		struct Block
+		{
+			unsigned char *data;
+			std::size_t size;
+			bool inFlight;
+		};
+
+		void issue(std::size_t blockIndex);
+		void waitFor(Block &block);
+		void checkError();
+
+		AsyncFile m_file;
+		std::unique_ptr<unsigned char, _impl::FreeDeleter> m_storage;
+		std::vector<Block> m_blocks;
+		const std::size_t m_blockSize;
+		std::size_t m_current;
+		std::uint64_t m_offset;
+		long m_error;
+		bool m_fixedBuffers;
+		bool m_closed;
+	};
+}
+
+#endif /*AFC_ASYNC_STREAM_H_*/
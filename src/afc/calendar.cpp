@@ -0,0 +1,209 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "calendar.h"
+
+#include <algorithm>
+
+#ifdef __AVX2__
+	#include <immintrin.h>
+#endif
+
+using namespace afc;
+using namespace std;
+
+namespace
+{
+	const int64_t millisPerHour = 3600 * 1000;
+	const int64_t millisPerDay = 24 * millisPerHour;
+
+	// Timestamps are converted in chunks, so that the days computed stay in L1 cache for the second pass.
+	const size_t chunkSize = 2048;
+
+	/* Days are shifted by whole 400-year eras to be non-negative, so that the civil date is
+	 * computed in unsigned 32-bit arithmetic with constant divisors, which vectorises.
+	 */
+	const uint32_t shiftEras = 200;
+	const uint32_t shiftedEpoch = 719468 + shiftEras * 146097; // 0000-03-01 is day 0 in H. Hinnant's algorithm.
+
+	struct CivilDate
+	{
+		uint32_t era;
+		uint32_t yearOfEra;
+		uint32_t dayOfYear; // Starting from March 1.
+		uint32_t month;
+		uint32_t day;
+	};
+
+	inline CivilDate civil(const int32_t days) noexcept
+	{
+		CivilDate d;
+		const uint32_t z = uint32_t(days) + shiftedEpoch;
+		d.era = z / 146097;
+		const uint32_t dayOfEra = z - d.era * 146097;
+		d.yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+		d.dayOfYear = dayOfEra - (365 * d.yearOfEra + d.yearOfEra / 4 - d.yearOfEra / 100);
+		const uint32_t mp = (5 * d.dayOfYear + 2) / 153;
+		d.day = d.dayOfYear - (153 * mp + 2) / 5 + 1;
+		d.month = mp < 10 ? mp + 3 : mp - 9;
+		return d;
+	}
+
+	inline int32_t year(const CivilDate &d) noexcept
+	{
+		return int32_t(d.yearOfEra + d.era * 400 + (d.month <= 2)) - int32_t(shiftEras * 400);
+	}
+
+	inline int32_t yearMonthKey(const int32_t days) noexcept
+	{
+		const CivilDate d = civil(days);
+		return year(d) * 100 + int32_t(d.month);
+	}
+
+	inline int32_t isoWeekKey(const int32_t days) noexcept
+	{
+		// 146097 is a multiple of 7, and 1970-01-01 (day shiftedEpoch) is Thursday. Monday is 0.
+		const uint32_t weekDay = (uint32_t(days) + shiftedEpoch + 2) % 7;
+		// The ISO week belongs to the year its Thursday belongs to.
+		const CivilDate thursday = civil(int32_t(uint32_t(days) - weekDay + 3));
+		/* The day of the year starting from January 1. The March-based year of the civil
+		 * date is leap if the year of era is (the era is a multiple of 400 years).
+		 */
+		const uint32_t leap = (thursday.yearOfEra % 4 == 0) & ((thursday.yearOfEra % 100 != 0) | (thursday.yearOfEra == 0));
+		const uint32_t dayOfYear = thursday.month > 2 ? thursday.dayOfYear + 59 + leap : thursday.dayOfYear - 306;
+		return year(thursday) * 100 + int32_t(dayOfYear / 7 + 1);
+	}
+
+	template<int64_t divisor>
+	inline int32_t floorDiv(const int64_t x) noexcept
+	{
+		return static_cast<int32_t>(helper::floorDiv(x, divisor));
+	}
+
+	/* floor((millis[i] + offset) / divisor) for i in [0, n). The quotient is computed in double
+	 * precision, which is exact for |x| < 2^51, and corrected by the remainder.
+	 */
+	template<int64_t divisor>
+	void divide(const Timestamp::time_type * const millis, const size_t n, int32_t * const dest, const int64_t offset) noexcept
+	{
+		size_t i = 0;
+#ifdef __AVX2__
+		const __m256i offsetVec = _mm256_set1_epi64x(offset);
+		// int64 to double conversion: adding an integer to the representation of 2^52 + 2^51.
+		const __m256i magic = _mm256_set1_epi64x(0x4338000000000000);
+		const __m256d magicDouble = _mm256_set1_pd(6755399441055744.0);
+		const __m256i maxValue = _mm256_set1_epi64x(int64_t(1) << 51);
+		const __m256i minValue = _mm256_set1_epi64x(-(int64_t(1) << 51));
+		const __m256d divisorVec = _mm256_set1_pd(double(divisor));
+		const __m256d one = _mm256_set1_pd(1.0);
+		for (; i + 4 <= n; i += 4) {
+			const __m256i x = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(millis + i)), offsetVec);
+			const __m256i outOfRange = _mm256_or_si256(_mm256_cmpgt_epi64(x, maxValue), _mm256_cmpgt_epi64(minValue, x));
+			if (unlikely(!_mm256_testz_si256(outOfRange, outOfRange))) {
+				for (size_t j = i; j < i + 4; ++j) {
+					dest[j] = floorDiv<divisor>(millis[j] + offset);
+				}
+				continue;
+			}
+			const __m256d xd = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(x, magic)), magicDouble);
+			__m256d q = _mm256_floor_pd(_mm256_div_pd(xd, divisorVec));
+			const __m256d r = _mm256_sub_pd(xd, _mm256_mul_pd(q, divisorVec));
+			q = _mm256_sub_pd(q, _mm256_and_pd(_mm256_cmp_pd(r, _mm256_setzero_pd(), _CMP_LT_OQ), one));
+			q = _mm256_add_pd(q, _mm256_and_pd(_mm256_cmp_pd(r, divisorVec, _CMP_GE_OQ), one));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm256_cvtpd_epi32(q));
+		}
+#endif
+		for (; i < n; ++i) {
+			dest[i] = floorDiv<divisor>(millis[i] + offset);
+		}
+	}
+
+	template<int64_t divisor>
+	void divide(const TimestampTZ * const times, const size_t n, int32_t * const dest) noexcept
+	{
+		for (size_t i = 0; i < n; ++i) {
+			dest[i] = floorDiv<divisor>(times[i].millis() + int64_t(times[i].getGmtOffset()) * 1000);
+		}
+	}
+
+	// Auto-vectorised.
+	template<int32_t (*key)(int32_t)>
+	void daysToKeys(int32_t * const dest, const size_t n) noexcept
+	{
+		for (size_t i = 0; i < n; ++i) {
+			dest[i] = key(dest[i]);
+		}
+	}
+
+	template<int32_t (*key)(int32_t)>
+	void calendarKeys(const Timestamp::time_type * const millis, const size_t n, int32_t * const dest, const long gmtOffset) noexcept
+	{
+		for (size_t i = 0; i < n; i += chunkSize) {
+			const size_t count = std::min(chunkSize, n - i);
+			divide<millisPerDay>(millis + i, count, dest + i, int64_t(gmtOffset) * 1000);
+			daysToKeys<key>(dest + i, count);
+		}
+	}
+
+	template<int32_t (*key)(int32_t)>
+	void calendarKeys(const TimestampTZ * const times, const size_t n, int32_t * const dest) noexcept
+	{
+		for (size_t i = 0; i < n; i += chunkSize) {
+			const size_t count = std::min(chunkSize, n - i);
+			divide<millisPerDay>(times + i, count, dest + i);
+			daysToKeys<key>(dest + i, count);
+		}
+	}
+}
+
+void afc::epochDayKeys(const Timestamp::time_type * const millis, const size_t n, int32_t * const dest, const long gmtOffset) noexcept
+{
+	divide<millisPerDay>(millis, n, dest, int64_t(gmtOffset) * 1000);
+}
+
+void afc::epochDayKeys(const TimestampTZ * const times, const size_t n, int32_t * const dest) noexcept
+{
+	divide<millisPerDay>(times, n, dest);
+}
+
+void afc::epochHourKeys(const Timestamp::time_type * const millis, const size_t n, int32_t * const dest, const long gmtOffset) noexcept
+{
+	divide<millisPerHour>(millis, n, dest, int64_t(gmtOffset) * 1000);
+}
+
+void afc::epochHourKeys(const TimestampTZ * const times, const size_t n, int32_t * const dest) noexcept
+{
+	divide<millisPerHour>(times, n, dest);
+}
+
+void afc::isoWeekKeys(const Timestamp::time_type * const millis, const size_t n, int32_t * const dest, const long gmtOffset) noexcept
+{
+	calendarKeys<isoWeekKey>(millis, n, dest, gmtOffset);
+}
+
+void afc::isoWeekKeys(const TimestampTZ * const times, const size_t n, int32_t * const dest) noexcept
+{
+	calendarKeys<isoWeekKey>(times, n, dest);
+}
+
+void afc::yearMonthKeys(const Timestamp::time_type * const millis, const size_t n, int32_t * const dest, const long gmtOffset) noexcept
+{
+	calendarKeys<yearMonthKey>(millis, n, dest, gmtOffset);
+}
+
+void afc::yearMonthKeys(const TimestampTZ * const times, const size_t n, int32_t * const dest) noexcept
+{
+	calendarKeys<yearMonthKey>(times, n, dest);
+}
@@ -0,0 +1,51 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_CALENDAR_H_
+#define AFC_CALENDAR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dateutil.hpp"
+
+namespace afc
+{
+	/* Bucket keys of arrays of timestamps (in milliseconds since the epoch) for grouping
+	 * events by calendar periods. The keys are computed in the time zone with the fixed
+	 * GMT offset (in seconds) or in the time zone of each TimestampTZ.
+	 *
+	 * The conversion uses integer-only civil date arithmetic that is vectorised (AVX2 is used
+	 * explicitly where available). Timestamps must be within about 70000 years of the epoch.
+	 */
+
+	// The number of days since 1970-01-01.
+	void epochDayKeys(const Timestamp::time_type *millis, std::size_t n, std::int32_t *dest, long gmtOffset = 0) noexcept;
+	void epochDayKeys(const TimestampTZ *times, std::size_t n, std::int32_t *dest) noexcept;
+
+	// The number of hours since 1970-01-01T00:00.
+	void epochHourKeys(const Timestamp::time_type *millis, std::size_t n, std::int32_t *dest, long gmtOffset = 0) noexcept;
+	void epochHourKeys(const TimestampTZ *times, std::size_t n, std::int32_t *dest) noexcept;
+
+	// ISO 8601 week-numbering year * 100 + week (e.g. 202053 for 2021-01-01).
+	void isoWeekKeys(const Timestamp::time_type *millis, std::size_t n, std::int32_t *dest, long gmtOffset = 0) noexcept;
+	void isoWeekKeys(const TimestampTZ *times, std::size_t n, std::int32_t *dest) noexcept;
+
+	// year * 100 + month (e.g. 201903 for March 2019).
+	void yearMonthKeys(const Timestamp::time_type *millis, std::size_t n, std::int32_t *dest, long gmtOffset = 0) noexcept;
+	void yearMonthKeys(const TimestampTZ *times, std::size_t n, std::int32_t *dest) noexcept;
+}
+
+#endif /*AFC_CALENDAR_H_*/
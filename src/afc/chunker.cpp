@@ -0,0 +1,300 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "chunker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "builtin.hpp"
+#include "crc.hpp"
+#include "Exception.h"
+
+using namespace afc;
+using namespace std;
+
+namespace
+{
+	// The number of the last octets the Gear hash depends on.
+	const size_t gearWindow = 64;
+	// The data is hashed and checksummed in blocks of this size.
+	const size_t crcBlockSize = 4096;
+	// The part of the input a thread finds candidate cut points in is not smaller than this.
+	const size_t minParallelPart = 1024 * 1024;
+
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	/* Random values that are a part of the chunking algorithm: the same data must be split
+	 * into the same chunks by all the versions of the library.
+	 */
+	struct GearTable
+	{
+		GearTable() noexcept
+		{
+			uint64_t state = 0x2545f4914f6cdd1d;
+			for (uint64_t &value : values) {
+				uint64_t z = (state += 0x9e3779b97f4a7c15);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+				value = z ^ (z >> 31);
+			}
+		}
+
+		uint64_t values[256];
+	};
+
+	const GearTable gear;
+
+	inline uint64_t roll(const uint64_t h, const unsigned char c) noexcept
+	{
+		return (h << 1) + gear.values[c];
+	}
+
+	// The upper bits of the hash depend on more octets than the lower ones.
+	inline uint64_t upperBits(const unsigned n) noexcept
+	{
+		return ~uint64_t(0) << (64 - n);
+	}
+
+	inline unsigned log2Floor(size_t x) noexcept
+	{
+		unsigned result = 0;
+		while (x >>= 1) {
+			++result;
+		}
+		return result;
+	}
+
+	const ChunkerOptions &validate(const ChunkerOptions &options)
+	{
+		if (options.minSize < gearWindow || options.minSize > options.averageSize ||
+				options.averageSize > options.maxSize || options.maxSize > (size_t(1) << 30)) {
+			throwException("invalid chunker options"_s);
+		}
+		return options;
+	}
+
+	/* Rolls the hash over [data + i, data + end). Returns the size of the chunk that ends at
+	 * the first octet the hash matches the mask at or 0 if there is no such octet.
+	 */
+	inline size_t scan(const unsigned char * const data, size_t i, const size_t end, uint64_t &h,
+			const uint64_t mask) noexcept
+	{
+		for (; i < end; ++i) {
+			h = roll(h, data[i]);
+			if (unlikely((h & mask) == 0)) {
+				return i + 1;
+			}
+		}
+		return 0;
+	}
+
+	// The end of a candidate chunk (shifted left by one) and whether it matches the strict mask.
+	typedef uint64_t Candidate;
+
+	void findCandidates(const unsigned char * const data, const size_t begin, const size_t end,
+			const uint64_t strictMask, const uint64_t looseMask, vector<Candidate> &candidates)
+	{
+		const size_t start = begin < gearWindow - 1 ? 0 : begin - (gearWindow - 1);
+		uint64_t h = 0;
+		for (size_t i = start; i < begin; ++i) {
+			h = roll(h, data[i]);
+		}
+		for (size_t i = begin; i < end; ++i) {
+			h = roll(h, data[i]);
+			if (unlikely((h & looseMask) == 0)) {
+				candidates.push_back(Candidate(i + 1) << 1 | ((h & strictMask) == 0));
+			}
+		}
+	}
+
+	template<typename Task>
+	void runInParallel(const unsigned threadCount, Task task)
+	{
+		vector<thread> threads;
+		threads.reserve(threadCount - 1);
+		for (unsigned i = 1; i < threadCount; ++i) {
+			threads.emplace_back(task, i);
+		}
+		task(0);
+		for (thread &t : threads) {
+			t.join();
+		}
+	}
+}
+
+afc::ContentChunker::ContentChunker(const ChunkerOptions &options)
+	: m_minSize(validate(options).minSize), m_averageSize(options.averageSize), m_maxSize(options.maxSize),
+	  m_strictMask(upperBits(log2Floor(options.averageSize) + 2)),
+	  m_looseMask(upperBits(log2Floor(options.averageSize) - 2))
+{
+}
+
+size_t afc::ContentChunker::cut(const unsigned char * const data, const size_t n, uint64_t &crc) const noexcept
+{
+	const size_t limit = std::min(n, m_maxSize);
+	if (limit <= m_minSize) {
+		crc = crc64Reversed(data, limit);
+		return limit;
+	}
+
+	/* Hashing starts gearWindow octets before the first possible cut point so that the hash
+	 * depends on the last gearWindow octets only, not on where the chunk starts.
+	 */
+	size_t pos = m_minSize - 1;
+	uint64_t h = 0;
+	for (size_t i = m_minSize - gearWindow; i < pos; ++i) {
+		h = roll(h, data[i]);
+	}
+	crc = crc64ReversedUpdate(0, data, pos);
+	while (pos < limit) {
+		const size_t end = std::min(pos + crcBlockSize, limit);
+		// Chunks shorter than the average size end at positions before averageSize - 1.
+		const size_t strictEnd = std::min(end, std::max(pos, m_averageSize - 1));
+		size_t size = scan(data, pos, strictEnd, h, m_strictMask);
+		if (size == 0) {
+			size = scan(data, strictEnd, end, h, m_looseMask);
+		}
+		if (size != 0) {
+			crc = crc64ReversedUpdate(crc, data + pos, size - pos);
+			return size;
+		}
+		crc = crc64ReversedUpdate(crc, data + pos, end - pos);
+		pos = end;
+	}
+	return limit;
+}
+
+void afc::ContentChunker::split(const unsigned char * const data, const size_t n, const ChunkHandler &handler) const
+{
+	for (size_t offset = 0; offset < n;) {
+		Chunk chunk;
+		chunk.offset = offset;
+		chunk.data = data + offset;
+		chunk.size = cut(chunk.data, n - offset, chunk.crc);
+		handler(chunk);
+		offset += chunk.size;
+	}
+}
+
+void afc::ContentChunker::split(InputStream &in, const ChunkHandler &handler) const
+{
+	// Data is moved to the beginning of the buffer only when less than maxSize octets are left.
+	vector<unsigned char> buf(4 * m_maxSize);
+	size_t begin = 0, end = 0;
+	bool eof = false;
+	uint64_t offset = 0;
+	for (;;) {
+		while (!eof && end - begin < m_maxSize) {
+			if (end == buf.size()) {
+				std::memmove(buf.data(), buf.data() + begin, end - begin);
+				end -= begin;
+				begin = 0;
+			}
+			const size_t count = in.read(buf.data() + end, buf.size() - end);
+			eof = count == 0;
+			end += count;
+		}
+		if (begin == end) {
+			return;
+		}
+		Chunk chunk;
+		chunk.offset = offset;
+		chunk.data = buf.data() + begin;
+		chunk.size = cut(chunk.data, end - begin, chunk.crc);
+		handler(chunk);
+		begin += chunk.size;
+		offset += chunk.size;
+	}
+}
+
+void afc::ContentChunker::splitParallel(const unsigned char * const data, const size_t n, const ChunkHandler &handler,
+		unsigned threadCount) const
+{
+	if (threadCount == 0) {
+		threadCount = std::max(1u, thread::hardware_concurrency());
+	}
+	threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, n / minParallelPart));
+	if (threadCount <= 1) {
+		split(data, n, handler);
+		return;
+	}
+
+	const size_t partSize = n / threadCount;
+	vector<vector<Candidate>> candidates(threadCount);
+	runInParallel(threadCount, [&](const unsigned part)
+	{
+		const size_t begin = part * partSize;
+		const size_t end = part == threadCount - 1 ? n : begin + partSize;
+		candidates[part].reserve(((end - begin) >> log2Floor(m_averageSize)) * 8);
+		findCandidates(data, begin, end, m_strictMask, m_looseMask, candidates[part]);
+	});
+
+	// The ends of the chunks. The same rules as in cut() are applied to the candidates.
+	vector<size_t> ends;
+	ends.reserve(n / m_averageSize + 1);
+	size_t part = 0, i = 0;
+	for (size_t start = 0; start < n;) {
+		size_t chunkEnd;
+		if (n - start <= m_minSize) {
+			chunkEnd = n;
+		} else {
+			const size_t minEnd = start + m_minSize, averageEnd = start + m_averageSize;
+			const size_t maxEnd = std::min(n, start + m_maxSize);
+			chunkEnd = maxEnd;
+			for (; part < threadCount; ++part, i = 0) {
+				const vector<Candidate> &c = candidates[part];
+				for (; i < c.size() && (c[i] >> 1) < minEnd; ++i);
+				size_t j = i;
+				for (; j < c.size() && (c[j] >> 1) < maxEnd; ++j) {
+					const size_t end = c[j] >> 1;
+					if (end >= averageEnd || (c[j] & 1) != 0) {
+						chunkEnd = end;
+						break;
+					}
+				}
+				if (j < c.size()) {
+					break;
+				}
+			}
+		}
+		ends.push_back(chunkEnd);
+		start = chunkEnd;
+	}
+
+	vector<uint64_t> crcs(ends.size());
+	runInParallel(threadCount, [&](const unsigned t)
+	{
+		const size_t first = ends.size() * t / threadCount, last = ends.size() * (t + 1) / threadCount;
+		for (size_t k = first; k < last; ++k) {
+			const size_t start = k == 0 ? 0 : ends[k - 1];
+			crcs[k] = crc64Reversed(data + start, ends[k] - start);
+		}
+	});
+
+	for (size_t k = 0; k < ends.size(); ++k) {
+		Chunk chunk;
+		chunk.offset = k == 0 ? 0 : ends[k - 1];
+		chunk.data = data + chunk.offset;
+		chunk.size = ends[k] - chunk.offset;
+		chunk.crc = crcs[k];
+		handler(chunk);
+	}
+}
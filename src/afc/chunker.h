@@ -0,0 +1,89 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_CHUNKER_H_
+#define AFC_CHUNKER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "stream.h"
+
+namespace afc
+{
+	struct ChunkerOptions
+	{
+		// The minimal size is at least 64 and not greater than the average size.
+		std::size_t minSize = 2 * 1024;
+		std::size_t averageSize = 8 * 1024;
+		// The maximal size is not less than the average size and not greater than 1 GiB.
+		std::size_t maxSize = 64 * 1024;
+	};
+
+	struct Chunk
+	{
+		std::uint64_t offset;
+		// Valid only within the handler call.
+		const unsigned char *data;
+		std::size_t size;
+		// crc64Reversed of the chunk.
+		std::uint64_t crc;
+	};
+
+	typedef std::function<void (const Chunk &chunk)> ChunkHandler;
+
+	/* Content-defined chunking (FastCDC): a chunk ends where the Gear rolling hash of the last
+	 * 64 octets matches a mask, so an insertion or a deletion changes only the chunks around it.
+	 * A stricter mask is used for chunks shorter than the average size and a looser one for
+	 * longer chunks, which keeps the sizes close to the average.
+	 *
+	 * The CRC-64 of each chunk is computed in the same pass: the data is hashed and checksummed
+	 * in blocks that stay in the L1 cache. All the modes produce the same chunks for the same data.
+	 */
+	class ContentChunker
+	{
+	public:
+		// Throws afc::Exception if the options are invalid.
+		explicit ContentChunker(const ChunkerOptions &options = ChunkerOptions());
+
+		/* Returns the size of the first chunk of the data and sets crc to its checksum.
+		 * The data must contain at least maxSize octets unless it is the end of the input.
+		 */
+		std::size_t cut(const unsigned char *data, std::size_t n, std::uint64_t &crc) const noexcept;
+
+		void split(InputStream &in, const ChunkHandler &handler) const;
+		void split(const unsigned char *data, std::size_t n, const ChunkHandler &handler) const;
+
+		/* Finds candidate cut points in parallel (the hash depends only on the last 64 octets,
+		 * so each thread hashes its own part of the data), resolves them into chunks sequentially
+		 * and checksums the chunks in parallel. The handler is invoked within the calling thread
+		 * in the order of the chunks. Meant for memory-mapped files.
+		 *
+		 * threadCount == 0 means the number of hardware threads.
+		 */
+		void splitParallel(const unsigned char *data, std::size_t n, const ChunkHandler &handler,
+				unsigned threadCount = 0) const;
+	private:
+		const std::size_t m_minSize;
+		const std::size_t m_averageSize;
+		const std::size_t m_maxSize;
+		// Used for chunks shorter than the average size.
+		const std::uint64_t m_strictMask;
+		const std::uint64_t m_looseMask;
+	};
+}
+
+#endif /*AFC_CHUNKER_H_*/
@@ -0,0 +1,534 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "codec_stream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#ifdef __SSSE3__
+	#include <tmmintrin.h>
+#endif
+
+#include "ascii.hpp"
+#include "base64.hpp"
+#include "builtin.hpp"
+#include "Exception.h"
+#include "number.h"
+#include "StringRef.hpp"
+
+using namespace afc;
+using namespace std;
+
+namespace
+{
+	// The number of encoded characters processed at once.
+	const size_t codecBlockSize = 64 * 1024;
+	const unsigned char invalidDigit = 0xff;
+
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	/* Encodes tripletCount * 3 octets into tripletCount * 4 characters.
+	 *
+	 * Twelve octets are encoded at once with SSSE3 (W. Muła's algorithm). Sixteen octets are
+	 * loaded each time, so the last few triplets are encoded one by one.
+	 */
+	void encodeBase64Triplets(const unsigned char *src, size_t tripletCount, unsigned char *dest) noexcept
+	{
+#ifdef __SSSE3__
+		const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+		const __m128i shiftLut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+				'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+		for (; tripletCount >= 6; tripletCount -= 4, src += 12, dest += 16) {
+			const __m128i in = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)), shuffle);
+			// Each 32-bit lane holds a triplet; 6-bit groups are moved to separate octets.
+			const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+			const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+			const __m128i indices = _mm_or_si128(t0, t1);
+
+			// Maps 0..25 to 13, 26..51 to 0, 52..61 to 1..10, 62 to 11, 63 to 12 to select the offset.
+			__m128i lutIndex = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+			lutIndex = _mm_or_si128(lutIndex, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+			const __m128i chars = _mm_add_epi8(_mm_shuffle_epi8(shiftLut, lutIndex), indices);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dest), chars);
+		}
+#endif
+		for (; tripletCount > 0; --tripletCount, dest += 4) {
+			src = afc::_impl::encodeTriplet(src, reinterpret_cast<char *>(dest));
+		}
+	}
+
+	// Encodes n octets into 2n lower-case hex digits.
+	void encodeHex(const unsigned char *src, size_t n, unsigned char *dest) noexcept
+	{
+#ifdef __SSSE3__
+		const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+		const __m128i lowNibble = _mm_set1_epi8(0x0f);
+		for (; n >= 16; n -= 16, src += 16, dest += 32) {
+			const __m128i octets = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+			const __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(octets, 4), lowNibble));
+			const __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(octets, lowNibble));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_unpacklo_epi8(hi, lo));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 16), _mm_unpackhi_epi8(hi, lo));
+		}
+#endif
+		for (; n > 0; --n, dest += 2) {
+			afc::octetToHex(*src++, dest);
+		}
+	}
+
+	/* Base64 digits shifted to their positions within a quartet. Invalid characters have
+	 * bit 24 set, which is never set for valid quartets.
+	 */
+	struct Base64DecodeTables
+	{
+		uint32_t shifted[4][256];
+		unsigned char digit[256];
+
+		Base64DecodeTables() noexcept
+		{
+			std::memset(digit, invalidDigit, sizeof(digit));
+			for (unsigned i = 0; i < 64; ++i) {
+				digit[static_cast<unsigned char>(afc::_impl::base64EncodeTable[i])] = static_cast<unsigned char>(i);
+			}
+			for (unsigned c = 0; c < 256; ++c) {
+				for (unsigned pos = 0; pos < 4; ++pos) {
+					shifted[pos][c] = digit[c] == invalidDigit ? 0x01000000 : uint32_t(digit[c]) << (18 - 6 * pos);
+				}
+			}
+		}
+	};
+
+	const Base64DecodeTables base64DecodeTables;
+
+	[[noreturn]]
+	void throwMalformedBase64()
+	{
+		throw Exception("malformed base64 input"_s);
+	}
+
+	[[noreturn]]
+	void throwMalformedHex()
+	{
+		throw Exception("malformed hex input"_s);
+	}
+}
+
+afc::_impl::CodecBlock::CodecBlock(const size_t capacity) : m_capacity(capacity)
+{
+	void *data;
+	if (::posix_memalign(&data, 64, capacity) != 0) {
+		throw bad_alloc();
+	}
+	m_data = static_cast<unsigned char *>(data);
+}
+
+afc::_impl::CodecBlock::~CodecBlock()
+{
+	std::free(m_data);
+}
+
+afc::Base64EncodingOutputStream::Base64EncodingOutputStream(OutputStream &out, const size_t lineLength)
+	: m_out(out), m_buf(codecBlockSize), m_size(0), m_lineLength(lineLength), m_lineFill(0), m_pendingSize(0),
+	  m_closed(false)
+{
+	if (lineLength % 4 != 0 || lineLength + 2 > codecBlockSize) {
+		throwException("base64 line length must be a multiple of 4"_s);
+	}
+}
+
+afc::Base64EncodingOutputStream::~Base64EncodingOutputStream()
+{
+	if (!m_closed) {
+		try {
+			close();
+		} catch (...) {
+			// Destructors must not throw.
+		}
+	}
+}
+
+void afc::Base64EncodingOutputStream::startLine()
+{
+	if (m_lineLength != 0 && m_lineFill == m_lineLength) {
+		if (m_buf.capacity() - m_size < 2) {
+			flush();
+		}
+		m_buf.data()[m_size++] = '\r';
+		m_buf.data()[m_size++] = '\n';
+		m_lineFill = 0;
+	}
+}
+
+void afc::Base64EncodingOutputStream::put(const unsigned char *triplets, size_t tripletCount)
+{
+	while (tripletCount > 0) {
+		startLine();
+		size_t count = min(tripletCount, (m_buf.capacity() - m_size) / 4);
+		if (m_lineLength != 0) {
+			count = min(count, (m_lineLength - m_lineFill) / 4);
+		}
+		if (count == 0) {
+			flush();
+			continue;
+		}
+		encodeBase64Triplets(triplets, count, m_buf.data() + m_size);
+		triplets += 3 * count;
+		tripletCount -= count;
+		m_size += 4 * count;
+		m_lineFill += 4 * count;
+	}
+}
+
+void afc::Base64EncodingOutputStream::write(const unsigned char * const data, const size_t n)
+{
+	if (unlikely(m_closed)) {
+		throwException("base64 stream is closed"_s);
+	}
+	const unsigned char *p = data;
+	size_t left = n;
+	if (m_pendingSize != 0) {
+		for (; m_pendingSize < 3 && left > 0; --left) {
+			m_pending[m_pendingSize++] = *p++;
+		}
+		if (m_pendingSize < 3) {
+			return;
+		}
+		put(m_pending, 1);
+		m_pendingSize = 0;
+	}
+	const size_t tripletCount = left / 3;
+	put(p, tripletCount);
+	p += 3 * tripletCount;
+	left -= 3 * tripletCount;
+
+	std::memcpy(m_pending, p, left);
+	m_pendingSize = static_cast<unsigned>(left);
+}
+
+void afc::Base64EncodingOutputStream::flush()
+{
+	if (m_size != 0) {
+		m_out.write(m_buf.data(), m_size);
+		m_size = 0;
+	}
+}
+
+void afc::Base64EncodingOutputStream::close()
+{
+	if (m_closed) {
+		return;
+	}
+	m_closed = true;
+	if (m_pendingSize != 0) {
+		startLine();
+		if (m_buf.capacity() - m_size < 4) {
+			flush();
+		}
+		unsigned char * const dest = m_buf.data() + m_size;
+		afc::encodeBase64(m_pending, m_pendingSize, dest);
+		m_size += 4;
+		m_pendingSize = 0;
+	}
+	flush();
+}
+
+afc::Base64DecodingInputStream::Base64DecodingInputStream(InputStream &in)
+	: m_in(in), m_src(codecBlockSize), m_buf(codecBlockSize / 4 * 3 + 3), m_pos(0), m_size(0), m_quartetSize(0),
+	  m_padded(false), m_eof(false)
+{
+}
+
+bool afc::Base64DecodingInputStream::refill()
+{
+	const uint32_t (&shifted)[4][256] = base64DecodeTables.shifted;
+	m_pos = m_size = 0;
+	while (m_size == 0) {
+		if (m_eof) {
+			return false;
+		}
+		const size_t srcSize = m_in.read(m_src.data(), m_src.capacity());
+		const unsigned char *p = m_src.data();
+		const unsigned char * const end = p + srcSize;
+		unsigned char *dest = m_buf.data();
+
+		if (srcSize == 0) {
+			m_eof = true;
+			// Unpadded input.
+			switch (m_quartetSize) {
+			case 0:
+				break;
+			case 1:
+				throwMalformedBase64();
+			case 2:
+				*dest++ = static_cast<unsigned char>((m_quartet[0] << 2) | (m_quartet[1] >> 4));
+				break;
+			case 3:
+				*dest++ = static_cast<unsigned char>((m_quartet[0] << 2) | (m_quartet[1] >> 4));
+				*dest++ = static_cast<unsigned char>((m_quartet[1] << 4) | (m_quartet[2] >> 2));
+				break;
+			}
+			m_quartetSize = 0;
+			m_size = static_cast<size_t>(dest - m_buf.data());
+			return m_size != 0;
+		}
+
+		while (p != end) {
+			// Whole quartets without whitespace are decoded at once.
+			if (m_quartetSize == 0 && !m_padded) {
+				while (end - p >= 4) {
+					const uint32_t v = shifted[0][p[0]] | shifted[1][p[1]] | shifted[2][p[2]] | shifted[3][p[3]];
+					if (unlikely(v >= 0x01000000)) {
+						break;
+					}
+					dest[0] = static_cast<unsigned char>(v >> 16);
+					dest[1] = static_cast<unsigned char>(v >> 8);
+					dest[2] = static_cast<unsigned char>(v);
+					dest += 3;
+					p += 4;
+				}
+				if (p == end) {
+					break;
+				}
+			}
+
+			const unsigned char c = *p++;
+			if (ascii::is<ascii::space>(c)) {
+				continue;
+			}
+			if (c == '=') {
+				if (!m_padded) {
+					if (m_quartetSize < 2) {
+						throwMalformedBase64();
+					}
+					*dest++ = static_cast<unsigned char>((m_quartet[0] << 2) | (m_quartet[1] >> 4));
+					if (m_quartetSize == 3) {
+						*dest++ = static_cast<unsigned char>((m_quartet[1] << 4) | (m_quartet[2] >> 2));
+					}
+					m_quartetSize = 0;
+					m_padded = true;
+				}
+				continue;
+			}
+			const unsigned char digit = base64DecodeTables.digit[c];
+			if (unlikely(digit == invalidDigit || m_padded)) {
+				throwMalformedBase64();
+			}
+			m_quartet[m_quartetSize++] = digit;
+			if (m_quartetSize == 4) {
+				dest[0] = static_cast<unsigned char>((m_quartet[0] << 2) | (m_quartet[1] >> 4));
+				dest[1] = static_cast<unsigned char>((m_quartet[1] << 4) | (m_quartet[2] >> 2));
+				dest[2] = static_cast<unsigned char>((m_quartet[2] << 6) | m_quartet[3]);
+				dest += 3;
+				m_quartetSize = 0;
+			}
+		}
+		m_size = static_cast<size_t>(dest - m_buf.data());
+	}
+	return true;
+}
+
+size_t afc::Base64DecodingInputStream::read(unsigned char * const data, const size_t n)
+{
+	size_t total = 0;
+	while (total < n) {
+		if (m_pos == m_size && !refill()) {
+			break;
+		}
+		const size_t count = min(n - total, m_size - m_pos);
+		std::memcpy(data + total, m_buf.data() + m_pos, count);
+		m_pos += count;
+		total += count;
+	}
+	return total;
+}
+
+void afc::Base64DecodingInputStream::reset()
+{
+	m_in.reset();
+	m_pos = m_size = 0;
+	m_quartetSize = 0;
+	m_padded = false;
+	m_eof = false;
+}
+
+size_t afc::Base64DecodingInputStream::skip(const size_t n)
+{
+	size_t total = 0;
+	while (total < n) {
+		if (m_pos == m_size && !refill()) {
+			break;
+		}
+		const size_t count = min(n - total, m_size - m_pos);
+		m_pos += count;
+		total += count;
+	}
+	return total;
+}
+
+afc::HexEncodingOutputStream::HexEncodingOutputStream(OutputStream &out)
+	: m_out(out), m_buf(codecBlockSize), m_size(0), m_closed(false)
+{
+}
+
+afc::HexEncodingOutputStream::~HexEncodingOutputStream()
+{
+	if (!m_closed) {
+		try {
+			close();
+		} catch (...) {
+			// Destructors must not throw.
+		}
+	}
+}
+
+void afc::HexEncodingOutputStream::write(const unsigned char * const data, const size_t n)
+{
+	if (unlikely(m_closed)) {
+		throwException("hex stream is closed"_s);
+	}
+	const unsigned char *p = data;
+	size_t left = n;
+	while (left > 0) {
+		const size_t count = min(left, (m_buf.capacity() - m_size) / 2);
+		if (count == 0) {
+			flush();
+			continue;
+		}
+		encodeHex(p, count, m_buf.data() + m_size);
+		p += count;
+		left -= count;
+		m_size += 2 * count;
+	}
+}
+
+void afc::HexEncodingOutputStream::flush()
+{
+	if (m_size != 0) {
+		m_out.write(m_buf.data(), m_size);
+		m_size = 0;
+	}
+}
+
+void afc::HexEncodingOutputStream::close()
+{
+	if (!m_closed) {
+		m_closed = true;
+		flush();
+	}
+}
+
+afc::HexDecodingInputStream::HexDecodingInputStream(InputStream &in)
+	: m_in(in), m_src(codecBlockSize), m_buf(codecBlockSize / 2 + 1), m_pos(0), m_size(0), m_highDigit(invalidDigit),
+	  m_eof(false)
+{
+}
+
+bool afc::HexDecodingInputStream::refill()
+{
+	const unsigned char * const asciiToDigit = afc::numdata<>::asciiToDigit;
+	m_pos = m_size = 0;
+	while (m_size == 0) {
+		if (m_eof) {
+			return false;
+		}
+		const size_t srcSize = m_in.read(m_src.data(), m_src.capacity());
+		if (srcSize == 0) {
+			m_eof = true;
+			if (m_highDigit != invalidDigit) {
+				throwMalformedHex();
+			}
+			return false;
+		}
+		const unsigned char *p = m_src.data();
+		const unsigned char * const end = p + srcSize;
+		unsigned char *dest = m_buf.data();
+		while (p != end) {
+			if (m_highDigit == invalidDigit) {
+				// Pairs of digits without whitespace are decoded at once.
+				while (end - p >= 2) {
+					const unsigned hi = asciiToDigit[p[0]];
+					const unsigned lo = asciiToDigit[p[1]];
+					if (unlikely((hi | lo) >= 16)) {
+						break;
+					}
+					*dest++ = static_cast<unsigned char>((hi << 4) | lo);
+					p += 2;
+				}
+				if (p == end) {
+					break;
+				}
+			}
+			const unsigned char c = *p++;
+			if (ascii::is<ascii::space>(c)) {
+				continue;
+			}
+			const unsigned char digit = asciiToDigit[c];
+			if (unlikely(digit >= 16)) {
+				throwMalformedHex();
+			}
+			if (m_highDigit == invalidDigit) {
+				m_highDigit = digit;
+			} else {
+				*dest++ = static_cast<unsigned char>((m_highDigit << 4) | digit);
+				m_highDigit = invalidDigit;
+			}
+		}
+		m_size = static_cast<size_t>(dest - m_buf.data());
+	}
+	return true;
+}
+
+size_t afc::HexDecodingInputStream::read(unsigned char * const data, const size_t n)
+{
+	size_t total = 0;
+	while (total < n) {
+		if (m_pos == m_size && !refill()) {
+			break;
+		}
+		const size_t count = min(n - total, m_size - m_pos);
+		std::memcpy(data + total, m_buf.data() + m_pos, count);
+		m_pos += count;
+		total += count;
+	}
+	return total;
+}
+
+void afc::HexDecodingInputStream::reset()
+{
+	m_in.reset();
+	m_pos = m_size = 0;
+	m_highDigit = invalidDigit;
+	m_eof = false;
+}
+
+size_t afc::HexDecodingInputStream::skip(const size_t n)
+{
+	size_t total = 0;
+	while (total < n) {
+		if (m_pos == m_size && !refill()) {
+			break;
+		}
+		const size_t count = min(n - total, m_size - m_pos);
+		m_pos += count;
+		total += count;
+	}
+	return total;
+}
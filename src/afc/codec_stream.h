@@ -0,0 +1,167 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_CODEC_STREAM_H_
+#define AFC_CODEC_STREAM_H_
+
+#include <cstddef>
+
+#include "stream.h"
+
+namespace afc
+{
+	/* Stream decorators that encode (decode) the data passed through them to (from) base64 and hex.
+	 *
+	 * Data is processed in blocks of fixed size, so memory used does not depend on the size of
+	 * the payload. The underlying streams are not owned and not closed by the decorators.
+	 */
+
+	namespace _impl
+	{
+		// A 64-byte aligned block that is large enough for vectorised codec kernels to be efficient.
+		class CodecBlock
+		{
+		public:
+			explicit CodecBlock(std::size_t capacity);
+			CodecBlock(const CodecBlock &) = delete;
+			~CodecBlock();
+
+			CodecBlock &operator=(const CodecBlock &) = delete;
+
+			unsigned char *data() const noexcept { return m_data; }
+			std::size_t capacity() const noexcept { return m_capacity; }
+		private:
+			unsigned char *m_data;
+			const std::size_t m_capacity;
+		};
+	}
+
+	class Base64EncodingOutputStream : public OutputStream
+	{
+	public:
+		/* If lineLength is not zero then lines of encoded characters are delimited with CRLF,
+		 * as in MIME (which uses 76). lineLength must be a multiple of 4.
+		 */
+		explicit Base64EncodingOutputStream(OutputStream &out, std::size_t lineLength = 0);
+		Base64EncodingOutputStream(const Base64EncodingOutputStream &) = delete;
+		// Finishes encoding if close() has not been called. Errors are ignored.
+		~Base64EncodingOutputStream();
+
+		Base64EncodingOutputStream &operator=(const Base64EncodingOutputStream &) = delete;
+
+		virtual void write(const unsigned char * const data, const std::size_t n);
+		// Passes the characters encoded so far to the underlying stream. Up to two trailing octets are kept.
+		void flush();
+		// Encodes the trailing octets with padding and flushes. The underlying stream is not closed.
+		void close();
+	private:
+		void put(const unsigned char *triplets, std::size_t tripletCount);
+		void startLine();
+
+		OutputStream &m_out;
+		_impl::CodecBlock m_buf;
+		std::size_t m_size;
+		const std::size_t m_lineLength;
+		std::size_t m_lineFill;
+		unsigned char m_pending[3];
+		unsigned m_pendingSize;
+		bool m_closed;
+	};
+
+	/* Decodes base64 with or without padding. Whitespace (e.g. line breaks) is ignored.
+	 * afc::Exception is thrown if malformed input is read.
+	 */
+	class Base64DecodingInputStream : public InputStream
+	{
+	public:
+		explicit Base64DecodingInputStream(InputStream &in);
+		Base64DecodingInputStream(const Base64DecodingInputStream &) = delete;
+
+		Base64DecodingInputStream &operator=(const Base64DecodingInputStream &) = delete;
+
+		virtual std::size_t read(unsigned char * const data, const std::size_t n);
+		// Resets the underlying stream and starts decoding from its beginning.
+		virtual void reset();
+		virtual std::size_t skip(const std::size_t n);
+		// The underlying stream is not closed.
+		virtual void close() {}
+	private:
+		bool refill();
+
+		InputStream &m_in;
+		_impl::CodecBlock m_src;
+		_impl::CodecBlock m_buf;
+		std::size_t m_pos;
+		std::size_t m_size;
+		unsigned char m_quartet[4];
+		unsigned m_quartetSize;
+		bool m_padded;
+		bool m_eof;
+	};
+
+	// Encodes each octet as two lower-case hex digits.
+	class HexEncodingOutputStream : public OutputStream
+	{
+	public:
+		explicit HexEncodingOutputStream(OutputStream &out);
+		HexEncodingOutputStream(const HexEncodingOutputStream &) = delete;
+		// Flushes if close() has not been called. Errors are ignored.
+		~HexEncodingOutputStream();
+
+		HexEncodingOutputStream &operator=(const HexEncodingOutputStream &) = delete;
+
+		virtual void write(const unsigned char * const data, const std::size_t n);
+		void flush();
+		// The underlying stream is not closed.
+		void close();
+	private:
+		OutputStream &m_out;
+		_impl::CodecBlock m_buf;
+		std::size_t m_size;
+		bool m_closed;
+	};
+
+	/* Decodes hex digits of either case. Whitespace is ignored.
+	 * afc::Exception is thrown if malformed input is read.
+	 */
+	class HexDecodingInputStream : public InputStream
+	{
+	public:
+		explicit HexDecodingInputStream(InputStream &in);
+		HexDecodingInputStream(const HexDecodingInputStream &) = delete;
+
+		HexDecodingInputStream &operator=(const HexDecodingInputStream &) = delete;
+
+		virtual std::size_t read(unsigned char * const data, const std::size_t n);
+		// Resets the underlying stream and starts decoding from its beginning.
+		virtual void reset();
+		virtual std::size_t skip(const std::size_t n);
+		// The underlying stream is not closed.
+		virtual void close() {}
+	private:
+		bool refill();
+
+		InputStream &m_in;
+		_impl::CodecBlock m_src;
+		_impl::CodecBlock m_buf;
+		std::size_t m_pos;
+		std::size_t m_size;
+		// The high digit of an octet split between source blocks or 0xff.
+		unsigned char m_highDigit;
+		bool m_eof;
+	};
+}
+
+#endif /*AFC_CODEC_STREAM_H_*/
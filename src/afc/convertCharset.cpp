@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include <climits>
 #include <cstddef>
 #include <cstring>
+#include <strings.h>
 
 #include "Exception.h"
 #include "cpu/primitive.h"
@@ -27,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "math_utils.h"
 #include "number.h"
 #include "StringRef.hpp"
+#include "utf8.h"
 
 using namespace afc;
 
@@ -34,6 +36,24 @@ namespace
 {
 	const endianness LE = endianness::LE;
 
+	bool isUtf8(const char * const encoding)
+	{
+		return strcasecmp(encoding, "UTF-8") == 0 || strcasecmp(encoding, "UTF8") == 0;
+	}
+
+	void checkUtf8(const char * const src, const std::size_t n)
+	{
+		const char * const invalid = utf8::validate(src, src + n);
+		if (invalid != src + n) {
+			const std::size_t bufCapacity = "Invalid UTF-8 sequence at offset "_s.size() + maxPrintedSize<std::size_t, 10>() + 1;
+			afc::FastStringBuffer<char, afc::AllocMode::accurate> buf(bufCapacity);
+			buf.append("Invalid UTF-8 sequence at offset "_s);
+			buf.returnTail(afc::printNumber<10>(std::size_t(invalid - src), buf.borrowTail()));
+			buf.append('.');
+			throw Exception(String::move(buf));
+		}
+	}
+
 	// RAII iconv wrapper
 	class Iconv
 	{
@@ -125,6 +145,11 @@ afc::U8String afc::convertToUtf8(const char * const src, std::size_t n, const ch
 	if (n == 0) {
 		return afc::String();
 	}
+	if (isUtf8(encoding)) {
+		// Validated and copied as is.
+		checkUtf8(src, n);
+		return afc::String(src, n);
+	}
 
 	Iconv conv("UTF-8", encoding);
 	char *srcBuf = const_cast<char *>(src); // for some reason iconv takes non-const source buffer
@@ -161,6 +186,12 @@ afc::String afc::convertFromUtf8(const char * const src, const std::size_t n, co
 		return afc::String();
 	}
 
+	// Ill-formed input is reported with its position rather than by iconv.
+	checkUtf8(src, n);
+	if (isUtf8(encoding)) {
+		return afc::String(src, n);
+	}
+
 	Iconv conv(encoding, "UTF-8");
 	char *srcBuf = const_cast<char *>(src); // for some reason iconv takes non-const source buffer
 	std::size_t srcSize = n;
@@ -0,0 +1,304 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "crash_handler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// POSIX and GNU API.
+#include <execinfo.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "_fatal_signal.h"
+#include "Exception.h"
+#include "number.h"
+#include "StringRef.hpp"
+
+using namespace afc;
+using namespace std;
+
+namespace
+{
+	const size_t maxFrames = 256;
+	const size_t maxModules = 256;
+	const size_t modulePathStorageSize = 64 * 1024;
+	const size_t maxBuildIdSize = 64;
+	const size_t altStackSize = 64 * 1024;
+
+	struct Module
+	{
+		uintptr_t begin;
+		uintptr_t end;
+		// The load bias. Offsets are relative to it, which is what addr2line expects.
+		uintptr_t base;
+		const char *path;
+		unsigned char buildId[maxBuildIdSize];
+		size_t buildIdSize;
+	};
+
+	// All the state the handler uses is allocated statically so that nothing is allocated on crash.
+	int outputFd = STDERR_FILENO;
+	void *frames[maxFrames];
+	Module modules[maxModules];
+	size_t moduleCount = 0;
+	char modulePaths[modulePathStorageSize];
+
+	// The alternate signal stack allocated for the thread; it is released when the thread exits.
+	struct AltStack
+	{
+		~AltStack()
+		{
+			if (stack != nullptr) {
+				stack_t altStack;
+				memset(&altStack, 0, sizeof(altStack));
+				altStack.ss_flags = SS_DISABLE;
+				::sigaltstack(&altStack, nullptr);
+				::munmap(stack, altStackSize);
+			}
+		}
+
+		void *stack = nullptr;
+	};
+	thread_local AltStack threadAltStack;
+
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	// A fixed-size line that is written with a single write(2) call.
+	class Line
+	{
+	public:
+		Line() noexcept : m_end(m_buf) {}
+
+		Line &operator<<(const ConstStringRef s) noexcept { return append(s.value(), s.size()); }
+		Line &operator<<(const char * const s) noexcept { return append(s, strlen(s)); }
+		Line &operator<<(const char c) noexcept { return append(&c, 1); }
+		Line &operator<<(const unsigned long n) noexcept
+		{
+			if (available() >= maxPrintedSize<unsigned long, 10>()) {
+				m_end = printNumber<10>(n, m_end);
+			}
+			return *this;
+		}
+
+		Line &hex(const uintptr_t n) noexcept
+		{
+			if (available() >= 2 + maxPrintedSize<uintptr_t, 16>()) {
+				*m_end++ = '0';
+				*m_end++ = 'x';
+				m_end = printNumber<16>(n, m_end);
+			}
+			return *this;
+		}
+
+		Line &hex(const unsigned char * const data, const size_t n) noexcept
+		{
+			for (size_t i = 0; i < n && available() >= 2; ++i) {
+				m_end = octetToHex(data[i], m_end);
+			}
+			return *this;
+		}
+
+		void write() noexcept
+		{
+			*this << '\n';
+			const char *p = m_buf;
+			while (p != m_end) {
+				const ssize_t n = ::write(outputFd, p, m_end - p);
+				if (n <= 0) {
+					if (n < 0 && errno == EINTR) {
+						continue;
+					}
+					return;
+				}
+				p += n;
+			}
+		}
+	private:
+		size_t available() const noexcept { return sizeof(m_buf) - (m_end - m_buf); }
+
+		Line &append(const char * const s, const size_t n) noexcept
+		{
+			m_end = copy_n(s, min(n, available()), m_end);
+			return *this;
+		}
+
+		char m_buf[1024];
+		char *m_end;
+	};
+
+	const char *signalName(const int sig) noexcept
+	{
+		switch (sig) {
+		case SIGSEGV: return "SIGSEGV";
+		case SIGBUS: return "SIGBUS";
+		case SIGILL: return "SIGILL";
+		case SIGFPE: return "SIGFPE";
+		case SIGABRT: return "SIGABRT";
+		default: return "?";
+		}
+	}
+
+	void readBuildId(const dl_phdr_info &info, const ElfW(Phdr) &header, Module &module) noexcept
+	{
+		const char *p = reinterpret_cast<const char *>(info.dlpi_addr + header.p_vaddr);
+		const char * const end = p + header.p_memsz;
+		while (p + sizeof(ElfW(Nhdr)) <= end) {
+			const ElfW(Nhdr) &note = *reinterpret_cast<const ElfW(Nhdr) *>(p);
+			const char * const name = p + sizeof(ElfW(Nhdr));
+			const char * const desc = name + ((note.n_namesz + 3) & ~3U);
+			if (note.n_type == NT_GNU_BUILD_ID && note.n_namesz == 4 && memcmp(name, "GNU", 4) == 0 &&
+					note.n_descsz <= maxBuildIdSize) {
+				memcpy(module.buildId, desc, note.n_descsz);
+				module.buildIdSize = note.n_descsz;
+				return;
+			}
+			p = desc + ((note.n_descsz + 3) & ~3U);
+		}
+	}
+
+	int collectModule(dl_phdr_info * const info, size_t, void * const data)
+	{
+		size_t &pathStorageUsed = *static_cast<size_t *>(data);
+		if (moduleCount == maxModules) {
+			return 1;
+		}
+		Module &module = modules[moduleCount];
+		module.begin = UINTPTR_MAX;
+		module.end = 0;
+		module.base = info->dlpi_addr;
+		module.buildIdSize = 0;
+		for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+			const ElfW(Phdr) &header = info->dlpi_phdr[i];
+			if (header.p_type == PT_LOAD) {
+				module.begin = min<uintptr_t>(module.begin, info->dlpi_addr + header.p_vaddr);
+				module.end = max<uintptr_t>(module.end, info->dlpi_addr + header.p_vaddr + header.p_memsz);
+			} else if (header.p_type == PT_NOTE && module.buildIdSize == 0) {
+				readBuildId(*info, header, module);
+			}
+		}
+		if (module.begin >= module.end) {
+			return 0;
+		}
+
+		// The main executable has an empty name.
+		const char *path = info->dlpi_name;
+		char execPath[4096];
+		if (path == nullptr || path[0] == '\0') {
+			const ssize_t n = ::readlink("/proc/self/exe", execPath, sizeof(execPath) - 1);
+			execPath[n > 0 ? n : 0] = '\0';
+			path = execPath;
+		}
+		const size_t pathSize = strlen(path) + 1;
+		if (pathStorageUsed + pathSize > sizeof(modulePaths)) {
+			return 1;
+		}
+		module.path = copy_n(path, pathSize, modulePaths + pathStorageUsed) - pathSize;
+		pathStorageUsed += pathSize;
+		++moduleCount;
+		return 0;
+	}
+
+	const Module *findModule(const uintptr_t address) noexcept
+	{
+		for (size_t i = 0; i < moduleCount; ++i) {
+			if (address >= modules[i].begin && address < modules[i].end) {
+				return &modules[i];
+			}
+		}
+		return nullptr;
+	}
+
+	void reportCrash(const int sig, siginfo_t * const info)
+	{
+		(Line() << "*** fatal signal "_s << static_cast<unsigned long>(sig) << " ("_s << signalName(sig)
+				<< "), fault address "_s).hex(reinterpret_cast<uintptr_t>(info->si_addr)).write();
+
+		const int frameCount = ::backtrace(frames, maxFrames);
+		for (int i = 0; i < frameCount; ++i) {
+			const uintptr_t address = reinterpret_cast<uintptr_t>(frames[i]);
+			Line line;
+			(line << '#' << static_cast<unsigned long>(i) << ' ').hex(address);
+			const Module * const module = findModule(address);
+			if (module != nullptr) {
+				(line << ' ' << module->path << " + "_s).hex(address - module->base);
+			}
+			line.write();
+		}
+
+		for (size_t i = 0; i < moduleCount; ++i) {
+			const Module &module = modules[i];
+			Line line;
+			line << "module "_s << module.path << " base "_s;
+			line.hex(module.base) << " build-id "_s;
+			if (module.buildIdSize != 0) {
+				line.hex(module.buildId, module.buildIdSize);
+			} else {
+				line << "none"_s;
+			}
+			line.write();
+		}
+	}
+}
+
+void afc::installCrashHandlerAltStack()
+{
+	if (threadAltStack.stack != nullptr) {
+		// The stack allocated for this thread is reused.
+		return;
+	}
+	void * const stack = ::mmap(nullptr, altStackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (stack == MAP_FAILED) {
+		throwException("unable to allocate the alternate signal stack"_s);
+	}
+	stack_t altStack;
+	altStack.ss_sp = stack;
+	altStack.ss_size = altStackSize;
+	altStack.ss_flags = 0;
+	if (::sigaltstack(&altStack, nullptr) == -1) {
+		::munmap(stack, altStackSize);
+		throwException("unable to install the alternate signal stack"_s);
+	}
+	threadAltStack.stack = stack;
+}
+
+void afc::refreshCrashHandlerModules()
+{
+	size_t pathStorageUsed = 0;
+	moduleCount = 0;
+	::dl_iterate_phdr(collectModule, &pathStorageUsed);
+}
+
+void afc::installCrashHandler(const int fd)
+{
+	outputFd = fd;
+	refreshCrashHandlerModules();
+
+	// The first call of backtrace() loads the unwinder, which is not async-signal-safe.
+	::backtrace(frames, 1);
+
+	installCrashHandlerAltStack();
+
+	_impl::addFatalSignalCallback(reportCrash);
+}
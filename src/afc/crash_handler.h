@@ -0,0 +1,45 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_CRASH_HANDLER_H_
+#define AFC_CRASH_HANDLER_H_
+
+namespace afc
+{
+	/* Installs an async-signal-safe handler of SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT.
+	 *
+	 * On a fatal signal the handler runs on an alternate signal stack, captures the raw frames
+	 * into preallocated memory and writes them to fd with write(2) only, without allocating
+	 * memory or symbolising addresses. Each frame is printed with the module it belongs to and
+	 * its offset within the module, and each module with its GNU build-id, so that the stack
+	 * can be symbolised offline, e.g. with 'addr2line -Cfe <module> <offset>...'.
+	 * The signal is then re-raised with the action that was installed before the handler
+	 * (the default action if there was none), so other crash handlers still run. The handler
+	 * is shared with afc::logger::installFlightRecorderCrashHook().
+	 *
+	 * The list of loaded modules is captured at installation; call refreshCrashHandlerModules()
+	 * after loading shared objects with dlopen().
+	 */
+	void installCrashHandler(int fd);
+
+	/* Provides the calling thread with its own alternate signal stack (a crash can be a stack overflow).
+	 * The stack is allocated once per thread and released when the thread exits.
+	 */
+	void installCrashHandlerAltStack();
+
+	void refreshCrashHandlerModules();
+}
+
+#endif /*AFC_CRASH_HANDLER_H_*/
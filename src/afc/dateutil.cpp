@@ -16,6 +16,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "dateutil.hpp"
 
+#include <cstring>
 #include <time.h>
 
 #include "builtin.hpp"
@@ -78,6 +79,107 @@ namespace
 		return true;
 	}
 
+	const char weekDayNames[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+
+	// The range of the formatters: 0000-01-01T00:00:00Z to 9999-12-31T23:59:59Z.
+	const int64_t minFormattedSecond = -62167219200;
+	const int64_t maxFormattedSecond = 253402300799;
+
+	inline int64_t clampFormattedSecond(const int64_t second) noexcept
+	{
+		return second < minFormattedSecond ? minFormattedSecond : second > maxFormattedSecond ? maxFormattedSecond : second;
+	}
+	const char monthNames[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+	struct HttpDateCache
+	{
+		bool valid;
+		int64_t second;
+		char text[afc::httpDateSize()];
+	};
+
+	struct RFC3339DateTimeCache
+	{
+		bool valid;
+		int64_t second;
+		long gmtOffset;
+		size_t size;
+		char text[afc::maxRFC3339DateTimeSize()];
+	};
+
+	// Zero-initialised PODs need no per-thread construction.
+	thread_local HttpDateCache httpDateCache;
+	thread_local RFC3339DateTimeCache rfc3339DateTimeCache;
+
+	struct CivilTime
+	{
+		int64_t days;
+		int64_t year;
+		unsigned month, day, hour, minute, second;
+
+		explicit CivilTime(const int64_t time) noexcept
+		{
+			days = afc::helper::floorDiv(time, 86400);
+			afc::helper::civilFromDays(days, year, month, day);
+			const unsigned secondOfDay = static_cast<unsigned>(time - days * 86400);
+			hour = secondOfDay / 3600;
+			minute = secondOfDay / 60 % 60;
+			second = secondOfDay % 60;
+		}
+	};
+
+	// "XX:XX:XX"
+	char *printTime(const CivilTime &t, char *dest) noexcept
+	{
+		dest = afc::printTwoDigits(t.hour, dest);
+		*dest++ = ':';
+		dest = afc::printTwoDigits(t.minute, dest);
+		*dest++ = ':';
+		return afc::printTwoDigits(t.second, dest);
+	}
+
+	inline bool parseChar(const char *&p, const char c) noexcept
+	{
+		if (unlikely(*p != c)) {
+			return false;
+		}
+		++p;
+		return true;
+	}
+
+	// Returns the index of the name that starts at p or -1.
+	template<std::size_t n>
+	inline int parseName(const char *&p, const char (&names)[n][4]) noexcept
+	{
+		for (std::size_t i = 0; i < n; ++i) {
+			if (std::memcmp(p, names[i], 3) == 0) {
+				p += 3;
+				return static_cast<int>(i);
+			}
+		}
+		return -1;
+	}
+
+	// "XX:XX:XX" in seconds. A leap second is folded into the next minute.
+	inline bool parseTime(const char *&p, int64_t &dest) noexcept
+	{
+		unsigned hour, minute, second;
+		if (unlikely(!parseTwoDigits(p, hour) || !parseChar(p, u8":"[0]) || !parseTwoDigits(p, minute) ||
+				!parseChar(p, u8":"[0]) || !parseTwoDigits(p, second))) {
+			return false;
+		}
+		if (unlikely(hour > 23 || minute > 59 || second > 60)) {
+			return false;
+		}
+		dest = hour * 3600 + minute * 60 + second;
+		return true;
+	}
+
+	inline bool validDate(const int64_t year, const unsigned month, const unsigned day) noexcept
+	{
+		return month >= 1 && month <= 12 && day >= 1 && day <= afc::helper::monthLength(year, month);
+	}
+
 	// TODO rewrite without use of strptime for better performance
 	bool parseDateTime(const char * const str, tm &dateTime)
 	{
@@ -275,3 +377,161 @@ bool afc::parseISODateTime(const char * const begin, const char * const end, Tim
 	dest.setGmtOffset(gmtOffset);
 	return true;
 }
+
+const char *afc::helper::httpDateText(const int64_t second) noexcept
+{
+	HttpDateCache &cache = httpDateCache;
+	if (likely(cache.valid && cache.second == second)) {
+		return cache.text;
+	}
+
+	const CivilTime t(clampFormattedSecond(second));
+
+	char *p = cache.text;
+	p = std::copy_n(weekDayNames[helper::weekDay(t.days)], 3, p);
+	*p++ = ',';
+	*p++ = ' ';
+	p = printTwoDigits(t.day, p);
+	*p++ = ' ';
+	p = std::copy_n(monthNames[t.month - 1], 3, p);
+	*p++ = ' ';
+	p = printFourDigits(t.year, p);
+	*p++ = ' ';
+	p = printTime(t, p);
+	std::memcpy(p, " GMT", 4);
+
+	cache.second = second;
+	cache.valid = true;
+	return cache.text;
+}
+
+const char *afc::helper::rfc3339DateTimeText(const int64_t second, const long gmtOffset, size_t &size) noexcept
+{
+	RFC3339DateTimeCache &cache = rfc3339DateTimeCache;
+	if (likely(cache.valid && cache.second == second && cache.gmtOffset == gmtOffset)) {
+		size = cache.size;
+		return cache.text;
+	}
+
+	const CivilTime t(clampFormattedSecond(second + gmtOffset));
+
+	char *p = cache.text;
+	p = printFourDigits(t.year, p);
+	*p++ = '-';
+	p = printTwoDigits(t.month, p);
+	*p++ = '-';
+	p = printTwoDigits(t.day, p);
+	*p++ = 'T';
+	p = printTime(t, p);
+	std::memcpy(p, ".000", 4);
+	p += 4;
+	if (gmtOffset == 0) {
+		*p++ = 'Z';
+	} else {
+		const long offsetMinutes = (gmtOffset >= 0 ? gmtOffset : -gmtOffset) / 60;
+		*p++ = gmtOffset >= 0 ? '+' : '-';
+		p = printTwoDigits(offsetMinutes / 60 % 100, p);
+		*p++ = ':';
+		p = printTwoDigits(offsetMinutes % 60, p);
+	}
+
+	cache.size = p - cache.text;
+	cache.second = second;
+	cache.gmtOffset = gmtOffset;
+	cache.valid = true;
+	size = cache.size;
+	return cache.text;
+}
+
+bool afc::parseHttpDate(const char * const begin, const char * const end, Timestamp &dest)
+{
+	if (unlikely(size_t(end - begin) != httpDateSize())) {
+		return false;
+	}
+	const char *p = begin;
+	const int weekDay = parseName(p, weekDayNames);
+	if (unlikely(weekDay < 0 || !parseChar(p, u8","[0]) || !parseChar(p, u8" "[0]))) {
+		return false;
+	}
+	unsigned day;
+	if (unlikely(!parseTwoDigits(p, day) || !parseChar(p, u8" "[0]))) {
+		return false;
+	}
+	const int month = parseName(p, monthNames) + 1;
+	unsigned year;
+	if (unlikely(month == 0 || !parseChar(p, u8" "[0]) || !parseFourDigits(p, year) || !parseChar(p, u8" "[0]))) {
+		return false;
+	}
+	int64_t time;
+	if (unlikely(!parseTime(p, time) || std::memcmp(p, " GMT", 4) != 0)) {
+		return false;
+	}
+	// Four digits limit the year to the range of the formatters.
+	if (unlikely(year > 9999 || !validDate(year, unsigned(month), day))) {
+		return false;
+	}
+	const int64_t days = helper::daysFromCivil(year, unsigned(month), day);
+	if (unlikely(helper::weekDay(days) != unsigned(weekDay))) {
+		return false;
+	}
+
+	dest.setMillis((days * 86400 + time) * 1000);
+	return true;
+}
+
+bool afc::parseRFC3339DateTime(const char * const begin, const char * const end, TimestampTZ &dest)
+{
+	// The shortest form is "XXXX-XX-XXTXX:XX:XXZ".
+	if (unlikely(end - begin < 20)) {
+		return false;
+	}
+	const char *p = begin;
+	unsigned year, month, day;
+	if (unlikely(!parseFourDigits(p, year) || !parseChar(p, u8"-"[0]) || !parseTwoDigits(p, month) ||
+			!parseChar(p, u8"-"[0]) || !parseTwoDigits(p, day))) {
+		return false;
+	}
+	const char separator = *p++;
+	if (unlikely(separator != u8"T"[0] && separator != u8"t"[0] && separator != u8" "[0])) {
+		return false;
+	}
+	int64_t time;
+	if (unlikely(!parseTime(p, time) || !validDate(year, month, day))) {
+		return false;
+	}
+
+	unsigned millis = 0;
+	if (*p == u8"."[0]) {
+		++p;
+		const char * const fractionBegin = p;
+		for (unsigned scale = 100; p != end && *p >= u8"0"[0] && *p <= u8"9"[0]; ++p, scale /= 10) {
+			millis += (*p - u8"0"[0]) * scale;
+		}
+		if (unlikely(p == fractionBegin || p == end)) {
+			return false;
+		}
+	}
+
+	long gmtOffset;
+	const char zone = *p++;
+	if (zone == u8"Z"[0] || zone == u8"z"[0]) {
+		gmtOffset = 0;
+	} else if (likely(zone == u8"+"[0] || zone == u8"-"[0])) {
+		unsigned offsetHours, offsetMinutes;
+		if (unlikely(end - p != 5 || !parseTwoDigits(p, offsetHours) || !parseChar(p, u8":"[0]) ||
+				!parseTwoDigits(p, offsetMinutes) || offsetHours > 23 || offsetMinutes > 59)) {
+			return false;
+		}
+		gmtOffset = (zone == u8"+"[0] ? 60 : -60) * long(offsetHours * 60 + offsetMinutes);
+	} else {
+		return false;
+	}
+	if (unlikely(p != end)) {
+		return false;
+	}
+
+	const int64_t utcSeconds = helper::daysFromCivil(year, month, day) * 86400 + time - gmtOffset;
+	dest.setMillis(utcSeconds * 1000 + millis);
+	dest.setGmtOffset(gmtOffset);
+	return true;
+}
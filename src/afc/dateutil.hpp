@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #define AFCDATEUTIL_HPP_
 
 #include "logger.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <ctime>
 #include <cstdint>
@@ -197,6 +198,44 @@ namespace afc
 	template<typename Iterator>
 	Iterator formatISODateTime(const TimestampTZ &time, Iterator dest);
 
+	// The size of IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+	constexpr std::size_t httpDateSize() noexcept
+	{
+		return sizeof("Sun, 06 Nov 1994 08:49:37 GMT") - 1;
+	}
+
+	/* Writes the time as HTTP-date (IMF-fixdate, RFC 7231), i.e. in the RFC 1123 format.
+	 * The text of the last second formatted is cached per thread, so formatting
+	 * of times within the same second is just copying. Years 0 to 9999 are supported;
+	 * times outside this range are clamped to it.
+	 */
+	template<typename Iterator>
+	Iterator formatHttpDate(const Timestamp &time, Iterator dest);
+
+	/* Only IMF-fixdate is accepted (not the obsolete RFC 850 and asctime formats).
+	 * The day of the week must match the date.
+	 */
+	bool parseHttpDate(const char *begin, const char *end, Timestamp &dest);
+
+	// E.g. "2019-03-15T12:30:45.123+03:00".
+	constexpr std::size_t maxRFC3339DateTimeSize() noexcept
+	{
+		return sizeof("XXXX-XX-XXTXX:XX:XX.XXX+XX:XX") - 1;
+	}
+
+	/* Writes the time with milliseconds in the RFC 3339 format in the time zone of the time
+	 * ("Z" is written for UTC). The text of the last second formatted is cached per thread,
+	 * so formatting of times within the same second is copying plus printing milliseconds.
+	 * Years 0 to 9999 are supported; times outside this range are clamped to it.
+	 */
+	template<typename Iterator>
+	Iterator formatRFC3339DateTime(const TimestampTZ &time, Iterator dest);
+
+	/* Accepts any number of fraction digits (the time is truncated to milliseconds),
+	 * 't' and ' ' as the date/time separator and 'z' as UTC.
+	 */
+	bool parseRFC3339DateTime(const char *begin, const char *end, TimestampTZ &dest);
+
 	inline Timestamp now()
 	{
 		/* This implementation works only for POSIX-compatible systems that store time in
@@ -212,6 +251,58 @@ namespace afc
 			static const bool initialised;
 		};
 
+		inline std::int64_t floorDiv(const std::int64_t x, const std::int64_t y) noexcept
+		{
+			return x >= 0 ? x / y : -((y - 1 - x) / y);
+		}
+
+		inline bool isLeapYear(const std::int64_t year) noexcept
+		{
+			return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+		}
+
+		// The first month is 1.
+		inline unsigned monthLength(const std::int64_t year, const unsigned month) noexcept
+		{
+			return month == 2 ? 28 + isLeapYear(year) : 30 + ((month + (month >> 3)) & 1);
+		}
+
+		// The number of days since 1970-01-01 of the date of the proleptic Gregorian calendar (by H. Hinnant).
+		inline std::int64_t daysFromCivil(std::int64_t year, const unsigned month, const unsigned day) noexcept
+		{
+			year -= month <= 2;
+			const std::int64_t era = floorDiv(year, 400);
+			const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+			const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+			const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+			return era * 146097 + dayOfEra - 719468;
+		}
+
+		inline void civilFromDays(std::int64_t days, std::int64_t &year, unsigned &month, unsigned &day) noexcept
+		{
+			days += 719468;
+			const std::int64_t era = floorDiv(days, 146097);
+			const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+			const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+			const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+			const unsigned mp = (5 * dayOfYear + 2) / 153;
+			day = dayOfYear - (153 * mp + 2) / 5 + 1;
+			month = mp < 10 ? mp + 3 : mp - 9;
+			year = yearOfEra + era * 400 + (month <= 2);
+		}
+
+		// Sunday is 0.
+		inline unsigned weekDay(const std::int64_t days) noexcept
+		{
+			// 1970-01-01 is Thursday.
+			return static_cast<unsigned>((days % 7 + 11) % 7);
+		}
+
+		// Return thread-local buffers with the text of the second.
+		const char *httpDateText(std::int64_t second) noexcept;
+		// "XXXX-XX-XXTXX:XX:XX.000" followed by the offset. The milliseconds are to be patched.
+		const char *rfc3339DateTimeText(std::int64_t second, long gmtOffset, std::size_t &size) noexcept;
+
 		template<typename T, typename Iterator>
 		inline Iterator printISOYear(const T year, Iterator dest)
 		{
@@ -292,5 +383,26 @@ Iterator afc::formatISODateTime(const afc::TimestampTZ &time, Iterator dest)
 	return dest;
 }
 
+template<typename Iterator>
+inline Iterator afc::formatHttpDate(const afc::Timestamp &time, Iterator dest)
+{
+	return std::copy_n(afc::helper::httpDateText(afc::helper::floorDiv(time.millis(), 1000)), afc::httpDateSize(), dest);
+}
+
+template<typename Iterator>
+inline Iterator afc::formatRFC3339DateTime(const afc::TimestampTZ &time, Iterator dest)
+{
+	const std::int64_t second = afc::helper::floorDiv(time.millis(), 1000);
+	const unsigned millis = static_cast<unsigned>(time.millis() - second * 1000);
+	std::size_t size;
+	const char * const text = afc::helper::rfc3339DateTimeText(second, time.getGmtOffset(), size);
+
+	const std::size_t millisPos = sizeof("XXXX-XX-XXTXX:XX:XX.") - 1;
+	dest = std::copy_n(text, millisPos, dest);
+	*dest++ = static_cast<char>('0' + millis / 100);
+	dest = afc::printTwoDigits(millis % 100, dest);
+	return std::copy_n(text + millisPos + 3, size - millisPos - 3, dest);
+}
+
 #endif /* AFCDATEUTIL_HPP_ */
 
@@ -0,0 +1,311 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "flight_recorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <streambuf>
+
+// POSIX API.
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "_fatal_signal.h"
+#include "builtin.hpp"
+#include "Exception.h"
+#include "math_utils.h"
+#include "number.h"
+#include "StackTrace.h"
+
+using namespace afc;
+using namespace afc::logger;
+using namespace std;
+
+/* The file consists of the header page followed by the data area. The data area
+ * is mapped twice back to back, so records are copied without handling wrap points.
+ */
+struct afc::logger::FlightRecorder::FileHeader
+{
+	char magic[8];
+	uint64_t capacity;
+	// The total number of octets reserved since the file is created. Never wraps.
+	atomic<uint64_t> writePos;
+};
+
+namespace
+{
+	const char fileMagic[8] = {'A', 'F', 'C', 'F', 'L', 'R', 'E', 'C'};
+
+	/* A record is aligned to recordAlignment. Its header is committed after the payload
+	 * is copied by storing the position of the record plus one, so neither a zero-filled
+	 * area nor a stale record from a previous lap is treated as a valid record.
+	 */
+	struct RecordHeader
+	{
+		atomic<uint64_t> tag;
+		uint32_t size;
+		uint32_t reserved;
+	};
+
+	const size_t recordAlignment = 8;
+
+	static_assert(sizeof(RecordHeader) % recordAlignment == 0, "RecordHeader breaks the alignment of records.");
+	static_assert(sizeof(atomic<uint64_t>) == sizeof(uint64_t) && ATOMIC_LLONG_LOCK_FREE == 2,
+			"64-bit atomics must be lock-free to be shared via a file mapping.");
+
+	inline size_t recordSize(const size_t payloadSize) noexcept
+	{
+		return (sizeof(RecordHeader) + payloadSize + recordAlignment - 1) & ~(recordAlignment - 1);
+	}
+
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	size_t pageSize() noexcept
+	{
+		return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+	}
+
+	/* Maps the header page and the data area which follows it, and then maps the data area once more
+	 * right after the first mapping. Returns nullptr in case of error.
+	 */
+	char *mapFile(const int fd, const size_t capacity, const bool writable) noexcept
+	{
+		const size_t headerSize = pageSize();
+		const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+
+		void * const area = ::mmap(nullptr, headerSize + 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (area == MAP_FAILED) {
+			return nullptr;
+		}
+		char * const start = static_cast<char *>(area);
+		if (::mmap(start, headerSize + capacity, prot, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+				::mmap(start + headerSize + capacity, capacity, prot, MAP_SHARED | MAP_FIXED, fd,
+						static_cast<off_t>(headerSize)) == MAP_FAILED) {
+			::munmap(area, headerSize + 2 * capacity);
+			return nullptr;
+		}
+		return start;
+	}
+
+	ssize_t writeToRecorder(void * const cookie, const char * const buf, const size_t size)
+	{
+		static_cast<FlightRecorder *>(cookie)->append(buf, size);
+		return static_cast<ssize_t>(size);
+	}
+
+	// Collects the text printed to the output stream into records of limited size.
+	class RecorderStreamBuf : public streambuf
+	{
+	public:
+		explicit RecorderStreamBuf(FlightRecorder &recorder) noexcept : m_recorder(recorder)
+		{
+			setp(m_buf, m_buf + sizeof(m_buf));
+		}
+
+		~RecorderStreamBuf() { sync(); }
+	protected:
+		virtual int_type overflow(const int_type c)
+		{
+			sync();
+			if (!traits_type::eq_int_type(c, traits_type::eof())) {
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+			}
+			return traits_type::not_eof(c);
+		}
+
+		virtual int sync()
+		{
+			if (pptr() != pbase()) {
+				m_recorder.append(pbase(), pptr() - pbase());
+				setp(m_buf, m_buf + sizeof(m_buf));
+			}
+			return 0;
+		}
+	private:
+		FlightRecorder &m_recorder;
+		char m_buf[1024];
+	};
+
+	atomic<FlightRecorder *> crashRecorder(nullptr);
+
+	void dumpToRecorder(const int sig, siginfo_t *)
+	{
+		FlightRecorder * const recorder = crashRecorder.load();
+		if (recorder == nullptr) {
+			return;
+		}
+
+		char buf[64];
+		char *p = std::copy_n("fatal signal ", "fatal signal "_s.size(), buf);
+		p = printNumber<10>(sig, p);
+		*p++ = '\n';
+		recorder->append(buf, p - buf);
+
+		RecorderStreamBuf streamBuf(*recorder);
+		ostream out(&streamBuf);
+		StackTrace(1).print(out, "\t");
+		out.flush();
+	}
+}
+
+afc::logger::FlightRecorder::FlightRecorder(const char * const file, const size_t minCapacity)
+{
+	const size_t headerSize = pageSize();
+	if (minCapacity > numeric_limits<size_t>::max() / 4) {
+		throwException("flight recorder capacity is too large"_s);
+	}
+	m_capacity = math::ceilPow2(max(minCapacity, headerSize));
+
+	const int fd = ::open(file, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		throwException("unable to open flight recorder file"_s);
+	}
+
+	struct stat fileStat;
+	if (::fstat(fd, &fileStat) == -1) {
+		::close(fd);
+		throwException("unable to open flight recorder file"_s);
+	}
+	const bool reused = static_cast<size_t>(fileStat.st_size) == headerSize + m_capacity;
+	if (!reused && ::ftruncate(fd, static_cast<off_t>(headerSize + m_capacity)) == -1) {
+		::close(fd);
+		throwException("unable to allocate flight recorder file"_s);
+	}
+
+	m_mapping = mapFile(fd, m_capacity, true);
+	// The mappings keep the file open.
+	::close(fd);
+	if (m_mapping == nullptr) {
+		throwException("unable to map flight recorder file"_s);
+	}
+	m_header = reinterpret_cast<FileHeader *>(m_mapping);
+	m_data = m_mapping + headerSize;
+
+	if (!reused || memcmp(m_header->magic, fileMagic, sizeof(fileMagic)) != 0 || m_header->capacity != m_capacity) {
+		memset(m_mapping, 0, headerSize + m_capacity);
+		m_header->capacity = m_capacity;
+		m_header->writePos.store(0, memory_order_relaxed);
+		// The magic is written last so that a half-initialised file is never reused.
+		atomic_thread_fence(memory_order_release);
+		memcpy(m_header->magic, fileMagic, sizeof(fileMagic));
+	}
+
+	static const cookie_io_functions_t functions = {nullptr, writeToRecorder, nullptr, nullptr};
+	m_stream = ::fopencookie(this, "w", functions);
+	if (m_stream == nullptr) {
+		::munmap(m_mapping, headerSize + 2 * m_capacity);
+		throwException("unable to create flight recorder stream"_s);
+	}
+	::setvbuf(m_stream, nullptr, _IOLBF, 4096);
+}
+
+afc::logger::FlightRecorder::~FlightRecorder()
+{
+	FlightRecorder *recorder = this;
+	if (crashRecorder.compare_exchange_strong(recorder, nullptr)) {
+		_impl::removeFatalSignalCallback(dumpToRecorder);
+	}
+	std::fclose(m_stream);
+	::munmap(m_mapping, pageSize() + 2 * m_capacity);
+}
+
+void afc::logger::FlightRecorder::append(const char * const data, size_t n) noexcept
+{
+	n = min(n, m_capacity / 4);
+
+	const size_t size = recordSize(n);
+	const uint64_t pos = m_header->writePos.fetch_add(size, memory_order_relaxed);
+	char * const dest = m_data + (pos & (m_capacity - 1));
+
+	RecordHeader &header = *reinterpret_cast<RecordHeader *>(dest);
+	// Invalidating the stale record first so that it is not mixed up with the new payload.
+	header.tag.store(0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	header.size = static_cast<uint32_t>(n);
+	memcpy(dest + sizeof(RecordHeader), data, n);
+	header.tag.store(pos + 1, memory_order_release);
+}
+
+size_t afc::logger::readFlightRecords(const char * const file,
+		const function<void (const char *record, size_t n)> &handler)
+{
+	const size_t headerSize = pageSize();
+
+	const int fd = ::open(file, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		throwException("unable to open flight recorder file"_s);
+	}
+	struct stat fileStat;
+	FlightRecorder::FileHeader fileHeader;
+	if (::fstat(fd, &fileStat) == -1 || static_cast<size_t>(fileStat.st_size) < headerSize ||
+			::pread(fd, &fileHeader, sizeof(fileHeader), 0) != sizeof(fileHeader) ||
+			memcmp(fileHeader.magic, fileMagic, sizeof(fileMagic)) != 0 ||
+			static_cast<size_t>(fileStat.st_size) != headerSize + fileHeader.capacity) {
+		::close(fd);
+		throwException("the file is not a flight recorder file"_s);
+	}
+	const size_t capacity = fileHeader.capacity;
+
+	const char * const mapping = mapFile(fd, capacity, false);
+	::close(fd);
+	if (mapping == nullptr) {
+		throwException("unable to map flight recorder file"_s);
+	}
+	const FlightRecorder::FileHeader &header = *reinterpret_cast<const FlightRecorder::FileHeader *>(mapping);
+	const char * const data = mapping + headerSize;
+
+	const uint64_t end = header.writePos.load(memory_order_acquire);
+	uint64_t pos = end > capacity ? end - capacity : 0;
+	size_t count = 0;
+	/* Records are scanned from the oldest position that is not overwritten yet. An invalid
+	 * header means either that the position is not a record boundary (the first record
+	 * in the window starts before it) or that the record was never committed, so scanning
+	 * is continued at the next aligned position.
+	 */
+	while (pos + sizeof(RecordHeader) <= end) {
+		const RecordHeader &recordHeader = *reinterpret_cast<const RecordHeader *>(data + (pos & (capacity - 1)));
+		if (recordHeader.tag.load(memory_order_acquire) == pos + 1 && recordHeader.size <= capacity / 4 &&
+				pos + recordSize(recordHeader.size) <= end) {
+			handler(reinterpret_cast<const char *>(&recordHeader) + sizeof(RecordHeader), recordHeader.size);
+			++count;
+			pos += recordSize(recordHeader.size);
+		} else {
+			pos += recordAlignment;
+		}
+	}
+
+	::munmap(const_cast<char *>(mapping), headerSize + 2 * capacity);
+	return count;
+}
+
+void afc::logger::installFlightRecorderCrashHook(FlightRecorder &recorder)
+{
+	_impl::addFatalSignalCallback(dumpToRecorder);
+	crashRecorder.store(&recorder);
+}
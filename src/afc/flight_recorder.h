@@ -0,0 +1,88 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_FLIGHT_RECORDER_H_
+#define AFC_FLIGHT_RECORDER_H_
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+
+namespace afc
+{
+	namespace logger
+	{
+		class FlightRecorder;
+
+		/* Passes the records that are kept in the flight recorder file to the handler,
+		 * from the oldest to the most recent one. Records that were being written when
+		 * the process died are skipped. Returns the number of records passed.
+		 */
+		std::size_t readFlightRecords(const char *file,
+				const std::function<void (const char *record, std::size_t n)> &handler);
+
+		/* A log sink that keeps the most recent records in a memory-mapped file used as
+		 * a circular buffer. Records are copied into the shared mapping without system calls,
+		 * so they survive a crash of the process since the kernel owns the pages.
+		 *
+		 * Any number of threads can append records concurrently; space is reserved lock-free.
+		 * If the file exists and is a flight recorder of the same capacity then new records
+		 * are appended after the existing ones.
+		 */
+		class FlightRecorder
+		{
+		public:
+			// The capacity is rounded up to a power of two multiple of the page size.
+			FlightRecorder(const char *file, std::size_t minCapacity);
+			FlightRecorder(const FlightRecorder &) = delete;
+			~FlightRecorder();
+
+			FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+			// Records longer than a quarter of the capacity are truncated.
+			void append(const char *data, std::size_t n) noexcept;
+
+			/* A line-buffered stream to be used with logToFile() and logToFileFmt().
+			 * Each line logged becomes a record, there is no need to flush the stream.
+			 */
+			std::FILE *stream() const noexcept { return m_stream; }
+
+			std::size_t capacity() const noexcept { return m_capacity; }
+		private:
+			friend std::size_t readFlightRecords(const char *,
+					const std::function<void (const char *, std::size_t)> &);
+
+			struct FileHeader;
+
+			char *m_mapping;
+			FileHeader *m_header;
+			char *m_data;
+			std::size_t m_capacity;
+			std::FILE *m_stream;
+		};
+
+		/* Makes the fatal signal handler shared with afc::installCrashHandler() (SIGSEGV, SIGBUS, SIGILL,
+		 * SIGFPE, SIGABRT) append the signal number and afc::StackTrace to the recorder. The signal is
+		 * then re-raised with the action that was installed before the handler, so that other crash
+		 * handlers still run. Destroying the recorder uninstalls the hook.
+		 *
+		 * Building the stack trace is not async-signal-safe, so it is best-effort: the signal
+		 * record is written first.
+		 */
+		void installFlightRecorderCrashHook(FlightRecorder &recorder);
+	}
+}
+
+#endif /*AFC_FLIGHT_RECORDER_H_*/
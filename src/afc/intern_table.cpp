@@ -0,0 +1,332 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "intern_table.h"
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <string>
+
+// POSIX API.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "builtin.hpp"
+#include "crc.hpp"
+#include "Exception.h"
+#include "platform.h"
+
+using namespace afc;
+using namespace std;
+
+#ifndef AFC_LE
+	#error "intern tables are mapped as is, so only little-endian platforms are supported"
+#endif
+
+namespace
+{
+	const char fileMagic[8] = {'A', 'F', 'C', 'I', 'N', 'T', 'R', 'N'};
+	const uint32_t fileVersion = 1;
+
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t reserved;
+		uint64_t count;
+		uint64_t slotCount;
+		uint64_t heapSize;
+		uint64_t dataChecksum;
+		// Of the fields above.
+		uint64_t headerChecksum;
+		uint64_t reserved2;
+	};
+
+	struct FileEntry
+	{
+		uint64_t offset;
+		uint32_t size;
+		uint32_t hash;
+	};
+
+	static_assert(sizeof(FileHeader) == 64 && sizeof(FileEntry) == 16, "Unexpected padding in the file structures.");
+
+	const size_t minSlotCount = 16;
+
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	// Writes to a file descriptor that is owned by the caller.
+	class DescriptorOutputStream : public OutputStream
+	{
+	public:
+		explicit DescriptorOutputStream(const int fd) noexcept : m_fd(fd) {}
+
+		virtual void write(const unsigned char *data, size_t n)
+		{
+			while (n > 0) {
+				const ssize_t written = ::write(m_fd, data, n);
+				if (written < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					throwException("unable to write intern table file"_s);
+				}
+				data += written;
+				n -= static_cast<size_t>(written);
+			}
+		}
+
+		virtual void close() {}
+	private:
+		const int m_fd;
+	};
+
+	// FNV-1a. The hash is a part of the file format, so std::hash cannot be used.
+	inline uint32_t stringHash(const char * const str, const size_t n) noexcept
+	{
+		uint64_t h = 0xcbf29ce484222325;
+		for (size_t i = 0; i < n; ++i) {
+			h = (h ^ static_cast<unsigned char>(str[i])) * 0x100000001b3;
+		}
+		return static_cast<uint32_t>(h ^ (h >> 32));
+	}
+
+	inline uint64_t headerChecksum(const FileHeader &header) noexcept
+	{
+		return crc64Reversed(reinterpret_cast<const unsigned char *>(&header), offsetof(FileHeader, headerChecksum));
+	}
+
+	inline bool isPowerOfTwo(const uint64_t x) noexcept
+	{
+		return x != 0 && (x & (x - 1)) == 0;
+	}
+
+	// The number of slots keeps the load factor not greater than 3/4.
+	inline bool needsRehash(const size_t count, const size_t slotCount) noexcept
+	{
+		return 4 * count > 3 * slotCount;
+	}
+}
+
+struct afc::InternTable::Entry : public FileEntry {};
+
+const uint32_t afc::InternTable::notFound;
+
+afc::InternTableBuilder::InternTableBuilder() : m_slots(minSlotCount, 0) {}
+
+uint32_t afc::InternTableBuilder::add(ConstStringRef str)
+{
+	if (unlikely(str.size() > numeric_limits<uint32_t>::max())) {
+		throwException("the string is too long for an intern table"_s);
+	}
+	const uint32_t h = stringHash(str.value(), str.size());
+	const size_t mask = m_slots.size() - 1;
+	size_t i = h & mask;
+	for (; m_slots[i] != 0; i = (i + 1) & mask) {
+		const Entry &entry = m_entries[m_slots[i] - 1];
+		if (entry.hash == h && entry.size == str.size() && std::memcmp(&m_heap[entry.offset], str.value(), str.size()) == 0) {
+			return m_slots[i] - 1;
+		}
+	}
+	if (unlikely(m_entries.size() == numeric_limits<uint32_t>::max() - 1)) {
+		throwException("too many strings for an intern table"_s);
+	}
+
+	const uint32_t id = static_cast<uint32_t>(m_entries.size());
+	m_entries.push_back(Entry{m_heap.size(), static_cast<uint32_t>(str.size()), h});
+	m_heap.insert(m_heap.end(), str.begin(), str.end());
+	m_heap.push_back('\0');
+	m_slots[i] = id + 1;
+	if (needsRehash(m_entries.size(), m_slots.size())) {
+		rehash(2 * m_slots.size());
+	}
+	return id;
+}
+
+void afc::InternTableBuilder::rehash(const size_t slotCount)
+{
+	vector<uint32_t> slots(slotCount, 0);
+	const size_t mask = slotCount - 1;
+	for (size_t id = 0; id < m_entries.size(); ++id) {
+		size_t i = m_entries[id].hash & mask;
+		while (slots[i] != 0) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = static_cast<uint32_t>(id + 1);
+	}
+	m_slots.swap(slots);
+}
+
+void afc::InternTableBuilder::write(OutputStream &out) const
+{
+	static_assert(sizeof(Entry) == sizeof(FileEntry), "Entries are written as is.");
+
+	const unsigned char * const slots = reinterpret_cast<const unsigned char *>(m_slots.data());
+	const size_t slotsSize = m_slots.size() * sizeof(uint32_t);
+	const unsigned char * const entries = reinterpret_cast<const unsigned char *>(m_entries.data());
+	const size_t entriesSize = m_entries.size() * sizeof(Entry);
+	const unsigned char * const heap = reinterpret_cast<const unsigned char *>(m_heap.data());
+
+	FileHeader header = FileHeader();
+	std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+	header.version = fileVersion;
+	header.count = m_entries.size();
+	header.slotCount = m_slots.size();
+	header.heapSize = m_heap.size();
+	uint64_t crc = crc64ReversedUpdate(0, slots, slotsSize);
+	crc = crc64ReversedUpdate(crc, entries, entriesSize);
+	header.dataChecksum = crc64ReversedUpdate(crc, heap, m_heap.size());
+	header.headerChecksum = headerChecksum(header);
+
+	out.write(reinterpret_cast<const unsigned char *>(&header), sizeof(header));
+	out.write(slots, slotsSize);
+	out.write(entries, entriesSize);
+	out.write(heap, m_heap.size());
+}
+
+void afc::InternTableBuilder::write(const char * const file) const
+{
+	/* Processes can have the file mapped, so it is replaced rather than rewritten:
+	 * they keep reading the old table while the new one is written.
+	 */
+	string tmpFile(file);
+	tmpFile += ".tmp.XXXXXX";
+	const int fd = ::mkstemp(&tmpFile[0]);
+	if (fd == -1) {
+		throwException("unable to create intern table file"_s);
+	}
+	try {
+		DescriptorOutputStream out(fd);
+		write(out);
+		// The new table must be on disk before it replaces the old one.
+		if (::fchmod(fd, 0644) == -1 || ::fsync(fd) == -1) {
+			throwException("unable to write intern table file"_s);
+		}
+	}
+	catch (...) {
+		::close(fd);
+		::unlink(tmpFile.c_str());
+		throw;
+	}
+	if (::close(fd) == -1 || ::rename(tmpFile.c_str(), file) == -1) {
+		::unlink(tmpFile.c_str());
+		throwException("unable to write intern table file"_s);
+	}
+}
+
+afc::InternTable::InternTable(const char * const file, const bool verifyData)
+{
+	const int fd = ::open(file, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		throwException("unable to open intern table file"_s);
+	}
+	struct ::stat fileStat;
+	if (::fstat(fd, &fileStat) == -1) {
+		::close(fd);
+		throwException("unable to open intern table file"_s);
+	}
+	m_fileSize = static_cast<size_t>(fileStat.st_size);
+	if (m_fileSize < sizeof(FileHeader)) {
+		::close(fd);
+		throwException("the file is not an intern table file"_s);
+	}
+	m_data = ::mmap(nullptr, m_fileSize, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (m_data == MAP_FAILED) {
+		throwException("unable to map intern table file"_s);
+	}
+	// Lookups access the index, the entries and the heap at random.
+	::madvise(m_data, m_fileSize, MADV_RANDOM);
+
+	const FileHeader &header = *static_cast<const FileHeader *>(m_data);
+	if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != fileVersion) {
+		::munmap(m_data, m_fileSize);
+		throwException("the file is not an intern table file"_s);
+	}
+	/* The sizes are validated so that the regions of the file cannot overflow. The heap size is not
+	 * added to the other sizes since it is not bounded by the checks above.
+	 */
+	if (header.headerChecksum != headerChecksum(header) || !isPowerOfTwo(header.slotCount) ||
+			header.slotCount > (m_fileSize - sizeof(FileHeader)) / sizeof(uint32_t) || header.count >= header.slotCount) {
+		::munmap(m_data, m_fileSize);
+		throwException("intern table file is corrupt"_s);
+	}
+	const size_t fixedPartSize = sizeof(FileHeader) + header.slotCount * sizeof(uint32_t) + header.count * sizeof(FileEntry);
+	if (fixedPartSize > m_fileSize || header.heapSize != m_fileSize - fixedPartSize) {
+		::munmap(m_data, m_fileSize);
+		throwException("intern table file is corrupt"_s);
+	}
+
+	const char * const base = static_cast<const char *>(m_data);
+	m_count = header.count;
+	m_slotMask = header.slotCount - 1;
+	m_slots = reinterpret_cast<const uint32_t *>(base + sizeof(FileHeader));
+	m_entries = reinterpret_cast<const Entry *>(m_slots + header.slotCount);
+	m_heap = reinterpret_cast<const char *>(m_entries + m_count);
+	m_heapSize = header.heapSize;
+	m_dataChecksum = header.dataChecksum;
+
+	if (verifyData && !verify()) {
+		::munmap(m_data, m_fileSize);
+		throwException("intern table file is corrupt"_s);
+	}
+}
+
+afc::InternTable::~InternTable()
+{
+	::munmap(m_data, m_fileSize);
+}
+
+bool afc::InternTable::verify() const noexcept
+{
+	const unsigned char * const data = static_cast<const unsigned char *>(m_data) + sizeof(FileHeader);
+	return crc64ReversedUpdate(0, data, m_fileSize - sizeof(FileHeader)) == m_dataChecksum;
+}
+
+uint32_t afc::InternTable::find(ConstStringRef str) const noexcept
+{
+	const uint32_t h = stringHash(str.value(), str.size());
+	// At least one slot is empty, but the number of probes is bounded in case the index is corrupt.
+	for (size_t i = h & m_slotMask, probes = 0; probes <= m_slotMask; i = (i + 1) & m_slotMask, ++probes) {
+		const uint32_t slot = m_slots[i];
+		if (slot == 0) {
+			return notFound;
+		}
+		if (unlikely(slot > m_count)) {
+			continue;
+		}
+		const Entry &entry = m_entries[slot - 1];
+		if (entry.hash == h && entry.size == str.size() && entry.offset <= m_heapSize &&
+				entry.size <= m_heapSize - entry.offset && std::memcmp(m_heap + entry.offset, str.value(), str.size()) == 0) {
+			return slot - 1;
+		}
+	}
+	return notFound;
+}
+
+ConstStringRef afc::InternTable::operator[](const uint32_t id) const noexcept
+{
+	const Entry &entry = m_entries[id];
+	if (unlikely(entry.offset > m_heapSize || entry.size > m_heapSize - entry.offset)) {
+		return ""_s;
+	}
+	return stringRef(m_heap + entry.offset, entry.size);
+}
@@ -0,0 +1,114 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_INTERN_TABLE_H_
+#define AFC_INTERN_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "stream.h"
+#include "StringRef.hpp"
+
+namespace afc
+{
+	/* The file of an intern table consists of:
+	 * 1) the header (see intern_table.cpp) protected by its own CRC-64;
+	 * 2) the hash index: a power-of-two number of 32-bit slots with the entry number plus one
+	 *    or zero for an empty slot (linear probing);
+	 * 3) the entries in the order of their ids: the offset of the string in the heap,
+	 *    its size and its hash;
+	 * 4) the string heap; each string is terminated by '\0'.
+	 * The index, the entries and the heap are protected by CRC-64 (crc64Reversed).
+	 * Numbers are stored in the little-endian byte order.
+	 */
+
+	// Assigns sequential ids to distinct strings and writes them as an intern table file.
+	class InternTableBuilder
+	{
+	public:
+		InternTableBuilder();
+
+		// Returns the id of the string. A string added already keeps its id.
+		std::uint32_t add(ConstStringRef str);
+
+		std::size_t size() const noexcept { return m_entries.size(); }
+
+		void write(OutputStream &out) const;
+		/* Writes the table to a temporary file next to the file given and then renames it
+		 * over the file, so the tables that are open keep the old data.
+		 */
+		void write(const char *file) const;
+	private:
+		struct Entry
+		{
+			std::uint64_t offset;
+			std::uint32_t size;
+			std::uint32_t hash;
+		};
+
+		void rehash(std::size_t slotCount);
+
+		std::vector<std::uint32_t> m_slots;
+		std::vector<Entry> m_entries;
+		std::vector<char> m_heap;
+	};
+
+	/* A read-only intern table mapped into memory. Opening it takes constant time; pages are
+	 * read by the system on demand. The instance is thread-safe.
+	 */
+	class InternTable
+	{
+	public:
+		static const std::uint32_t notFound = UINT32_MAX;
+
+		/* Throws afc::Exception if the file cannot be mapped or its header is invalid. The data
+		 * is verified against its checksum only if verifyData is true, which reads the whole file.
+		 * Lookups never access memory outside the mapping even if the data is corrupt.
+		 */
+		explicit InternTable(const char *file, bool verifyData = false);
+		InternTable(const InternTable &) = delete;
+		~InternTable();
+
+		InternTable &operator=(const InternTable &) = delete;
+
+		std::size_t size() const noexcept { return m_count; }
+
+		// The id of the string or notFound.
+		std::uint32_t find(ConstStringRef str) const noexcept;
+		bool contains(ConstStringRef str) const noexcept { return find(str) != notFound; }
+
+		// The string with the id given, which must be less than size(). It is followed by '\0'.
+		ConstStringRef operator[](const std::uint32_t id) const noexcept;
+
+		// Verifies the data against its checksum.
+		bool verify() const noexcept;
+	private:
+		struct Entry;
+
+		void *m_data;
+		std::size_t m_fileSize;
+		std::size_t m_count;
+		std::size_t m_slotMask;
+		const std::uint32_t *m_slots;
+		const Entry *m_entries;
+		const char *m_heap;
+		std::size_t m_heapSize;
+		std::uint64_t m_dataChecksum;
+	};
+}
+
+#endif /*AFC_INTERN_TABLE_H_*/
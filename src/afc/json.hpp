@@ -20,11 +20,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #define AFC_JSON_HPP_
 
 #include <algorithm>
-#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <type_traits>
 
+#include <afc/ascii.hpp>
 #include <afc/builtin.hpp>
+#include <afc/number.h>
+#include <afc/utf8.h>
 #include <afc/utils.h>
 
 namespace afc
@@ -48,10 +53,24 @@ namespace json
 		trailingSpaces
 	};
 
+	namespace _impl
+	{
+		template<typename Iterator>
+		inline Iterator skipSpaces(Iterator begin, Iterator end) {
+			return std::find_if(begin, end, [](const char c) { return !afc::ascii::is<afc::ascii::space>(c); });
+		}
+
+		inline const char *skipSpaces(const char * const begin, const char * const end) noexcept
+		{
+			return afc::ascii::findFirstNotOf<afc::ascii::space>(begin, end);
+		}
+	}
+
 	// TODO define noexcept
+	// Spaces are the ones std::isspace() recognises in the "C" locale regardless of the current locale.
 	template<typename Iterator>
 	inline Iterator skipSpaces(Iterator begin, Iterator end) {
-		return std::find_if(begin, end, [](const char c) { return !std::isspace(c); });
+		return _impl::skipSpaces(begin, end);
 	}
 
 	template<SpacePolicy spacePolicy, typename Iterator>
@@ -353,6 +372,71 @@ namespace json
 		return skipTrailingSpaces<spacePolicy>(i, end);
 	}
 
+	namespace _impl
+	{
+		enum class EscapeStatus
+		{
+			ok,
+			prematureEnd,
+			malformed
+		};
+
+		// Parses XXXX of \uXXXX. i points to 'u' and is left at the last hex digit on success.
+		template<typename Iterator>
+		inline EscapeStatus parseHexEscape(Iterator &i, const Iterator end, char32_t &result)
+		{
+			result = 0;
+			for (unsigned n = 0; n < 4; ++n) {
+				if (unlikely(++i == end)) {
+					return EscapeStatus::prematureEnd;
+				}
+				const unsigned char digit = afc::numdata<>::asciiToDigit[static_cast<unsigned char>(*i)];
+				if (unlikely(digit >= 16)) {
+					return EscapeStatus::malformed;
+				}
+				result = (result << 4) | digit;
+			}
+			return EscapeStatus::ok;
+		}
+
+		/* Parses \uXXXX or a surrogate pair \uXXXX\uXXXX into a code point. i points to 'u'
+		 * and is left at the last hex digit on success.
+		 */
+		template<typename Iterator>
+		inline EscapeStatus parseUnicodeEscape(Iterator &i, const Iterator end, char32_t &codePoint)
+		{
+			EscapeStatus status = parseHexEscape(i, end, codePoint);
+			if (unlikely(status != EscapeStatus::ok) || likely(codePoint < 0xd800 || codePoint > 0xdfff)) {
+				return status;
+			}
+			if (codePoint > 0xdbff) {
+				return EscapeStatus::malformed; // An unpaired low surrogate.
+			}
+			if (unlikely(++i == end)) {
+				return EscapeStatus::prematureEnd;
+			}
+			if (*i != u8"\\"[0]) {
+				return EscapeStatus::malformed;
+			}
+			if (unlikely(++i == end)) {
+				return EscapeStatus::prematureEnd;
+			}
+			if (*i != u8"u"[0]) {
+				return EscapeStatus::malformed;
+			}
+			char32_t low;
+			status = parseHexEscape(i, end, low);
+			if (unlikely(status != EscapeStatus::ok)) {
+				return status;
+			}
+			if (low < 0xdc00 || low > 0xdfff) {
+				return EscapeStatus::malformed;
+			}
+			codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+			return EscapeStatus::ok;
+		}
+	}
+
 	template<typename Iterator, typename CharDestination, typename ErrorHandler>
 	inline const char *parseCharsToUTF8(Iterator begin, Iterator end, CharDestination dest, ErrorHandler &errorHandler)
 	{
@@ -392,8 +476,21 @@ namespace json
 			} else if (c == u8"t"[0]) {
 				c = u8"\t"[0];
 			} else if (c == u8"u"[0]) {
-				// TODO support unicode escapes.
-				goto malformedJson;
+				char32_t codePoint;
+				switch (_impl::parseUnicodeEscape(i, end, codePoint)) {
+				case _impl::EscapeStatus::ok:
+					break;
+				case _impl::EscapeStatus::prematureEnd:
+					goto prematureEnd;
+				default:
+					goto malformedJson;
+				}
+				char buf[afc::utf8::maxCharSize];
+				const char * const bufEnd = afc::utf8::encode(codePoint, buf);
+				for (const char *p = buf; p != bufEnd - 1; ++p) {
+					dest(*p);
+				}
+				c = bufEnd[-1];
 			} else {
 				goto malformedJson;
 			}
@@ -410,6 +507,76 @@ namespace json
 		errorHandler.malformedJson(i);
 		return end;
 	}
+
+	namespace _impl
+	{
+		inline bool needsEscape(const unsigned char c) noexcept { return afc::ascii::is<afc::ascii::jsonEscaped>(c); }
+
+		inline char *escapeChar(const char c, char *dest) noexcept
+		{
+			*dest++ = '\\';
+			switch (c) {
+			case '"': case '\\':
+				*dest++ = c;
+				return dest;
+			case '\n':
+				*dest++ = 'n';
+				return dest;
+			case '\r':
+				*dest++ = 'r';
+				return dest;
+			case '\t':
+				*dest++ = 't';
+				return dest;
+			case '\b':
+				*dest++ = 'b';
+				return dest;
+			case '\f':
+				*dest++ = 'f';
+				return dest;
+			default:
+				*dest++ = 'u';
+				*dest++ = '0';
+				*dest++ = '0';
+				return afc::octetToHex(static_cast<unsigned char>(c), dest);
+			}
+		}
+	}
+
+	// The maximal number of characters a string of n characters occupies once escaped.
+	constexpr std::size_t maxEscapedSize(const std::size_t n) noexcept { return 6 * n; }
+
+	/* Writes the characters [begin, end) escaped to be placed inside a JSON string literal.
+	 * Only '"', '\\' and control characters are escaped; other characters (including UTF-8
+	 * sequences) are copied as is. dest must have space for maxEscapedSize(end - begin) characters.
+	 *
+	 * Sixteen characters are checked at once.
+	 */
+	inline char *escape(const char *begin, const char * const end, char *dest) noexcept
+	{
+		while (end - begin >= 16) {
+			const std::uint32_t mask = afc::ascii::classify16<afc::ascii::jsonEscaped>(begin);
+			if (likely(mask == 0)) {
+				std::memcpy(dest, begin, 16);
+				begin += 16;
+				dest += 16;
+			} else {
+				const unsigned n = static_cast<unsigned>(__builtin_ctz(mask));
+				std::memcpy(dest, begin, n);
+				dest = _impl::escapeChar(begin[n], dest + n);
+				begin += n + 1;
+			}
+		}
+		for (; begin != end; ++begin) {
+			const char c = *begin;
+			if (likely(!_impl::needsEscape(static_cast<unsigned char>(c)))) {
+				*dest++ = c;
+			} else {
+				dest = _impl::escapeChar(c, dest);
+			}
+		}
+		return dest;
+	}
 }
 }
 
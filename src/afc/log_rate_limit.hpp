@@ -0,0 +1,278 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_LOG_RATE_LIMIT_HPP_
+#define AFC_LOG_RATE_LIMIT_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// POSIX API.
+#include <time.h>
+
+#include "builtin.hpp"
+#include "logger.hpp"
+
+namespace afc
+{
+	namespace logger
+	{
+		/* A logging call site that counts the lines it suppresses. Sites are statically
+		 * allocated by the AFC_LOG_* macros and are linked into a lock-free list so that
+		 * the counts can be reported by logSuppressedCounts().
+		 */
+		class LogSite
+		{
+		public:
+			LogSite(const char * const file, const unsigned line) noexcept
+				: m_file(file), m_line(line), m_suppressed(0), m_next(sites().load(std::memory_order_relaxed))
+			{
+				while (!sites().compare_exchange_weak(m_next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+			}
+
+			LogSite(const LogSite &) = delete;
+			LogSite &operator=(const LogSite &) = delete;
+
+			void suppress() noexcept { m_suppressed.fetch_add(1, std::memory_order_relaxed); }
+
+			/* Logs the number of lines suppressed since the last report, if any.
+			 * Called before the line allowed is logged so that the order of events is kept.
+			 */
+			void reportSuppressed(std::FILE * const dest) noexcept
+			{
+				if (unlikely(m_suppressed.load(std::memory_order_relaxed) != 0)) {
+					const std::uint64_t count = m_suppressed.exchange(0, std::memory_order_relaxed);
+					if (count != 0) {
+						using afc::operator"" _s;
+						logToFile<false>(dest, "suppressed "_s, count, " similar messages at "_s, m_file, ':', m_line);
+					}
+				}
+			}
+
+			static std::atomic<LogSite *> &sites() noexcept
+			{
+				static std::atomic<LogSite *> head(nullptr);
+				return head;
+			}
+
+			LogSite *next() const noexcept { return m_next; }
+		private:
+			const char * const m_file;
+			const unsigned m_line;
+			std::atomic<std::uint64_t> m_suppressed;
+			LogSite *m_next;
+		};
+
+		// Reports the lines suppressed by all the call sites that are not reported yet.
+		inline void logSuppressedCounts(std::FILE * const dest) noexcept
+		{
+			for (LogSite *site = LogSite::sites().load(std::memory_order_acquire); site != nullptr; site = site->next()) {
+				site->reportSuppressed(dest);
+			}
+		}
+
+		/* Calls logSuppressedCounts() periodically from a background thread so that the lines
+		 * suppressed by call sites that are not visited again are reported as well.
+		 */
+		class SuppressedCountsReporter
+		{
+		public:
+			explicit SuppressedCountsReporter(std::FILE * const dest,
+					const std::chrono::milliseconds period = std::chrono::seconds(1))
+				: m_dest(dest), m_period(period), m_stopped(false)
+			{
+				m_worker = std::thread(&SuppressedCountsReporter::run, this);
+			}
+
+			SuppressedCountsReporter(const SuppressedCountsReporter &) = delete;
+
+			// Stops the background thread and reports the counts that are left.
+			~SuppressedCountsReporter()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stopped = true;
+				}
+				m_stopRequested.notify_one();
+				m_worker.join();
+				logSuppressedCounts(m_dest);
+			}
+
+			SuppressedCountsReporter &operator=(const SuppressedCountsReporter &) = delete;
+		private:
+			void run()
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (!m_stopRequested.wait_for(lock, m_period, [this]() { return m_stopped; })) {
+					lock.unlock();
+					logSuppressedCounts(m_dest);
+					lock.lock();
+				}
+			}
+
+			std::FILE * const m_dest;
+			const std::chrono::milliseconds m_period;
+			bool m_stopped;
+			std::mutex m_mutex;
+			std::condition_variable m_stopRequested;
+			std::thread m_worker;
+		};
+
+		/* A lock-free token bucket implemented as the generic cell rate algorithm: the only state
+		 * is the theoretical arrival time of the next line. A suppressed call costs a clock read
+		 * via vDSO, a load and an increment of the suppressed count.
+		 *
+		 * A site with a rate that is not positive suppresses all the lines.
+		 */
+		class RateLimitedLogSite : public LogSite
+		{
+		public:
+			RateLimitedLogSite(const char * const file, const unsigned line, const double perSecond,
+					const unsigned burst) noexcept
+				: LogSite(file, line), m_interval(perSecond > 0 ? static_cast<std::int64_t>(1e9 / perSecond) : 0),
+				  m_tolerance(m_interval * (static_cast<std::int64_t>(burst > 0 ? burst : 1) - 1)),
+				  // No time is reached by the arrival time if the rate is not positive (or NaN).
+				  m_arrivalTime(perSecond > 0 ? 0 : INT64_MAX)
+			{
+			}
+
+			bool tryAcquire() noexcept
+			{
+				const std::int64_t now = nanoTime();
+				std::int64_t arrivalTime = m_arrivalTime.load(std::memory_order_relaxed);
+				do {
+					if (now < arrivalTime - m_tolerance) {
+						suppress();
+						return false;
+					}
+				} while (!m_arrivalTime.compare_exchange_weak(arrivalTime,
+						(arrivalTime > now ? arrivalTime : now) + m_interval, std::memory_order_relaxed));
+				return true;
+			}
+		private:
+			static std::int64_t nanoTime() noexcept
+			{
+				// Millisecond resolution is enough for rate limiting and the coarse clock is much cheaper.
+				::timespec time;
+				::clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+				return std::int64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+			}
+
+			const std::int64_t m_interval;
+			const std::int64_t m_tolerance;
+			std::atomic<std::int64_t> m_arrivalTime;
+		};
+
+		// Allows each n-th call.
+		class EveryNLogSite : public LogSite
+		{
+		public:
+			EveryNLogSite(const char * const file, const unsigned line, const std::uint64_t n) noexcept
+				: LogSite(file, line), m_n(n > 0 ? n : 1), m_count(0) {}
+
+			bool tryAcquire() noexcept
+			{
+				if (m_count.fetch_add(1, std::memory_order_relaxed) % m_n == 0) {
+					return true;
+				}
+				suppress();
+				return false;
+			}
+		private:
+			const std::uint64_t m_n;
+			std::atomic<std::uint64_t> m_count;
+		};
+
+		/* Allows calls with the given probability using a per-thread pseudo-random generator.
+		 * A probability that is not positive (including NaN) suppresses all calls.
+		 */
+		class SampledLogSite : public LogSite
+		{
+		public:
+			SampledLogSite(const char * const file, const unsigned line, const double probability) noexcept
+				: LogSite(file, line),
+				  m_threshold(!(probability > 0.0) ? 0 : probability >= 1.0 ? UINT32_MAX :
+						static_cast<std::uint32_t>(probability * 4294967296.0)) {}
+
+			bool tryAcquire() noexcept
+			{
+				if (nextRandom() < m_threshold) {
+					return true;
+				}
+				suppress();
+				return false;
+			}
+		private:
+			static std::uint32_t nextRandom() noexcept
+			{
+				// xorshift64*. Seeded differently in each thread by the address of the state.
+				static thread_local std::uint64_t state = reinterpret_cast<std::uintptr_t>(&state) | 1;
+				state ^= state >> 12;
+				state ^= state << 25;
+				state ^= state >> 27;
+				return static_cast<std::uint32_t>((state * 0x2545F4914F6CDD1DULL) >> 32);
+			}
+
+			const std::uint32_t m_threshold;
+		};
+	}
+}
+
+/* The macros below log the line as logToFile<false>(dest, args...) does if the call site allows it.
+ * Otherwise the arguments are not evaluated and only the suppressed count of the site is incremented.
+ * The number of lines suppressed is logged before the next line allowed or by logSuppressedCounts().
+ * The destination is evaluated once, and only if the line is allowed.
+ */
+
+// Logs at most perSecond lines per second on average, allowing bursts of up to burst lines.
+#define AFC_LOG_RATE_LIMITED(dest, perSecond, burst, ...) \
+	do { \
+		static ::afc::logger::RateLimitedLogSite afc_logSite_(__FILE__, __LINE__, (perSecond), (burst)); \
+		if (afc_logSite_.tryAcquire()) { \
+			::std::FILE * const afc_logDest_ = (dest); \
+			afc_logSite_.reportSuppressed(afc_logDest_); \
+			::afc::logger::logToFile<false>(afc_logDest_, __VA_ARGS__); \
+		} \
+	} while (false)
+
+// Logs the first line and then each n-th one.
+#define AFC_LOG_EVERY_N(dest, n, ...) \
+	do { \
+		static ::afc::logger::EveryNLogSite afc_logSite_(__FILE__, __LINE__, (n)); \
+		if (afc_logSite_.tryAcquire()) { \
+			::std::FILE * const afc_logDest_ = (dest); \
+			afc_logSite_.reportSuppressed(afc_logDest_); \
+			::afc::logger::logToFile<false>(afc_logDest_, __VA_ARGS__); \
+		} \
+	} while (false)
+
+// Logs each line with the given probability.
+#define AFC_LOG_SAMPLED(dest, probability, ...) \
+	do { \
+		static ::afc::logger::SampledLogSite afc_logSite_(__FILE__, __LINE__, (probability)); \
+		if (afc_logSite_.tryAcquire()) { \
+			::std::FILE * const afc_logDest_ = (dest); \
+			afc_logSite_.reportSuppressed(afc_logDest_); \
+			::afc::logger::logToFile<false>(afc_logDest_, __VA_ARGS__); \
+		} \
+	} while (false)
+
+#endif /* AFC_LOG_RATE_LIMIT_HPP_ */
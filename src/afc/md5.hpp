@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include <ctime>
 #include <cstddef>
+#include <openssl/evp.h>
 #include <openssl/md5.h>
 #include "ensure_ascii.hpp"
 #include "number.h"
@@ -28,7 +29,7 @@ namespace afc
 	OutputIterator md5String(const unsigned char * const data, std::size_t n, const OutputIterator dest)
 	{
 		unsigned char hash[MD5_DIGEST_LENGTH];
-		MD5(data, n, hash);
+		EVP_Digest(data, n, hash, nullptr, EVP_md5(), nullptr);
 
 		OutputIterator p = dest;
 		for (size_t i = 0; i < MD5_DIGEST_LENGTH; ++i) {
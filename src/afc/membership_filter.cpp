@@ -0,0 +1,504 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "membership_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+
+// POSIX API.
+#include <stdlib.h>
+
+#ifdef __AVX2__
+	#include <immintrin.h>
+#endif
+
+#include "builtin.hpp"
+#include "crc.hpp"
+#include "Exception.h"
+#include "platform.h"
+
+using namespace afc;
+using namespace std;
+
+#ifndef AFC_LE
+	#error "filters are serialised as is, so only little-endian platforms are supported"
+#endif
+
+namespace
+{
+	const uint32_t formatVersion = 1;
+	const char bloomMagic[8] = {'A', 'F', 'C', 'B', 'L', 'O', 'O', 'M'};
+	const char fuseMagic[8] = {'A', 'F', 'C', 'F', 'U', 'S', 'E', '8'};
+
+	struct FilterHeader
+	{
+		char magic[8];
+		uint32_t version;
+		// The segment length of a binary fuse filter.
+		uint32_t param32;
+		// The block count of a Bloom filter; the seed, the segment count length and the element count of a binary fuse filter.
+		uint64_t params[3];
+		uint64_t dataChecksum;
+		// Of the fields above.
+		uint64_t headerChecksum;
+	};
+
+	static_assert(sizeof(FilterHeader) == 56, "Unexpected padding in the filter header.");
+
+	// The number of probes whose memory is prefetched before they are evaluated.
+	const size_t probeBatchSize = 16;
+	// The probability of a failure is astronomically low after that many seeds.
+	const unsigned maxFuseAttempts = 100;
+
+	// The odd constants that derive eight bit positions from a 32-bit hash (as in Apache Parquet).
+	const uint32_t bloomSalts[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+			0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	inline uint64_t load64(const unsigned char * const p) noexcept
+	{
+		uint64_t x;
+		std::memcpy(&x, p, sizeof(x));
+		return x;
+	}
+
+	inline uint64_t rotl(const uint64_t x, const int n) noexcept
+	{
+		return (x << n) | (x >> (64 - n));
+	}
+
+	inline uint64_t splitMix64(uint64_t &state) noexcept
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		return z ^ (z >> 31);
+	}
+
+	inline uint64_t headerChecksum(const FilterHeader &header) noexcept
+	{
+		return crc64Reversed(reinterpret_cast<const unsigned char *>(&header), offsetof(FilterHeader, headerChecksum));
+	}
+
+	void writeFilter(OutputStream &out, FilterHeader &header, const unsigned char * const data, const size_t n)
+	{
+		header.version = formatVersion;
+		header.dataChecksum = crc64Reversed(data, n);
+		header.headerChecksum = headerChecksum(header);
+		out.write(reinterpret_cast<const unsigned char *>(&header), sizeof(header));
+		out.write(data, n);
+	}
+
+	void readFully(InputStream &in, unsigned char *data, size_t n)
+	{
+		while (n > 0) {
+			const size_t count = in.read(data, n);
+			if (count == 0) {
+				throwException("unexpected end of filter data"_s);
+			}
+			data += count;
+			n -= count;
+		}
+	}
+
+	void readHeader(InputStream &in, FilterHeader &header, const char (&magic)[8])
+	{
+		readFully(in, reinterpret_cast<unsigned char *>(&header), sizeof(header));
+		if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != formatVersion) {
+			throwException("the data is not a filter of the expected type"_s);
+		}
+		if (header.headerChecksum != headerChecksum(header)) {
+			throwException("filter data is corrupt"_s);
+		}
+	}
+
+	void verifyData(const FilterHeader &header, const unsigned char * const data, const size_t n)
+	{
+		if (crc64Reversed(data, n) != header.dataChecksum) {
+			throwException("filter data is corrupt"_s);
+		}
+	}
+
+	inline uint32_t mulHigh(const uint32_t a, const uint32_t b) noexcept
+	{
+		return static_cast<uint32_t>((static_cast<uint64_t>(a) * b) >> 32);
+	}
+
+	inline uint64_t mulHigh(const uint64_t a, const uint64_t b) noexcept
+	{
+		return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+	}
+
+	inline uint8_t fingerprint(const uint64_t h) noexcept
+	{
+		return static_cast<uint8_t>(h ^ (h >> 32));
+	}
+
+	// The parameters found empirically by the authors of binary fuse filters for arity 3.
+	inline uint32_t fuseSegmentLength(const size_t n) noexcept
+	{
+		if (n == 0) {
+			return 4;
+		}
+		const int bits = static_cast<int>(std::floor(std::log(double(n)) / std::log(3.33) + 2.25));
+		return uint32_t(1) << std::min(bits, 18);
+	}
+
+	inline double fuseSizeFactor(const size_t n) noexcept
+	{
+		return n <= 1 ? 0 : std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) / std::log(double(n)));
+	}
+}
+
+struct alignas(32) afc::BlockedBloomFilter::Block
+{
+	uint32_t words[8];
+};
+
+uint64_t afc::filterHash(ConstStringRef str) noexcept
+{
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(str.value());
+	size_t n = str.size();
+	uint64_t h = 0x9e3779b97f4a7c15 ^ (n * 0xc6a4a7935bd1e995);
+	for (; n >= 8; p += 8, n -= 8) {
+		h ^= rotl(load64(p) * 0x87c37b91114253d5, 31) * 0x4cf5ad432745937f;
+		h = rotl(h, 27) * 5 + 0x52dce729;
+	}
+	if (n > 0) {
+		uint64_t tail = 0;
+		std::memcpy(&tail, p, n);
+		h ^= rotl(tail * 0x87c37b91114253d5, 31) * 0x4cf5ad432745937f;
+	}
+	return mixHash(h);
+}
+
+afc::BlockedBloomFilter::BlockedBloomFilter(const size_t expectedCount, const unsigned bitsPerElement)
+	: BlockedBloomFilter()
+{
+	if (unlikely(bitsPerElement == 0 || expectedCount > numeric_limits<size_t>::max() / bitsPerElement)) {
+		throwException("invalid Bloom filter parameters"_s);
+	}
+	const size_t bits = expectedCount * bitsPerElement;
+	allocate(std::max<size_t>(1, bits / (8 * blockSize) + (bits % (8 * blockSize) != 0)));
+	clear();
+}
+
+afc::BlockedBloomFilter::~BlockedBloomFilter()
+{
+	std::free(m_blocks);
+}
+
+BlockedBloomFilter &afc::BlockedBloomFilter::operator=(BlockedBloomFilter &&o) noexcept
+{
+	std::swap(m_blocks, o.m_blocks);
+	std::swap(m_blockCount, o.m_blockCount);
+	return *this;
+}
+
+void afc::BlockedBloomFilter::allocate(const size_t blockCount)
+{
+	// Blocks are addressed by the upper 32 bits of a hash.
+	if (unlikely(blockCount > numeric_limits<uint32_t>::max())) {
+		throwException("the Bloom filter is too large"_s);
+	}
+	void *data;
+	if (::posix_memalign(&data, 64, blockCount * blockSize) != 0) {
+		throw bad_alloc();
+	}
+	m_blocks = static_cast<Block *>(data);
+	m_blockCount = blockCount;
+}
+
+inline const BlockedBloomFilter::Block &afc::BlockedBloomFilter::block(const uint64_t hash) const noexcept
+{
+	return m_blocks[mulHigh(static_cast<uint32_t>(hash >> 32), static_cast<uint32_t>(m_blockCount))];
+}
+
+void afc::BlockedBloomFilter::clear() noexcept
+{
+	std::memset(m_blocks, 0, m_blockCount * blockSize);
+}
+
+#ifdef __AVX2__
+namespace
+{
+	inline __m256i bloomMask(const uint64_t hash) noexcept
+	{
+		const __m256i salts = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bloomSalts));
+		const __m256i shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(hash)), salts), 27);
+		return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+	}
+}
+
+void afc::BlockedBloomFilter::add(const uint64_t hash) noexcept
+{
+	__m256i * const p = const_cast<__m256i *>(reinterpret_cast<const __m256i *>(&block(hash)));
+	_mm256_store_si256(p, _mm256_or_si256(_mm256_load_si256(p), bloomMask(hash)));
+}
+
+bool afc::BlockedBloomFilter::contains(const uint64_t hash) const noexcept
+{
+	const __m256i data = _mm256_load_si256(reinterpret_cast<const __m256i *>(&block(hash)));
+	return _mm256_testc_si256(data, bloomMask(hash));
+}
+#else
+void afc::BlockedBloomFilter::add(const uint64_t hash) noexcept
+{
+	uint32_t * const words = const_cast<uint32_t *>(block(hash).words);
+	const uint32_t key = static_cast<uint32_t>(hash);
+	for (size_t i = 0; i < 8; ++i) {
+		words[i] |= uint32_t(1) << ((key * bloomSalts[i]) >> 27);
+	}
+}
+
+bool afc::BlockedBloomFilter::contains(const uint64_t hash) const noexcept
+{
+	const uint32_t * const words = block(hash).words;
+	const uint32_t key = static_cast<uint32_t>(hash);
+	uint32_t missing = 0;
+	for (size_t i = 0; i < 8; ++i) {
+		const uint32_t mask = uint32_t(1) << ((key * bloomSalts[i]) >> 27);
+		missing |= ~words[i] & mask;
+	}
+	return missing == 0;
+}
+#endif
+
+void afc::BlockedBloomFilter::contains(const uint64_t * const hashes, const size_t n, bool * const results) const noexcept
+{
+	for (size_t i = 0; i < n; i += probeBatchSize) {
+		const size_t end = std::min(n, i + probeBatchSize);
+		for (size_t j = i; j < end; ++j) {
+			__builtin_prefetch(&block(hashes[j]));
+		}
+		for (size_t j = i; j < end; ++j) {
+			results[j] = contains(hashes[j]);
+		}
+	}
+}
+
+void afc::BlockedBloomFilter::write(OutputStream &out) const
+{
+	FilterHeader header = FilterHeader();
+	std::memcpy(header.magic, bloomMagic, sizeof(bloomMagic));
+	header.params[0] = m_blockCount;
+	writeFilter(out, header, reinterpret_cast<const unsigned char *>(m_blocks), m_blockCount * blockSize);
+}
+
+BlockedBloomFilter afc::BlockedBloomFilter::read(InputStream &in)
+{
+	FilterHeader header;
+	readHeader(in, header, bloomMagic);
+	if (header.params[0] == 0 || header.params[0] > numeric_limits<uint32_t>::max()) {
+		throwException("filter data is corrupt"_s);
+	}
+	BlockedBloomFilter filter;
+	filter.allocate(header.params[0]);
+	unsigned char * const data = reinterpret_cast<unsigned char *>(filter.m_blocks);
+	readFully(in, data, filter.sizeInBytes());
+	verifyData(header, data, filter.sizeInBytes());
+	return filter;
+}
+
+afc::BinaryFuseFilter::BinaryFuseFilter(const uint64_t * const hashes, const size_t n) : BinaryFuseFilter()
+{
+	if (unlikely(n > numeric_limits<uint32_t>::max() / 2)) {
+		throwException("too many elements for a binary fuse filter"_s);
+	}
+	vector<uint64_t> keys(hashes, hashes + n);
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	build(keys);
+}
+
+/* The three positions of an element lie in three consecutive segments, so that the ones
+ * of all the elements are local to each other, which is what makes the filter compact.
+ */
+inline void afc::BinaryFuseFilter::positions(const uint64_t h, uint32_t (&result)[3]) const noexcept
+{
+	const uint32_t mask = m_segmentLength - 1;
+	result[0] = static_cast<uint32_t>(mulHigh(h, uint64_t(m_segmentCountLength)));
+	result[1] = (result[0] + m_segmentLength) ^ (static_cast<uint32_t>(h >> 18) & mask);
+	result[2] = (result[0] + 2 * m_segmentLength) ^ (static_cast<uint32_t>(h) & mask);
+}
+
+void afc::BinaryFuseFilter::build(vector<uint64_t> &keys)
+{
+	const size_t n = keys.size();
+	m_count = n;
+	m_segmentLength = fuseSegmentLength(n);
+	const size_t capacity = static_cast<size_t>(std::round(n * fuseSizeFactor(n)));
+	// The last two segments hold only the second and the third positions.
+	const size_t segments = (capacity + m_segmentLength - 1) / m_segmentLength;
+	const size_t segmentCount = segments > 2 ? segments - 2 : 1;
+	m_segmentCountLength = static_cast<uint32_t>(segmentCount * m_segmentLength);
+	const size_t arrayLength = m_segmentCountLength + 2 * size_t(m_segmentLength);
+	m_fingerprints.assign(arrayLength, 0);
+	if (n == 0) {
+		return;
+	}
+
+	/* Each slot keeps the number of elements mapped to it (in the upper six bits), the xor of
+	 * their position numbers (in the lower two bits) and the xor of their hashes. A slot with
+	 * a single element identifies that element, which is then removed (peeled) from the other
+	 * two slots. If all the elements are peeled the fingerprints are assigned in the reverse order.
+	 */
+	vector<uint8_t> slotCounts(arrayLength);
+	vector<uint64_t> slotHashes(arrayLength);
+	vector<uint32_t> queue(arrayLength);
+	vector<uint64_t> stack(n);
+	vector<uint8_t> stackPositions(n);
+	uint64_t rng = 0x726b2b9d438b9d4d;
+	size_t stackSize = 0;
+	for (unsigned attempt = 0; stackSize != n; ++attempt) {
+		if (unlikely(attempt == maxFuseAttempts)) {
+			throwException("unable to build the binary fuse filter"_s);
+		}
+		m_seed = splitMix64(rng);
+		std::fill(slotCounts.begin(), slotCounts.end(), 0);
+		std::fill(slotHashes.begin(), slotHashes.end(), 0);
+
+		bool overflow = false;
+		for (const uint64_t key : keys) {
+			const uint64_t h = mixHash(key + m_seed);
+			uint32_t p[3];
+			positions(h, p);
+			for (uint8_t i = 0; i < 3; ++i) {
+				slotCounts[p[i]] = static_cast<uint8_t>((slotCounts[p[i]] + 4) ^ i);
+				slotHashes[p[i]] ^= h;
+				overflow |= slotCounts[p[i]] < 4;
+			}
+		}
+		if (unlikely(overflow)) {
+			continue;
+		}
+
+		size_t queueSize = 0;
+		for (uint32_t i = 0; i < arrayLength; ++i) {
+			queue[queueSize] = i;
+			queueSize += (slotCounts[i] >> 2) == 1;
+		}
+		stackSize = 0;
+		while (queueSize > 0) {
+			const uint32_t index = queue[--queueSize];
+			if ((slotCounts[index] >> 2) != 1) {
+				continue;
+			}
+			const uint64_t h = slotHashes[index];
+			const uint8_t found = slotCounts[index] & 3;
+			stack[stackSize] = h;
+			stackPositions[stackSize] = found;
+			++stackSize;
+
+			uint32_t p[3];
+			positions(h, p);
+			for (uint8_t k = 1; k < 3; ++k) {
+				const uint8_t i = (found + k) % 3;
+				const uint32_t other = p[i];
+				queue[queueSize] = other;
+				queueSize += (slotCounts[other] >> 2) == 2;
+				slotCounts[other] = static_cast<uint8_t>((slotCounts[other] - 4) ^ i);
+				slotHashes[other] ^= h;
+			}
+		}
+	}
+
+	for (size_t i = n; i-- > 0;) {
+		const uint64_t h = stack[i];
+		uint32_t p[3];
+		positions(h, p);
+		const uint8_t found = stackPositions[i];
+		m_fingerprints[p[found]] = 0;
+		m_fingerprints[p[found]] = fingerprint(h) ^ m_fingerprints[p[0]] ^ m_fingerprints[p[1]] ^ m_fingerprints[p[2]];
+	}
+}
+
+bool afc::BinaryFuseFilter::contains(const uint64_t hash) const noexcept
+{
+	if (unlikely(m_count == 0)) {
+		return false;
+	}
+	const uint64_t h = mixHash(hash + m_seed);
+	uint32_t p[3];
+	positions(h, p);
+	const uint8_t * const f = m_fingerprints.data();
+	return (fingerprint(h) ^ f[p[0]] ^ f[p[1]] ^ f[p[2]]) == 0;
+}
+
+void afc::BinaryFuseFilter::contains(const uint64_t * const hashes, const size_t n, bool * const results) const noexcept
+{
+	if (unlikely(m_count == 0)) {
+		std::fill(results, results + n, false);
+		return;
+	}
+	const uint8_t * const f = m_fingerprints.data();
+	uint64_t h[probeBatchSize];
+	uint32_t p[probeBatchSize][3];
+	for (size_t i = 0; i < n; i += probeBatchSize) {
+		const size_t count = std::min(n - i, probeBatchSize);
+		for (size_t j = 0; j < count; ++j) {
+			h[j] = mixHash(hashes[i + j] + m_seed);
+			positions(h[j], p[j]);
+			__builtin_prefetch(f + p[j][0]);
+			__builtin_prefetch(f + p[j][1]);
+			__builtin_prefetch(f + p[j][2]);
+		}
+		for (size_t j = 0; j < count; ++j) {
+			results[i + j] = (fingerprint(h[j]) ^ f[p[j][0]] ^ f[p[j][1]] ^ f[p[j][2]]) == 0;
+		}
+	}
+}
+
+void afc::BinaryFuseFilter::write(OutputStream &out) const
+{
+	FilterHeader header = FilterHeader();
+	std::memcpy(header.magic, fuseMagic, sizeof(fuseMagic));
+	header.param32 = m_segmentLength;
+	header.params[0] = m_seed;
+	header.params[1] = m_segmentCountLength;
+	header.params[2] = m_count;
+	writeFilter(out, header, m_fingerprints.data(), m_fingerprints.size());
+}
+
+BinaryFuseFilter afc::BinaryFuseFilter::read(InputStream &in)
+{
+	FilterHeader header;
+	readHeader(in, header, fuseMagic);
+	const uint32_t segmentLength = header.param32;
+	const uint64_t segmentCountLength = header.params[1];
+	if (segmentLength == 0 || (segmentLength & (segmentLength - 1)) != 0 || segmentCountLength == 0 ||
+			segmentCountLength > numeric_limits<uint32_t>::max() / 2 || segmentCountLength % segmentLength != 0 ||
+			header.params[2] > segmentCountLength) {
+		throwException("filter data is corrupt"_s);
+	}
+	BinaryFuseFilter filter;
+	filter.m_seed = header.params[0];
+	filter.m_segmentLength = segmentLength;
+	filter.m_segmentCountLength = static_cast<uint32_t>(segmentCountLength);
+	filter.m_count = header.params[2];
+	filter.m_fingerprints.resize(segmentCountLength + 2 * uint64_t(segmentLength));
+	readFully(in, filter.m_fingerprints.data(), filter.m_fingerprints.size());
+	verifyData(header, filter.m_fingerprints.data(), filter.m_fingerprints.size());
+	return filter;
+}
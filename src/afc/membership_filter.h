@@ -0,0 +1,201 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_MEMBERSHIP_FILTER_H_
+#define AFC_MEMBERSHIP_FILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Repository.h"
+#include "stream.h"
+#include "StringRef.hpp"
+
+namespace afc
+{
+	/* Approximate membership filters over 64-bit hashes: a negative answer is exact, a positive
+	 * one is wrong with a small probability. Hashes passed in must be well mixed in all the bits
+	 * (e.g. produced by filterHash() or mixHash()).
+	 *
+	 * The serialised form consists of a header protected by CRC-64 (crc64Reversed) and the filter
+	 * data protected by its own CRC-64. Numbers are stored in the little-endian byte order.
+	 */
+
+	// The MurmurHash3 finaliser. Turns a weak hash (e.g. std::hash<int>) into a well mixed one.
+	inline std::uint64_t mixHash(std::uint64_t h) noexcept
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccd;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// A hash of the string that does not depend on the process or the platform so it can be serialised.
+	std::uint64_t filterHash(ConstStringRef str) noexcept;
+
+	/* A split block Bloom filter: each element sets one bit in each of the eight 32-bit words
+	 * of a single 256-bit block, so a probe touches one cache line and is a few SIMD instructions.
+	 * The false positive rate is about 3% with 8 bits per element, 0.5% with 12 bits per element
+	 * and 0.15% with 16 bits per element.
+	 */
+	class BlockedBloomFilter
+	{
+	public:
+		explicit BlockedBloomFilter(std::size_t expectedCount, unsigned bitsPerElement = 12);
+		BlockedBloomFilter(const BlockedBloomFilter &) = delete;
+		BlockedBloomFilter(BlockedBloomFilter &&o) noexcept : m_blocks(o.m_blocks), m_blockCount(o.m_blockCount)
+		{
+			o.m_blocks = nullptr;
+			o.m_blockCount = 0;
+		}
+		~BlockedBloomFilter();
+
+		BlockedBloomFilter &operator=(const BlockedBloomFilter &) = delete;
+		BlockedBloomFilter &operator=(BlockedBloomFilter &&o) noexcept;
+
+		void add(std::uint64_t hash) noexcept;
+		bool contains(std::uint64_t hash) const noexcept;
+		// Sets results[i] to contains(hashes[i]). The probes are interleaved to overlap cache misses.
+		void contains(const std::uint64_t *hashes, std::size_t n, bool *results) const noexcept;
+
+		void clear() noexcept;
+
+		std::size_t sizeInBytes() const noexcept { return m_blockCount * blockSize; }
+
+		void write(OutputStream &out) const;
+		// Throws afc::Exception if the data is not a valid Bloom filter.
+		static BlockedBloomFilter read(InputStream &in);
+	private:
+		struct Block;
+
+		static const std::size_t blockSize = 32;
+
+		BlockedBloomFilter() noexcept : m_blocks(nullptr), m_blockCount(0) {}
+
+		void allocate(std::size_t blockCount);
+		const Block &block(std::uint64_t hash) const noexcept;
+
+		Block *m_blocks;
+		std::size_t m_blockCount;
+	};
+
+	/* A static filter built from a set of hashes at once: a binary fuse filter with 8-bit
+	 * fingerprints. It takes about 9 bits per element at the false positive rate of 0.4%;
+	 * a probe reads three octets.
+	 */
+	class BinaryFuseFilter
+	{
+	public:
+		// Duplicate hashes are allowed.
+		BinaryFuseFilter(const std::uint64_t *hashes, std::size_t n);
+
+		bool contains(std::uint64_t hash) const noexcept;
+		// Sets results[i] to contains(hashes[i]). The probes are interleaved to overlap cache misses.
+		void contains(const std::uint64_t *hashes, std::size_t n, bool *results) const noexcept;
+
+		// The number of distinct hashes the filter is built from.
+		std::size_t size() const noexcept { return m_count; }
+		std::size_t sizeInBytes() const noexcept { return m_fingerprints.size(); }
+
+		void write(OutputStream &out) const;
+		// Throws afc::Exception if the data is not a valid binary fuse filter.
+		static BinaryFuseFilter read(InputStream &in);
+	private:
+		BinaryFuseFilter() noexcept : m_seed(0), m_segmentLength(0), m_segmentCountLength(0), m_count(0) {}
+
+		void build(std::vector<std::uint64_t> &hashes);
+		void positions(std::uint64_t h, std::uint32_t (&result)[3]) const noexcept;
+
+		std::uint64_t m_seed;
+		std::uint32_t m_segmentLength;
+		std::uint32_t m_segmentCountLength;
+		std::size_t m_count;
+		std::vector<std::uint8_t> m_fingerprints;
+	};
+
+	/* A Repository with a Bloom filter in front of it so that looking up values that are absent,
+	 * which is typical of deduplication, seldom walks the tree. The filter is rebuilt with twice
+	 * the capacity when the number of values exceeds it. Values removed stay in the filter until
+	 * it is rebuilt, which only increases the false positive rate.
+	 */
+	template<typename T, typename Hash = std::hash<T>, typename Less = std::less<T>>
+	class PrefilteredRepository
+	{
+		PrefilteredRepository(const PrefilteredRepository &) = delete;
+		PrefilteredRepository &operator=(const PrefilteredRepository &) = delete;
+	public:
+		explicit PrefilteredRepository(const std::size_t expectedCount = 1024, const unsigned bitsPerElement = 12)
+			: m_values(), m_filter(expectedCount, bitsPerElement), m_capacity(expectedCount == 0 ? 1 : expectedCount),
+			  m_bitsPerElement(bitsPerElement), m_hash() {}
+
+		inline const T &get(const T &val);
+		// nullptr if the value is not in the repository.
+		inline const T *find(const T &val) const;
+		bool remove(const T &val) { return m_values.remove(val); }
+
+		std::size_t size() const noexcept { return m_values.size(); }
+		bool empty() const noexcept { return m_values.empty(); }
+		void clear() { m_values.clear(); m_filter.clear(); }
+	private:
+		std::uint64_t hash(const T &val) const { return mixHash(m_hash(val)); }
+		inline void grow();
+
+		Repository<T, Less> m_values;
+		BlockedBloomFilter m_filter;
+		std::size_t m_capacity;
+		const unsigned m_bitsPerElement;
+		Hash m_hash;
+	};
+}
+
+template<typename T, typename Hash, typename Less>
+const T &afc::PrefilteredRepository<T, Hash, Less>::get(const T &val)
+{
+	const std::uint64_t h = hash(val);
+	if (m_filter.contains(h)) {
+		const T * const existing = m_values.find(val);
+		if (existing != nullptr) {
+			return *existing;
+		}
+	}
+	const T &result = m_values.get(val);
+	m_filter.add(h);
+	if (m_values.size() > m_capacity) {
+		grow();
+	}
+	return result;
+}
+
+template<typename T, typename Hash, typename Less>
+const T *afc::PrefilteredRepository<T, Hash, Less>::find(const T &val) const
+{
+	return m_filter.contains(hash(val)) ? m_values.find(val) : nullptr;
+}
+
+template<typename T, typename Hash, typename Less>
+void afc::PrefilteredRepository<T, Hash, Less>::grow()
+{
+	BlockedBloomFilter filter(2 * m_capacity, m_bitsPerElement);
+	m_values.forEach([this, &filter](const T &val) { filter.add(hash(val)); });
+	m_filter = std::move(filter);
+	m_capacity *= 2;
+}
+
+#endif /*AFC_MEMBERSHIP_FILTER_H_*/
@@ -0,0 +1,354 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "multi_hash.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace afc;
+using namespace std;
+
+namespace
+{
+	/* GCC vector extensions are used so that the same code is compiled to SSE2, AVX2 or AVX-512
+	 * instructions, whichever are available for the vector width.
+	 */
+	template<unsigned lanes>
+	struct Vector
+	{
+		typedef uint32_t type __attribute__((vector_size(4 * lanes)));
+	};
+
+	/* Vectors are passed by reference and never returned: vectors wider than the instruction
+	 * set supports would be passed by value on the stack, which -Wpsabi warns about.
+	 */
+	template<typename Vec>
+	inline void rotl(Vec &x, const unsigned n) noexcept { x = (x << n) | (x >> (32 - n)); }
+
+	// Accumulates the rotation of x to the right by n bits into result.
+	template<typename Vec>
+	inline void xorRotr(Vec &result, const Vec &x, const unsigned n) noexcept { result ^= (x >> n) | (x << (32 - n)); }
+
+	inline uint32_t loadLE(const unsigned char * const p) noexcept
+	{
+		return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+	}
+
+	inline uint32_t loadBE(const unsigned char * const p) noexcept
+	{
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+	}
+
+	/* The message blocks of a lane: the full blocks are read from the message itself, and the
+	 * last (one or two) blocks with the padding and the length are built in tail.
+	 */
+	struct LaneMessage
+	{
+		const unsigned char *data;
+		size_t fullBlocks;
+		size_t blockCount;
+		unsigned char tail[128];
+
+		template<bool bigEndianLength>
+		void init(const HashInput &input) noexcept
+		{
+			data = input.data;
+			fullBlocks = input.size / 64;
+			const size_t rest = input.size % 64;
+			const size_t tailSize = rest < 56 ? 64 : 128;
+			blockCount = fullBlocks + tailSize / 64;
+
+			std::memset(tail, 0, tailSize);
+			if (rest != 0) {
+				std::memcpy(tail, input.data + fullBlocks * 64, rest);
+			}
+			tail[rest] = 0x80;
+			const uint64_t bitLength = uint64_t(input.size) * 8;
+			for (unsigned i = 0; i < 8; ++i) {
+				tail[bigEndianLength ? tailSize - 1 - i : tailSize - 8 + i] = static_cast<unsigned char>(bitLength >> (8 * i));
+			}
+		}
+
+		const unsigned char *block(const size_t i) const noexcept
+		{
+			return i < fullBlocks ? data + i * 64 : i < blockCount ? tail + (i - fullBlocks) * 64 : tail;
+		}
+	};
+
+	template<unsigned lanes, typename Vec>
+	inline void activeLanes(const LaneMessage * const messages, const size_t blockIndex, Vec &mask) noexcept
+	{
+		for (unsigned l = 0; l < lanes; ++l) {
+			mask[l] = blockIndex < messages[l].blockCount ? ~uint32_t(0) : 0;
+		}
+	}
+
+	// Adds the block result to the state of the lanes that are not finished yet.
+	template<typename Vec>
+	inline void addActive(Vec &state, const Vec &result, const Vec &active) noexcept { state += result & active; }
+
+	const uint32_t md5K[64] = {
+			0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+			0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+			0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+			0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+			0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+			0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+			0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+			0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+	const unsigned md5Shifts[64] = {
+			7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+			5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+			4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+			6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+	template<unsigned lanes>
+	void md5(const HashInput * const inputs, unsigned char digests[][md5DigestSize]) noexcept
+	{
+		typedef typename Vector<lanes>::type Vec;
+
+		LaneMessage messages[lanes];
+		size_t maxBlocks = 0;
+		for (unsigned l = 0; l < lanes; ++l) {
+			messages[l].template init<false>(inputs[l]);
+			maxBlocks = max(maxBlocks, messages[l].blockCount);
+		}
+
+		Vec a0 = Vec{} + 0x67452301, b0 = Vec{} + 0xefcdab89, c0 = Vec{} + 0x98badcfe, d0 = Vec{} + 0x10325476;
+		Vec w[16];
+		for (size_t blockIndex = 0; blockIndex < maxBlocks; ++blockIndex) {
+			for (unsigned l = 0; l < lanes; ++l) {
+				const unsigned char * const block = messages[l].block(blockIndex);
+				for (unsigned i = 0; i < 16; ++i) {
+					w[i][l] = loadLE(block + 4 * i);
+				}
+			}
+
+			Vec a = a0, b = b0, c = c0, d = d0;
+			for (unsigned i = 0; i < 64; ++i) {
+				Vec f;
+				unsigned g;
+				if (i < 16) {
+					f = d ^ (b & (c ^ d));
+					g = i;
+				} else if (i < 32) {
+					f = c ^ (d & (b ^ c));
+					g = (5 * i + 1) % 16;
+				} else if (i < 48) {
+					f = b ^ c ^ d;
+					g = (3 * i + 5) % 16;
+				} else {
+					f = c ^ (b | ~d);
+					g = (7 * i) % 16;
+				}
+				Vec rotated = a + f + md5K[i] + w[g];
+				rotl(rotated, md5Shifts[i]);
+				a = d;
+				d = c;
+				c = b;
+				b += rotated;
+			}
+
+			Vec active;
+			activeLanes<lanes>(messages, blockIndex, active);
+			addActive(a0, a, active);
+			addActive(b0, b, active);
+			addActive(c0, c, active);
+			addActive(d0, d, active);
+		}
+
+		for (unsigned l = 0; l < lanes; ++l) {
+			const uint32_t state[4] = {a0[l], b0[l], c0[l], d0[l]};
+			for (unsigned i = 0; i < 4; ++i) {
+				for (unsigned j = 0; j < 4; ++j) {
+					digests[l][4 * i + j] = static_cast<unsigned char>(state[i] >> (8 * j));
+				}
+			}
+		}
+	}
+
+	const uint32_t sha256K[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+	const uint32_t sha256Initial[8] = {
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+	template<unsigned lanes>
+	void sha256(const HashInput * const inputs, unsigned char digests[][sha256DigestSize]) noexcept
+	{
+		typedef typename Vector<lanes>::type Vec;
+
+		LaneMessage messages[lanes];
+		size_t maxBlocks = 0;
+		for (unsigned l = 0; l < lanes; ++l) {
+			messages[l].template init<true>(inputs[l]);
+			maxBlocks = max(maxBlocks, messages[l].blockCount);
+		}
+
+		Vec state[8];
+		for (unsigned i = 0; i < 8; ++i) {
+			state[i] = Vec{} + sha256Initial[i];
+		}
+		Vec w[64];
+		for (size_t blockIndex = 0; blockIndex < maxBlocks; ++blockIndex) {
+			for (unsigned l = 0; l < lanes; ++l) {
+				const unsigned char * const block = messages[l].block(blockIndex);
+				for (unsigned i = 0; i < 16; ++i) {
+					w[i][l] = loadBE(block + 4 * i);
+				}
+			}
+			for (unsigned i = 16; i < 64; ++i) {
+				Vec s0 = w[i - 15] >> 3;
+				xorRotr(s0, w[i - 15], 7);
+				xorRotr(s0, w[i - 15], 18);
+				Vec s1 = w[i - 2] >> 10;
+				xorRotr(s1, w[i - 2], 17);
+				xorRotr(s1, w[i - 2], 19);
+				w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+			}
+
+			Vec a = state[0], b = state[1], c = state[2], d = state[3];
+			Vec e = state[4], f = state[5], g = state[6], h = state[7];
+			for (unsigned i = 0; i < 64; ++i) {
+				Vec s1 = Vec{};
+				xorRotr(s1, e, 6);
+				xorRotr(s1, e, 11);
+				xorRotr(s1, e, 25);
+				const Vec ch = g ^ (e & (f ^ g));
+				const Vec t1 = h + s1 + ch + sha256K[i] + w[i];
+				Vec s0 = Vec{};
+				xorRotr(s0, a, 2);
+				xorRotr(s0, a, 13);
+				xorRotr(s0, a, 22);
+				const Vec maj = (a & b) | (c & (a | b));
+				const Vec t2 = s0 + maj;
+				h = g;
+				g = f;
+				f = e;
+				e = d + t1;
+				d = c;
+				c = b;
+				b = a;
+				a = t1 + t2;
+			}
+
+			Vec active;
+			activeLanes<lanes>(messages, blockIndex, active);
+			const Vec result[8] = {a, b, c, d, e, f, g, h};
+			for (unsigned i = 0; i < 8; ++i) {
+				addActive(state[i], result[i], active);
+			}
+		}
+
+		for (unsigned l = 0; l < lanes; ++l) {
+			for (unsigned i = 0; i < 8; ++i) {
+				for (unsigned j = 0; j < 4; ++j) {
+					digests[l][4 * i + j] = static_cast<unsigned char>(state[i][l] >> (24 - 8 * j));
+				}
+			}
+		}
+	}
+
+#if defined __AVX512F__
+	const unsigned batchLanes = 16;
+#elif defined __AVX2__
+	const unsigned batchLanes = 8;
+#else
+	const unsigned batchLanes = 4;
+#endif
+
+	/* Messages are sorted by the number of blocks so that lanes of a group finish at about
+	 * the same time. The last group is completed with empty messages.
+	 */
+	template<size_t digestSize, typename Hash>
+	void batch(const HashInput * const inputs, const size_t count, unsigned char digests[][digestSize], Hash hash)
+	{
+		vector<size_t> order(count);
+		for (size_t i = 0; i < count; ++i) {
+			order[i] = i;
+		}
+		stable_sort(order.begin(), order.end(),
+				[inputs](const size_t i, const size_t j) { return inputs[i].size / 64 < inputs[j].size / 64; });
+
+		HashInput group[batchLanes];
+		unsigned char groupDigests[batchLanes][digestSize];
+		for (size_t i = 0; i < count; i += batchLanes) {
+			const size_t groupSize = min(size_t(batchLanes), count - i);
+			for (size_t l = 0; l < batchLanes; ++l) {
+				group[l] = l < groupSize ? inputs[order[i + l]] : HashInput{nullptr, 0};
+			}
+			hash(group, groupDigests);
+			for (size_t l = 0; l < groupSize; ++l) {
+				std::memcpy(digests[order[i + l]], groupDigests[l], digestSize);
+			}
+		}
+	}
+}
+
+unsigned afc::multiBufferLanes() noexcept
+{
+	return batchLanes;
+}
+
+void afc::md5x4(const HashInput inputs[4], unsigned char digests[][md5DigestSize]) noexcept
+{
+	md5<4>(inputs, digests);
+}
+
+void afc::md5x8(const HashInput inputs[8], unsigned char digests[][md5DigestSize]) noexcept
+{
+	md5<8>(inputs, digests);
+}
+
+void afc::md5x16(const HashInput inputs[16], unsigned char digests[][md5DigestSize]) noexcept
+{
+	md5<16>(inputs, digests);
+}
+
+void afc::sha256x4(const HashInput inputs[4], unsigned char digests[][sha256DigestSize]) noexcept
+{
+	sha256<4>(inputs, digests);
+}
+
+void afc::sha256x8(const HashInput inputs[8], unsigned char digests[][sha256DigestSize]) noexcept
+{
+	sha256<8>(inputs, digests);
+}
+
+void afc::sha256x16(const HashInput inputs[16], unsigned char digests[][sha256DigestSize]) noexcept
+{
+	sha256<16>(inputs, digests);
+}
+
+void afc::md5Batch(const HashInput * const inputs, const size_t count, unsigned char digests[][md5DigestSize])
+{
+	batch<md5DigestSize>(inputs, count, digests, md5<batchLanes>);
+}
+
+void afc::sha256Batch(const HashInput * const inputs, const size_t count, unsigned char digests[][sha256DigestSize])
+{
+	batch<sha256DigestSize>(inputs, count, digests, sha256<batchLanes>);
+}
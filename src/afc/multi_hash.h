@@ -0,0 +1,105 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_MULTI_HASH_H_
+#define AFC_MULTI_HASH_H_
+
+#include <algorithm>
+#include <cstddef>
+
+#include "number.h"
+
+namespace afc
+{
+	/* Multi-buffer MD5 and SHA-256: independent messages are hashed at once, each in its own
+	 * SIMD lane, which hides the latency of the serial dependency chain of a single message.
+	 * It pays off for many short messages (e.g. keys) where per-call overhead dominates.
+	 *
+	 * Messages of different sizes can be hashed together; a lane stops being updated when
+	 * its message is processed.
+	 */
+
+	const std::size_t md5DigestSize = 16;
+	const std::size_t sha256DigestSize = 32;
+
+	struct HashInput
+	{
+		const unsigned char *data;
+		std::size_t size;
+	};
+
+	/* The number of lanes (4, 8 or 16) used by the batch functions. It is chosen at compile time
+	 * by the widest vector instructions enabled (AVX-512F, AVX2 or SSE2), not detected at run time.
+	 */
+	unsigned multiBufferLanes() noexcept;
+
+	void md5x4(const HashInput inputs[4], unsigned char digests[][md5DigestSize]) noexcept;
+	void md5x8(const HashInput inputs[8], unsigned char digests[][md5DigestSize]) noexcept;
+	void md5x16(const HashInput inputs[16], unsigned char digests[][md5DigestSize]) noexcept;
+
+	void sha256x4(const HashInput inputs[4], unsigned char digests[][sha256DigestSize]) noexcept;
+	void sha256x8(const HashInput inputs[8], unsigned char digests[][sha256DigestSize]) noexcept;
+	void sha256x16(const HashInput inputs[16], unsigned char digests[][sha256DigestSize]) noexcept;
+
+	/* Schedules the messages into lanes (messages of similar size are hashed together) and
+	 * writes the digests in the order of the inputs.
+	 */
+	void md5Batch(const HashInput *inputs, std::size_t count, unsigned char digests[][md5DigestSize]);
+	void sha256Batch(const HashInput *inputs, std::size_t count, unsigned char digests[][sha256DigestSize]);
+
+	// Writes the lower-case hex digests (2 * md5DigestSize characters each) in the order of the inputs.
+	template<typename OutputIterator>
+	OutputIterator md5HexBatch(const HashInput *inputs, std::size_t count, OutputIterator dest);
+
+	// Writes the lower-case hex digests (2 * sha256DigestSize characters each) in the order of the inputs.
+	template<typename OutputIterator>
+	OutputIterator sha256HexBatch(const HashInput *inputs, std::size_t count, OutputIterator dest);
+
+	namespace _impl
+	{
+		// The number of inputs hashed before their digests are written out.
+		const std::size_t hexBatchChunkSize = 256;
+
+		template<std::size_t digestSize, typename Batch, typename OutputIterator>
+		OutputIterator hexBatch(const HashInput *inputs, const std::size_t count, OutputIterator dest, Batch batch)
+		{
+			unsigned char digests[hexBatchChunkSize][digestSize];
+			for (std::size_t i = 0; i < count; i += hexBatchChunkSize) {
+				const std::size_t chunkSize = std::min(hexBatchChunkSize, count - i);
+				batch(inputs + i, chunkSize, digests);
+				for (std::size_t j = 0; j < chunkSize; ++j) {
+					for (std::size_t k = 0; k < digestSize; ++k) {
+						dest = afc::octetToHex(digests[j][k], dest);
+					}
+				}
+			}
+			return dest;
+		}
+	}
+}
+
+template<typename OutputIterator>
+inline OutputIterator afc::md5HexBatch(const HashInput * const inputs, const std::size_t count, OutputIterator dest)
+{
+	return _impl::hexBatch<md5DigestSize>(inputs, count, dest, md5Batch);
+}
+
+template<typename OutputIterator>
+inline OutputIterator afc::sha256HexBatch(const HashInput * const inputs, const std::size_t count, OutputIterator dest)
+{
+	return _impl::hexBatch<sha256DigestSize>(inputs, count, dest, sha256Batch);
+}
+
+#endif /*AFC_MULTI_HASH_H_*/
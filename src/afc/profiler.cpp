@@ -0,0 +1,438 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <utility>
+
+// POSIX and GNU API.
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "_demangle.h"
+#include "Exception.h"
+#include "StringRef.hpp"
+
+using namespace afc;
+using namespace std;
+
+struct afc::Profiler::ThreadBuffer
+{
+	ThreadBuffer(const unsigned bufferSize, const unsigned maxDepth)
+		: frames(size_t(bufferSize) * maxDepth), depths(bufferSize), capacity(bufferSize), maxDepth(maxDepth),
+		  head(0), tail(0), dropped(0), retired(false) {}
+
+	// Samples are stored leaf first.
+	vector<uintptr_t> frames;
+	vector<unsigned> depths;
+	const unsigned capacity;
+	const unsigned maxDepth;
+	// Written by the signal handler of the owning thread.
+	atomic<uint64_t> head;
+	// Written by the collector.
+	atomic<uint64_t> tail;
+	atomic<uint64_t> dropped;
+	timer_t timer;
+	bool retired;
+};
+
+namespace
+{
+	// Frames of the signal handler and the signal trampoline are captured on top of the sampled ones.
+	const unsigned maxCapturedFrames = 256;
+	const unsigned handlerFrames = 2;
+
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	// Non-zero while a profiler exists.
+	atomic<unsigned> activeGeneration(0);
+	unsigned lastGeneration = 0;
+	atomic<Profiler *> activeProfiler(nullptr);
+	// The SIGPROF action to restore when the active profiler is destroyed.
+	struct sigaction previousAction;
+
+	// The buffer is accessed by the signal handler so it is a plain thread-local pointer.
+	thread_local Profiler::ThreadBuffer *currentBuffer = nullptr;
+	thread_local unsigned currentGeneration = 0;
+
+	// Unregisters the thread from the profiler when the thread exits.
+	struct ThreadRegistration
+	{
+		~ThreadRegistration()
+		{
+			Profiler * const profiler = activeProfiler.load();
+			if (profiler != nullptr && currentGeneration == activeGeneration.load()) {
+				profiler->unregisterThread();
+			}
+		}
+	};
+	thread_local ThreadRegistration threadRegistration;
+
+	inline uintptr_t interruptedAddress(void * const context) noexcept
+	{
+		const ucontext_t &uc = *static_cast<const ucontext_t *>(context);
+#if defined __x86_64__
+		return static_cast<uintptr_t>(uc.uc_mcontext.gregs[REG_RIP]);
+#elif defined __i386__
+		return static_cast<uintptr_t>(uc.uc_mcontext.gregs[REG_EIP]);
+#elif defined __aarch64__
+		return static_cast<uintptr_t>(uc.uc_mcontext.pc);
+#else
+		return 0;
+#endif
+	}
+
+	void handleProfilingSignal(int, siginfo_t *, void * const context)
+	{
+		Profiler::ThreadBuffer * const buffer = currentBuffer;
+		if (buffer == nullptr || currentGeneration != activeGeneration.load(memory_order_relaxed)) {
+			return;
+		}
+		const int savedErrno = errno;
+
+		const uint64_t head = buffer->head.load(memory_order_relaxed);
+		if (head - buffer->tail.load(memory_order_acquire) == buffer->capacity) {
+			buffer->dropped.fetch_add(1, memory_order_relaxed);
+			errno = savedErrno;
+			return;
+		}
+
+		void *frames[maxCapturedFrames];
+		const int count = ::backtrace(frames, static_cast<int>(min(buffer->maxDepth + handlerFrames, maxCapturedFrames)));
+
+		// The frames above the interrupted one belong to the signal handler.
+		const uintptr_t pc = interruptedAddress(context);
+		int start = min(static_cast<int>(handlerFrames), count);
+		for (int i = 0; i < count; ++i) {
+			if (reinterpret_cast<uintptr_t>(frames[i]) == pc) {
+				start = i;
+				break;
+			}
+		}
+
+		const unsigned depth = min(static_cast<unsigned>(count - start), buffer->maxDepth);
+		const size_t slot = head % buffer->capacity;
+		uintptr_t * const dest = buffer->frames.data() + slot * buffer->maxDepth;
+		for (unsigned i = 0; i < depth; ++i) {
+			dest[i] = reinterpret_cast<uintptr_t>(frames[start + i]);
+		}
+		buffer->depths[slot] = depth;
+		buffer->head.store(head + 1, memory_order_release);
+
+		errno = savedErrno;
+	}
+
+	afc::String hexAddress(const uintptr_t address, const char * const module)
+	{
+		char buf[64];
+		const int n = module == nullptr ? std::snprintf(buf, sizeof(buf), "0x%lx", static_cast<unsigned long>(address)) :
+				std::snprintf(buf, sizeof(buf), "%s+0x%lx", module, static_cast<unsigned long>(address));
+		return afc::String(buf, static_cast<size_t>(min(n, int(sizeof(buf) - 1))));
+	}
+
+	afc::String resolveWithDladdr(const uintptr_t address)
+	{
+		Dl_info info;
+		if (::dladdr(reinterpret_cast<void *>(address), &info) == 0) {
+			return hexAddress(address, nullptr);
+		}
+		if (info.dli_sname != nullptr) {
+			char * const demangled = afc::demangle(info.dli_sname);
+			if (demangled != nullptr) {
+				afc::String result(demangled);
+				std::free(demangled);
+				return result;
+			}
+			return afc::String(info.dli_sname);
+		}
+		const char *module = info.dli_fname;
+		if (module != nullptr) {
+			const char * const slash = std::strrchr(module, '/');
+			if (slash != nullptr) {
+				module = slash + 1;
+			}
+		}
+		return hexAddress(address - reinterpret_cast<uintptr_t>(info.dli_fbase), module);
+	}
+}
+
+size_t afc::Profiler::StackHash::operator()(const vector<uintptr_t> &stack) const noexcept
+{
+	size_t hash = stack.size();
+	for (const uintptr_t address : stack) {
+		hash ^= address + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+	}
+	return hash;
+}
+
+afc::Profiler::Profiler(const ProfilerOptions &options)
+	: m_options(options), m_frequency(options.frequency), m_droppedRetired(0), m_generation(++lastGeneration),
+	  m_stopped(false)
+{
+	if (m_options.bufferSize == 0 || m_options.maxDepth == 0 || m_options.maxDepth > maxCapturedFrames - handlerFrames) {
+		throwException("invalid profiler options"_s);
+	}
+	if (activeProfiler.load() != nullptr) {
+		throwException("only one profiler can be active at a time"_s);
+	}
+
+	// The first call of backtrace() loads the unwinder, which must not happen in the signal handler.
+	void *frame;
+	::backtrace(&frame, 1);
+
+	struct sigaction action;
+	std::memset(&action, 0, sizeof(action));
+	action.sa_sigaction = handleProfilingSignal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_SIGINFO | SA_RESTART;
+	if (::sigaction(SIGPROF, &action, &previousAction) == -1) {
+		throwException("unable to install the profiling signal handler"_s);
+	}
+
+	activeProfiler.store(this);
+	activeGeneration.store(m_generation);
+	m_collector = thread(&Profiler::run, this);
+}
+
+afc::Profiler::~Profiler()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopped = true;
+	}
+	m_stop.notify_one();
+	m_collector.join();
+
+	// Threads that are still registered see that their buffers belong to a stale profiler.
+	activeGeneration.store(0);
+	for (const unique_ptr<ThreadBuffer> &buffer : m_buffers) {
+		if (!buffer->retired) {
+			::timer_delete(buffer->timer);
+		}
+	}
+	/* Profiling signals that are still pending must not reach the previous action, which is
+	 * termination by default. Ignoring the signal discards them.
+	 */
+	::signal(SIGPROF, SIG_IGN);
+	::sigaction(SIGPROF, &previousAction, nullptr);
+	activeProfiler.store(nullptr);
+}
+
+void afc::Profiler::registerThread()
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (currentBuffer != nullptr && currentGeneration == m_generation) {
+		return;
+	}
+
+	unique_ptr<ThreadBuffer> buffer(new ThreadBuffer(m_options.bufferSize, m_options.maxDepth));
+
+	sigevent event;
+	std::memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_THREAD_ID;
+	event.sigev_signo = SIGPROF;
+	event._sigev_un._tid = static_cast<pid_t>(::syscall(SYS_gettid));
+	if (::timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &buffer->timer) == -1) {
+		throwException("unable to create the profiling timer"_s);
+	}
+
+	currentBuffer = buffer.get();
+	currentGeneration = m_generation;
+	// Makes sure the thread-local registration is constructed so that it is destroyed on thread exit.
+	(void) &threadRegistration;
+	armTimer(*buffer);
+	m_buffers.push_back(move(buffer));
+}
+
+void afc::Profiler::unregisterThread()
+{
+	lock_guard<mutex> lock(m_mutex);
+	ThreadBuffer * const buffer = currentBuffer;
+	if (buffer == nullptr || currentGeneration != m_generation) {
+		return;
+	}
+	::timer_delete(buffer->timer);
+	currentBuffer = nullptr;
+	atomic_signal_fence(memory_order_seq_cst);
+	// The samples left are collected before the buffer is released.
+	buffer->retired = true;
+}
+
+void afc::Profiler::armTimer(ThreadBuffer &buffer) noexcept
+{
+	itimerspec spec;
+	std::memset(&spec, 0, sizeof(spec));
+	if (m_frequency != 0) {
+		spec.it_interval.tv_nsec = static_cast<long>(1000000000 / m_frequency);
+		if (spec.it_interval.tv_nsec == 0) {
+			spec.it_interval.tv_nsec = 1;
+		}
+		spec.it_value = spec.it_interval;
+	}
+	::timer_settime(buffer.timer, 0, &spec, nullptr);
+}
+
+void afc::Profiler::setFrequency(const unsigned frequency)
+{
+	lock_guard<mutex> lock(m_mutex);
+	m_frequency = frequency;
+	for (const unique_ptr<ThreadBuffer> &buffer : m_buffers) {
+		if (!buffer->retired) {
+			armTimer(*buffer);
+		}
+	}
+}
+
+void afc::Profiler::collect()
+{
+	vector<uintptr_t> stack;
+	for (auto i = m_buffers.begin(); i != m_buffers.end();) {
+		ThreadBuffer &buffer = **i;
+		const uint64_t head = buffer.head.load(memory_order_acquire);
+		for (uint64_t pos = buffer.tail.load(memory_order_relaxed); pos != head; ++pos) {
+			const size_t slot = pos % buffer.capacity;
+			const uintptr_t * const frames = buffer.frames.data() + slot * buffer.maxDepth;
+			stack.assign(frames, frames + buffer.depths[slot]);
+			++m_stacks[stack];
+		}
+		buffer.tail.store(head, memory_order_release);
+
+		if (buffer.retired) {
+			m_droppedRetired += buffer.dropped.load(memory_order_relaxed);
+			i = m_buffers.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void afc::Profiler::symbolise(const vector<uintptr_t> &addresses)
+{
+#ifdef AFC_USE_STACK_TRACE
+	vector<void *> rawAddresses;
+	rawAddresses.reserve(addresses.size());
+	for (const uintptr_t address : addresses) {
+		rawAddresses.push_back(reinterpret_cast<void *>(address));
+	}
+	vector<AddrStatus> symbols;
+	symbols.reserve(addresses.size());
+	if (backtraceSymbols(rawAddresses.data(), rawAddresses.size(), symbols) && symbols.size() == addresses.size()) {
+		for (size_t i = 0; i < addresses.size(); ++i) {
+			if (symbols[i].success && symbols[i].functionName.size() != 0) {
+				m_symbols.emplace(addresses[i], symbols[i].functionName);
+			}
+		}
+	}
+#endif
+	// Addresses that are not resolved via BFD fall back to the dynamic symbol table.
+	for (const uintptr_t address : addresses) {
+		if (m_symbols.find(address) == m_symbols.end()) {
+			m_symbols.emplace(address, resolveWithDladdr(address));
+		}
+	}
+}
+
+void afc::Profiler::writeFoldedStacks(ostream &out)
+{
+	lock_guard<mutex> lock(m_mutex);
+	collect();
+
+	/* Return addresses point to the instruction after the call, which can belong to the next
+	 * function if the call is the last instruction. So callers are symbolised by address - 1.
+	 */
+	auto symbolAddress = [](const vector<uintptr_t> &stack, const size_t i) { return i == 0 ? stack[0] : stack[i] - 1; };
+
+	// Only the addresses seen for the first time are symbolised, all at once.
+	vector<uintptr_t> unknown;
+	for (const auto &entry : m_stacks) {
+		for (size_t i = 0; i < entry.first.size(); ++i) {
+			const uintptr_t address = symbolAddress(entry.first, i);
+			if (m_symbols.find(address) == m_symbols.end()) {
+				unknown.push_back(address);
+			}
+		}
+	}
+	sort(unknown.begin(), unknown.end());
+	unknown.erase(unique(unknown.begin(), unknown.end()), unknown.end());
+	if (!unknown.empty()) {
+		symbolise(unknown);
+	}
+
+	for (const auto &entry : m_stacks) {
+		const vector<uintptr_t> &stack = entry.first;
+		if (stack.empty()) {
+			continue;
+		}
+		// The root frame goes first.
+		for (size_t i = stack.size(); i-- > 0;) {
+			const afc::String &name = m_symbols.find(symbolAddress(stack, i))->second;
+			out.write(name.data(), static_cast<streamsize>(name.size()));
+			out.put(i == 0 ? ' ' : ';');
+		}
+		out << entry.second;
+		out.put('\n');
+	}
+}
+
+void afc::Profiler::reset()
+{
+	lock_guard<mutex> lock(m_mutex);
+	collect();
+	m_stacks.clear();
+}
+
+uint64_t afc::Profiler::sampleCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	collect();
+	uint64_t count = 0;
+	for (const auto &entry : m_stacks) {
+		count += entry.second;
+	}
+	return count;
+}
+
+uint64_t afc::Profiler::droppedSampleCount()
+{
+	lock_guard<mutex> lock(m_mutex);
+	uint64_t count = m_droppedRetired;
+	for (const unique_ptr<ThreadBuffer> &buffer : m_buffers) {
+		count += buffer->dropped.load(memory_order_relaxed);
+	}
+	return count;
+}
+
+void afc::Profiler::run()
+{
+	unique_lock<mutex> lock(m_mutex);
+	while (!m_stop.wait_for(lock, chrono::milliseconds(100), [this]() { return m_stopped; })) {
+		collect();
+	}
+}
@@ -0,0 +1,106 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_PROFILER_H_
+#define AFC_PROFILER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "SimpleString.hpp"
+
+namespace afc
+{
+	struct ProfilerOptions
+	{
+		// Samples per second of CPU time consumed by each thread registered.
+		unsigned frequency = 99;
+		// The maximal number of frames captured per sample.
+		unsigned maxDepth = 64;
+		// The number of samples each thread can hold until the background thread collects them.
+		unsigned bufferSize = 256;
+	};
+
+	/* A sampling CPU profiler. Each thread registered gets a CPU-time timer that delivers SIGPROF
+	 * to it; the signal handler stores the return addresses into the lock-free buffer of the thread.
+	 * A background thread collects the samples and aggregates them by stack.
+	 *
+	 * Only one profiler can exist at a time. Addresses are symbolised only when the stacks are
+	 * written, and each address is symbolised once.
+	 */
+	class Profiler
+	{
+	public:
+		explicit Profiler(const ProfilerOptions &options = ProfilerOptions());
+		Profiler(const Profiler &) = delete;
+		~Profiler();
+
+		Profiler &operator=(const Profiler &) = delete;
+
+		// Starts sampling the calling thread. The thread is unregistered automatically when it exits.
+		void registerThread();
+		void unregisterThread();
+
+		// Zero suspends sampling.
+		void setFrequency(unsigned frequency);
+		unsigned frequency() const noexcept { return m_frequency; }
+
+		/* Writes the stacks sampled so far in the folded format consumed by flamegraph.pl:
+		 * 'root;caller;callee <count>' per line.
+		 */
+		void writeFoldedStacks(std::ostream &out);
+		// Discards the stacks sampled so far.
+		void reset();
+
+		std::uint64_t sampleCount();
+		// The number of samples lost because the buffer of a thread was full.
+		std::uint64_t droppedSampleCount();
+
+		struct ThreadBuffer;
+	private:
+		struct StackHash
+		{
+			std::size_t operator()(const std::vector<std::uintptr_t> &stack) const noexcept;
+		};
+
+		void armTimer(ThreadBuffer &buffer) noexcept;
+		// Must be called with m_mutex locked.
+		void collect();
+		void symbolise(const std::vector<std::uintptr_t> &addresses);
+		void run();
+
+		const ProfilerOptions m_options;
+		unsigned m_frequency;
+		std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+		std::unordered_map<std::vector<std::uintptr_t>, std::uint64_t, StackHash> m_stacks;
+		std::map<std::uintptr_t, afc::String> m_symbols;
+		std::uint64_t m_droppedRetired;
+		const unsigned m_generation;
+		bool m_stopped;
+		std::mutex m_mutex;
+		std::condition_variable m_stop;
+		std::thread m_collector;
+	};
+}
+
+#endif /*AFC_PROFILER_H_*/
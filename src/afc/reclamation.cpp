@@ -0,0 +1,361 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "reclamation.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+
+#include "builtin.hpp"
+#include "Exception.h"
+
+using namespace afc;
+using namespace std;
+
+using afc::_impl::ReclamationDomain;
+using afc::_impl::Retired;
+using afc::_impl::ThreadRecord;
+
+namespace
+{
+	void throwException(ConstStringRef message) { throw Exception(message); }
+
+	// The number of retired objects at which the retiring thread tries to reclaim them.
+	const size_t epochCollectThreshold = 64;
+
+	/* The domains alive. Threads that exit release their records only in the domains alive.
+	 * It is never destroyed so that threads can exit after the static objects are destroyed.
+	 */
+	struct Registry
+	{
+		mutex lock;
+		set<uint64_t> domains;
+		// The domains in which exiting threads are releasing their records; a domain waits for them when destroyed.
+		multiset<uint64_t> releasing;
+		condition_variable released;
+		uint64_t lastId = 0;
+	};
+
+	Registry &registry()
+	{
+		static Registry * const instance = new Registry();
+		return *instance;
+	}
+
+	struct CachedRecord
+	{
+		uint64_t domainId;
+		ReclamationDomain *domain;
+		ThreadRecord *record;
+	};
+
+	struct ThreadRecords
+	{
+		~ThreadRecords()
+		{
+			Registry &r = registry();
+			/* Releasing a record runs deleters that can retire objects into other domains, which locks
+			 * the registry and can acquire new records, so the records are released without the lock
+			 * until none are left.
+			 */
+			for (;;) {
+				vector<CachedRecord> alive;
+				{
+					lock_guard<mutex> lock(r.lock);
+					for (const CachedRecord &cached : records) {
+						if (r.domains.count(cached.domainId) != 0) {
+							alive.push_back(cached);
+							r.releasing.insert(cached.domainId);
+						}
+					}
+					records.clear();
+				}
+				if (alive.empty()) {
+					return;
+				}
+				for (const CachedRecord &cached : alive) {
+					cached.domain->releaseRecord(*cached.record);
+					{
+						lock_guard<mutex> lock(r.lock);
+						r.releasing.erase(r.releasing.find(cached.domainId));
+					}
+					r.released.notify_all();
+				}
+			}
+		}
+
+		// Drops the records of the domains destroyed.
+		void prune()
+		{
+			Registry &r = registry();
+			lock_guard<mutex> lock(r.lock);
+			records.erase(remove_if(records.begin(), records.end(),
+					[&](const CachedRecord &cached) { return r.domains.count(cached.domainId) == 0; }), records.end());
+		}
+
+		vector<CachedRecord> records;
+	};
+
+	thread_local ThreadRecords threadRecords;
+
+	uint64_t registerDomain()
+	{
+		Registry &r = registry();
+		lock_guard<mutex> lock(r.lock);
+		const uint64_t id = ++r.lastId;
+		r.domains.insert(id);
+		return id;
+	}
+
+	void freeRetired(vector<Retired> &retired) noexcept
+	{
+		for (const Retired &object : retired) {
+			object.deleter(object.p);
+		}
+		retired.clear();
+	}
+}
+
+afc::_impl::ReclamationDomain::ReclamationDomain() : m_id(registerDomain()), m_records(nullptr) {}
+
+afc::_impl::ReclamationDomain::~ReclamationDomain()
+{
+	unregister();
+	ThreadRecord *record = m_records.load(memory_order_acquire);
+	while (record != nullptr) {
+		ThreadRecord * const next = record->next;
+		delete record;
+		record = next;
+	}
+}
+
+void afc::_impl::ReclamationDomain::unregister() noexcept
+{
+	Registry &r = registry();
+	unique_lock<mutex> lock(r.lock);
+	r.domains.erase(m_id);
+	// Threads that are exiting can still be releasing their records of this domain.
+	r.released.wait(lock, [&]() { return r.releasing.count(m_id) == 0; });
+}
+
+ThreadRecord &afc::_impl::ReclamationDomain::threadRecord()
+{
+	for (const CachedRecord &cached : threadRecords.records) {
+		if (likely(cached.domainId == m_id)) {
+			return *cached.record;
+		}
+	}
+	return acquireRecord();
+}
+
+ThreadRecord &afc::_impl::ReclamationDomain::acquireRecord()
+{
+	threadRecords.prune();
+
+	ThreadRecord *record = nullptr;
+	for (ThreadRecord *r = m_records.load(memory_order_acquire); r != nullptr; r = r->next) {
+		bool inUse = false;
+		if (!r->inUse.load(memory_order_relaxed) && r->inUse.compare_exchange_strong(inUse, true, memory_order_acquire)) {
+			record = r;
+			break;
+		}
+	}
+	if (record == nullptr) {
+		record = newRecord();
+		record->next = m_records.load(memory_order_relaxed);
+		while (!m_records.compare_exchange_weak(record->next, record, memory_order_release, memory_order_relaxed)) {}
+	}
+	threadRecords.records.push_back(CachedRecord{m_id, this, record});
+	return *record;
+}
+
+EpochDomain &afc::EpochDomain::global()
+{
+	static EpochDomain * const instance = new EpochDomain();
+	return *instance;
+}
+
+afc::EpochDomain::~EpochDomain()
+{
+	unregister();
+}
+
+afc::EpochDomain::Record::~Record()
+{
+	freeRetired(retired);
+}
+
+EpochDomain::Record &afc::EpochDomain::pin()
+{
+	Record &record = static_cast<Record &>(threadRecord());
+	if (record.nesting++ == 0) {
+		record.state.store(m_epoch.load(memory_order_relaxed) << 1 | 1, memory_order_release);
+		// The pinned state must be visible to reclaimers before the structure is read.
+		atomic_thread_fence(memory_order_seq_cst);
+	}
+	return record;
+}
+
+void afc::EpochDomain::retire(void * const p, const Deleter deleter)
+{
+	Record &record = static_cast<Record &>(threadRecord());
+	record.retired.push_back(Retired{p, deleter, m_epoch.load(memory_order_acquire)});
+	if (record.retired.size() >= epochCollectThreshold) {
+		collect(record);
+	}
+}
+
+void afc::EpochDomain::collect()
+{
+	collect(static_cast<Record &>(threadRecord()));
+}
+
+bool afc::EpochDomain::tryAdvance() noexcept
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	uint64_t epoch = m_epoch.load(memory_order_acquire);
+	for (ThreadRecord *r = records(); r != nullptr; r = r->next) {
+		const uint64_t state = static_cast<Record *>(r)->state.load(memory_order_acquire);
+		if ((state & 1) != 0 && (state >> 1) != epoch) {
+			return false;
+		}
+	}
+	return m_epoch.compare_exchange_strong(epoch, epoch + 1, memory_order_acq_rel);
+}
+
+void afc::EpochDomain::collect(Record &record)
+{
+	if (record.retired.empty()) {
+		return;
+	}
+	// An object retired in the epoch e can be referenced by the readers pinned at e - 1 and e only.
+	uint64_t epoch = m_epoch.load(memory_order_acquire);
+	for (unsigned i = 0; i < 2 && record.retired.front().epoch + 2 > epoch && tryAdvance(); ++i) {
+		epoch = m_epoch.load(memory_order_acquire);
+	}
+	const auto end = find_if(record.retired.begin(), record.retired.end(),
+			[epoch](const Retired &object) { return object.epoch + 2 > epoch; });
+	// Deleters can retire objects, so the objects to free are detached from the list first.
+	vector<Retired> reclaimable(record.retired.begin(), end);
+	record.retired.erase(record.retired.begin(), end);
+	freeRetired(reclaimable);
+}
+
+void afc::EpochDomain::releaseRecord(ThreadRecord &r) noexcept
+{
+	Record &record = static_cast<Record &>(r);
+	try {
+		collect(record);
+	} catch (...) {
+		// The objects not reclaimed are kept by the record for its next owner.
+	}
+	record.inUse.store(false, memory_order_release);
+}
+
+HazardDomain &afc::HazardDomain::global()
+{
+	static HazardDomain * const instance = new HazardDomain();
+	return *instance;
+}
+
+afc::HazardDomain::~HazardDomain()
+{
+	unregister();
+}
+
+afc::HazardDomain::Record::~Record()
+{
+	freeRetired(retired);
+}
+
+ThreadRecord *afc::HazardDomain::newRecord()
+{
+	Record * const record = new Record();
+	m_recordCount.fetch_add(1, memory_order_relaxed);
+	return record;
+}
+
+void afc::HazardDomain::retire(void * const p, const Deleter deleter)
+{
+	Record &record = threadRecord();
+	record.retired.push_back(Retired{p, deleter, 0});
+	// Amortises the scan of all the hazard pointers while keeping the number of retired objects bounded.
+	if (record.retired.size() >= 2 * slotsPerThread * m_recordCount.load(memory_order_relaxed) + 16) {
+		collect(record);
+	}
+}
+
+void afc::HazardDomain::collect()
+{
+	collect(threadRecord());
+}
+
+void afc::HazardDomain::collect(Record &record)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	vector<const void *> hazards;
+	for (ThreadRecord *r = records(); r != nullptr; r = r->next) {
+		for (const atomic<const void *> &slot : static_cast<Record *>(r)->slots) {
+			const void * const p = slot.load(memory_order_acquire);
+			if (p != nullptr) {
+				hazards.push_back(p);
+			}
+		}
+	}
+	sort(hazards.begin(), hazards.end());
+
+	vector<Retired> reclaimable;
+	const auto end = partition(record.retired.begin(), record.retired.end(),
+			[&](const Retired &object) { return binary_search(hazards.begin(), hazards.end(), object.p); });
+	reclaimable.assign(end, record.retired.end());
+	record.retired.erase(end, record.retired.end());
+	freeRetired(reclaimable);
+}
+
+void afc::HazardDomain::releaseRecord(ThreadRecord &r) noexcept
+{
+	Record &record = static_cast<Record &>(r);
+	try {
+		collect(record);
+	} catch (...) {
+		// The objects not reclaimed are kept by the record for its next owner.
+	}
+	record.inUse.store(false, memory_order_release);
+}
+
+afc::HazardPointer::HazardPointer(HazardDomain &domain)
+	: m_record(domain.threadRecord()), m_index(acquireSlot(m_record)), m_slot(m_record.slots[m_index])
+{
+}
+
+afc::HazardPointer::~HazardPointer()
+{
+	reset();
+	m_record.usedSlots &= ~(1u << m_index);
+}
+
+unsigned afc::HazardPointer::acquireSlot(HazardDomain::Record &record)
+{
+	for (unsigned i = 0; i < HazardDomain::slotsPerThread; ++i) {
+		if ((record.usedSlots & (1u << i)) == 0) {
+			record.usedSlots |= 1u << i;
+			return i;
+		}
+	}
+	throwException("too many hazard pointers are owned by the thread"_s);
+	return 0; // Never reached.
+}
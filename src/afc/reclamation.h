@@ -0,0 +1,232 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_RECLAMATION_H_
+#define AFC_RECLAMATION_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Safe memory reclamation for lock-free data structures. An object unlinked from a structure
+ * is retired rather than deleted; the domain deletes it once no reader can hold a reference to it.
+ *
+ * EpochDomain is cheap for readers (a thread-local store per critical section) but a reader that
+ * stays in its critical section forever blocks all reclamation. HazardDomain bounds the number
+ * of objects awaiting reclamation at the cost of a full fence per protected pointer.
+ *
+ * Each thread takes a record of the domain on its first use and releases it on exit; the records
+ * and the objects that are not reclaimed yet are freed with the domain. A domain must not be
+ * destroyed while it is used by other threads.
+ */
+namespace afc
+{
+	typedef void (*Deleter)(void *p);
+
+	namespace _impl
+	{
+		class ThreadRecord
+		{
+		public:
+			ThreadRecord() noexcept : inUse(true), next(nullptr) {}
+			ThreadRecord(const ThreadRecord &) = delete;
+			virtual ~ThreadRecord() {}
+
+			ThreadRecord &operator=(const ThreadRecord &) = delete;
+
+			std::atomic<bool> inUse;
+			// Records are never unlinked until the domain is destroyed.
+			ThreadRecord *next;
+		};
+
+		struct Retired
+		{
+			void *p;
+			Deleter deleter;
+			// The epoch at retirement (EpochDomain only).
+			std::uint64_t epoch;
+		};
+
+		class ReclamationDomain
+		{
+		public:
+			ReclamationDomain(const ReclamationDomain &) = delete;
+			ReclamationDomain &operator=(const ReclamationDomain &) = delete;
+
+			// Invoked on exit of the thread that owns the record.
+			virtual void releaseRecord(ThreadRecord &record) noexcept = 0;
+		protected:
+			ReclamationDomain();
+			virtual ~ReclamationDomain();
+
+			// The record of the calling thread.
+			ThreadRecord &threadRecord();
+			ThreadRecord *records() const noexcept { return m_records.load(std::memory_order_acquire); }
+
+			virtual ThreadRecord *newRecord() = 0;
+
+			// To be called first by the destructor of the derived class.
+			void unregister() noexcept;
+		private:
+			ThreadRecord &acquireRecord();
+
+			const std::uint64_t m_id;
+			std::atomic<ThreadRecord *> m_records;
+		};
+	}
+
+	class EpochDomain : private _impl::ReclamationDomain
+	{
+		friend class EpochGuard;
+	public:
+		EpochDomain() : m_epoch(1) {}
+		~EpochDomain();
+
+		// The process-wide domain. It is never destroyed.
+		static EpochDomain &global();
+
+		template<typename T>
+		void retire(T * const p) { retire(p, [](void * const q) { delete static_cast<T *>(q); }); }
+		void retire(void *p, Deleter deleter);
+
+		// Frees the objects retired by the calling thread that no reader can reference any longer.
+		void collect();
+
+		virtual void releaseRecord(_impl::ThreadRecord &record) noexcept;
+	private:
+		struct Record : public _impl::ThreadRecord
+		{
+			Record() : state(0), nesting(0) {}
+			~Record();
+
+			// The epoch the thread is pinned at multiplied by two with the lowest bit set, or zero if it is not pinned.
+			std::atomic<std::uint64_t> state;
+			unsigned nesting;
+			// In the order of retirement.
+			std::vector<_impl::Retired> retired;
+		};
+
+		virtual _impl::ThreadRecord *newRecord() { return new Record(); }
+
+		Record &pin();
+		static void unpin(Record &record) noexcept
+		{
+			if (--record.nesting == 0) {
+				record.state.store(0, std::memory_order_release);
+			}
+		}
+
+		bool tryAdvance() noexcept;
+		void collect(Record &record);
+
+		std::atomic<std::uint64_t> m_epoch;
+	};
+
+	/* Marks a read-side critical section of an EpochDomain. Objects reachable from a lock-free
+	 * structure within the section are not freed until the section ends. Sections can be nested.
+	 */
+	class EpochGuard
+	{
+	public:
+		explicit EpochGuard(EpochDomain &domain = EpochDomain::global()) : m_record(domain.pin()) {}
+		EpochGuard(const EpochGuard &) = delete;
+		~EpochGuard() { EpochDomain::unpin(m_record); }
+
+		EpochGuard &operator=(const EpochGuard &) = delete;
+	private:
+		EpochDomain::Record &m_record;
+	};
+
+	class HazardDomain : private _impl::ReclamationDomain
+	{
+		friend class HazardPointer;
+	public:
+		// The maximal number of HazardPointer instances a thread can own simultaneously.
+		static const unsigned slotsPerThread = 4;
+
+		HazardDomain() : m_recordCount(0) {}
+		~HazardDomain();
+
+		// The process-wide domain. It is never destroyed.
+		static HazardDomain &global();
+
+		template<typename T>
+		void retire(T * const p) { retire(p, [](void * const q) { delete static_cast<T *>(q); }); }
+		void retire(void *p, Deleter deleter);
+
+		// Frees the objects retired by the calling thread that are not protected by hazard pointers.
+		void collect();
+
+		virtual void releaseRecord(_impl::ThreadRecord &record) noexcept;
+	private:
+		struct Record : public _impl::ThreadRecord
+		{
+			Record() : usedSlots(0) { for (std::atomic<const void *> &slot : slots) { slot.store(nullptr, std::memory_order_relaxed); } }
+			~Record();
+
+			std::atomic<const void *> slots[slotsPerThread];
+			unsigned usedSlots;
+			std::vector<_impl::Retired> retired;
+		};
+
+		virtual _impl::ThreadRecord *newRecord();
+
+		Record &threadRecord() { return static_cast<Record &>(ReclamationDomain::threadRecord()); }
+		void collect(Record &record);
+
+		std::atomic<std::size_t> m_recordCount;
+	};
+
+	/* Protects a single object of a HazardDomain from being freed. Throws afc::Exception if
+	 * the thread owns HazardDomain::slotsPerThread hazard pointers of the domain already.
+	 */
+	class HazardPointer
+	{
+	public:
+		explicit HazardPointer(HazardDomain &domain = HazardDomain::global());
+		HazardPointer(const HazardPointer &) = delete;
+		~HazardPointer();
+
+		HazardPointer &operator=(const HazardPointer &) = delete;
+
+		// Loads the pointer so that the object it points to stays valid until reset() or the next protect().
+		template<typename T>
+		T *protect(const std::atomic<T *> &src) noexcept
+		{
+			T *p = src.load(std::memory_order_relaxed);
+			for (;;) {
+				m_slot.store(p, std::memory_order_release);
+				// The hazard must be visible to reclaimers before the pointer is validated.
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				T * const q = src.load(std::memory_order_acquire);
+				if (q == p) {
+					return p;
+				}
+				p = q;
+			}
+		}
+
+		void reset() noexcept { m_slot.store(nullptr, std::memory_order_release); }
+	private:
+		static unsigned acquireSlot(HazardDomain::Record &record);
+
+		HazardDomain::Record &m_record;
+		const unsigned m_index;
+		std::atomic<const void *> &m_slot;
+	};
+}
+
+#endif /*AFC_RECLAMATION_H_*/
@@ -0,0 +1,132 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "ring_buffer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+// POSIX and Linux API.
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "builtin.hpp"
+#include "Exception.h"
+#include "math_utils.h"
+
+using namespace afc;
+using namespace std;
+
+namespace
+{
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	inline int sysMemfdCreate(const char * const name, const unsigned flags) noexcept
+	{
+		// Called directly since glibc provides the wrapper only since 2.27.
+		return static_cast<int>(::syscall(__NR_memfd_create, name, flags));
+	}
+
+	// MFD_CLOEXEC from linux/memfd.h.
+	const unsigned memfdCloseOnExec = 0x0001U;
+}
+
+afc::MirroredRingBuffer::MirroredRingBuffer(const size_t minCapacity) : m_writePos(0), m_readPos(0)
+{
+	const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+	if (minCapacity > numeric_limits<size_t>::max() / 4) {
+		throwException("ring buffer capacity is too large"_s);
+	}
+	m_capacity = math::ceilPow2(max(minCapacity, pageSize));
+	m_mask = m_capacity - 1;
+
+	const int fd = sysMemfdCreate("afc_ring_buffer", memfdCloseOnExec);
+	if (fd == -1) {
+		throwException("unable to create ring buffer storage"_s);
+	}
+	if (::ftruncate(fd, static_cast<off_t>(m_capacity)) == -1) {
+		::close(fd);
+		throwException("unable to allocate ring buffer storage"_s);
+	}
+
+	// The address range for both mappings is reserved first so that they are adjacent.
+	void * const area = ::mmap(nullptr, 2 * m_capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (area == MAP_FAILED) {
+		::close(fd);
+		throwException("unable to reserve ring buffer address space"_s);
+	}
+	char * const first = static_cast<char *>(area);
+	char * const second = first + m_capacity;
+
+	if (::mmap(first, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+			::mmap(second, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		::munmap(area, 2 * m_capacity);
+		::close(fd);
+		throwException("unable to map ring buffer storage"_s);
+	}
+	// The mappings keep the storage alive.
+	::close(fd);
+
+	m_buf = first;
+}
+
+afc::MirroredRingBuffer::~MirroredRingBuffer()
+{
+	::munmap(m_buf, 2 * m_capacity);
+}
+
+size_t afc::MirroredRingBuffer::read(unsigned char * const data, const size_t n) noexcept
+{
+	const size_t count = min(n, size());
+	memcpy(data, readData(), count);
+	consume(count);
+	return count;
+}
+
+size_t afc::MirroredRingBuffer::write(const unsigned char * const data, const size_t n) noexcept
+{
+	const size_t count = min(n, freeSpace());
+	memcpy(writeData(), data, count);
+	commit(count);
+	return count;
+}
+
+void afc::MirroredRingBuffer::throwOverflow()
+{
+	throw Exception("not enough free space in the ring buffer"_s);
+}
+
+void afc::RingBufferInputStream::reset()
+{
+	throwException("reset is not supported by ring buffer streams"_s);
+}
+
+size_t afc::RingBufferInputStream::skip(const size_t n)
+{
+	const size_t count = min(n, m_buf.size());
+	m_buf.consume(count);
+	return count;
+}
+
+void afc::RingBufferOutputStream::write(const unsigned char * const data, const size_t n)
+{
+	m_buf.reserve(n);
+	m_buf.write(data, n);
+}
@@ -0,0 +1,150 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_RING_BUFFER_H_
+#define AFC_RING_BUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "builtin.hpp"
+#include "stream.h"
+#include "StringRef.hpp"
+
+namespace afc
+{
+	/* A circular byte buffer whose storage is mapped twice back to back in the address
+	 * space, so that both the readable and the writable regions are always contiguous
+	 * regardless of where they wrap around.
+	 *
+	 * It is safe for one producer thread and one consumer thread to use the instance
+	 * concurrently. The capacity is a power of two multiple of the page size.
+	 */
+	class MirroredRingBuffer
+	{
+	public:
+		explicit MirroredRingBuffer(std::size_t minCapacity);
+		MirroredRingBuffer(const MirroredRingBuffer &) = delete;
+		~MirroredRingBuffer();
+
+		MirroredRingBuffer &operator=(const MirroredRingBuffer &) = delete;
+
+		std::size_t capacity() const noexcept { return m_capacity; }
+		std::size_t size() const noexcept
+		{
+			return m_writePos.load(std::memory_order_acquire) - m_readPos.load(std::memory_order_acquire);
+		}
+		std::size_t freeSpace() const noexcept { return m_capacity - size(); }
+		bool empty() const noexcept { return size() == 0; }
+
+		// Consumer side. The region [readData(), readData() + size()) is contiguous.
+		const char *readData() const noexcept
+		{
+			return m_buf + (m_readPos.load(std::memory_order_relaxed) & m_mask);
+		}
+		void consume(const std::size_t n) noexcept
+		{
+			assert(n <= size());
+			m_readPos.store(m_readPos.load(std::memory_order_relaxed) + n, std::memory_order_release);
+		}
+		std::size_t read(unsigned char *data, std::size_t n) noexcept;
+
+		// Producer side. The region [writeData(), writeData() + freeSpace()) is contiguous.
+		char *writeData() noexcept { return m_buf + (m_writePos.load(std::memory_order_relaxed) & m_mask); }
+		void commit(const std::size_t n) noexcept
+		{
+			assert(n <= freeSpace());
+			m_writePos.store(m_writePos.load(std::memory_order_relaxed) + n, std::memory_order_release);
+		}
+		std::size_t write(const unsigned char *data, std::size_t n) noexcept;
+
+		void clear() noexcept { m_readPos.store(m_writePos.load(std::memory_order_acquire), std::memory_order_release); }
+
+		/* The FastStringBuffer-like producer interface. The caller ensures that there is
+		 * enough free space before appending, as with FastStringBuffer::reserve(); reserve()
+		 * throws afc::Exception if the free space cannot be provided since the ring does not grow.
+		 */
+		void reserve(const std::size_t n) const
+		{
+			if (unlikely(freeSpace() < n)) {
+				throwOverflow();
+			}
+		}
+
+		MirroredRingBuffer &append(const char * const str, const std::size_t n) noexcept
+		{
+			assert(n <= freeSpace());
+			std::copy_n(str, n, writeData());
+			commit(n);
+			return *this;
+		}
+		MirroredRingBuffer &append(ConstStringRef str) noexcept { return append(str.value(), str.size()); }
+		MirroredRingBuffer &append(const char c) noexcept
+		{
+			assert(freeSpace() > 0);
+			*writeData() = c;
+			commit(1);
+			return *this;
+		}
+
+		typedef char * Tail;
+
+		// Characters written via the tail become readable once the tail is returned.
+		Tail borrowTail() noexcept { return writeData(); }
+		void returnTail(const Tail tail) noexcept { commit(tail - writeData()); }
+	private:
+		[[noreturn]] static void throwOverflow();
+
+		char *m_buf;
+		std::size_t m_capacity;
+		std::size_t m_mask;
+		// Positions are not wrapped; they are reduced modulo capacity when the storage is accessed.
+		alignas(64) std::atomic<std::uint64_t> m_writePos;
+		alignas(64) std::atomic<std::uint64_t> m_readPos;
+	};
+
+	// Reads the data from the ring buffer. Does not own the ring buffer.
+	class RingBufferInputStream : public InputStream
+	{
+	public:
+		explicit RingBufferInputStream(MirroredRingBuffer &buf) noexcept : m_buf(buf) {}
+
+		virtual std::size_t read(unsigned char * const data, const std::size_t n) { return m_buf.read(data, n); }
+		// Throws afc::Exception since the data consumed is not retained.
+		virtual void reset();
+		virtual std::size_t skip(const std::size_t n);
+		virtual void close() {}
+	private:
+		MirroredRingBuffer &m_buf;
+	};
+
+	/* Writes the data to the ring buffer. Does not own the ring buffer.
+	 * Throws afc::Exception if there is not enough free space for the data written.
+	 */
+	class RingBufferOutputStream : public OutputStream
+	{
+	public:
+		explicit RingBufferOutputStream(MirroredRingBuffer &buf) noexcept : m_buf(buf) {}
+
+		virtual void write(const unsigned char * const data, const std::size_t n);
+	private:
+		MirroredRingBuffer &m_buf;
+	};
+}
+
+#endif /*AFC_RING_BUFFER_H_*/
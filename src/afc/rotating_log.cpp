@@ -0,0 +1,429 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "rotating_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+// POSIX and Linux API.
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "builtin.hpp"
+#include "Exception.h"
+#include "stream.h"
+
+using namespace afc;
+using namespace afc::logger;
+using namespace std;
+
+struct afc::logger::RotatingLogFile::Segment
+{
+	int fd;
+	string path;
+	atomic<uint64_t> size;
+	time_t deadline;
+	// The number of logging threads that are writing to this segment.
+	atomic<unsigned> users;
+};
+
+namespace
+{
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	ssize_t writeToLogFile(void * const cookie, const char * const buf, const size_t size)
+	{
+		return static_cast<RotatingLogFile *>(cookie)->write(buf, size) ? static_cast<ssize_t>(size) : -1;
+	}
+
+	bool writeAll(const int fd, const char *data, size_t n) noexcept
+	{
+		while (n > 0) {
+			const ssize_t written = ::write(fd, data, n);
+			if (unlikely(written < 0)) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			data += written;
+			n -= static_cast<size_t>(written);
+		}
+		return true;
+	}
+
+	inline bool isDigit(const char c) noexcept
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// Consumes count digits (at least one if count is zero) and returns the rest of the string or nullptr.
+	const char *skipDigits(const char *s, const size_t count) noexcept
+	{
+		const char * const start = s;
+		while (isDigit(*s) && (count == 0 || size_t(s - start) < count)) {
+			++s;
+		}
+		return s == start || (count != 0 && size_t(s - start) != count) ? nullptr : s;
+	}
+
+	// Checks if the suffix is 'YYYYMMDDThhmmss.N' or 'YYYYMMDDThhmmss.N.gz', i.e. the file is a segment.
+	bool isSegmentSuffix(const char *s) noexcept
+	{
+		if ((s = skipDigits(s, 8)) == nullptr || *s++ != 'T' || (s = skipDigits(s, 6)) == nullptr || *s++ != '.' ||
+				(s = skipDigits(s, 0)) == nullptr) {
+			return false;
+		}
+		return *s == '\0' || std::strcmp(s, ".gz") == 0;
+	}
+
+	// Returns the file name with the '.gz' suffix or the empty string if compression fails.
+	string compressFile(const string &path)
+	{
+		string gzPath = path + ".gz";
+		try {
+			FileInputStream in(path.c_str());
+			GZipFileOutputStream out(gzPath.c_str());
+			unsigned char buf[64 * 1024];
+			size_t n;
+			while ((n = in.read(buf, sizeof(buf))) > 0) {
+				out.write(buf, n);
+			}
+			out.close();
+			in.close();
+		}
+		catch (Exception &ex) {
+			::unlink(gzPath.c_str());
+			return string();
+		}
+		return gzPath;
+	}
+}
+
+afc::logger::RotatingLogFile::RotatingLogFile(const char * const file, const RotationOptions &options)
+		: m_file(file), m_options(options), m_stream(nullptr), m_current(nullptr), m_next(nullptr), m_retired(nullptr),
+		  m_segmentCount(0), m_stopped(false)
+{
+	m_current.store(createSegment(), memory_order_relaxed);
+
+	static const cookie_io_functions_t functions = {nullptr, writeToLogFile, nullptr, nullptr};
+	m_stream = ::fopencookie(this, "w", functions);
+	if (m_stream == nullptr) {
+		Segment * const segment = m_current.load(memory_order_relaxed);
+		::close(segment->fd);
+		delete segment;
+		throwException("unable to create log stream"_s);
+	}
+	::setvbuf(m_stream, nullptr, _IOFBF, 64 * 1024);
+
+	m_worker = thread(&RotatingLogFile::run, this);
+}
+
+afc::logger::RotatingLogFile::~RotatingLogFile()
+{
+	std::fclose(m_stream);
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopped = true;
+	}
+	m_workAvailable.notify_one();
+	m_worker.join();
+
+	// No logging threads are left, so the remaining segments are finished by this thread.
+	Segment * const retired = m_retired.exchange(nullptr);
+	if (retired != nullptr) {
+		retire(retired);
+	}
+	retire(m_current.exchange(nullptr));
+
+	Segment * const next = m_next.exchange(nullptr);
+	if (next != nullptr) {
+		discard(next);
+		delete next;
+	}
+	for (Segment * const segment : m_freeSegments) {
+		delete segment;
+	}
+}
+
+inline auto afc::logger::RotatingLogFile::acquireCurrent() noexcept -> Segment *
+{
+	for (;;) {
+		Segment * const segment = m_current.load();
+		segment->users.fetch_add(1);
+		/* If the segment is still current then the background thread is guaranteed to see
+		 * this user once the segment is retired, so the segment is not closed under the writer.
+		 */
+		if (likely(m_current.load() == segment)) {
+			return segment;
+		}
+		segment->users.fetch_sub(1);
+	}
+}
+
+bool afc::logger::RotatingLogFile::write(const char *data, size_t n) noexcept
+{
+	bool success = true;
+	for (;;) {
+		Segment * const segment = acquireCurrent();
+
+		/* The stream flushes its buffer at arbitrary points, so a chunk can contain the end of
+		 * the record that closes the segment as well as the records that follow it.
+		 */
+		const char *recordEnd = nullptr;
+		const uint64_t size = segment->size.load(memory_order_relaxed);
+		if (segment->deadline != 0 && now() >= segment->deadline) {
+			recordEnd = static_cast<const char *>(std::memchr(data, '\n', n));
+		} else if (m_options.maxSegmentSize != 0 && size + n >= m_options.maxSegmentSize) {
+			// The first record that reaches the limit is the last one in the segment.
+			const size_t offset = size >= m_options.maxSegmentSize ? 0 : m_options.maxSegmentSize - size - 1;
+			recordEnd = static_cast<const char *>(std::memchr(data + offset, '\n', n - offset));
+		}
+		const size_t count = recordEnd == nullptr ? n : static_cast<size_t>(recordEnd + 1 - data);
+
+		success &= writeAll(segment->fd, data, count);
+		segment->size.fetch_add(count, memory_order_relaxed);
+
+		const bool rotated = recordEnd != nullptr && rotate(segment);
+		if (!rotated && count < n) {
+			// The next segment is not ready yet, so the rest of the chunk stays in this one.
+			success &= writeAll(segment->fd, data + count, n - count);
+			segment->size.fetch_add(n - count, memory_order_relaxed);
+		}
+
+		segment->users.fetch_sub(1, memory_order_release);
+		if (!rotated || count == n) {
+			return success;
+		}
+		data += count;
+		n -= count;
+	}
+}
+
+bool afc::logger::RotatingLogFile::rotate(Segment * const segment) noexcept
+{
+	Segment *next = m_next.exchange(nullptr);
+	if (next == nullptr && m_options.nextSegmentTimeout > chrono::milliseconds::zero()) {
+		unique_lock<mutex> lock(m_mutex);
+		m_workAvailable.notify_one();
+		m_nextReady.wait_for(lock, m_options.nextSegmentTimeout,
+				[this, &next]() { return (next = m_next.exchange(nullptr)) != nullptr; });
+	}
+	if (next == nullptr) {
+		// The next segment is not ready yet. Logging continues into the current one.
+		return false;
+	}
+	// The age of a segment is counted from the moment it becomes current, not from its creation.
+	next->deadline = m_options.maxSegmentAge != 0 ? now() + m_options.maxSegmentAge : 0;
+	Segment *expected = segment;
+	if (!m_current.compare_exchange_strong(expected, next)) {
+		// Another thread has already rotated this segment.
+		Segment *empty = nullptr;
+		if (!m_next.compare_exchange_strong(empty, next)) {
+			// The background thread has already prepared another one. This one is not published anywhere.
+			discard(next);
+			delete next;
+		}
+		return true;
+	}
+	m_retired.store(segment);
+
+	// The mutex is held only to avoid losing the notification.
+	{
+		lock_guard<mutex> lock(m_mutex);
+	}
+	m_workAvailable.notify_one();
+	return true;
+}
+
+auto afc::logger::RotatingLogFile::createSegment() -> Segment *
+{
+	const time_t creationTime = now();
+	struct tm time;
+	::gmtime_r(&creationTime, &time);
+	char timestamp[32];
+	std::strftime(timestamp, sizeof(timestamp), "%Y%m%dT%H%M%S", &time);
+
+	/* A segment with the same name can be left by another process, e.g. if the process is restarted
+	 * within the same second, so the sequence number is increased until the name is not taken.
+	 */
+	string path;
+	int fd;
+	do {
+		path = m_file;
+		path += '.';
+		path += timestamp;
+		path += '.';
+		path += to_string(++m_segmentCount);
+		fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+	} while (fd == -1 && errno == EEXIST);
+	if (fd == -1) {
+		throwException("unable to create log segment"_s);
+	}
+	if (m_options.preallocationSize != 0) {
+		/* The size of the file is kept so that readers see only the data written.
+		 * Preallocation is an optimisation so it is fine if the file system does not support it.
+		 */
+		::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(m_options.preallocationSize));
+	}
+
+	Segment *segment;
+	if (m_freeSegments.empty()) {
+		segment = new Segment();
+		segment->users.store(0, memory_order_relaxed);
+	} else {
+		segment = m_freeSegments.back();
+		m_freeSegments.pop_back();
+	}
+	segment->fd = fd;
+	segment->path = move(path);
+	segment->size.store(0, memory_order_relaxed);
+	segment->deadline = m_options.maxSegmentAge != 0 ? creationTime + m_options.maxSegmentAge : 0;
+	return segment;
+}
+
+void afc::logger::RotatingLogFile::discard(Segment * const segment) noexcept
+{
+	// It has never been written to.
+	::close(segment->fd);
+	segment->fd = -1;
+	::unlink(segment->path.c_str());
+}
+
+void afc::logger::RotatingLogFile::retire(Segment * const segment)
+{
+	// Waiting for the logging threads that have started writing before the segment is switched.
+	while (segment->users.load() != 0) {
+		this_thread::yield();
+	}
+
+	// Releasing the disk space preallocated but not used.
+	::ftruncate(segment->fd, static_cast<off_t>(segment->size.load(memory_order_relaxed)));
+	::close(segment->fd);
+	segment->fd = -1;
+
+	if (m_options.compress && !compressFile(segment->path).empty()) {
+		::unlink(segment->path.c_str());
+	}
+	m_freeSegments.push_back(segment);
+
+	enforceRetention();
+}
+
+void afc::logger::RotatingLogFile::enforceRetention()
+{
+	if (m_options.maxTotalSize == 0 && m_options.maxRetentionAge == 0) {
+		return;
+	}
+
+	const size_t slash = m_file.rfind('/');
+	const string dir = slash == string::npos ? string(".") : m_file.substr(0, slash + 1);
+	const string prefix = (slash == string::npos ? m_file : m_file.substr(slash + 1)) + '.';
+
+	DIR * const dirStream = ::opendir(dir.c_str());
+	if (dirStream == nullptr) {
+		return;
+	}
+	Segment * const current = m_current.load();
+	Segment * const next = m_next.load();
+
+	// (modification time in nanoseconds, path, size) of the segments closed.
+	vector<tuple<int64_t, string, uint64_t>> segments;
+	uint64_t totalSize = 0;
+	for (const dirent *entry; (entry = ::readdir(dirStream)) != nullptr;) {
+		// Other files that share the prefix, e.g. 'file.1' or 'file.bak', are not touched.
+		if (std::strncmp(entry->d_name, prefix.c_str(), prefix.size()) != 0 || !isSegmentSuffix(entry->d_name + prefix.size())) {
+			continue;
+		}
+		string path = slash == string::npos ? string(entry->d_name) : dir + entry->d_name;
+		if ((current != nullptr && path == current->path) || (next != nullptr && path == next->path)) {
+			continue;
+		}
+		struct stat fileStat;
+		if (::stat(path.c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+			totalSize += fileStat.st_size;
+			const int64_t mtime = int64_t(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+			segments.emplace_back(mtime, move(path), fileStat.st_size);
+		}
+	}
+	::closedir(dirStream);
+
+	sort(segments.begin(), segments.end());
+	const int64_t minTime = m_options.maxRetentionAge != 0 ?
+			int64_t(now() - m_options.maxRetentionAge) * 1000000000 : numeric_limits<int64_t>::min();
+	for (const auto &segment : segments) {
+		if ((m_options.maxTotalSize != 0 && totalSize > m_options.maxTotalSize) || get<0>(segment) < minTime) {
+			::unlink(get<1>(segment).c_str());
+			totalSize -= get<2>(segment);
+		} else {
+			break;
+		}
+	}
+}
+
+void afc::logger::RotatingLogFile::run()
+{
+	for (;;) {
+		bool stopped;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_workAvailable.wait_for(lock, chrono::seconds(1),
+					[this]() { return m_stopped || m_retired.load() != nullptr || m_next.load() == nullptr; });
+			stopped = m_stopped;
+		}
+		if (stopped) {
+			return;
+		}
+
+		Segment * const retired = m_retired.exchange(nullptr);
+		if (retired != nullptr) {
+			retire(retired);
+		}
+		if (m_next.load() == nullptr) {
+			try {
+				Segment * const segment = createSegment();
+				Segment *empty = nullptr;
+				// A logging thread that has failed to rotate can put back the segment it has taken.
+				if (!m_next.compare_exchange_strong(empty, segment)) {
+					discard(segment);
+					m_freeSegments.push_back(segment);
+				} else {
+					// The mutex is held only to avoid losing the notification.
+					{
+						lock_guard<mutex> lock(m_mutex);
+					}
+					m_nextReady.notify_all();
+				}
+			}
+			catch (Exception &ex) {
+				// Logging continues into the current segment; creation is retried later.
+				this_thread::sleep_for(chrono::seconds(1));
+			}
+		}
+	}
+}
@@ -0,0 +1,117 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_ROTATING_LOG_H_
+#define AFC_ROTATING_LOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace afc
+{
+	namespace logger
+	{
+		struct RotationOptions
+		{
+			// A segment is closed once its size reaches this value (zero disables size-based rotation).
+			std::uint64_t maxSegmentSize = 64 * 1024 * 1024;
+			// A segment is closed once it has been open for this number of seconds (zero disables it).
+			std::time_t maxSegmentAge = 0;
+			// Disk space reserved for each segment upfront via fallocate.
+			std::uint64_t preallocationSize = 64 * 1024 * 1024;
+			// Closed segments are compressed with gzip if true.
+			bool compress = true;
+			// Oldest closed segments are deleted once their total size exceeds this value (zero means no limit).
+			std::uint64_t maxTotalSize = 0;
+			// Closed segments older than this number of seconds are deleted (zero means no limit).
+			std::time_t maxRetentionAge = 0;
+			/* How long a logging thread waits for the next segment if it is not ready when the current
+			 * one is to be closed. Logging continues into the current segment after that.
+			 */
+			std::chrono::milliseconds nextSegmentTimeout = std::chrono::milliseconds::zero();
+			// The source of the current time for the segment names and ages; std::time() if null.
+			std::time_t (*clock)() = nullptr;
+		};
+
+		/* A log sink that writes into a sequence of segment files named 'file.YYYYMMDDThhmmss.N'.
+		 *
+		 * The next segment is created and preallocated by a background thread in advance,
+		 * so logging threads switch to it by swapping a pointer. The background thread
+		 * then compresses the closed segment to 'segment.gz' and enforces the retention limits.
+		 * If the next segment is not ready yet then logging continues into the current one.
+		 */
+		class RotatingLogFile
+		{
+		public:
+			explicit RotatingLogFile(const char *file, const RotationOptions &options = RotationOptions());
+			RotatingLogFile(const RotatingLogFile &) = delete;
+			// Closes the current segment and waits for the background work to finish.
+			~RotatingLogFile();
+
+			RotatingLogFile &operator=(const RotatingLogFile &) = delete;
+
+			/* Writes the data to the current segment. It is safe to call this function from
+			 * multiple threads. Segments are switched only after a new line, so the data can be
+			 * split between two segments if it contains the end of the record that closes a segment.
+			 */
+			bool write(const char *data, std::size_t n) noexcept;
+
+			/* A fully buffered stream to be used with logToFile() and logToFileFmt().
+			 * Lines logged with flush == true are written to the segment immediately.
+			 */
+			std::FILE *stream() const noexcept { return m_stream; }
+		private:
+			struct Segment;
+
+			Segment *acquireCurrent() noexcept;
+			// Returns false if the segment is still current since the next one is not ready yet.
+			bool rotate(Segment *segment) noexcept;
+			Segment *createSegment();
+			// Closes and deletes the file of a segment that has never been current.
+			void discard(Segment *segment) noexcept;
+			void retire(Segment *segment);
+			void enforceRetention();
+			void run();
+			std::time_t now() const noexcept { return m_options.clock != nullptr ? m_options.clock() : std::time(nullptr); }
+
+			const std::string m_file;
+			const RotationOptions m_options;
+			std::FILE *m_stream;
+			std::atomic<Segment *> m_current;
+			// Prepared by the background thread; taken by the logging thread that rotates the current segment.
+			std::atomic<Segment *> m_next;
+			std::atomic<Segment *> m_retired;
+			// Segments are reused after they are retired since logging threads can still refer to them.
+			std::vector<Segment *> m_freeSegments;
+			std::uint64_t m_segmentCount;
+			bool m_stopped;
+			std::mutex m_mutex;
+			std::condition_variable m_workAvailable;
+			std::condition_variable m_nextReady;
+			std::thread m_worker;
+		};
+	}
+}
+
+#endif /*AFC_ROTATING_LOG_H_*/
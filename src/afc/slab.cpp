@@ -0,0 +1,263 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "slab.h"
+
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+
+#include "builtin.hpp"
+#include "sync.hpp"
+
+using namespace afc;
+using namespace std;
+
+namespace
+{
+	const size_t granularity = 16;
+	const size_t sizeClassCount = maxSlabObjectSize / granularity;
+	const size_t slabSize = 64 * 1024;
+	// The number of objects moved between a thread cache and the pool at once.
+	const size_t batchSize = 32;
+
+	/* The first word of a free object links it to the next free one. The second word of the first
+	 * object of a full batch kept by the pool links the batch to the next one.
+	 */
+	struct FreeObject
+	{
+		FreeObject *next;
+		FreeObject *nextBatch;
+	};
+
+	struct Chain
+	{
+		FreeObject *head;
+		size_t size;
+	};
+
+	inline size_t sizeClass(const size_t size) noexcept
+	{
+		assert(size > 0 && size <= maxSlabObjectSize);
+		return (size - 1) / granularity;
+	}
+
+	// The process-wide free objects of a size class. The lists are intrusive, so that giving objects back never allocates.
+	class Pool
+	{
+	public:
+		Pool() noexcept : m_objectSize(0), m_batches(nullptr), m_partial{nullptr, 0} {}
+
+		void init(const size_t objectSize) noexcept { m_objectSize = objectSize; }
+
+		Chain take()
+		{
+			lock_guard<SpinLock> lock(m_lock);
+			if (m_batches == nullptr) {
+				if (m_partial.size != 0) {
+					const Chain chain = m_partial;
+					m_partial = Chain{nullptr, 0};
+					return chain;
+				}
+				carve();
+			}
+			FreeObject * const head = m_batches;
+			m_batches = head->nextBatch;
+			return Chain{head, batchSize};
+		}
+
+		void give(const Chain chain) noexcept
+		{
+			lock_guard<SpinLock> lock(m_lock);
+			if (chain.size == batchSize) {
+				pushBatch(chain.head);
+			} else {
+				addToPartial(chain.head);
+			}
+		}
+	private:
+		void pushBatch(FreeObject * const head) noexcept
+		{
+			head->nextBatch = m_batches;
+			m_batches = head;
+		}
+
+		void addToPartial(FreeObject *object) noexcept
+		{
+			while (object != nullptr) {
+				FreeObject * const next = object->next;
+				object->next = m_partial.head;
+				m_partial.head = object;
+				if (++m_partial.size == batchSize) {
+					pushBatch(m_partial.head);
+					m_partial = Chain{nullptr, 0};
+				}
+				object = next;
+			}
+		}
+
+		// Splits a new slab into batches.
+		void carve()
+		{
+			char * const slab = static_cast<char *>(::operator new(slabSize));
+			const size_t count = slabSize / m_objectSize;
+			FreeObject *head = nullptr;
+			for (size_t i = count; i > 0; --i) {
+				FreeObject * const object = reinterpret_cast<FreeObject *>(slab + (i - 1) * m_objectSize);
+				object->next = head;
+				head = object;
+				if ((count - i + 1) % batchSize == 0) {
+					pushBatch(head);
+					head = nullptr;
+				}
+			}
+			if (head != nullptr) {
+				addToPartial(head);
+			}
+		}
+
+		size_t m_objectSize;
+		SpinLock m_lock;
+		FreeObject *m_batches;
+		Chain m_partial;
+	};
+
+	// Never destroyed since objects can be deallocated by the static objects' destructors.
+	Pool *pools()
+	{
+		static Pool * const instance = []()
+		{
+			Pool * const p = new Pool[sizeClassCount];
+			for (size_t i = 0; i < sizeClassCount; ++i) {
+				p[i].init((i + 1) * granularity);
+			}
+			return p;
+		}();
+		return instance;
+	}
+
+	// Zero-initialised, so that thread_local access needs no initialisation guard.
+	thread_local Chain threadCaches[sizeClassCount];
+	thread_local bool threadCachesRegistered;
+
+	// Returns the objects cached by the thread to the pool when the thread exits.
+	struct ThreadCacheReleaser
+	{
+		~ThreadCacheReleaser()
+		{
+			for (size_t i = 0; i < sizeClassCount; ++i) {
+				if (threadCaches[i].size != 0) {
+					pools()[i].give(threadCaches[i]);
+					threadCaches[i] = Chain{nullptr, 0};
+				}
+			}
+		}
+	};
+
+	void registerThreadCaches()
+	{
+		thread_local ThreadCacheReleaser releaser;
+		(void) releaser;
+		threadCachesRegistered = true;
+	}
+
+	// Detaches batchSize objects from the cache.
+	void releaseBatch(Chain &cache, const size_t sizeClass)
+	{
+		FreeObject * const head = cache.head;
+		FreeObject *last = head;
+		for (size_t i = 1; i < batchSize; ++i) {
+			last = last->next;
+		}
+		cache.head = last->next;
+		cache.size -= batchSize;
+		last->next = nullptr;
+		pools()[sizeClass].give(Chain{head, batchSize});
+	}
+}
+
+void *afc::slabAllocate(const size_t size)
+{
+	const size_t c = sizeClass(size);
+	Chain &cache = threadCaches[c];
+	if (unlikely(cache.size == 0)) {
+		if (unlikely(!threadCachesRegistered)) {
+			registerThreadCaches();
+		}
+		cache = pools()[c].take();
+	}
+	FreeObject * const object = cache.head;
+	cache.head = object->next;
+	--cache.size;
+	return object;
+}
+
+void afc::slabDeallocate(void * const p, const size_t size) noexcept
+{
+	const size_t c = sizeClass(size);
+	Chain &cache = threadCaches[c];
+	// A thread can free objects without ever allocating any. They are returned to the pool when it exits.
+	if (unlikely(cache.size == 0 && !threadCachesRegistered)) {
+		registerThreadCaches();
+	}
+	FreeObject * const object = static_cast<FreeObject *>(p);
+	object->next = cache.head;
+	cache.head = object;
+	if (unlikely(++cache.size >= 2 * batchSize)) {
+		releaseBatch(cache, c);
+	}
+}
+
+void afc::slabDeallocate(void * const * const objects, const size_t n, const size_t size) noexcept
+{
+	if (n == 0) {
+		return;
+	}
+	const size_t c = sizeClass(size);
+	Chain &cache = threadCaches[c];
+	if (unlikely(cache.size == 0 && !threadCachesRegistered)) {
+		registerThreadCaches();
+	}
+	const auto push = [&cache](void * const p)
+	{
+		FreeObject * const object = static_cast<FreeObject *>(p);
+		object->next = cache.head;
+		cache.head = object;
+		++cache.size;
+	};
+
+	size_t i = 0;
+	for (; i < n && cache.size < batchSize; ++i) {
+		push(objects[i]);
+	}
+	if (n - i >= batchSize) {
+		// The cache is full enough, so full batches are linked and given to the pool directly.
+		for (; n - i >= batchSize; i += batchSize) {
+			FreeObject *head = nullptr;
+			for (size_t j = i + batchSize; j > i; --j) {
+				FreeObject * const object = static_cast<FreeObject *>(objects[j - 1]);
+				object->next = head;
+				head = object;
+			}
+			pools()[c].give(Chain{head, batchSize});
+		}
+	}
+	for (; i < n; ++i) {
+		push(objects[i]);
+	}
+	if (cache.size >= 2 * batchSize) {
+		releaseBatch(cache, c);
+	}
+}
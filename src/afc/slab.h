@@ -0,0 +1,136 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_SLAB_H_
+#define AFC_SLAB_H_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace afc
+{
+	/* A small-object allocator. Objects of equal size classes (multiples of 16 octets up to
+	 * maxSlabObjectSize) are carved from 64 KiB slabs. Each thread keeps a cache of free objects
+	 * per size class and exchanges them with the process-wide pool in batches, so that most
+	 * allocations and deallocations take no lock. Memory is retained by the pool for reuse
+	 * rather than returned to the system.
+	 *
+	 * An object can be deallocated by any thread; its size class must be the one it is allocated with.
+	 */
+	const std::size_t maxSlabObjectSize = 512;
+
+	// size must be positive and not greater than maxSlabObjectSize. Throws std::bad_alloc.
+	void *slabAllocate(std::size_t size);
+	void slabDeallocate(void *p, std::size_t size) noexcept;
+	// Deallocates n objects of the same size.
+	void slabDeallocate(void * const *objects, std::size_t n, std::size_t size) noexcept;
+
+	namespace _impl
+	{
+		template<typename T>
+		struct SlabTraits
+		{
+			static const bool fits = sizeof(T) <= maxSlabObjectSize && alignof(T) <= 16;
+
+			static void *allocate(const std::size_t n)
+			{
+				return fits && n <= maxSlabObjectSize / sizeof(T) ? slabAllocate(n * sizeof(T)) : ::operator new(n * sizeof(T));
+			}
+
+			static void deallocate(void * const p, const std::size_t n) noexcept
+			{
+				if (fits && n <= maxSlabObjectSize / sizeof(T)) {
+					slabDeallocate(p, n * sizeof(T));
+				} else {
+					::operator delete(p);
+				}
+			}
+		};
+	}
+
+	// Typed objects allocated from the slab allocator (or by the global operator new if T is too big).
+	template<typename T>
+	class ObjectPool
+	{
+	public:
+		ObjectPool() = delete;
+
+		template<typename... Args>
+		static T *create(Args &&...args)
+		{
+			void * const p = _impl::SlabTraits<T>::allocate(1);
+			try {
+				return new (p) T(std::forward<Args>(args)...);
+			} catch (...) {
+				_impl::SlabTraits<T>::deallocate(p, 1);
+				throw;
+			}
+		}
+
+		static void destroy(const T * const object) noexcept
+		{
+			if (object != nullptr) {
+				object->~T();
+				_impl::SlabTraits<T>::deallocate(const_cast<T *>(object), 1);
+			}
+		}
+
+		// Destroys n objects and returns them to the pool at once. The pointers must not be null.
+		static void destroy(const T * const *objects, const std::size_t n) noexcept
+		{
+			for (std::size_t i = 0; i < n; ++i) {
+				objects[i]->~T();
+			}
+			if (_impl::SlabTraits<T>::fits) {
+				slabDeallocate(reinterpret_cast<void * const *>(const_cast<T * const *>(objects)), n, sizeof(T));
+			} else {
+				for (std::size_t i = 0; i < n; ++i) {
+					::operator delete(const_cast<T *>(objects[i]));
+				}
+			}
+		}
+
+		// To be used with std::unique_ptr.
+		struct Deleter
+		{
+			void operator()(T * const object) const noexcept { destroy(object); }
+		};
+	};
+
+	/* The STL allocator over the slab allocator. It suits node-based containers best; allocations
+	 * of more than maxSlabObjectSize octets are passed to the global operator new.
+	 */
+	template<typename T>
+	class SlabAllocator
+	{
+	public:
+		typedef T value_type;
+
+		SlabAllocator() noexcept {}
+		template<typename U>
+		SlabAllocator(const SlabAllocator<U> &) noexcept {}
+
+		T *allocate(const std::size_t n) { return static_cast<T *>(_impl::SlabTraits<T>::allocate(n)); }
+		void deallocate(T * const p, const std::size_t n) noexcept { _impl::SlabTraits<T>::deallocate(p, n); }
+	};
+
+	template<typename T, typename U>
+	inline bool operator==(const SlabAllocator<T> &, const SlabAllocator<U> &) noexcept { return true; }
+	template<typename T, typename U>
+	inline bool operator!=(const SlabAllocator<T> &, const SlabAllocator<U> &) noexcept { return false; }
+}
+
+#endif /*AFC_SLAB_H_*/
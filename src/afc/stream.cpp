@@ -15,12 +15,16 @@ You should have received a copy of the GNU Lesser General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "stream.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <new>
 #include <utility>
 
+#include "builtin.hpp"
 #include "Exception.h"
 #include "FastStringBuffer.hpp"
 #include "StringRef.hpp"
@@ -31,7 +35,11 @@ using namespace std;
 namespace
 {
 	// 128 is small enough to not consume too much of the stack and quite large to minimise the amount of invocations
-	static const size_t gZipSkipChunkSize = 128;
+	static const size_t skipChunkSize = 128;
+#if defined AFC_USE_LZ4 || defined AFC_USE_ZSTD
+	// The amount of the compressed data read from (or passed to) the codec at once.
+	static const size_t codecChunkSize = 64 * 1024;
+#endif
 
 	void throwException(const char * const message)
 	{
@@ -85,6 +93,32 @@ namespace
 		}
 		close(file); // ignoring any potential fclose failure
 	}
+
+	// Skips data of streams that cannot seek over the decoded content.
+	size_t skipByReading(InputStream &in, const size_t n)
+	{
+		unsigned char buf[skipChunkSize];
+		size_t skipped = 0;
+		size_t bytesLeft = n;
+		for (; bytesLeft > skipChunkSize; bytesLeft -= skipChunkSize) {
+			const size_t count = in.read(buf, skipChunkSize);
+			skipped += count;
+			if (count != skipChunkSize) {
+				return skipped;
+			}
+		}
+		skipped += in.read(buf, bytesLeft);
+		return skipped;
+	}
+
+	inline unsigned char *allocateBuffer(const size_t n)
+	{
+		void * const buf = std::malloc(n);
+		if (unlikely(buf == nullptr)) {
+			throw std::bad_alloc();
+		}
+		return static_cast<unsigned char *>(buf);
+	}
 }
 
 afc::FileInputStream::FileInputStream(const char * const file)
@@ -218,24 +252,16 @@ void afc::GZipFileInputStream::reset()
 size_t afc::GZipFileInputStream::skip(const size_t n)
 {
 	// reading n bytes since gzseek does not allow for skipping less than n bytes in case of premature end of the file
-	unsigned char buf[gZipSkipChunkSize];
-	size_t skipped = 0;
-	size_t bytesLeft = n;
-	for (; bytesLeft > gZipSkipChunkSize; bytesLeft -= gZipSkipChunkSize) {
-		const size_t count = read(buf, gZipSkipChunkSize);
-		skipped += count;
-		if (count != gZipSkipChunkSize) {
-			return skipped;
-		}
-	}
-	skipped += read(buf, bytesLeft);
-	return skipped;
+	return skipByReading(*this, n);
 }
 
-afc::GZipFileOutputStream::GZipFileOutputStream(const char * const file)
+afc::GZipFileOutputStream::GZipFileOutputStream(const char * const file, const int level)
 {
-	// TODO Make compression level configurable. Return level from 9 to default once this is implemented.
-	m_file = gzopen(file, "wb9");
+	if (level != Z_DEFAULT_COMPRESSION && (level < 0 || level > 9)) {
+		throwException("invalid compression level"_s);
+	}
+	const char mode[] = {'w', 'b', level == Z_DEFAULT_COMPRESSION ? '\0' : char('0' + level), '\0'};
+	m_file = gzopen(file, mode);
 	if (m_file == 0) {
 		throwCannotOpenFileIOException(file);
 	}
@@ -258,3 +284,332 @@ afc::GZipFileOutputStream::~GZipFileOutputStream()
 {
 	closeFileNoexcept(m_file, function<int (gzFile)>(gzclose));
 }
+
+#ifdef AFC_USE_LZ4
+afc::LZ4FrameInputStream::LZ4FrameInputStream(const char * const file)
+		: m_context(nullptr), m_buf(nullptr), m_bufPos(0), m_bufSize(0), m_inFrame(false)
+{
+	m_file = fopen(file, "rb");
+	if (m_file == nullptr) {
+		throwCannotOpenFileIOException(file);
+	}
+	if (LZ4F_isError(LZ4F_createDecompressionContext(&m_context, LZ4F_VERSION))) {
+		closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+		throwException("unable to create LZ4 decompression context"_s);
+	}
+	try {
+		m_buf = allocateBuffer(codecChunkSize);
+	} catch (...) {
+		LZ4F_freeDecompressionContext(m_context);
+		closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+		throw;
+	}
+}
+
+size_t afc::LZ4FrameInputStream::read(unsigned char * const buf, const size_t n)
+{
+	ensureNotClosed(m_file);
+	size_t count = 0;
+	while (count < n) {
+		if (m_bufPos == m_bufSize) {
+			m_bufPos = 0;
+			m_bufSize = fread(m_buf, sizeof(unsigned char), codecChunkSize, m_file);
+			if (m_bufSize == 0) {
+				if (ferror(m_file)) {
+					throwException("error encountered while reading from file"_s);
+				}
+				if (m_inFrame) {
+					throwException("unexpected end of LZ4 frame"_s);
+				}
+				break;
+			}
+		}
+		size_t dstSize = n - count;
+		size_t srcSize = m_bufSize - m_bufPos;
+		const size_t hint = LZ4F_decompress(m_context, buf + count, &dstSize, m_buf + m_bufPos, &srcSize, nullptr);
+		if (LZ4F_isError(hint)) {
+			throwException(LZ4F_getErrorName(hint));
+		}
+		m_bufPos += srcSize;
+		count += dstSize;
+		// Zero is returned once the frame is decoded completely. The next frame (if any) is decoded then.
+		m_inFrame = hint != 0;
+	}
+	return count;
+}
+
+void afc::LZ4FrameInputStream::reset()
+{
+	ensureNotClosed(m_file);
+	if (fseek(m_file, 0, SEEK_SET) != 0) {
+		throwException("unable to reset stream"_s);
+	}
+	LZ4F_resetDecompressionContext(m_context);
+	m_bufPos = m_bufSize = 0;
+	m_inFrame = false;
+}
+
+size_t afc::LZ4FrameInputStream::skip(const size_t n)
+{
+	return skipByReading(*this, n);
+}
+
+void afc::LZ4FrameInputStream::close()
+{
+	closeFileRef(m_file, function<int (FILE *)>(fclose));
+}
+
+afc::LZ4FrameInputStream::~LZ4FrameInputStream()
+{
+	closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+	LZ4F_freeDecompressionContext(m_context);
+	std::free(m_buf);
+}
+
+afc::LZ4FrameOutputStream::LZ4FrameOutputStream(const char * const file, const int level)
+		: m_context(nullptr), m_buf(nullptr)
+{
+	std::memset(&m_prefs, 0, sizeof(m_prefs));
+	m_prefs.compressionLevel = level;
+	m_prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+	// The bound covers the frame footer, too.
+	m_bufCapacity = std::max<size_t>(LZ4F_compressBound(codecChunkSize, &m_prefs), LZ4F_HEADER_SIZE_MAX);
+
+	m_file = fopen(file, "wb");
+	if (m_file == nullptr) {
+		throwCannotOpenFileIOException(file);
+	}
+	if (LZ4F_isError(LZ4F_createCompressionContext(&m_context, LZ4F_VERSION))) {
+		closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+		throwException("unable to create LZ4 compression context"_s);
+	}
+	try {
+		m_buf = allocateBuffer(m_bufCapacity);
+
+		const size_t headerSize = LZ4F_compressBegin(m_context, m_buf, m_bufCapacity, &m_prefs);
+		if (LZ4F_isError(headerSize)) {
+			throwException(LZ4F_getErrorName(headerSize));
+		}
+		if (fwrite(m_buf, sizeof(unsigned char), headerSize, m_file) != headerSize) {
+			throwException("error encountered while writing to file"_s);
+		}
+	} catch (...) {
+		std::free(m_buf);
+		LZ4F_freeCompressionContext(m_context);
+		closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+		throw;
+	}
+}
+
+void afc::LZ4FrameOutputStream::write(const unsigned char * const data, const size_t n)
+{
+	ensureNotClosed(m_file);
+	for (size_t i = 0; i < n;) {
+		const size_t chunkSize = std::min(n - i, codecChunkSize);
+		const size_t compressedSize = LZ4F_compressUpdate(m_context, m_buf, m_bufCapacity, data + i, chunkSize, nullptr);
+		if (LZ4F_isError(compressedSize)) {
+			throwException(LZ4F_getErrorName(compressedSize));
+		}
+		if (fwrite(m_buf, sizeof(unsigned char), compressedSize, m_file) != compressedSize) {
+			throwException("error encountered while writing to file"_s);
+		}
+		i += chunkSize;
+	}
+}
+
+void afc::LZ4FrameOutputStream::close()
+{
+	if (m_file == nullptr) {
+		return;
+	}
+	const size_t footerSize = LZ4F_compressEnd(m_context, m_buf, m_bufCapacity, nullptr);
+	if (LZ4F_isError(footerSize)) {
+		throwException(LZ4F_getErrorName(footerSize));
+	}
+	if (fwrite(m_buf, sizeof(unsigned char), footerSize, m_file) != footerSize) {
+		throwException("error encountered while writing to file"_s);
+	}
+	closeFileRef(m_file, function<int (FILE *)>(fclose));
+}
+
+afc::LZ4FrameOutputStream::~LZ4FrameOutputStream()
+{
+	if (m_file != nullptr) {
+		// Completing the frame as gzclose() does for gzip streams; ignoring any failure.
+		const size_t footerSize = LZ4F_compressEnd(m_context, m_buf, m_bufCapacity, nullptr);
+		if (!LZ4F_isError(footerSize)) {
+			fwrite(m_buf, sizeof(unsigned char), footerSize, m_file);
+		}
+	}
+	closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+	LZ4F_freeCompressionContext(m_context);
+	std::free(m_buf);
+}
+#endif
+
+#ifdef AFC_USE_ZSTD
+afc::ZstdInputStream::ZstdInputStream(const char * const file, const unsigned char * const dictionary,
+		const size_t dictionarySize)
+		: m_context(nullptr), m_buf(nullptr), m_bufPos(0), m_bufSize(0), m_inFrame(false)
+{
+	m_file = fopen(file, "rb");
+	if (m_file == nullptr) {
+		throwCannotOpenFileIOException(file);
+	}
+	m_context = ZSTD_createDCtx();
+	if (m_context == nullptr) {
+		closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+		throw std::bad_alloc();
+	}
+	try {
+		if (dictionary != nullptr && ZSTD_isError(ZSTD_DCtx_loadDictionary(m_context, dictionary, dictionarySize))) {
+			throwException("unable to load zstd dictionary"_s);
+		}
+		m_buf = allocateBuffer(ZSTD_DStreamInSize());
+	} catch (...) {
+		ZSTD_freeDCtx(m_context);
+		closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+		throw;
+	}
+}
+
+size_t afc::ZstdInputStream::read(unsigned char * const buf, const size_t n)
+{
+	ensureNotClosed(m_file);
+	ZSTD_outBuffer out = {buf, n, 0};
+	while (out.pos < out.size) {
+		if (m_bufPos == m_bufSize) {
+			m_bufPos = 0;
+			m_bufSize = fread(m_buf, sizeof(unsigned char), ZSTD_DStreamInSize(), m_file);
+			if (m_bufSize == 0) {
+				if (ferror(m_file)) {
+					throwException("error encountered while reading from file"_s);
+				}
+				if (m_inFrame) {
+					throwException("unexpected end of zstd frame"_s);
+				}
+				break;
+			}
+		}
+		ZSTD_inBuffer in = {m_buf, m_bufSize, m_bufPos};
+		const size_t hint = ZSTD_decompressStream(m_context, &out, &in);
+		if (ZSTD_isError(hint)) {
+			throwException(ZSTD_getErrorName(hint));
+		}
+		m_bufPos = in.pos;
+		// Zero is returned once the frame is decoded and flushed completely.
+		m_inFrame = hint != 0;
+	}
+	return out.pos;
+}
+
+void afc::ZstdInputStream::reset()
+{
+	ensureNotClosed(m_file);
+	if (fseek(m_file, 0, SEEK_SET) != 0) {
+		throwException("unable to reset stream"_s);
+	}
+	// The dictionary loaded is kept.
+	ZSTD_DCtx_reset(m_context, ZSTD_reset_session_only);
+	m_bufPos = m_bufSize = 0;
+	m_inFrame = false;
+}
+
+size_t afc::ZstdInputStream::skip(const size_t n)
+{
+	return skipByReading(*this, n);
+}
+
+void afc::ZstdInputStream::close()
+{
+	closeFileRef(m_file, function<int (FILE *)>(fclose));
+}
+
+afc::ZstdInputStream::~ZstdInputStream()
+{
+	closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+	ZSTD_freeDCtx(m_context);
+	std::free(m_buf);
+}
+
+afc::ZstdOutputStream::ZstdOutputStream(const char * const file, const ZstdOptions &options)
+		: m_context(nullptr), m_buf(nullptr), m_bufCapacity(ZSTD_CStreamOutSize())
+{
+	m_file = fopen(file, "wb");
+	if (m_file == nullptr) {
+		throwCannotOpenFileIOException(file);
+	}
+	m_context = ZSTD_createCCtx();
+	if (m_context == nullptr) {
+		closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+		throw std::bad_alloc();
+	}
+	try {
+		if (ZSTD_isError(ZSTD_CCtx_setParameter(m_context, ZSTD_c_compressionLevel, options.level))) {
+			throwException("invalid compression level"_s);
+		}
+		ZSTD_CCtx_setParameter(m_context, ZSTD_c_checksumFlag, 1);
+		if (options.workerCount > 0 &&
+				ZSTD_isError(ZSTD_CCtx_setParameter(m_context, ZSTD_c_nbWorkers, static_cast<int>(options.workerCount)))) {
+			throwException("multi-threaded zstd compression is not supported by libzstd"_s);
+		}
+		if (options.dictionary != nullptr &&
+				ZSTD_isError(ZSTD_CCtx_loadDictionary(m_context, options.dictionary, options.dictionarySize))) {
+			throwException("unable to load zstd dictionary"_s);
+		}
+		m_buf = allocateBuffer(m_bufCapacity);
+	} catch (...) {
+		ZSTD_freeCCtx(m_context);
+		closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+		throw;
+	}
+}
+
+void afc::ZstdOutputStream::compress(const unsigned char * const data, const size_t n, const ZSTD_EndDirective mode)
+{
+	ZSTD_inBuffer in = {data, n, 0};
+	for (;;) {
+		ZSTD_outBuffer out = {m_buf, m_bufCapacity, 0};
+		const size_t remaining = ZSTD_compressStream2(m_context, &out, &in, mode);
+		if (ZSTD_isError(remaining)) {
+			throwException(ZSTD_getErrorName(remaining));
+		}
+		if (fwrite(m_buf, sizeof(unsigned char), out.pos, m_file) != out.pos) {
+			throwException("error encountered while writing to file"_s);
+		}
+		if (mode == ZSTD_e_end ? remaining == 0 : in.pos == in.size) {
+			return;
+		}
+	}
+}
+
+void afc::ZstdOutputStream::write(const unsigned char * const data, const size_t n)
+{
+	ensureNotClosed(m_file);
+	compress(data, n, ZSTD_e_continue);
+}
+
+void afc::ZstdOutputStream::close()
+{
+	if (m_file == nullptr) {
+		return;
+	}
+	compress(nullptr, 0, ZSTD_e_end);
+	closeFileRef(m_file, function<int (FILE *)>(fclose));
+}
+
+afc::ZstdOutputStream::~ZstdOutputStream()
+{
+	if (m_file != nullptr) {
+		try {
+			// Completing the frame as gzclose() does for gzip streams.
+			compress(nullptr, 0, ZSTD_e_end);
+		} catch (...) {
+			// Ignoring any failure.
+		}
+	}
+	closeFileNoexcept(m_file, function<int (FILE *)>(fclose));
+	ZSTD_freeCCtx(m_context);
+	std::free(m_buf);
+}
+#endif
@@ -16,8 +16,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #ifndef STREAM_H_
 #define STREAM_H_
 
+#include <cstddef>
 #include <cstdio>
 #include <zlib.h>
+#ifdef AFC_USE_LZ4
+	#include <lz4frame.h>
+#endif
+#ifdef AFC_USE_ZSTD
+	#include <zstd.h>
+#endif
 
 namespace afc
 {
@@ -97,7 +104,8 @@ namespace afc
 	class GZipFileOutputStream : public OutputStream
 	{
 	public:
-		GZipFileOutputStream(const char * const file);
+		// Level is either from 0 (no compression) to 9 (best compression) or Z_DEFAULT_COMPRESSION.
+		GZipFileOutputStream(const char * const file, const int level = Z_DEFAULT_COMPRESSION);
 		GZipFileOutputStream(GZipFileOutputStream &) = delete;
 		~GZipFileOutputStream();
 
@@ -107,9 +115,114 @@ namespace afc
 
 		virtual void close();
 	private:
-		static const int COMPRESS_LEVEL = 9;
 		gzFile m_file;
 	};
+
+#ifdef AFC_USE_LZ4
+	class LZ4FrameInputStream : public InputStream
+	{
+	public:
+		LZ4FrameInputStream(const char * const file);
+		LZ4FrameInputStream(LZ4FrameInputStream &) = delete;
+		~LZ4FrameInputStream();
+
+		void operator=(LZ4FrameInputStream &) = delete;
+
+		virtual std::size_t read(unsigned char * const buf, const std::size_t n);
+		virtual void reset();
+		virtual std::size_t skip(const std::size_t n);
+
+		virtual void close();
+	private:
+		std::FILE *m_file;
+		LZ4F_dctx *m_context;
+		unsigned char *m_buf;
+		std::size_t m_bufPos;
+		std::size_t m_bufSize;
+		bool m_inFrame;
+	};
+
+	class LZ4FrameOutputStream : public OutputStream
+	{
+	public:
+		// Level 0 is the fast default; levels from 3 to 12 select the high-compression mode.
+		LZ4FrameOutputStream(const char * const file, const int level = 0);
+		LZ4FrameOutputStream(LZ4FrameOutputStream &) = delete;
+		~LZ4FrameOutputStream();
+
+		void operator=(LZ4FrameOutputStream &) = delete;
+
+		virtual void write(const unsigned char * const data, const std::size_t n);
+
+		virtual void close();
+	private:
+		std::FILE *m_file;
+		LZ4F_cctx *m_context;
+		LZ4F_preferences_t m_prefs;
+		unsigned char *m_buf;
+		std::size_t m_bufCapacity;
+	};
+#endif
+
+#ifdef AFC_USE_ZSTD
+	struct ZstdOptions
+	{
+		int level = ZSTD_CLEVEL_DEFAULT;
+		// Zero means that compression is performed by the calling thread.
+		unsigned workerCount = 0;
+		/* A dictionary (e.g. trained by 'zstd --train') that improves compression of small records.
+		 * It is copied by the stream so it can be freed once the stream is constructed.
+		 */
+		const unsigned char *dictionary = nullptr;
+		std::size_t dictionarySize = 0;
+	};
+
+	class ZstdInputStream : public InputStream
+	{
+	public:
+		// The dictionary must be the same the data is compressed with.
+		ZstdInputStream(const char * const file, const unsigned char * const dictionary = nullptr,
+				const std::size_t dictionarySize = 0);
+		ZstdInputStream(ZstdInputStream &) = delete;
+		~ZstdInputStream();
+
+		void operator=(ZstdInputStream &) = delete;
+
+		virtual std::size_t read(unsigned char * const buf, const std::size_t n);
+		virtual void reset();
+		virtual std::size_t skip(const std::size_t n);
+
+		virtual void close();
+	private:
+		std::FILE *m_file;
+		ZSTD_DCtx *m_context;
+		unsigned char *m_buf;
+		std::size_t m_bufPos;
+		std::size_t m_bufSize;
+		bool m_inFrame;
+	};
+
+	class ZstdOutputStream : public OutputStream
+	{
+	public:
+		ZstdOutputStream(const char * const file, const ZstdOptions &options = ZstdOptions());
+		ZstdOutputStream(ZstdOutputStream &) = delete;
+		~ZstdOutputStream();
+
+		void operator=(ZstdOutputStream &) = delete;
+
+		virtual void write(const unsigned char * const data, const std::size_t n);
+
+		virtual void close();
+	private:
+		void compress(const unsigned char *data, std::size_t n, ZSTD_EndDirective mode);
+
+		std::FILE *m_file;
+		ZSTD_CCtx *m_context;
+		unsigned char *m_buf;
+		std::size_t m_bufCapacity;
+	};
+#endif
 }
 
 #endif /*STREAM_H_*/
@@ -0,0 +1,275 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_STRUCTURED_LOG_HPP_
+#define AFC_STRUCTURED_LOG_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <locale.h>
+#include <type_traits>
+#include <utility>
+
+#include "builtin.hpp"
+#include "dateutil.hpp"
+#include "FastStringBuffer.hpp"
+#include "json.hpp"
+#include "logger.hpp"
+#include "number.h"
+#include "SimpleString.hpp"
+#include "StringRef.hpp"
+
+namespace afc
+{
+	namespace logger
+	{
+		enum class LogFormat
+		{
+			// {"event":"request","user":12,"latency_us":340}
+			json,
+			// event=request user=12 latency_us=340
+			logfmt
+		};
+
+		namespace _impl
+		{
+			struct KVString
+			{
+				const char *data;
+				std::size_t size;
+			};
+
+			inline KVString kvString(const afc::ConstStringRef s) noexcept { return {s.value(), s.size()}; }
+			inline KVString kvString(const char * const s) noexcept { return {s, std::strlen(s)}; }
+			inline KVString kvString(const afc::String &s) noexcept { return {s.data(), s.size()}; }
+			inline KVString kvString(const afc::FastStringBuffer<char> &s) noexcept { return {s.data(), s.size()}; }
+			inline KVString kvString(const std::pair<const char *, const char *> &s) noexcept
+			{
+				return {s.first, std::size_t(s.second - s.first)};
+			}
+
+			// A logfmt value is quoted only if it cannot be parsed back otherwise.
+			inline bool needsQuotes(const KVString s) noexcept
+			{
+				if (s.size == 0) {
+					return true;
+				}
+				for (const char *p = s.data, * const end = s.data + s.size; p != end; ++p) {
+					const char c = *p;
+					if (c == ' ' || c == '=' || afc::json::_impl::needsEscape(static_cast<unsigned char>(c))) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			// Floating-point numbers are formatted in the "C" locale so that the decimal point is always '.'.
+			inline ::locale_t cLocale() noexcept
+			{
+				static const ::locale_t locale = ::newlocale(LC_ALL_MASK, "C", ::locale_t(0));
+				return locale;
+			}
+
+			/* Appends keys and values to the line buffer. Each append reserves the space it needs,
+			 * so the buffer is expanded at most a few times per thread.
+			 */
+			template<LogFormat format>
+			class KVWriter
+			{
+			public:
+				explicit KVWriter(afc::FastStringBuffer<char> &buf) noexcept : m_buf(buf) {}
+
+				void key(const KVString s, const bool first)
+				{
+					char *p = reserve(afc::json::maxEscapedSize(s.size) + 4);
+					if (format == LogFormat::json) {
+						*p++ = first ? '{' : ',';
+						*p++ = '"';
+						p = afc::json::escape(s.data, s.data + s.size, p);
+						*p++ = '"';
+						*p++ = ':';
+					} else {
+						if (!first) {
+							*p++ = ' ';
+						}
+						// Keys are quoted as values are so that the line can be parsed back.
+						const bool quoted = needsQuotes(s);
+						if (quoted) {
+							*p++ = '"';
+						}
+						p = afc::json::escape(s.data, s.data + s.size, p);
+						if (quoted) {
+							*p++ = '"';
+						}
+						*p++ = '=';
+					}
+					commit(p);
+				}
+
+				void value(const KVString s)
+				{
+					char *p = reserve(afc::json::maxEscapedSize(s.size) + 2);
+					if (format == LogFormat::json || needsQuotes(s)) {
+						*p++ = '"';
+						p = afc::json::escape(s.data, s.data + s.size, p);
+						*p++ = '"';
+					} else {
+						p = std::copy_n(s.data, s.size, p);
+					}
+					commit(p);
+				}
+
+				template<typename T>
+				void value(const T &s, decltype(kvString(s)) * = nullptr) { value(kvString(s)); }
+
+				void value(const char c) { value(KVString{&c, 1}); }
+
+				void value(const bool b)
+				{
+					using afc::operator"" _s;
+					raw(b ? "true"_s : "false"_s);
+				}
+
+				void value(std::nullptr_t)
+				{
+					using afc::operator"" _s;
+					raw("null"_s);
+				}
+
+				template<typename T>
+				typename std::enable_if<std::is_integral<T>::value>::type value(const T n)
+				{
+					char *p = reserve(afc::maxPrintedSize<T, 10>());
+					commit(afc::printNumber<10>(n, p));
+				}
+
+				template<typename T>
+				typename std::enable_if<std::is_floating_point<T>::value>::type value(const T n)
+				{
+					if (format == LogFormat::json && unlikely(!std::isfinite(n))) {
+						// JSON has no representation for infinities and NaN.
+						value(nullptr);
+						return;
+					}
+					const std::size_t maxSize = 32;
+					char *p = reserve(maxSize);
+					const ::locale_t prevLocale = ::uselocale(cLocale());
+					const int size = std::snprintf(p, maxSize, "%.17g", static_cast<double>(n));
+					::uselocale(prevLocale);
+					commit(p + size);
+				}
+
+				void value(const afc::TimestampTZ &time)
+				{
+					char *p = reserve(afc::maxISODateTimeSize() + 2);
+					if (format == LogFormat::json) {
+						*p++ = '"';
+					}
+					p = afc::formatISODateTime(time, p);
+					if (format == LogFormat::json) {
+						*p++ = '"';
+					}
+					commit(p);
+				}
+
+				void value(const afc::ISODateTimeView &view)
+				{
+					afc::TimestampTZ time;
+					time = static_cast<std::time_t>(view.ref);
+					value(time);
+				}
+
+				void end()
+				{
+					char *p = reserve(2);
+					if (format == LogFormat::json) {
+						*p++ = '}';
+					}
+					*p++ = '\n';
+					commit(p);
+				}
+			private:
+				void raw(const afc::ConstStringRef s)
+				{
+					commit(std::copy_n(s.value(), s.size(), reserve(s.size())));
+				}
+
+				char *reserve(const std::size_t n)
+				{
+					m_buf.reserve(m_buf.size() + n);
+					return m_buf.end();
+				}
+
+				void commit(const char * const end) noexcept { m_buf.resize(end - m_buf.begin()); }
+
+				afc::FastStringBuffer<char> &m_buf;
+			};
+
+			template<LogFormat format>
+			inline void writeKV(KVWriter<format> &) {}
+
+			template<LogFormat format, typename Key, typename Value, typename... Args>
+			inline void writeKV(KVWriter<format> &writer, const Key &key, const Value &value, const Args &...args)
+			{
+				writer.key(kvString(key), false);
+				writer.value(value);
+				writeKV(writer, args...);
+			}
+
+			inline afc::FastStringBuffer<char> &kvLineBuffer() noexcept
+			{
+				// The buffer is reused by all the records logged by the thread.
+				static thread_local afc::FastStringBuffer<char> buf;
+				return buf;
+			}
+		}
+
+		/* Logs a record with the event name and the key-value pairs that follow it as a single line:
+		 *
+		 *     logKV(dest, "request"_s, "user", id, "latency_us", t);
+		 *
+		 * Keys are C-strings or ConstStringRefs. Values are strings, characters, numbers, booleans,
+		 * nullptr, TimestampTZ and ISODateTimeView. The line is built in a per-thread buffer
+		 * and written with a single call, without creating temporary strings.
+		 */
+		template<LogFormat format = LogFormat::json, bool flush = false, typename... Args>
+		inline bool logKV(std::FILE * const dest, const afc::ConstStringRef event, const Args &...keyValues)
+		{
+			static_assert(sizeof...(Args) % 2 == 0, "Each key must be followed by its value.");
+			using afc::operator"" _s;
+
+			afc::FastStringBuffer<char> &buf = _impl::kvLineBuffer();
+			buf.clear();
+
+			_impl::KVWriter<format> writer(buf);
+			writer.key(_impl::kvString("event"_s), true);
+			writer.value(event);
+			_impl::writeKV(writer, keyValues...);
+			writer.end();
+
+			FileLock fileLock(dest);
+			bool success = logText(buf.data(), buf.size(), dest);
+			if (flush) {
+				// Flushing the buffer even if logging payload fails.
+				success &= (std::fflush(dest) != EOF);
+			}
+			return success;
+		}
+	}
+}
+
+#endif /* AFC_STRUCTURED_LOG_HPP_ */
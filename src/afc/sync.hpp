@@ -0,0 +1,289 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_SYNC_HPP_
+#define AFC_SYNC_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "builtin.hpp"
+
+/* Locks for short critical sections. All of them satisfy the Lockable requirements
+ * so that std::lock_guard and std::unique_lock can be used with them.
+ */
+namespace afc
+{
+	// Tells the CPU that the thread is in a spin-wait loop.
+	inline void cpuRelax() noexcept { __builtin_ia32_pause(); }
+
+	/* Exponential backoff for spin-wait loops. Once the limit of pauses is reached the thread
+	 * yields the CPU at each step so that the lock owner can progress if it is preempted.
+	 */
+	class Backoff
+	{
+	public:
+		Backoff() noexcept : m_pauses(1) {}
+
+		void operator()() noexcept
+		{
+			if (m_pauses <= maxPauses) {
+				for (unsigned i = 0; i < m_pauses; ++i) {
+					cpuRelax();
+				}
+				m_pauses *= 2;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	private:
+		static const unsigned maxPauses = 64;
+
+		unsigned m_pauses;
+	};
+
+	// A test-and-test-and-set spinlock. The waiters spin on a shared cache line without writing to it.
+	class SpinLock
+	{
+	public:
+		SpinLock() noexcept : m_locked(false) {}
+		SpinLock(const SpinLock &) = delete;
+		SpinLock &operator=(const SpinLock &) = delete;
+
+		void lock() noexcept
+		{
+			while (unlikely(m_locked.exchange(true, std::memory_order_acquire))) {
+				Backoff backoff;
+				do {
+					backoff();
+				} while (m_locked.load(std::memory_order_relaxed));
+			}
+		}
+
+		bool try_lock() noexcept
+		{
+			return !m_locked.load(std::memory_order_relaxed) && !m_locked.exchange(true, std::memory_order_acquire);
+		}
+
+		void unlock() noexcept { m_locked.store(false, std::memory_order_release); }
+	private:
+		std::atomic<bool> m_locked;
+	};
+
+	/* A FIFO spinlock. Waiters are served in the order of arrival, so none of them starves,
+	 * at the cost of a handover to a preempted waiter stalling all the following ones. So it is
+	 * not to be used if the threads contending for the lock can outnumber the CPUs.
+	 */
+	class TicketLock
+	{
+	public:
+		TicketLock() noexcept : m_next(0), m_serving(0) {}
+		TicketLock(const TicketLock &) = delete;
+		TicketLock &operator=(const TicketLock &) = delete;
+
+		void lock() noexcept
+		{
+			const std::uint32_t ticket = m_next.fetch_add(1, std::memory_order_relaxed);
+			std::uint32_t serving;
+			unsigned spins = 0;
+			while (unlikely((serving = m_serving.load(std::memory_order_acquire)) != ticket)) {
+				// The farther the turn is the longer the wait. The CPU is yielded to the preempted owner eventually.
+				const std::uint32_t distance = ticket - serving;
+				if (distance > maxSpinningWaiters || spins >= maxSpins) {
+					std::this_thread::yield();
+				} else {
+					for (std::uint32_t i = 0; i < distance * pausesPerWaiter; ++i) {
+						cpuRelax();
+					}
+					++spins;
+				}
+			}
+		}
+
+		bool try_lock() noexcept
+		{
+			std::uint32_t serving = m_serving.load(std::memory_order_relaxed);
+			return m_next.compare_exchange_strong(serving, serving + 1, std::memory_order_acquire, std::memory_order_relaxed);
+		}
+
+		void unlock() noexcept
+		{
+			m_serving.store(m_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+	private:
+		static const std::uint32_t maxSpinningWaiters = 4;
+		static const std::uint32_t pausesPerWaiter = 16;
+		static const unsigned maxSpins = 64;
+
+		std::atomic<std::uint32_t> m_next;
+		std::atomic<std::uint32_t> m_serving;
+	};
+
+	/* A reader-biased read-write spinlock. Readers do not wait for writers that wait for the lock,
+	 * so writers can starve under constant read load. It is meant for read-mostly data with short
+	 * critical sections; lock_shared() is a single atomic increment if there is no writer.
+	 */
+	class RWSpinLock
+	{
+	public:
+		RWSpinLock() noexcept : m_state(0) {}
+		RWSpinLock(const RWSpinLock &) = delete;
+		RWSpinLock &operator=(const RWSpinLock &) = delete;
+
+		void lock() noexcept
+		{
+			Backoff backoff;
+			while (unlikely(!try_lock())) {
+				do {
+					backoff();
+				} while (m_state.load(std::memory_order_relaxed) != 0);
+			}
+		}
+
+		bool try_lock() noexcept
+		{
+			std::uint32_t expected = 0;
+			return m_state.compare_exchange_strong(expected, writer, std::memory_order_acquire, std::memory_order_relaxed);
+		}
+
+		// Readers may have announced themselves transiently while the writer holds the lock.
+		void unlock() noexcept { m_state.fetch_sub(writer, std::memory_order_release); }
+
+		void lock_shared() noexcept
+		{
+			while (unlikely(!try_lock_shared())) {
+				Backoff backoff;
+				do {
+					backoff();
+				} while (m_state.load(std::memory_order_relaxed) & writer);
+			}
+		}
+
+		bool try_lock_shared() noexcept
+		{
+			if (likely((m_state.fetch_add(reader, std::memory_order_acquire) & writer) == 0)) {
+				return true;
+			}
+			m_state.fetch_sub(reader, std::memory_order_relaxed);
+			return false;
+		}
+
+		void unlock_shared() noexcept { m_state.fetch_sub(reader, std::memory_order_release); }
+	private:
+		static const std::uint32_t writer = 1;
+		static const std::uint32_t reader = 2;
+
+		// The writer flag and the number of readers multiplied by two.
+		std::atomic<std::uint32_t> m_state;
+	};
+
+	// std::lock_guard for the shared ownership of a lock like RWSpinLock.
+	template<typename SharedLockable>
+	class SharedLockGuard
+	{
+	public:
+		explicit SharedLockGuard(SharedLockable &lock) noexcept : m_lock(lock) { m_lock.lock_shared(); }
+		SharedLockGuard(const SharedLockGuard &) = delete;
+		~SharedLockGuard() { m_lock.unlock_shared(); }
+
+		SharedLockGuard &operator=(const SharedLockGuard &) = delete;
+	private:
+		SharedLockable &m_lock;
+	};
+
+	/* Publishes a trivially copyable value to readers that never block the writers. A reader
+	 * copies the value and retries if a write has happened meanwhile, so SeqLock suits small
+	 * read-mostly snapshots (e.g. cached time strings or configuration). Writers are serialised.
+	 *
+	 * The value is stored as relaxed atomic words so that racing reads are well-defined.
+	 */
+	template<typename T>
+	class SeqLock
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable.");
+	public:
+		explicit SeqLock(const T &value = T()) noexcept : m_seq(0) { storeWords(value); }
+		SeqLock(const SeqLock &) = delete;
+		SeqLock &operator=(const SeqLock &) = delete;
+
+		T load() const noexcept
+		{
+			Backoff backoff;
+			for (;;) {
+				const std::uint32_t seq = m_seq.load(std::memory_order_acquire);
+				if (likely((seq & 1) == 0)) {
+					Word words[wordCount];
+					for (std::size_t i = 0; i < wordCount; ++i) {
+						words[i] = m_words[i].load(std::memory_order_relaxed);
+					}
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (likely(m_seq.load(std::memory_order_relaxed) == seq)) {
+						T value;
+						std::memcpy(&value, words, sizeof(T));
+						return value;
+					}
+				}
+				backoff();
+			}
+		}
+
+		void store(const T &value) noexcept
+		{
+			std::lock_guard<SpinLock> lock(m_writeLock);
+			storeWords(value);
+		}
+
+		// Replaces the value with f(value) atomically with respect to other writers.
+		template<typename F>
+		void update(F f)
+		{
+			std::lock_guard<SpinLock> lock(m_writeLock);
+			storeWords(f(load()));
+		}
+
+		// Changes with each store, so that readers can detect changes cheaply.
+		std::uint32_t version() const noexcept { return m_seq.load(std::memory_order_acquire) / 2; }
+	private:
+		typedef std::uintptr_t Word;
+
+		static const std::size_t wordCount = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+		void storeWords(const T &value) noexcept
+		{
+			Word words[wordCount] = {};
+			std::memcpy(words, &value, sizeof(T));
+
+			const std::uint32_t seq = m_seq.load(std::memory_order_relaxed);
+			m_seq.store(seq + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			for (std::size_t i = 0; i < wordCount; ++i) {
+				m_words[i].store(words[i], std::memory_order_relaxed);
+			}
+			m_seq.store(seq + 2, std::memory_order_release);
+		}
+
+		// Odd while a write is in progress.
+		std::atomic<std::uint32_t> m_seq;
+		std::atomic<Word> m_words[wordCount];
+		SpinLock m_writeLock;
+	};
+}
+
+#endif /*AFC_SYNC_HPP_*/
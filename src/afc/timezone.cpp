@@ -0,0 +1,472 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "timezone.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "builtin.hpp"
+#include "Exception.h"
+#include "stream.h"
+#include "StringRef.hpp"
+
+using namespace afc;
+using namespace std;
+using afc::helper::civilFromDays;
+using afc::helper::daysFromCivil;
+using afc::helper::floorDiv;
+using afc::helper::isLeapYear;
+using afc::helper::monthLength;
+using afc::helper::weekDay;
+
+namespace
+{
+	void throwException(ConstStringRef message)
+	{
+		throw Exception(message);
+	}
+
+	void throwMalformedData()
+	{
+		throwException("malformed TZif data"_s);
+	}
+
+	void throwMalformedRule()
+	{
+		throwException("malformed TZ rule in TZif data"_s);
+	}
+
+	const int64_t secondsPerDay = 86400;
+
+	// Big-endian fields of TZif data with bounds checking.
+	class TZifReader
+	{
+	public:
+		TZifReader(const unsigned char * const begin, const unsigned char * const end) noexcept : m_pos(begin), m_end(end) {}
+
+		const unsigned char *take(const size_t n)
+		{
+			if (unlikely(size_t(m_end - m_pos) < n)) {
+				throwMalformedData();
+			}
+			const unsigned char * const result = m_pos;
+			m_pos += n;
+			return result;
+		}
+
+		uint32_t u32()
+		{
+			const unsigned char * const p = take(4);
+			return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+		}
+
+		int64_t i64()
+		{
+			const uint64_t high = u32();
+			return static_cast<int64_t>((high << 32) | u32());
+		}
+
+		int64_t time(const bool wide) { return wide ? i64() : static_cast<int32_t>(u32()); }
+
+		const unsigned char *pos() const noexcept { return m_pos; }
+		const unsigned char *end() const noexcept { return m_end; }
+	private:
+		const unsigned char *m_pos;
+		const unsigned char * const m_end;
+	};
+
+	struct TZifHeader
+	{
+		char version;
+		uint32_t isUtCount, isStdCount, leapCount, timeCount, typeCount, charCount;
+
+		explicit TZifHeader(TZifReader &in)
+		{
+			const unsigned char * const p = in.take(20);
+			if (std::memcmp(p, "TZif", 4) != 0) {
+				throwMalformedData();
+			}
+			version = static_cast<char>(p[4]);
+			isUtCount = in.u32();
+			isStdCount = in.u32();
+			leapCount = in.u32();
+			timeCount = in.u32();
+			typeCount = in.u32();
+			charCount = in.u32();
+			if (typeCount == 0 || typeCount > 256 || charCount == 0 || charCount > 0xffff) {
+				throwMalformedData();
+			}
+		}
+
+		size_t dataSize(const size_t timeSize) const noexcept
+		{
+			return size_t(timeCount) * (timeSize + 1) + size_t(typeCount) * 6 + charCount +
+					size_t(leapCount) * (timeSize + 4) + isStdCount + isUtCount;
+		}
+	};
+
+	// The parser of the POSIX TZ rule syntax.
+	class RuleParser
+	{
+	public:
+		RuleParser(const char * const begin, const char * const end) noexcept : m_pos(begin), m_end(end) {}
+
+		bool atEnd() const noexcept { return m_pos == m_end; }
+		bool peek(const char c) const noexcept { return m_pos != m_end && *m_pos == c; }
+
+		void expect(const char c)
+		{
+			if (!peek(c)) {
+				throwMalformedRule();
+			}
+			++m_pos;
+		}
+
+		// Either alphabetic characters or any characters in angle brackets.
+		string name()
+		{
+			const char *begin = m_pos;
+			const char *end;
+			if (peek('<')) {
+				begin = ++m_pos;
+				while (m_pos != m_end && *m_pos != '>') {
+					++m_pos;
+				}
+				end = m_pos;
+				expect('>');
+			} else {
+				while (m_pos != m_end && ((*m_pos >= 'a' && *m_pos <= 'z') || (*m_pos >= 'A' && *m_pos <= 'Z'))) {
+					++m_pos;
+				}
+				end = m_pos;
+			}
+			if (begin == end) {
+				throwMalformedRule();
+			}
+			return string(begin, end);
+		}
+
+		unsigned number(const unsigned maxValue)
+		{
+			if (atEnd() || *m_pos < '0' || *m_pos > '9') {
+				throwMalformedRule();
+			}
+			unsigned result = 0;
+			while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9') {
+				result = result * 10 + unsigned(*m_pos++ - '0');
+				if (result > maxValue) {
+					throwMalformedRule();
+				}
+			}
+			return result;
+		}
+
+		// [+-]hh[:mm[:ss]] in seconds.
+		int32_t time(const unsigned maxHours)
+		{
+			int32_t sign = 1;
+			if (peek('+')) {
+				++m_pos;
+			} else if (peek('-')) {
+				++m_pos;
+				sign = -1;
+			}
+			int32_t result = int32_t(number(maxHours)) * 3600;
+			if (peek(':')) {
+				++m_pos;
+				result += int32_t(number(59)) * 60;
+				if (peek(':')) {
+					++m_pos;
+					result += int32_t(number(59));
+				}
+			}
+			return sign * result;
+		}
+	private:
+		const char *m_pos;
+		const char * const m_end;
+	};
+}
+
+afc::TimeZone::TimeZone(const char * const name, const unsigned char * const data, const size_t n)
+		: m_name(name), m_hasRule(false), m_lastTransition(0)
+{
+	TZifReader in(data, data + n);
+	TZifHeader header(in);
+	bool wide = false;
+	if (header.version >= '2') {
+		// The 32-bit data block is superseded by the 64-bit one.
+		in.take(header.dataSize(4));
+		header = TZifHeader(in);
+		wide = true;
+	}
+
+	m_transitions.resize(header.timeCount);
+	for (int64_t &t : m_transitions) {
+		t = in.time(wide);
+	}
+	if (!std::is_sorted(m_transitions.begin(), m_transitions.end())) {
+		throwMalformedData();
+	}
+	const unsigned char * const types = in.take(header.timeCount);
+	m_transitionTypes.assign(types, types + header.timeCount);
+	for (const uint8_t type : m_transitionTypes) {
+		if (type >= header.typeCount) {
+			throwMalformedData();
+		}
+	}
+
+	m_types.resize(header.typeCount);
+	for (LocalTimeType &type : m_types) {
+		type.gmtOffset = static_cast<int32_t>(in.u32());
+		const unsigned char * const p = in.take(2);
+		type.isDst = p[0] != 0;
+		type.abbreviation = p[1];
+		if (type.abbreviation >= header.charCount) {
+			throwMalformedData();
+		}
+	}
+	const unsigned char * const chars = in.take(header.charCount);
+	m_abbreviations.assign(reinterpret_cast<const char *>(chars), header.charCount);
+	// Each abbreviation is null-terminated, including the last one.
+	m_abbreviations.push_back('\0');
+
+	in.take(size_t(header.leapCount) * (wide ? 12 : 8) + header.isStdCount + header.isUtCount);
+
+	if (wide && in.pos() != in.end()) {
+		// The footer: "\n<POSIX TZ rule>\n".
+		const char * const begin = reinterpret_cast<const char *>(in.take(1));
+		const char * const end = static_cast<const char *>(std::memchr(begin + 1, '\n', in.end() - in.pos()));
+		if (*begin != '\n' || end == nullptr) {
+			throwMalformedData();
+		}
+		if (end != begin + 1) {
+			parseRule(begin + 1, end);
+		}
+	}
+}
+
+uint16_t afc::TimeZone::addLocalTimeType(const int32_t gmtOffset, const bool isDst, const string &abbreviation)
+{
+	if (m_abbreviations.size() + abbreviation.size() >= 0xffff) {
+		throwMalformedRule();
+	}
+	m_types.push_back(LocalTimeType{gmtOffset, isDst, static_cast<uint16_t>(m_abbreviations.size())});
+	m_abbreviations.append(abbreviation);
+	m_abbreviations.push_back('\0');
+	return static_cast<uint16_t>(m_types.size() - 1);
+}
+
+void afc::TimeZone::parseRule(const char * const begin, const char * const end)
+{
+	RuleParser parser(begin, end);
+
+	const string stdName = parser.name();
+	// POSIX offsets are positive to the west of Greenwich.
+	const int32_t stdOffset = -parser.time(24);
+	m_rule.stdType = addLocalTimeType(stdOffset, false, stdName);
+	m_rule.hasDst = !parser.atEnd();
+	m_hasRule = true;
+	if (!m_rule.hasDst) {
+		return;
+	}
+
+	const string dstName = parser.name();
+	const int32_t dstOffset = parser.atEnd() || parser.peek(',') ? stdOffset + 3600 : -parser.time(24);
+	m_rule.dstType = addLocalTimeType(dstOffset, true, dstName);
+
+	auto parseDate = [&parser](RuleDate &date)
+	{
+		parser.expect(',');
+		if (parser.peek('M')) {
+			parser.expect('M');
+			date.kind = RuleDate::monthWeekDay;
+			date.month = static_cast<uint8_t>(parser.number(12));
+			parser.expect('.');
+			date.week = static_cast<uint8_t>(parser.number(5));
+			parser.expect('.');
+			date.weekDay = static_cast<uint8_t>(parser.number(6));
+			if (date.month == 0 || date.week == 0) {
+				throwMalformedRule();
+			}
+		} else if (parser.peek('J')) {
+			parser.expect('J');
+			date.kind = RuleDate::julianNoLeap;
+			date.day = static_cast<uint16_t>(parser.number(365));
+			if (date.day == 0) {
+				throwMalformedRule();
+			}
+		} else {
+			date.kind = RuleDate::julian;
+			date.day = static_cast<uint16_t>(parser.number(365));
+		}
+		date.time = 7200;
+		if (parser.peek('/')) {
+			parser.expect('/');
+			// RFC 8536 allows for hours in [-167, 167].
+			date.time = parser.time(167);
+		}
+	};
+
+	if (parser.atEnd()) {
+		// The US rules are the default ones, as in glibc.
+		m_rule.start = RuleDate{RuleDate::monthWeekDay, 3, 2, 0, 0, 7200};
+		m_rule.end = RuleDate{RuleDate::monthWeekDay, 11, 1, 0, 0, 7200};
+		return;
+	}
+	parseDate(m_rule.start);
+	parseDate(m_rule.end);
+	if (!parser.atEnd()) {
+		throwMalformedRule();
+	}
+}
+
+int64_t afc::TimeZone::ruleTransition(const int64_t year, const RuleDate &date, const int32_t gmtOffset) const noexcept
+{
+	int64_t days;
+	switch (date.kind) {
+	case RuleDate::julianNoLeap:
+		// February 29 is never counted.
+		days = daysFromCivil(year, 1, 1) + date.day - 1 + (isLeapYear(year) && date.day >= 60);
+		break;
+	case RuleDate::julian:
+		days = daysFromCivil(year, 1, 1) + date.day;
+		break;
+	default:
+		{
+			const int64_t first = daysFromCivil(year, date.month, 1);
+			days = first + (date.weekDay - int64_t(weekDay(first)) + 7) % 7 + 7 * (date.week - 1);
+			// The week 5 stands for the last week day in the month.
+			const int64_t last = first + monthLength(year, date.month) - 1;
+			while (days > last) {
+				days -= 7;
+			}
+		}
+	}
+	return days * secondsPerDay + date.time - gmtOffset;
+}
+
+const afc::TimeZone::LocalTimeType &afc::TimeZone::ruleLocalTimeType(const int64_t t) const noexcept
+{
+	const LocalTimeType &stdType = m_types[m_rule.stdType];
+	if (!m_rule.hasDst) {
+		return stdType;
+	}
+	const LocalTimeType &dstType = m_types[m_rule.dstType];
+
+	int64_t year;
+	unsigned month, day;
+	civilFromDays(floorDiv(t + stdType.gmtOffset, secondsPerDay), year, month, day);
+
+	const int64_t start = ruleTransition(year, m_rule.start, stdType.gmtOffset);
+	const int64_t end = ruleTransition(year, m_rule.end, dstType.gmtOffset);
+	// DST spans the new year in the southern hemisphere.
+	const bool isDst = start < end ? t >= start && t < end : t < end || t >= start;
+	return isDst ? dstType : stdType;
+}
+
+const afc::TimeZone::LocalTimeType &afc::TimeZone::localTimeType(const int64_t t) const noexcept
+{
+	const size_t n = m_transitions.size();
+	if (unlikely(n == 0)) {
+		return m_hasRule ? ruleLocalTimeType(t) : m_types[0];
+	}
+
+	// Transition i - 1 is the last one that is not later than t.
+	size_t i = m_lastTransition.load(memory_order_relaxed);
+	if (!((i == 0 || m_transitions[i - 1] <= t) && (i == n || t < m_transitions[i]))) {
+		i = std::upper_bound(m_transitions.begin(), m_transitions.end(), t) - m_transitions.begin();
+		m_lastTransition.store(i, memory_order_relaxed);
+	}
+
+	if (i == 0) {
+		// The local time type 0 is in effect before the first transition (RFC 8536).
+		return m_types[0];
+	}
+	if (i == n && m_hasRule) {
+		return ruleLocalTimeType(t);
+	}
+	return m_types[m_transitionTypes[i - 1]];
+}
+
+std::tm afc::TimeZone::localTime(const Timestamp &time) const noexcept
+{
+	const int64_t t = seconds(time);
+	const LocalTimeType &type = localTimeType(t);
+	const int64_t local = t + type.gmtOffset;
+	const int64_t days = floorDiv(local, secondsPerDay);
+	const int64_t secondOfDay = local - days * secondsPerDay;
+
+	int64_t year;
+	unsigned month, day;
+	civilFromDays(days, year, month, day);
+
+	std::tm result;
+	result.tm_year = static_cast<int>(year - 1900);
+	result.tm_mon = static_cast<int>(month - 1);
+	result.tm_mday = static_cast<int>(day);
+	result.tm_hour = static_cast<int>(secondOfDay / 3600);
+	result.tm_min = static_cast<int>(secondOfDay / 60 % 60);
+	result.tm_sec = static_cast<int>(secondOfDay % 60);
+	result.tm_wday = static_cast<int>(weekDay(days));
+	result.tm_yday = static_cast<int>(days - daysFromCivil(year, 1, 1));
+	result.tm_isdst = type.isDst;
+	// Note: tm_gmtoff and tm_zone are not a part of the standard C++11.
+	result.tm_gmtoff = type.gmtOffset;
+	result.tm_zone = m_abbreviations.c_str() + type.abbreviation;
+	return result;
+}
+
+afc::TimeZoneDatabase &afc::TimeZoneDatabase::system()
+{
+	static TimeZoneDatabase database([]()
+	{
+		const char * const dir = std::getenv("TZDIR");
+		return dir != nullptr && *dir != '\0' ? dir : "/usr/share/zoneinfo";
+	}());
+	return database;
+}
+
+const afc::TimeZone &afc::TimeZoneDatabase::get(const char * const name)
+{
+	// Names must not escape the database directory.
+	if (*name == '\0' || *name == '/' || std::strstr(name, "..") != nullptr) {
+		throwException("invalid time zone name"_s);
+	}
+
+	lock_guard<mutex> lock(m_mutex);
+
+	auto pos = m_zones.find(name);
+	if (pos != m_zones.end()) {
+		return *pos->second;
+	}
+
+	const string file = m_directory + '/' + name;
+	vector<unsigned char> data;
+	{
+		FileInputStream in(file.c_str());
+		unsigned char buf[4096];
+		size_t n;
+		while ((n = in.read(buf, sizeof(buf))) > 0) {
+			data.insert(data.end(), buf, buf + n);
+		}
+	}
+	unique_ptr<TimeZone> zone(new TimeZone(name, data.data(), data.size()));
+	const TimeZone &result = *zone;
+	m_zones.emplace(name, std::move(zone));
+	return result;
+}
@@ -0,0 +1,152 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_TIMEZONE_H_
+#define AFC_TIMEZONE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dateutil.hpp"
+
+namespace afc
+{
+	/* A time zone loaded from TZif data (RFC 8536) into transition tables. Unlike the
+	 * facilities that rely upon the process-global TZ, any number of zones can be used at
+	 * once, and conversions are lock-free and thread-safe.
+	 *
+	 * Timestamps beyond the last transition are converted by the POSIX TZ rule from the
+	 * footer of the data. Leap second records are ignored (POSIX time is assumed).
+	 */
+	class TimeZone
+	{
+	public:
+		// Throws afc::Exception if the data are malformed.
+		TimeZone(const char *name, const unsigned char *data, std::size_t n);
+		TimeZone(const TimeZone &) = delete;
+
+		TimeZone &operator=(const TimeZone &) = delete;
+
+		const std::string &name() const noexcept { return m_name; }
+
+		// The offset of the local time from UTC in seconds.
+		long gmtOffset(const Timestamp &time) const noexcept { return localTimeType(seconds(time)).gmtOffset; }
+
+		// tm_gmtoff, tm_isdst and tm_zone are set as well. tm_zone lives as long as the zone.
+		std::tm localTime(const Timestamp &time) const noexcept;
+
+		TimestampTZ toTimestampTZ(const Timestamp &time) const noexcept
+		{
+			TimestampTZ result;
+			result.setMillis(time.millis());
+			result.setGmtOffset(gmtOffset(time));
+			return result;
+		}
+	private:
+		struct LocalTimeType
+		{
+			std::int32_t gmtOffset;
+			bool isDst;
+			// The position of the abbreviation in m_abbreviations.
+			std::uint16_t abbreviation;
+		};
+
+		struct RuleDate
+		{
+			enum Kind : std::uint8_t
+			{
+				julianNoLeap, // Jn
+				julian, // n
+				monthWeekDay // Mm.w.d
+			};
+
+			Kind kind;
+			std::uint8_t month;
+			std::uint8_t week;
+			std::uint8_t weekDay;
+			std::uint16_t day;
+			// The local time of the transition in seconds.
+			std::int32_t time;
+		};
+
+		// The POSIX TZ rule (e.g. "CET-1CEST,M3.5.0,M10.5.0/3").
+		struct Rule
+		{
+			std::uint16_t stdType;
+			std::uint16_t dstType;
+			bool hasDst;
+			RuleDate start;
+			RuleDate end;
+		};
+
+		static std::int64_t seconds(const Timestamp &time) noexcept
+		{
+			const Timestamp::time_type millis = time.millis();
+			return millis >= 0 ? millis / 1000 : -((999 - millis) / 1000);
+		}
+
+		const LocalTimeType &localTimeType(std::int64_t t) const noexcept;
+		const LocalTimeType &ruleLocalTimeType(std::int64_t t) const noexcept;
+		std::int64_t ruleTransition(std::int64_t year, const RuleDate &date, std::int32_t gmtOffset) const noexcept;
+
+		void parseRule(const char *begin, const char *end);
+		std::uint16_t addLocalTimeType(std::int32_t gmtOffset, bool isDst, const std::string &abbreviation);
+
+		std::string m_name;
+		// Sorted UTC times of transitions (in seconds) and the local time types they switch to.
+		std::vector<std::int64_t> m_transitions;
+		std::vector<std::uint8_t> m_transitionTypes;
+		std::vector<LocalTimeType> m_types;
+		std::string m_abbreviations;
+		Rule m_rule;
+		bool m_hasRule;
+		/* The index of the transition found by the last lookup. Timestamps that are converted
+		 * one after another are usually close to each other, so the binary search is avoided.
+		 * Threads race benignly: the value is a hint only.
+		 */
+		mutable std::atomic<std::size_t> m_lastTransition;
+	};
+
+	/* Loads zones from a TZif database directory on the first request. Zones live as long
+	 * as the database. get() is thread-safe.
+	 */
+	class TimeZoneDatabase
+	{
+	public:
+		// The directory the environment variable TZDIR points to or /usr/share/zoneinfo.
+		static TimeZoneDatabase &system();
+
+		explicit TimeZoneDatabase(const char *directory) : m_directory(directory) {}
+		TimeZoneDatabase(const TimeZoneDatabase &) = delete;
+
+		TimeZoneDatabase &operator=(const TimeZoneDatabase &) = delete;
+
+		// name is e.g. "Europe/Minsk". Throws afc::Exception if the zone cannot be loaded.
+		const TimeZone &get(const char *name);
+	private:
+		const std::string m_directory;
+		std::mutex m_mutex;
+		std::map<std::string, std::unique_ptr<TimeZone>> m_zones;
+	};
+}
+
+#endif /*AFC_TIMEZONE_H_*/
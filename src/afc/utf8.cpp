@@ -0,0 +1,295 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "utf8.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __AVX2__
+	#include <immintrin.h>
+#elif defined __SSSE3__
+	#include <tmmintrin.h>
+#elif defined __SSE2__
+	#include <emmintrin.h>
+#endif
+
+#include "builtin.hpp"
+
+using namespace afc;
+
+namespace
+{
+	inline unsigned char octet(const char * const p) noexcept { return static_cast<unsigned char>(*p); }
+
+	inline bool inRange(const unsigned char c, const unsigned char min, const unsigned char max) noexcept
+	{
+		return c >= min && c <= max;
+	}
+
+	// Well-formed sequences as listed in Table 3-7 of the Unicode Standard.
+	const char *validateScalar(const char *i, const char * const end) noexcept
+	{
+		while (i != end) {
+			const unsigned char c = octet(i);
+			if (c < 0x80) {
+				++i;
+				continue;
+			}
+
+			std::size_t size;
+			unsigned char min = 0x80, max = 0xbf; // The range of the second octet.
+			if (inRange(c, 0xc2, 0xdf)) {
+				size = 2;
+			} else if (inRange(c, 0xe0, 0xef)) {
+				size = 3;
+				if (c == 0xe0) {
+					min = 0xa0;
+				} else if (c == 0xed) {
+					max = 0x9f;
+				}
+			} else if (inRange(c, 0xf0, 0xf4)) {
+				size = 4;
+				if (c == 0xf0) {
+					min = 0x90;
+				} else if (c == 0xf4) {
+					max = 0x8f;
+				}
+			} else {
+				return i;
+			}
+
+			if (std::size_t(end - i) < size || !inRange(octet(i + 1), min, max)) {
+				return i;
+			}
+			for (std::size_t j = 2; j < size; ++j) {
+				if (!utf8::isContinuation(i[j])) {
+					return i;
+				}
+			}
+			i += size;
+		}
+		return end;
+	}
+
+#ifdef __SSSE3__
+	/* The lookup algorithm by J. Keiser and D. Lemire ("Validating UTF-8 in less than one
+	 * instruction per byte"): each pair of adjacent octets is classified by three table
+	 * lookups (the high nibble of the first octet, its low nibble and the high nibble of the
+	 * second octet); the error bits of the three lookups intersect for ill-formed pairs only.
+	 * Third and fourth octets of sequences are checked separately.
+	 */
+	const std::uint8_t tooShort = 1 << 0; // A lead octet followed by a lead octet or ASCII.
+	const std::uint8_t tooLong = 1 << 1; // ASCII followed by a continuation octet.
+	const std::uint8_t overlong3 = 1 << 2;
+	const std::uint8_t tooLarge = 1 << 3;
+	const std::uint8_t surrogate = 1 << 4;
+	const std::uint8_t overlong2 = 1 << 5;
+	const std::uint8_t tooLarge1000 = 1 << 6;
+	const std::uint8_t overlong4 = 1 << 6;
+	const std::uint8_t twoContinuations = 1 << 7;
+	const std::uint8_t carry = tooShort | tooLong | twoContinuations;
+
+	inline __m128i lookup(const std::uint8_t a0, const std::uint8_t a1, const std::uint8_t a2, const std::uint8_t a3,
+			const std::uint8_t a4, const std::uint8_t a5, const std::uint8_t a6, const std::uint8_t a7,
+			const std::uint8_t a8, const std::uint8_t a9, const std::uint8_t a10, const std::uint8_t a11,
+			const std::uint8_t a12, const std::uint8_t a13, const std::uint8_t a14, const std::uint8_t a15) noexcept
+	{
+		return _mm_setr_epi8(char(a0), char(a1), char(a2), char(a3), char(a4), char(a5), char(a6), char(a7),
+				char(a8), char(a9), char(a10), char(a11), char(a12), char(a13), char(a14), char(a15));
+	}
+
+	inline __m128i highNibbles(const __m128i v) noexcept { return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f)); }
+
+	struct Validator
+	{
+		__m128i error = _mm_setzero_si128();
+		__m128i previous = _mm_setzero_si128();
+		// Non-zero if the previous block ends with an incomplete sequence.
+		__m128i previousIncomplete = _mm_setzero_si128();
+
+		void check(const __m128i input) noexcept
+		{
+			if (_mm_movemask_epi8(input) == 0) {
+				error = _mm_or_si128(error, previousIncomplete);
+				previousIncomplete = _mm_setzero_si128();
+				previous = input;
+				return;
+			}
+
+			const __m128i byte1High = lookup(
+					tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong,
+					twoContinuations, twoContinuations, twoContinuations, twoContinuations,
+					tooShort | overlong2,
+					tooShort,
+					tooShort | overlong3 | surrogate,
+					tooShort | tooLarge | tooLarge1000 | overlong4);
+			const __m128i byte1Low = lookup(
+					carry | overlong3 | overlong2 | overlong4,
+					carry | overlong2,
+					carry,
+					carry,
+					carry | tooLarge,
+					carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+					carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+					carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+					carry | tooLarge | tooLarge1000, carry | tooLarge | tooLarge1000,
+					carry | tooLarge | tooLarge1000 | surrogate,
+					carry | tooLarge | tooLarge1000,
+					carry | tooLarge | tooLarge1000);
+			const __m128i byte2High = lookup(
+					tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort,
+					tooLong | overlong2 | twoContinuations | overlong3 | tooLarge1000 | overlong4,
+					tooLong | overlong2 | twoContinuations | overlong3 | tooLarge,
+					tooLong | overlong2 | twoContinuations | surrogate | tooLarge,
+					tooLong | overlong2 | twoContinuations | surrogate | tooLarge,
+					tooShort, tooShort, tooShort, tooShort);
+
+			const __m128i previous1 = _mm_alignr_epi8(input, previous, 15);
+			const __m128i specialCases = _mm_and_si128(_mm_and_si128(
+					_mm_shuffle_epi8(byte1High, highNibbles(previous1)),
+					_mm_shuffle_epi8(byte1Low, _mm_and_si128(previous1, _mm_set1_epi8(0x0f)))),
+					_mm_shuffle_epi8(byte2High, highNibbles(input)));
+
+			// The high bit is set for octets that must be the third or fourth octets of sequences.
+			const __m128i previous2 = _mm_alignr_epi8(input, previous, 14);
+			const __m128i previous3 = _mm_alignr_epi8(input, previous, 13);
+			const __m128i mustBe23 = _mm_and_si128(_mm_or_si128(
+					_mm_subs_epu8(previous2, _mm_set1_epi8(char(0xe0 - 0x80))),
+					_mm_subs_epu8(previous3, _mm_set1_epi8(char(0xf0 - 0x80)))),
+					_mm_set1_epi8(char(0x80)));
+
+			error = _mm_or_si128(error, _mm_xor_si128(mustBe23, specialCases));
+			previousIncomplete = _mm_subs_epu8(input, _mm_setr_epi8(
+					char(0xff), char(0xff), char(0xff), char(0xff), char(0xff), char(0xff), char(0xff), char(0xff),
+					char(0xff), char(0xff), char(0xff), char(0xff), char(0xff),
+					char(0xf0 - 1), char(0xe0 - 1), char(0xc0 - 1)));
+			previous = input;
+		}
+
+		bool failed() const noexcept
+		{
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xffff;
+		}
+	};
+
+	/* The position the scalar validator restarts from once an error is detected within the
+	 * block that starts at blockBegin. All the octets before the block are well-formed, so
+	 * the restart position is the first lead octet among the last three octets before the block.
+	 */
+	inline const char *restartPosition(const char * const begin, const char * const blockBegin) noexcept
+	{
+		const char *p = std::size_t(blockBegin - begin) < utf8::maxCharSize - 1 ? begin : blockBegin - (utf8::maxCharSize - 1);
+		while (p != blockBegin && utf8::isContinuation(*p)) {
+			++p;
+		}
+		return p;
+	}
+#endif
+
+#ifdef __AVX2__
+	const std::size_t countBlockSize = 32;
+
+	// Bit i is set if the octet i is not a continuation octet.
+	inline std::uint32_t leadMask(const char * const p) noexcept
+	{
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+		return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(-65))));
+	}
+#elif defined __SSE2__
+	const std::size_t countBlockSize = 16;
+
+	inline std::uint32_t leadMask(const char * const p) noexcept
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8(-65))));
+	}
+#else
+	const std::size_t countBlockSize = 8;
+
+	inline std::uint32_t leadMask(const char * const p) noexcept
+	{
+		std::uint32_t mask = 0;
+		for (std::size_t i = 0; i < countBlockSize; ++i) {
+			mask |= std::uint32_t(!utf8::isContinuation(p[i])) << i;
+		}
+		return mask;
+	}
+#endif
+}
+
+const char *afc::utf8::validate(const char * const begin, const char * const end) noexcept
+{
+#ifdef __SSSE3__
+	Validator validator;
+	const char *i = begin;
+	for (; end - i >= 16; i += 16) {
+		validator.check(_mm_loadu_si128(reinterpret_cast<const __m128i *>(i)));
+		if (unlikely(validator.failed())) {
+			return validateScalar(restartPosition(begin, i), end);
+		}
+	}
+	/* The tail is padded with ASCII characters so that an incomplete sequence at the end
+	 * is reported as a sequence that is too short.
+	 */
+	char tail[16] = {};
+	std::memcpy(tail, i, end - i);
+	validator.check(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tail)));
+	return unlikely(validator.failed()) ? validateScalar(restartPosition(begin, i), end) : end;
+#else
+	return validateScalar(begin, end);
+#endif
+}
+
+std::size_t afc::utf8::countCodePoints(const char *begin, const char * const end) noexcept
+{
+	std::size_t count = 0;
+	for (; std::size_t(end - begin) >= countBlockSize; begin += countBlockSize) {
+		count += __builtin_popcount(leadMask(begin));
+	}
+	for (; begin != end; ++begin) {
+		count += !isContinuation(*begin);
+	}
+	return count;
+}
+
+const char *afc::utf8::advance(const char *begin, const char * const end, const std::size_t n) noexcept
+{
+	if (n == 0) {
+		return begin;
+	}
+	// The code point n starts at the lead octet that follows n lead octets.
+	std::size_t leadsLeft = n;
+	for (; std::size_t(end - begin) >= countBlockSize; begin += countBlockSize) {
+		std::uint32_t mask = leadMask(begin);
+		const std::size_t leads = static_cast<std::size_t>(__builtin_popcount(mask));
+		if (leads > leadsLeft) {
+			for (std::size_t i = 0; i < leadsLeft; ++i) {
+				mask &= mask - 1;
+			}
+			return begin + __builtin_ctz(mask);
+		}
+		leadsLeft -= leads;
+	}
+	for (; begin != end; ++begin) {
+		if (!isContinuation(*begin)) {
+			if (leadsLeft == 0) {
+				return begin;
+			}
+			--leadsLeft;
+		}
+	}
+	return end;
+}
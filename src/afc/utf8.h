@@ -0,0 +1,126 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_UTF8_H_
+#define AFC_UTF8_H_
+
+#include <cstddef>
+
+#include "FastStringBuffer.hpp"
+#include "StringRef.hpp"
+
+namespace afc
+{
+namespace utf8
+{
+	// The maximal number of octets a code point occupies.
+	const std::size_t maxCharSize = 4;
+	const char32_t maxCodePoint = 0x10ffff;
+
+	inline bool isContinuation(const char c) noexcept { return (static_cast<unsigned char>(c) & 0xc0) == 0x80; }
+
+	/* Returns the position of the first ill-formed sequence in [begin, end) or end if the
+	 * characters are well-formed UTF-8 (overlong forms, surrogates and code points beyond
+	 * U+10FFFF are rejected).
+	 *
+	 * Sixteen octets are checked at once if SSSE3 is available; runs of ASCII characters are skipped.
+	 */
+	const char *validate(const char *begin, const char *end) noexcept;
+
+	inline bool isValid(const char * const begin, const char * const end) noexcept { return validate(begin, end) == end; }
+	inline bool isValid(const ConstStringRef s) noexcept { return isValid(s.begin(), s.end()); }
+
+	/* The number of code points in well-formed UTF-8 characters (i.e. the number of octets
+	 * that are not continuation octets). Vectorised.
+	 */
+	std::size_t countCodePoints(const char *begin, const char *end) noexcept;
+	inline std::size_t countCodePoints(const ConstStringRef s) noexcept { return countCodePoints(s.begin(), s.end()); }
+
+	// Returns the position of the code point n or end if there are no more than n code points. Vectorised.
+	const char *advance(const char *begin, const char *end, std::size_t n) noexcept;
+
+	/* Returns the end of the longest prefix of [begin, end) that has at most maxBytes octets
+	 * and does not split a character.
+	 */
+	inline const char *truncateBytes(const char * const begin, const char * const end, const std::size_t maxBytes) noexcept
+	{
+		if (std::size_t(end - begin) <= maxBytes) {
+			return end;
+		}
+		const char *p = begin + maxBytes;
+		// Ill-formed input (longer runs of continuation octets) is cut where a well-formed character would end.
+		for (std::size_t i = 1; i < maxCharSize && p != begin && isContinuation(*p); ++i) {
+			--p;
+		}
+		return p;
+	}
+
+	inline ConstStringRef truncate(const ConstStringRef s, const std::size_t maxCodePoints) noexcept
+	{
+		return stringRef(s.begin(), advance(s.begin(), s.end(), maxCodePoints) - s.begin());
+	}
+
+	inline ConstStringRef truncateBytes(const ConstStringRef s, const std::size_t maxBytes) noexcept
+	{
+		return stringRef(s.begin(), truncateBytes(s.begin(), s.end(), maxBytes) - s.begin());
+	}
+
+	// At most count code points that start with the code point offset.
+	inline ConstStringRef slice(const ConstStringRef s, const std::size_t offset, const std::size_t count) noexcept
+	{
+		const char * const begin = advance(s.begin(), s.end(), offset);
+		return stringRef(begin, advance(begin, s.end(), count) - begin);
+	}
+
+	template<AllocMode allocMode>
+	inline void truncate(FastStringBuffer<char, allocMode> &buf, const std::size_t maxCodePoints) noexcept
+	{
+		const char * const begin = buf.data();
+		buf.resize(advance(begin, begin + buf.size(), maxCodePoints) - begin);
+	}
+
+	template<AllocMode allocMode>
+	inline void truncateBytes(FastStringBuffer<char, allocMode> &buf, const std::size_t maxBytes) noexcept
+	{
+		const char * const begin = buf.data();
+		buf.resize(truncateBytes(begin, begin + buf.size(), maxBytes) - begin);
+	}
+
+	/* Writes the UTF-8 form of the code point to dest and returns the position after it.
+	 * The code point must not exceed maxCodePoint.
+	 */
+	inline char *encode(const char32_t codePoint, char *dest) noexcept
+	{
+		if (codePoint < 0x80) {
+			*dest++ = static_cast<char>(codePoint);
+		} else if (codePoint < 0x800) {
+			*dest++ = static_cast<char>(0xc0 | (codePoint >> 6));
+			*dest++ = static_cast<char>(0x80 | (codePoint & 0x3f));
+		} else if (codePoint < 0x10000) {
+			*dest++ = static_cast<char>(0xe0 | (codePoint >> 12));
+			*dest++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+			*dest++ = static_cast<char>(0x80 | (codePoint & 0x3f));
+		} else {
+			*dest++ = static_cast<char>(0xf0 | (codePoint >> 18));
+			*dest++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+			*dest++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+			*dest++ = static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+		return dest;
+	}
+}
+}
+
+#endif /*AFC_UTF8_H_*/
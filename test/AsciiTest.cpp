@@ -0,0 +1,118 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "AsciiTest.hpp"
+#include <afc/ascii.hpp>
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::AsciiTest);
+
+using namespace afc::ascii;
+
+namespace
+{
+	// All octets in a sequence that does not repeat with period 16 or 32.
+	std::string allOctets()
+	{
+		std::string result;
+		for (unsigned i = 0; i < 3 * 256; ++i) {
+			result.push_back(static_cast<char>((i * 7 + i / 256) & 0xff));
+		}
+		return result;
+	}
+
+	template<unsigned classes>
+	void checkClassify(const std::string &s)
+	{
+		for (std::size_t i = 0; i + 32 <= s.size(); ++i) {
+			std::uint32_t expected = 0;
+			for (unsigned j = 0; j < 32; ++j) {
+				expected |= static_cast<std::uint32_t>(is<classes>(s[i + j])) << j;
+			}
+			CPPUNIT_ASSERT_EQUAL(expected & 0xffff, classify16<classes>(s.data() + i));
+			CPPUNIT_ASSERT_EQUAL(expected, classify32<classes>(s.data() + i));
+		}
+	}
+}
+
+void afc::AsciiTest::testClassTable()
+{
+	for (unsigned c = 0; c < 256; ++c) {
+		const bool ascii = c < 0x80;
+		CPPUNIT_ASSERT_EQUAL(ascii && std::isspace(c) != 0, is<space>(c));
+		CPPUNIT_ASSERT_EQUAL(ascii && std::isdigit(c) != 0, is<digit>(c));
+		CPPUNIT_ASSERT_EQUAL(ascii && std::isxdigit(c) != 0, is<hexDigit>(c));
+		CPPUNIT_ASSERT_EQUAL(ascii && std::isalpha(c) != 0, is<alpha>(c));
+		CPPUNIT_ASSERT_EQUAL(ascii && (std::isalnum(c) != 0 || c == '-' || c == '_' || c == '.'), is<urlUnreserved>(c));
+		CPPUNIT_ASSERT_EQUAL(c != 0 && std::strchr("{}[]:,", static_cast<int>(c)) != nullptr, is<jsonStructural>(c));
+		CPPUNIT_ASSERT_EQUAL(c < 0x20 || c == '"' || c == '\\', is<jsonEscaped>(c));
+	}
+	CPPUNIT_ASSERT(is<space | digit>(' '));
+	CPPUNIT_ASSERT(is<space | digit>('7'));
+	CPPUNIT_ASSERT(!is<space | digit>('a'));
+	CPPUNIT_ASSERT_EQUAL(unsigned(digit | hexDigit | urlUnreserved), classesOf('5'));
+}
+
+void afc::AsciiTest::testClassify()
+{
+	const std::string s = allOctets();
+	checkClassify<space>(s);
+	checkClassify<digit>(s);
+	checkClassify<hexDigit>(s);
+	checkClassify<alpha>(s);
+	checkClassify<urlUnreserved>(s);
+	checkClassify<jsonStructural>(s);
+	checkClassify<jsonEscaped>(s);
+	checkClassify<space | jsonStructural>(s);
+}
+
+void afc::AsciiTest::testFindFirstOf()
+{
+	const std::string s = std::string(100, 'a') + " b";
+	const char * const begin = s.data();
+	CPPUNIT_ASSERT_EQUAL(std::size_t(100), std::size_t(findFirstOf<jsonStructural | space>(begin, begin + s.size()) - begin));
+
+	const std::string json = std::string(70, 'x') + ",y";
+	CPPUNIT_ASSERT_EQUAL(std::size_t(70), std::size_t(findFirstOf<jsonStructural>(json.data(), json.data() + json.size()) - json.data()));
+	for (std::size_t n = 0; n < 40; ++n) {
+		const std::string t(n, 'x');
+		CPPUNIT_ASSERT(findFirstOf<digit>(t.data(), t.data() + n) == t.data() + n);
+	}
+}
+
+void afc::AsciiTest::testFindFirstNotOf()
+{
+	for (std::size_t n = 0; n < 100; ++n) {
+		const std::string s = std::string(n, ' ') + "\t\n\r\v\f" + "x ";
+		const char * const end = s.data() + s.size();
+		CPPUNIT_ASSERT_EQUAL(n + 5, std::size_t(findFirstNotOf<space>(s.data(), end) - s.data()));
+
+		const std::string onlySpaces(n, '\n');
+		CPPUNIT_ASSERT(findFirstNotOf<space>(onlySpaces.data(), onlySpaces.data() + n) == onlySpaces.data() + n);
+	}
+}
+
+void afc::AsciiTest::testFind()
+{
+	for (std::size_t n = 0; n < 50; ++n) {
+		const std::string s = std::string(n, 'a') + "\xff" + "b";
+		CPPUNIT_ASSERT_EQUAL(n, std::size_t(find(s.data(), s.data() + s.size(), '\xff') - s.data()));
+		CPPUNIT_ASSERT(find(s.data(), s.data() + n, 'b') == s.data() + n);
+	}
+}
@@ -0,0 +1,178 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "AsyncStreamTest.hpp"
+#include "TestUtil.hpp"
+#include <afc/async_stream.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::AsyncStreamTest);
+
+using afc::test::TempFile;
+
+namespace
+{
+	std::vector<unsigned char> testData(const std::size_t n)
+	{
+		std::vector<unsigned char> data(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			data[i] = static_cast<unsigned char>((i * 31) ^ (i >> 8));
+		}
+		return data;
+	}
+
+	void checkWriteRead(const afc::AsyncIOOptions &options)
+	{
+		TempFile file;
+		// Not a multiple of the block size to check the last partial block.
+		const std::vector<unsigned char> data = testData(10 * options.blockSize + 123);
+
+		{
+			afc::AsyncFileOutputStream out(file.path.c_str(), options);
+			out.write(data.data(), 7);
+			out.write(data.data() + 7, data.size() - 7);
+			out.close();
+		}
+
+		afc::AsyncFileInputStream in(file.path.c_str(), options);
+		std::vector<unsigned char> result(data.size() + 10);
+		std::size_t count = in.read(result.data(), 5);
+		CPPUNIT_ASSERT_EQUAL(std::size_t(5), count);
+		count += in.read(result.data() + 5, result.size() - 5);
+		CPPUNIT_ASSERT_EQUAL(data.size(), count);
+		result.resize(count);
+		CPPUNIT_ASSERT(data == result);
+
+		unsigned char c;
+		CPPUNIT_ASSERT_EQUAL(std::size_t(0), in.read(&c, 1));
+		in.close();
+	}
+}
+
+void afc::AsyncStreamTest::testWriteRead_IoUring()
+{
+	afc::AsyncIOOptions options;
+	options.queueDepth = 4;
+	options.blockSize = 4096;
+
+	checkWriteRead(options);
+
+	options.registerBuffers = false;
+	checkWriteRead(options);
+}
+
+void afc::AsyncStreamTest::testWriteRead_Sync()
+{
+	afc::AsyncIOOptions options;
+	options.queueDepth = 3;
+	options.blockSize = 1000;
+	options.useIoUring = false;
+
+	checkWriteRead(options);
+}
+
+void afc::AsyncStreamTest::testSkipAndReset()
+{
+	TempFile file;
+	const std::vector<unsigned char> data = testData(5000);
+	{
+		afc::AsyncFileOutputStream out(file.path.c_str());
+		out.write(data.data(), data.size());
+	}
+
+	afc::AsyncIOOptions options;
+	options.queueDepth = 2;
+	options.blockSize = 512;
+	afc::AsyncFileInputStream in(file.path.c_str(), options);
+
+	unsigned char c;
+	CPPUNIT_ASSERT_EQUAL(std::size_t(1), in.read(&c, 1));
+	CPPUNIT_ASSERT_EQUAL(data[0], c);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2000), in.skip(2000));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(1), in.read(&c, 1));
+	CPPUNIT_ASSERT_EQUAL(data[2001], c);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2998), in.skip(10000));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), in.read(&c, 1));
+
+	in.reset();
+	CPPUNIT_ASSERT_EQUAL(std::size_t(1), in.read(&c, 1));
+	CPPUNIT_ASSERT_EQUAL(data[0], c);
+}
+
+void afc::AsyncStreamTest::testCompletionHandlers()
+{
+	TempFile file;
+	const std::vector<unsigned char> data = testData(300);
+
+	{
+		afc::AsyncFile out(file.path.c_str(), afc::AsyncFile::writeOnly, 2);
+		long results[3] = {0, 0, 0};
+		out.write(0, data.data(), 100, [&results](const long result) { results[0] = result; });
+		out.write(100, data.data() + 100, 100, [&results](const long result) { results[1] = result; });
+		// The queue is full; this call waits for one of the requests above to complete.
+		out.write(200, data.data() + 200, 100, [&results](const long result) { results[2] = result; });
+		while (out.pending() > 0) {
+			out.poll(1);
+		}
+		CPPUNIT_ASSERT_EQUAL(100L, results[0]);
+		CPPUNIT_ASSERT_EQUAL(100L, results[1]);
+		CPPUNIT_ASSERT_EQUAL(100L, results[2]);
+		CPPUNIT_ASSERT_EQUAL(std::uint64_t(300), out.size());
+		out.close();
+	}
+
+	afc::AsyncFile in(file.path.c_str(), afc::AsyncFile::readOnly, 4, false);
+	CPPUNIT_ASSERT(!in.usesIoUring());
+	std::vector<unsigned char> buf(200);
+	long result = 0;
+	in.read(250, buf.data(), buf.size(), [&result](const long r) { result = r; });
+	// Handlers are invoked only by poll().
+	CPPUNIT_ASSERT_EQUAL(0L, result);
+	CPPUNIT_ASSERT_EQUAL(1u, in.poll());
+	CPPUNIT_ASSERT_EQUAL(50L, result);
+	CPPUNIT_ASSERT(std::equal(data.begin() + 250, data.end(), buf.begin()));
+}
+
+void afc::AsyncStreamTest::testShortRead()
+{
+	for (const bool useIoUring : {true, false}) {
+		TempFile file;
+		const std::vector<unsigned char> data = testData(5000);
+		std::FILE *f = std::fopen(file.path.c_str(), "wb");
+		std::fwrite(data.data(), 1, 100, f);
+		std::fclose(f);
+
+		afc::AsyncIOOptions options;
+		options.blockSize = 8192;
+		options.useIoUring = useIoUring;
+		afc::AsyncFileInputStream in(file.path.c_str(), options);
+		// The first block is read ahead by the constructor, which gets 100 octets only.
+		f = std::fopen(file.path.c_str(), "ab");
+		std::fwrite(data.data() + 100, 1, data.size() - 100, f);
+		std::fclose(f);
+
+		std::vector<unsigned char> result(data.size() + 10);
+		const std::size_t count = in.read(result.data(), result.size());
+
+		CPPUNIT_ASSERT_EQUAL(data.size(), count);
+		result.resize(count);
+		CPPUNIT_ASSERT(data == result);
+	}
+}
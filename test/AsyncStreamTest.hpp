@@ -0,0 +1,42 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_ASYNCSTREAMTEST_HPP_
+#define AFC_ASYNCSTREAMTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class AsyncStreamTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(AsyncStreamTest);
+		CPPUNIT_TEST(testWriteRead_IoUring);
+		CPPUNIT_TEST(testWriteRead_Sync);
+		CPPUNIT_TEST(testSkipAndReset);
+		CPPUNIT_TEST(testCompletionHandlers);
+		CPPUNIT_TEST(testShortRead);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testWriteRead_IoUring();
+		void testWriteRead_Sync();
+		void testSkipAndReset();
+		void testCompletionHandlers();
+		void testShortRead();
+	};
+}
+
+#endif /* AFC_ASYNCSTREAMTEST_HPP_ */
@@ -0,0 +1,173 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "CalendarTest.hpp"
+#include <afc/calendar.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::CalendarTest);
+
+using afc::Timestamp;
+using afc::TimestampTZ;
+using std::int32_t;
+using std::int64_t;
+using std::vector;
+
+namespace
+{
+	typedef void (*KeyFunction)(const Timestamp::time_type *, std::size_t, int32_t *, long);
+
+	vector<int32_t> keys(KeyFunction f, const vector<Timestamp::time_type> &millis, const long gmtOffset = 0)
+	{
+		vector<int32_t> result(millis.size());
+		f(millis.data(), millis.size(), result.data(), gmtOffset);
+		return result;
+	}
+
+	// The millis of the midnight of the date given.
+	Timestamp::time_type date(const int64_t year, const unsigned month, const unsigned day)
+	{
+		return afc::helper::daysFromCivil(year, month, day) * 86400000;
+	}
+
+	int32_t libcIsoWeekKey(const std::time_t t)
+	{
+		std::tm dateTime;
+		::gmtime_r(&t, &dateTime);
+		char buf[32];
+		std::strftime(buf, sizeof(buf), "%G%V", &dateTime);
+		return static_cast<int32_t>(std::atol(buf));
+	}
+
+	int32_t libcYearMonthKey(const std::time_t t)
+	{
+		std::tm dateTime;
+		::gmtime_r(&t, &dateTime);
+		return (dateTime.tm_year + 1900) * 100 + dateTime.tm_mon + 1;
+	}
+}
+
+void afc::CalendarTest::testEpochDayKeys()
+{
+	// The size is not a multiple of the vector width to cover the scalar tail.
+	const vector<Timestamp::time_type> millis{0, 1, 86399999, 86400000, -1, -86400000, -86400001,
+			date(2019, 3, 15) + 12345, date(1900, 1, 1), date(2400, 2, 29) + 86399999, -(int64_t(1) << 52)};
+	const vector<int32_t> expected{0, 0, 0, 1, -1, -1, -2,
+			17970, -25567, 157113, int32_t(afc::helper::floorDiv(-(int64_t(1) << 52), 86400000))};
+
+	CPPUNIT_ASSERT(keys(epochDayKeys, millis) == expected);
+}
+
+void afc::CalendarTest::testEpochHourKeys()
+{
+	const vector<Timestamp::time_type> millis{0, 3599999, 3600000, -1, -3600000, -3600001, date(2019, 3, 15) + 3600000 * 5 + 1};
+	const vector<int32_t> expected{0, 0, 1, -1, -1, -2, 17970 * 24 + 5};
+
+	CPPUNIT_ASSERT(keys(epochHourKeys, millis) == expected);
+}
+
+void afc::CalendarTest::testYearMonthKeys()
+{
+	const vector<Timestamp::time_type> millis{0, -1, date(2000, 2, 29), date(2000, 3, 1) - 1, date(2000, 3, 1),
+			date(2019, 12, 31), date(2020, 1, 1), date(1, 1, 1), date(0, 12, 31), date(-1, 3, 1), date(9999, 12, 31)};
+	const vector<int32_t> expected{197001, 196912, 200002, 200002, 200003,
+			201912, 202001, 101, 12, -100 + 3, 999912};
+
+	CPPUNIT_ASSERT(keys(yearMonthKeys, millis) == expected);
+}
+
+void afc::CalendarTest::testIsoWeekKeys_YearBoundaries()
+{
+	const vector<Timestamp::time_type> millis{
+			date(1970, 1, 1), // Thursday.
+			date(2004, 12, 31), date(2005, 1, 2), date(2005, 1, 3),
+			date(2008, 12, 28), date(2008, 12, 29), // Monday of 2009-W01.
+			date(2009, 12, 31), date(2010, 1, 3), date(2010, 1, 4),
+			date(2020, 12, 31), date(2021, 1, 1), date(2000, 2, 29), date(1600, 1, 1)};
+	const vector<int32_t> expected{197001,
+			200453, 200453, 200501,
+			200852, 200901,
+			200953, 200953, 201001,
+			202053, 202053, 200009, 159952};
+
+	CPPUNIT_ASSERT(keys(isoWeekKeys, millis) == expected);
+}
+
+void afc::CalendarTest::testGmtOffset()
+{
+	const vector<Timestamp::time_type> millis{date(2019, 12, 31) + 22 * 3600000, date(2020, 1, 1) + 3600000};
+
+	CPPUNIT_ASSERT(keys(epochDayKeys, millis, 3 * 3600) == (vector<int32_t>{18262, 18262}));
+	CPPUNIT_ASSERT(keys(epochDayKeys, millis, -2 * 3600) == (vector<int32_t>{18261, 18261}));
+	CPPUNIT_ASSERT(keys(epochHourKeys, millis, 5400) == (vector<int32_t>{18261 * 24 + 23, 18262 * 24 + 2}));
+	CPPUNIT_ASSERT(keys(yearMonthKeys, millis, 3 * 3600) == (vector<int32_t>{202001, 202001}));
+	CPPUNIT_ASSERT(keys(yearMonthKeys, millis, -2 * 3600) == (vector<int32_t>{201912, 201912}));
+	CPPUNIT_ASSERT(keys(isoWeekKeys, millis, -2 * 3600) == (vector<int32_t>{202001, 202001}));
+}
+
+void afc::CalendarTest::testTimestampTZ()
+{
+	const Timestamp::time_type millis[] = {date(2019, 12, 31) + 22 * 3600000, date(2020, 1, 1) + 3600000, -1};
+	const long offsets[] = {3 * 3600, -2 * 3600, 0};
+	vector<TimestampTZ> times(3);
+	for (std::size_t i = 0; i < times.size(); ++i) {
+		times[i].setMillis(millis[i]);
+		times[i].setGmtOffset(offsets[i]);
+	}
+	vector<int32_t> result(times.size());
+
+	epochDayKeys(times.data(), times.size(), result.data());
+	CPPUNIT_ASSERT(result == (vector<int32_t>{18262, 18261, -1}));
+	epochHourKeys(times.data(), times.size(), result.data());
+	CPPUNIT_ASSERT(result == (vector<int32_t>{18262 * 24 + 1, 18261 * 24 + 23, -1}));
+	yearMonthKeys(times.data(), times.size(), result.data());
+	CPPUNIT_ASSERT(result == (vector<int32_t>{202001, 201912, 196912}));
+	isoWeekKeys(times.data(), times.size(), result.data());
+	CPPUNIT_ASSERT(result == (vector<int32_t>{202001, 202001, 197001}));
+}
+
+void afc::CalendarTest::testRandomTimestampsMatchLibc()
+{
+	// Years from about 100 to 8000 (libc prints negative ISO years differently).
+	const int64_t range = int64_t(7900) * 365 * 86400;
+	std::srand(1);
+	vector<Timestamp::time_type> millis(5000);
+	for (Timestamp::time_type &t : millis) {
+		const int64_t r = (int64_t(std::rand()) << 31 | std::rand()) % range;
+		t = (r - int64_t(1870) * 365 * 86400) * 1000 + std::rand() % 1000;
+	}
+	// The vector loop is to be exited by the timestamps out of the range of exact double arithmetic.
+	millis[100] = int64_t(1) << 52;
+	millis[2500] = -(int64_t(1) << 52);
+	const vector<int32_t> days = keys(epochDayKeys, millis);
+	const vector<int32_t> hours = keys(epochHourKeys, millis);
+	const vector<int32_t> weeks = keys(isoWeekKeys, millis);
+	const vector<int32_t> months = keys(yearMonthKeys, millis);
+
+	for (std::size_t i = 0; i < millis.size(); ++i) {
+		CPPUNIT_ASSERT_EQUAL(afc::helper::floorDiv(millis[i], 86400000), int64_t(days[i]));
+		CPPUNIT_ASSERT_EQUAL(afc::helper::floorDiv(millis[i], 3600000), int64_t(hours[i]));
+		if (i == 100 || i == 2500) {
+			continue;
+		}
+		const std::time_t t = static_cast<std::time_t>(afc::helper::floorDiv(millis[i], 1000));
+		CPPUNIT_ASSERT_EQUAL(libcIsoWeekKey(t), weeks[i]);
+		CPPUNIT_ASSERT_EQUAL(libcYearMonthKey(t), months[i]);
+	}
+}
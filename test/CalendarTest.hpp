@@ -0,0 +1,46 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_CALENDARTEST_HPP_
+#define AFC_CALENDARTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class CalendarTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(CalendarTest);
+		CPPUNIT_TEST(testEpochDayKeys);
+		CPPUNIT_TEST(testEpochHourKeys);
+		CPPUNIT_TEST(testYearMonthKeys);
+		CPPUNIT_TEST(testIsoWeekKeys_YearBoundaries);
+		CPPUNIT_TEST(testGmtOffset);
+		CPPUNIT_TEST(testTimestampTZ);
+		CPPUNIT_TEST(testRandomTimestampsMatchLibc);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testEpochDayKeys();
+		void testEpochHourKeys();
+		void testYearMonthKeys();
+		void testIsoWeekKeys_YearBoundaries();
+		void testGmtOffset();
+		void testTimestampTZ();
+		void testRandomTimestampsMatchLibc();
+	};
+}
+
+#endif /* AFC_CALENDARTEST_HPP_ */
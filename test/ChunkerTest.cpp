@@ -0,0 +1,214 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "ChunkerTest.hpp"
+#include "TestUtil.hpp"
+#include <afc/chunker.h>
+#include <afc/crc.hpp>
+#include <afc/Exception.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::ChunkerTest);
+
+using afc::test::StringInputStream;
+using afc::test::randomOctets;
+using std::size_t;
+using std::string;
+using std::uint64_t;
+using std::vector;
+
+namespace
+{
+	struct ChunkInfo
+	{
+		uint64_t offset;
+		size_t size;
+		uint64_t crc;
+		string data;
+
+		bool operator==(const ChunkInfo &o) const
+		{
+			return offset == o.offset && size == o.size && crc == o.crc && data == o.data;
+		}
+	};
+
+	const unsigned char *octets(const string &s)
+	{
+		return reinterpret_cast<const unsigned char *>(s.data());
+	}
+
+	afc::ChunkHandler collector(vector<ChunkInfo> &chunks)
+	{
+		return [&chunks](const afc::Chunk &chunk)
+		{
+			chunks.push_back(ChunkInfo{chunk.offset, chunk.size, chunk.crc,
+					string(reinterpret_cast<const char *>(chunk.data), chunk.size)});
+		};
+	}
+
+	vector<ChunkInfo> split(const afc::ContentChunker &chunker, const string &data)
+	{
+		vector<ChunkInfo> chunks;
+		chunker.split(octets(data), data.size(), collector(chunks));
+		return chunks;
+	}
+
+	// Verifies that the chunks cover the data and have valid sizes and checksums.
+	void assertValid(const vector<ChunkInfo> &chunks, const string &data, const afc::ChunkerOptions &options)
+	{
+		uint64_t offset = 0;
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			const ChunkInfo &chunk = chunks[i];
+			CPPUNIT_ASSERT_EQUAL(offset, chunk.offset);
+			CPPUNIT_ASSERT(chunk.size <= options.maxSize);
+			CPPUNIT_ASSERT(chunk.size >= options.minSize || i == chunks.size() - 1);
+			CPPUNIT_ASSERT(chunk.size > 0);
+			CPPUNIT_ASSERT(data.compare(offset, chunk.size, chunk.data) == 0);
+			CPPUNIT_ASSERT_EQUAL(afc::crc64Reversed(octets(chunk.data), chunk.size), chunk.crc);
+			offset += chunk.size;
+		}
+		CPPUNIT_ASSERT_EQUAL(uint64_t(data.size()), offset);
+	}
+}
+
+void afc::ChunkerTest::testChunks()
+{
+	const string data = randomOctets(4 * 1024 * 1024, 1);
+	ChunkerOptions options;
+	const ContentChunker chunker(options);
+
+	const vector<ChunkInfo> chunks = split(chunker, data);
+
+	assertValid(chunks, data, options);
+	const double averageSize = double(data.size()) / chunks.size();
+	CPPUNIT_ASSERT(averageSize > options.averageSize * 0.75);
+	CPPUNIT_ASSERT(averageSize < options.averageSize * 1.5);
+	// The sizes are not all the same.
+	CPPUNIT_ASSERT(size_t(std::count_if(chunks.begin(), chunks.end(),
+			[&options](const ChunkInfo &c) { return c.size == options.maxSize; })) < chunks.size() / 10);
+}
+
+void afc::ChunkerTest::testEmptyAndShortInput()
+{
+	ChunkerOptions options;
+	const ContentChunker chunker(options);
+
+	CPPUNIT_ASSERT(split(chunker, string()).empty());
+
+	const string data = randomOctets(options.minSize, 2);
+	const vector<ChunkInfo> chunks = split(chunker, data);
+
+	CPPUNIT_ASSERT_EQUAL(size_t(1), chunks.size());
+	assertValid(chunks, data, options);
+
+	StringInputStream in{string()};
+	vector<ChunkInfo> streamChunks;
+	chunker.split(in, collector(streamChunks));
+
+	CPPUNIT_ASSERT(streamChunks.empty());
+}
+
+void afc::ChunkerTest::testStream()
+{
+	const string data = randomOctets(1024 * 1024 + 123, 3);
+	ChunkerOptions options;
+	options.minSize = 512;
+	options.averageSize = 4096;
+	options.maxSize = 16384;
+	const ContentChunker chunker(options);
+	const vector<ChunkInfo> expected = split(chunker, data);
+
+	for (const size_t readSize : {size_t(1000), size_t(65536), ~size_t(0)}) {
+		StringInputStream in(data, readSize);
+		vector<ChunkInfo> chunks;
+
+		chunker.split(in, collector(chunks));
+
+		CPPUNIT_ASSERT(chunks == expected);
+	}
+}
+
+void afc::ChunkerTest::testParallel()
+{
+	string data = randomOctets(6 * 1024 * 1024 + 7, 4);
+	// Runs of the same octet produce chunks of the maximal size.
+	std::fill_n(data.begin() + 3 * 1024 * 1024 - 100000, 200000, 'x');
+	ChunkerOptions options;
+	const ContentChunker chunker(options);
+	const vector<ChunkInfo> expected = split(chunker, data);
+
+	for (const unsigned threadCount : {1u, 2u, 3u, 5u}) {
+		vector<ChunkInfo> chunks;
+
+		chunker.splitParallel(octets(data), data.size(), collector(chunks), threadCount);
+
+		CPPUNIT_ASSERT(chunks == expected);
+	}
+}
+
+void afc::ChunkerTest::testShiftResistance()
+{
+	const string data = randomOctets(2 * 1024 * 1024, 5);
+	const string edited = data.substr(0, 100000) + "inserted text" + data.substr(100000, 900000) + data.substr(1000100);
+	const ContentChunker chunker;
+
+	const vector<ChunkInfo> original = split(chunker, data);
+	const vector<ChunkInfo> modified = split(chunker, edited);
+
+	std::set<uint64_t> originalCrcs;
+	for (const ChunkInfo &chunk : original) {
+		originalCrcs.insert(chunk.crc);
+	}
+	size_t common = 0;
+	for (const ChunkInfo &chunk : modified) {
+		common += originalCrcs.count(chunk.crc);
+	}
+	// Only the chunks around the insertion and the deletion differ.
+	CPPUNIT_ASSERT(common + 6 >= modified.size());
+}
+
+void afc::ChunkerTest::testUniformData()
+{
+	const string data(300000, '\0');
+	ChunkerOptions options;
+	const ContentChunker chunker(options);
+
+	const vector<ChunkInfo> chunks = split(chunker, data);
+
+	assertValid(chunks, data, options);
+	CPPUNIT_ASSERT_EQUAL(size_t(5), chunks.size());
+	CPPUNIT_ASSERT_EQUAL(options.maxSize, chunks[0].size);
+	CPPUNIT_ASSERT_EQUAL(data.size() - 4 * options.maxSize, chunks[4].size);
+}
+
+void afc::ChunkerTest::testInvalidOptions()
+{
+	ChunkerOptions options;
+	options.minSize = 32;
+	CPPUNIT_ASSERT_THROW(ContentChunker{options}, afc::Exception);
+
+	options = ChunkerOptions();
+	options.averageSize = options.maxSize + 1;
+	CPPUNIT_ASSERT_THROW(ContentChunker{options}, afc::Exception);
+
+	options = ChunkerOptions();
+	options.minSize = options.averageSize + 1;
+	CPPUNIT_ASSERT_THROW(ContentChunker{options}, afc::Exception);
+}
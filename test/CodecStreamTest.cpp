@@ -0,0 +1,223 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "CodecStreamTest.hpp"
+#include "TestUtil.hpp"
+#include <afc/codec_stream.h>
+
+#include <afc/base64.hpp>
+#include <afc/Exception.h>
+#include <afc/number.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::CodecStreamTest);
+
+using afc::test::StringInputStream;
+using afc::test::StringOutputStream;
+using afc::test::randomOctets;
+using std::size_t;
+using std::string;
+
+namespace
+{
+	string base64(const string &s)
+	{
+		string result;
+		afc::encodeBase64(s.begin(), s.size(), std::back_inserter(result));
+		return result;
+	}
+
+	string readAll(afc::InputStream &in, const size_t chunk = 7)
+	{
+		string result;
+		unsigned char buf[4096];
+		size_t n;
+		while ((n = in.read(buf, std::min(chunk, sizeof(buf)))) > 0) {
+			result.append(reinterpret_cast<const char *>(buf), n);
+		}
+		return result;
+	}
+
+	// Writes s in chunks of growing size.
+	void writeInChunks(afc::OutputStream &out, const string &s)
+	{
+		const unsigned char * const data = reinterpret_cast<const unsigned char *>(s.data());
+		for (size_t pos = 0, chunk = 1; pos < s.size(); pos += chunk, ++chunk) {
+			out.write(data + pos, std::min(chunk, s.size() - pos));
+		}
+	}
+
+	string decodeBase64(const string &encoded, const size_t maxChunk = ~size_t(0))
+	{
+		StringInputStream in(encoded, maxChunk);
+		afc::Base64DecodingInputStream decoder(in);
+		return readAll(decoder, 1000);
+	}
+
+	string decodeHex(const string &encoded, const size_t maxChunk = ~size_t(0))
+	{
+		StringInputStream in(encoded, maxChunk);
+		afc::HexDecodingInputStream decoder(in);
+		return readAll(decoder, 1000);
+	}
+}
+
+void afc::CodecStreamTest::testBase64Encoding()
+{
+	for (size_t n = 0; n < 200; ++n) {
+		const string data = randomOctets(n, static_cast<unsigned>(n));
+		StringOutputStream out;
+		{
+			Base64EncodingOutputStream encoder(out);
+			writeInChunks(encoder, data);
+			encoder.close();
+		}
+		CPPUNIT_ASSERT_EQUAL(base64(data), out.data);
+	}
+
+	StringOutputStream out;
+	{
+		Base64EncodingOutputStream encoder(out);
+		encoder.write(reinterpret_cast<const unsigned char *>("hello"), 5);
+		// The destructor finishes encoding.
+	}
+	CPPUNIT_ASSERT_EQUAL(string("aGVsbG8="), out.data);
+}
+
+void afc::CodecStreamTest::testBase64EncodingLargeInput()
+{
+	const string data = randomOctets(1000003, 1);
+	StringOutputStream out;
+	Base64EncodingOutputStream encoder(out);
+	encoder.write(reinterpret_cast<const unsigned char *>(data.data()), 100);
+	encoder.write(reinterpret_cast<const unsigned char *>(data.data()) + 100, data.size() - 100);
+	encoder.flush();
+	// Everything but the trailing incomplete triplet is flushed.
+	CPPUNIT_ASSERT_EQUAL(size_t(1000002 / 3 * 4), out.data.size());
+	encoder.close();
+
+	CPPUNIT_ASSERT_EQUAL(base64(data), out.data);
+	CPPUNIT_ASSERT(data == decodeBase64(out.data));
+}
+
+void afc::CodecStreamTest::testBase64LineWrapping()
+{
+	const string data = randomOctets(57 * 3, 2);
+	StringOutputStream out;
+	{
+		Base64EncodingOutputStream encoder(out, 76);
+		writeInChunks(encoder, data);
+	}
+	const string plain = base64(data);
+	CPPUNIT_ASSERT_EQUAL(plain.substr(0, 76) + "\r\n" + plain.substr(76, 76) + "\r\n" + plain.substr(152), out.data);
+	CPPUNIT_ASSERT(data == decodeBase64(out.data, 33));
+
+	StringOutputStream shortOut;
+	{
+		Base64EncodingOutputStream encoder(shortOut, 8);
+		encoder.write(reinterpret_cast<const unsigned char *>("hello world"), 11);
+	}
+	CPPUNIT_ASSERT_EQUAL(string("aGVsbG8g\r\nd29ybGQ="), shortOut.data);
+
+	StringOutputStream dummy;
+	CPPUNIT_ASSERT_THROW(Base64EncodingOutputStream(dummy, 75), afc::Exception);
+}
+
+void afc::CodecStreamTest::testBase64Decoding()
+{
+	CPPUNIT_ASSERT_EQUAL(string(""), decodeBase64(""));
+	CPPUNIT_ASSERT_EQUAL(string("hello"), decodeBase64("aGVsbG8="));
+	CPPUNIT_ASSERT_EQUAL(string("hello"), decodeBase64("aGVsbG8"));
+	CPPUNIT_ASSERT_EQUAL(string("hell"), decodeBase64("aGVsbA=="));
+	CPPUNIT_ASSERT_EQUAL(string("hell"), decodeBase64("aGVs\n bA==\r\n"));
+	CPPUNIT_ASSERT_EQUAL(string("hello world"), decodeBase64("aGVsbG8gd29ybGQ=", 1));
+
+	for (size_t n = 0; n < 100; ++n) {
+		const string data = randomOctets(n, static_cast<unsigned>(n + 7));
+		CPPUNIT_ASSERT(data == decodeBase64(base64(data), 5));
+	}
+}
+
+void afc::CodecStreamTest::testBase64DecodingMalformedInput()
+{
+	CPPUNIT_ASSERT_THROW(decodeBase64("aGV*"), afc::Exception);
+	CPPUNIT_ASSERT_THROW(decodeBase64("a"), afc::Exception);
+	CPPUNIT_ASSERT_THROW(decodeBase64("a==="), afc::Exception);
+	CPPUNIT_ASSERT_THROW(decodeBase64("aGVsbA==aGVs"), afc::Exception);
+	CPPUNIT_ASSERT_THROW(decodeBase64("aGVs\xc3\xa9"), afc::Exception);
+}
+
+void afc::CodecStreamTest::testBase64DecodingResetAndSkip()
+{
+	const string data = randomOctets(1000, 3);
+	StringInputStream in(base64(data));
+	Base64DecodingInputStream decoder(in);
+
+	CPPUNIT_ASSERT_EQUAL(size_t(10), decoder.skip(10));
+	unsigned char buf[5];
+	CPPUNIT_ASSERT_EQUAL(size_t(5), decoder.read(buf, 5));
+	CPPUNIT_ASSERT(data.substr(10, 5) == string(reinterpret_cast<const char *>(buf), 5));
+	CPPUNIT_ASSERT_EQUAL(size_t(985), decoder.skip(2000));
+	CPPUNIT_ASSERT_EQUAL(size_t(0), decoder.read(buf, 5));
+
+	decoder.reset();
+	CPPUNIT_ASSERT(data == readAll(decoder));
+}
+
+void afc::CodecStreamTest::testHexEncoding()
+{
+	for (size_t n = 0; n < 100; ++n) {
+		const string data = randomOctets(n, static_cast<unsigned>(n + 11));
+		StringOutputStream out;
+		{
+			HexEncodingOutputStream encoder(out);
+			writeInChunks(encoder, data);
+		}
+		string expected;
+		for (const char c : data) {
+			char digits[2];
+			afc::octetToHex(static_cast<unsigned char>(c), digits);
+			expected.append(digits, 2);
+		}
+		CPPUNIT_ASSERT_EQUAL(expected, out.data);
+	}
+
+	const string large = randomOctets(200001, 4);
+	StringOutputStream out;
+	HexEncodingOutputStream encoder(out);
+	encoder.write(reinterpret_cast<const unsigned char *>(large.data()), large.size());
+	encoder.close();
+	CPPUNIT_ASSERT_EQUAL(size_t(400002), out.data.size());
+	CPPUNIT_ASSERT(large == decodeHex(out.data));
+}
+
+void afc::CodecStreamTest::testHexDecoding()
+{
+	CPPUNIT_ASSERT_EQUAL(string(""), decodeHex(""));
+	CPPUNIT_ASSERT_EQUAL(string("\x01\xab\xcd\xef", 4), decodeHex("01abCDeF"));
+	CPPUNIT_ASSERT_EQUAL(string("\x01\xab\xcd\xef", 4), decodeHex("0 1ab\nCD eF\n", 3));
+	CPPUNIT_ASSERT_EQUAL(string("\x01\xab\xcd\xef", 4), decodeHex("01abCDeF", 1));
+}
+
+void afc::CodecStreamTest::testHexDecodingMalformedInput()
+{
+	CPPUNIT_ASSERT_THROW(decodeHex("0g"), afc::Exception);
+	CPPUNIT_ASSERT_THROW(decodeHex("abc"), afc::Exception);
+	CPPUNIT_ASSERT_THROW(decodeHex("ab c", 1), afc::Exception);
+}
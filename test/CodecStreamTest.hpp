@@ -0,0 +1,50 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_CODECSTREAMTEST_HPP_
+#define AFC_CODECSTREAMTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class CodecStreamTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(CodecStreamTest);
+		CPPUNIT_TEST(testBase64Encoding);
+		CPPUNIT_TEST(testBase64EncodingLargeInput);
+		CPPUNIT_TEST(testBase64LineWrapping);
+		CPPUNIT_TEST(testBase64Decoding);
+		CPPUNIT_TEST(testBase64DecodingMalformedInput);
+		CPPUNIT_TEST(testBase64DecodingResetAndSkip);
+		CPPUNIT_TEST(testHexEncoding);
+		CPPUNIT_TEST(testHexDecoding);
+		CPPUNIT_TEST(testHexDecodingMalformedInput);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testBase64Encoding();
+		void testBase64EncodingLargeInput();
+		void testBase64LineWrapping();
+		void testBase64Decoding();
+		void testBase64DecodingMalformedInput();
+		void testBase64DecodingResetAndSkip();
+		void testHexEncoding();
+		void testHexDecoding();
+		void testHexDecodingMalformedInput();
+	};
+}
+
+#endif /* AFC_CODECSTREAMTEST_HPP_ */
@@ -0,0 +1,185 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "ConcurrentRepositoryTest.hpp"
+#include <afc/ConcurrentRepository.h>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::ConcurrentRepositoryTest);
+
+using std::size_t;
+using std::string;
+using std::vector;
+
+namespace
+{
+	const unsigned threadCount = 4;
+
+	string key(const unsigned i)
+	{
+		return "key-" + std::to_string(i);
+	}
+}
+
+void afc::ConcurrentRepositoryTest::testStringRepository()
+{
+	EpochDomain domain;
+	ConcurrentRepository<string> rep(domain);
+
+	CPPUNIT_ASSERT_EQUAL(size_t(0), rep.size());
+	CPPUNIT_ASSERT(rep.empty());
+	CPPUNIT_ASSERT(rep.find("hello") == nullptr);
+
+	const string &i = rep.get("hello");
+	const string &j = rep.get("hello");
+	const string &k = rep.get("");
+	const string &l = rep.get("world");
+
+	CPPUNIT_ASSERT_EQUAL(size_t(3), rep.size());
+	CPPUNIT_ASSERT(!rep.empty());
+	CPPUNIT_ASSERT_EQUAL(string("hello"), i);
+	CPPUNIT_ASSERT(&i == &j);
+	CPPUNIT_ASSERT(rep.find("hello") == &i);
+	CPPUNIT_ASSERT_EQUAL(string(), k);
+	CPPUNIT_ASSERT(rep.find("") == &k);
+	CPPUNIT_ASSERT_EQUAL(string("world"), l);
+
+	CPPUNIT_ASSERT(!rep.remove("World"));
+	CPPUNIT_ASSERT_EQUAL(size_t(3), rep.size());
+	CPPUNIT_ASSERT(rep.remove("hello"));
+	CPPUNIT_ASSERT(rep.find("hello") == nullptr);
+	CPPUNIT_ASSERT_EQUAL(size_t(2), rep.size());
+	CPPUNIT_ASSERT(!rep.remove("hello"));
+	CPPUNIT_ASSERT(rep.remove(""));
+	CPPUNIT_ASSERT(rep.remove("world"));
+	CPPUNIT_ASSERT(rep.empty());
+}
+
+void afc::ConcurrentRepositoryTest::testGrowth()
+{
+	EpochDomain domain;
+	ConcurrentRepository<string> rep(domain);
+	vector<const string *> values;
+	for (unsigned i = 0; i < 1000; ++i) {
+		values.push_back(&rep.get(key(i)));
+	}
+
+	CPPUNIT_ASSERT_EQUAL(size_t(1000), rep.size());
+	// The values are not moved when the table grows.
+	for (unsigned i = 0; i < 1000; ++i) {
+		CPPUNIT_ASSERT(rep.find(key(i)) == values[i]);
+		CPPUNIT_ASSERT_EQUAL(key(i), *values[i]);
+	}
+}
+
+void afc::ConcurrentRepositoryTest::testClear()
+{
+	EpochDomain domain;
+	ConcurrentRepository<string> rep(domain);
+	for (unsigned i = 0; i < 100; ++i) {
+		rep.get(key(i));
+	}
+
+	rep.clear();
+	CPPUNIT_ASSERT(rep.empty());
+	CPPUNIT_ASSERT(rep.find(key(1)) == nullptr);
+	CPPUNIT_ASSERT_EQUAL(key(1), rep.get(key(1)));
+	CPPUNIT_ASSERT_EQUAL(size_t(1), rep.size());
+}
+
+void afc::ConcurrentRepositoryTest::testConcurrentGet()
+{
+	const unsigned keyCount = 2000;
+	EpochDomain domain;
+	ConcurrentRepository<string> rep(domain);
+	vector<vector<const string *>> values(threadCount, vector<const string *>(keyCount));
+	vector<std::thread> threads;
+	for (unsigned t = 0; t < threadCount; ++t) {
+		threads.emplace_back([&, t]()
+		{
+			// Each thread interns the keys in its own order.
+			static const unsigned steps[] = {1, 3, 7, 11};
+			for (unsigned i = 0; i < keyCount; ++i) {
+				const unsigned k = (i * steps[t % 4] + t) % keyCount;
+				values[t][k] = &rep.get(key(k));
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	CPPUNIT_ASSERT_EQUAL(size_t(keyCount), rep.size());
+	for (unsigned k = 0; k < keyCount; ++k) {
+		CPPUNIT_ASSERT_EQUAL(key(k), *values[0][k]);
+		for (unsigned t = 1; t < threadCount; ++t) {
+			CPPUNIT_ASSERT(values[t][k] == values[0][k]);
+		}
+	}
+}
+
+void afc::ConcurrentRepositoryTest::testConcurrentGetAndRemove()
+{
+	// The stable keys are never removed; the volatile ones are interned and removed repeatedly.
+	const unsigned stableKeyCount = 100;
+	const unsigned volatileKeyCount = 50;
+	const unsigned iterationCount = 20000;
+	EpochDomain domain;
+	ConcurrentRepository<string> rep(domain);
+	vector<const string *> stable;
+	for (unsigned i = 0; i < stableKeyCount; ++i) {
+		stable.push_back(&rep.get(key(i)));
+	}
+
+	std::atomic<bool> failed(false);
+	vector<std::thread> threads;
+	threads.emplace_back([&]()
+	{
+		for (unsigned i = 0; i < iterationCount; ++i) {
+			const string k = "volatile-" + std::to_string(i % volatileKeyCount);
+			if (i % 3 == 2) {
+				rep.remove(k);
+			} else if (rep.get(k) != k) {
+				failed = true;
+			}
+		}
+	});
+	for (unsigned t = 1; t < threadCount; ++t) {
+		threads.emplace_back([&, t]()
+		{
+			for (unsigned i = 0; i < iterationCount; ++i) {
+				const unsigned k = (i * 7 + t) % stableKeyCount;
+				if (&rep.get(key(k)) != stable[k] || rep.find(key(k)) != stable[k]) {
+					failed = true;
+				}
+				// The value found can be removed concurrently, so it is not dereferenced.
+				rep.find("volatile-" + std::to_string(i % volatileKeyCount));
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	CPPUNIT_ASSERT(!failed);
+	for (unsigned i = 0; i < stableKeyCount; ++i) {
+		CPPUNIT_ASSERT(rep.find(key(i)) == stable[i]);
+	}
+}
@@ -16,6 +16,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>. */
 #include "ConvertCharsetTest.hpp"
 #include <afc/utils.h>
 
+#include <afc/Exception.h>
 #include <afc/StringRef.hpp>
 #include <afc/SimpleString.hpp>
 #include <string>
@@ -45,3 +46,26 @@ void afc::ConvertCharsetTest::testConvertToUtf8(void)
 		CPPUNIT_ASSERT_EQUAL(std::string(u8"Najvialik\u0161aje baha\u0107cie"), std::string(result.begin(), result.end()));
 	}
 }
+
+void afc::ConvertCharsetTest::testConvertUtf8_IllFormedInput()
+{
+	{
+		const auto input = u8"Najvialik\u0161aje"_s;
+		afc::U8String result = afc::convertToUtf8(input.value(), input.size(), "UTF-8");
+		CPPUNIT_ASSERT_EQUAL(std::string(input.begin(), input.end()), std::string(result.begin(), result.end()));
+	}
+
+	const auto input = "Najvialik" "\xc5" "aje"_s;
+	try {
+		afc::convertToUtf8(input.value(), input.size(), "utf-8");
+		CPPUNIT_FAIL("Exception is expected.");
+	} catch (afc::Exception &ex) {
+		CPPUNIT_ASSERT_EQUAL(std::string("Invalid UTF-8 sequence at offset 9."), std::string(ex.what()));
+	}
+	try {
+		afc::convertFromUtf8(input.value(), input.size(), "CP1250");
+		CPPUNIT_FAIL("Exception is expected.");
+	} catch (afc::Exception &ex) {
+		CPPUNIT_ASSERT_EQUAL(std::string("Invalid UTF-8 sequence at offset 9."), std::string(ex.what()));
+	}
+}
@@ -25,9 +25,11 @@ namespace afc
 	{
 		CPPUNIT_TEST_SUITE(ConvertCharsetTest);
 		CPPUNIT_TEST(testConvertToUtf8);
+		CPPUNIT_TEST(testConvertUtf8_IllFormedInput);
 		CPPUNIT_TEST_SUITE_END();
 	public:
 		void testConvertToUtf8(void);
+		void testConvertUtf8_IllFormedInput();
 	};
 }
 
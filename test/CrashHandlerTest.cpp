@@ -0,0 +1,129 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "CrashHandlerTest.hpp"
+#include <afc/crash_handler.h>
+
+#include <csignal>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::CrashHandlerTest);
+
+namespace
+{
+	/* Runs the crashing function in a child process and returns what the crash handler writes.
+	 * The function beforeInstall is called with the output descriptor before the crash handler is installed.
+	 */
+	template<typename Crash>
+	std::string crashOutput(Crash crash, const int expectedSignal, void (*beforeInstall)(int fd) = nullptr)
+	{
+		int fds[2];
+		CPPUNIT_ASSERT_EQUAL(0, ::pipe(fds));
+
+		const pid_t pid = ::fork();
+		CPPUNIT_ASSERT(pid != -1);
+		if (pid == 0) {
+			::close(fds[0]);
+			if (beforeInstall != nullptr) {
+				beforeInstall(fds[1]);
+			}
+			afc::installCrashHandler(fds[1]);
+			crash();
+			::_exit(0);
+		}
+		::close(fds[1]);
+
+		std::string output;
+		char buf[4096];
+		ssize_t n;
+		while ((n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+			output.append(buf, n);
+		}
+		::close(fds[0]);
+
+		int status;
+		CPPUNIT_ASSERT_EQUAL(pid, ::waitpid(pid, &status, 0));
+		CPPUNIT_ASSERT(WIFSIGNALED(status));
+		CPPUNIT_ASSERT_EQUAL(expectedSignal, WTERMSIG(status));
+		return output;
+	}
+
+	void checkReport(const std::string &output, const char * const header)
+	{
+		CPPUNIT_ASSERT_EQUAL(std::size_t(0), output.find(header));
+		CPPUNIT_ASSERT(output.find("\n#0 0x") != std::string::npos);
+		CPPUNIT_ASSERT(output.find("\nmodule ") != std::string::npos);
+		CPPUNIT_ASSERT(output.find(" build-id ") != std::string::npos);
+	}
+
+	volatile int *volatile nullPointer = nullptr;
+
+	int previousHandlerFd = -1;
+	const char previousHandlerMessage[] = "previous handler\n";
+
+	// Another crash handler that terminates the process with the same signal.
+	void previousHandler(const int sig)
+	{
+		ssize_t written = ::write(previousHandlerFd, previousHandlerMessage, sizeof(previousHandlerMessage) - 1);
+		(void) written;
+		std::signal(sig, SIG_DFL);
+		std::raise(sig);
+	}
+
+	void installPreviousHandler(const int fd)
+	{
+		previousHandlerFd = fd;
+		std::signal(SIGSEGV, previousHandler);
+	}
+
+	unsigned recurse(const unsigned n)
+	{
+		if (n == ~0U) {
+			return 0;
+		}
+		volatile char frame[1024];
+		frame[0] = static_cast<char>(n);
+		return recurse(n + 1) + frame[0];
+	}
+}
+
+void afc::CrashHandlerTest::testSegmentationFault()
+{
+	const std::string output = crashOutput([]() { *nullPointer = 1; }, SIGSEGV);
+
+	checkReport(output, "*** fatal signal 11 (SIGSEGV), fault address 0x0\n");
+}
+
+void afc::CrashHandlerTest::testStackOverflow()
+{
+	// The handler runs on the alternate stack since the thread stack is exhausted.
+	const std::string output = crashOutput([]() { recurse(0); }, SIGSEGV);
+
+	checkReport(output, "*** fatal signal 11 (SIGSEGV), fault address 0x");
+}
+
+void afc::CrashHandlerTest::testPreviousHandlerChained()
+{
+	const std::string output = crashOutput([]() { *nullPointer = 1; }, SIGSEGV, installPreviousHandler);
+
+	checkReport(output, "*** fatal signal 11 (SIGSEGV), fault address 0x0\n");
+	// The previous handler runs once the report is written.
+	const std::size_t messageSize = sizeof(previousHandlerMessage) - 1;
+	CPPUNIT_ASSERT(output.size() > messageSize);
+	CPPUNIT_ASSERT_EQUAL(std::string(previousHandlerMessage), output.substr(output.size() - messageSize));
+	CPPUNIT_ASSERT_EQUAL(output.size() - messageSize, output.find(previousHandlerMessage));
+}
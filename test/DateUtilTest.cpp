@@ -422,3 +422,133 @@ void afc::DateUtilTest::test_TimestampTZ_CastToTm()
 	CPPUNIT_ASSERT_EQUAL(26, result.tm_sec);
 	CPPUNIT_ASSERT_EQUAL(-150L * 60, result.tm_gmtoff);
 }
+
+void afc::DateUtilTest::testFormatHttpDate()
+{
+	char buf[afc::httpDateSize()];
+
+	// 1994-11-06T08:49:37Z
+	CPPUNIT_ASSERT_EQUAL(buf + sizeof(buf), formatHttpDate(Timestamp(784111777000), buf));
+	CPPUNIT_ASSERT_EQUAL(string("Sun, 06 Nov 1994 08:49:37 GMT"), string(buf, sizeof(buf)));
+
+	// The same second is taken from the cache.
+	formatHttpDate(Timestamp(784111777999), buf);
+	CPPUNIT_ASSERT_EQUAL(string("Sun, 06 Nov 1994 08:49:37 GMT"), string(buf, sizeof(buf)));
+
+	formatHttpDate(Timestamp(784111778000), buf);
+	CPPUNIT_ASSERT_EQUAL(string("Sun, 06 Nov 1994 08:49:38 GMT"), string(buf, sizeof(buf)));
+
+	formatHttpDate(Timestamp(-1), buf);
+	CPPUNIT_ASSERT_EQUAL(string("Wed, 31 Dec 1969 23:59:59 GMT"), string(buf, sizeof(buf)));
+
+	formatHttpDate(Timestamp(951782400000), buf);
+	CPPUNIT_ASSERT_EQUAL(string("Tue, 29 Feb 2000 00:00:00 GMT"), string(buf, sizeof(buf)));
+
+	// Times outside the supported years are clamped.
+	formatHttpDate(Timestamp(253402300800000), buf);
+	CPPUNIT_ASSERT_EQUAL(string("Fri, 31 Dec 9999 23:59:59 GMT"), string(buf, sizeof(buf)));
+	formatHttpDate(Timestamp(-62167219201000), buf);
+	CPPUNIT_ASSERT_EQUAL(string("Sat, 01 Jan 0000 00:00:00 GMT"), string(buf, sizeof(buf)));
+}
+
+void afc::DateUtilTest::testParseHttpDate()
+{
+	const auto valid = "Sun, 06 Nov 1994 08:49:37 GMT"_s;
+	Timestamp dest;
+	CPPUNIT_ASSERT(parseHttpDate(valid.begin(), valid.end(), dest));
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(784111777000), dest.millis());
+
+	const afc::ConstStringRef invalid[] = {"Sun, 06 Nov 1994 08:49:37 UTC"_s, "Sun, 06 Nov 1994 08:49:37 GMT "_s,
+			"Sunday, 06-Nov-94 08:49:37 GMT"_s, "Sun Nov  6 08:49:37 1994"_s, "Sun, 31 Nov 1994 08:49:37 GMT"_s,
+			"Sun, 06 Nob 1994 08:49:37 GMT"_s, "Sun, 06 Nov 1994 24:49:37 GMT"_s, "Sun. 06 Nov 1994 08:49:37 GMT"_s,
+			// The day of the week does not match the date.
+			"Mon, 06 Nov 1994 08:49:37 GMT"_s};
+	for (const afc::ConstStringRef s : invalid) {
+		CPPUNIT_ASSERT(!parseHttpDate(s.begin(), s.end(), dest));
+	}
+}
+
+void afc::DateUtilTest::testFormatRFC3339DateTime()
+{
+	char buf[afc::maxRFC3339DateTimeSize()];
+	TimestampTZ time;
+
+	time.setMillis(1552653045123);
+	time.setGmtOffset(0);
+	char *end = formatRFC3339DateTime(time, buf);
+	CPPUNIT_ASSERT_EQUAL(string("2019-03-15T12:30:45.123Z"), string(buf, end));
+
+	time.setMillis(1552653045007);
+	end = formatRFC3339DateTime(time, buf);
+	CPPUNIT_ASSERT_EQUAL(string("2019-03-15T12:30:45.007Z"), string(buf, end));
+
+	time.setGmtOffset(3 * 3600);
+	end = formatRFC3339DateTime(time, buf);
+	CPPUNIT_ASSERT_EQUAL(buf + sizeof(buf), end);
+	CPPUNIT_ASSERT_EQUAL(string("2019-03-15T15:30:45.007+03:00"), string(buf, end));
+
+	time.setGmtOffset(-(9 * 3600 + 30 * 60));
+	end = formatRFC3339DateTime(time, buf);
+	CPPUNIT_ASSERT_EQUAL(string("2019-03-15T03:00:45.007-09:30"), string(buf, end));
+
+	time.setMillis(-1);
+	time.setGmtOffset(0);
+	end = formatRFC3339DateTime(time, buf);
+	CPPUNIT_ASSERT_EQUAL(string("1969-12-31T23:59:59.999Z"), string(buf, end));
+}
+
+void afc::DateUtilTest::testParseRFC3339DateTime()
+{
+	TimestampTZ dest;
+
+	const auto utc = "2019-03-15T12:30:45.123Z"_s;
+	CPPUNIT_ASSERT(parseRFC3339DateTime(utc.begin(), utc.end(), dest));
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(1552653045123), dest.millis());
+	CPPUNIT_ASSERT_EQUAL(0L, dest.getGmtOffset());
+
+	const auto withOffset = "2019-03-15t15:30:45+03:00"_s;
+	CPPUNIT_ASSERT(parseRFC3339DateTime(withOffset.begin(), withOffset.end(), dest));
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(1552653045000), dest.millis());
+	CPPUNIT_ASSERT_EQUAL(10800L, dest.getGmtOffset());
+
+	const auto longFraction = "2019-03-15 03:00:45.0079999-09:30"_s;
+	CPPUNIT_ASSERT(parseRFC3339DateTime(longFraction.begin(), longFraction.end(), dest));
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(1552653045007), dest.millis());
+	CPPUNIT_ASSERT_EQUAL(-34200L, dest.getGmtOffset());
+
+	const auto shortFraction = "2019-03-15T12:30:45.1z"_s;
+	CPPUNIT_ASSERT(parseRFC3339DateTime(shortFraction.begin(), shortFraction.end(), dest));
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(1552653045100), dest.millis());
+
+	const afc::ConstStringRef invalid[] = {"2019-03-15T12:30:45"_s, "2019-03-15T12:30:45.Z"_s, "2019-03-15T12:30:45.123"_s,
+			"2019-02-29T12:30:45Z"_s, "2019-03-15X12:30:45Z"_s, "2019-03-15T12:30:45+0300"_s, "2019-03-15T12:30:45+03:00 "_s,
+			"2019-13-15T12:30:45Z"_s, "2019-03-15T12:60:45Z"_s};
+	for (const afc::ConstStringRef s : invalid) {
+		CPPUNIT_ASSERT(!parseRFC3339DateTime(s.begin(), s.end(), dest));
+	}
+
+	// Round trip.
+	char buf[afc::maxRFC3339DateTimeSize()];
+	const char * const end = formatRFC3339DateTime(dest, buf);
+	TimestampTZ parsed;
+	CPPUNIT_ASSERT(parseRFC3339DateTime(buf, end, parsed));
+	CPPUNIT_ASSERT_EQUAL(dest.millis(), parsed.millis());
+}
+
+void afc::DateUtilTest::testCivilDateConversion()
+{
+	for (std::int64_t days = -800000; days < 800000; days += 13) {
+		std::int64_t year;
+		unsigned month, day;
+		afc::helper::civilFromDays(days, year, month, day);
+		CPPUNIT_ASSERT(day >= 1 && day <= afc::helper::monthLength(year, month));
+		CPPUNIT_ASSERT_EQUAL(days, afc::helper::daysFromCivil(year, month, day));
+
+		const time_t t = static_cast<time_t>(days * 86400);
+		tm expected;
+		gmtime_r(&t, &expected);
+		CPPUNIT_ASSERT_EQUAL(long(expected.tm_year) + 1900, long(year));
+		CPPUNIT_ASSERT_EQUAL(expected.tm_mon + 1, int(month));
+		CPPUNIT_ASSERT_EQUAL(expected.tm_wday, int(afc::helper::weekDay(days)));
+	}
+}
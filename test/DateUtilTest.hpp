@@ -49,6 +49,12 @@ namespace afc
 
 		CPPUNIT_TEST(test_TimestampTZ_AssignTimeT);
 		CPPUNIT_TEST(test_TimestampTZ_CastToTm);
+
+		CPPUNIT_TEST(testFormatHttpDate);
+		CPPUNIT_TEST(testParseHttpDate);
+		CPPUNIT_TEST(testFormatRFC3339DateTime);
+		CPPUNIT_TEST(testParseRFC3339DateTime);
+		CPPUNIT_TEST(testCivilDateConversion);
 		CPPUNIT_TEST_SUITE_END();
 
 		std::unique_ptr<std::string> m_timeZoneBackup;
@@ -78,6 +84,12 @@ namespace afc
 
 		void test_TimestampTZ_AssignTimeT();
 		void test_TimestampTZ_CastToTm();
+
+		void testFormatHttpDate();
+		void testParseHttpDate();
+		void testFormatRFC3339DateTime();
+		void testParseRFC3339DateTime();
+		void testCivilDateConversion();
 	};
 }
 
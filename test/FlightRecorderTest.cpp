@@ -0,0 +1,221 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "FlightRecorderTest.hpp"
+#include "TestUtil.hpp"
+#include <afc/crash_handler.h>
+#include <afc/flight_recorder.h>
+#include <afc/logger.hpp>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::FlightRecorderTest);
+
+using afc::test::TempFile;
+
+namespace
+{
+	std::vector<std::string> readRecords(const std::string &file)
+	{
+		std::vector<std::string> records;
+		afc::logger::readFlightRecords(file.c_str(),
+				[&records](const char * const record, const std::size_t n) { records.emplace_back(record, n); });
+		return records;
+	}
+
+	int previousHandlerFd = -1;
+
+	void previousHandler(int)
+	{
+		const char marker = 'p';
+		ssize_t result = ::write(previousHandlerFd, &marker, 1);
+		(void) result;
+	}
+
+	std::string line(const unsigned i)
+	{
+		return "line " + std::to_string(i) + '\n';
+	}
+}
+
+void afc::FlightRecorderTest::testRecords()
+{
+	TempFile file;
+	{
+		logger::FlightRecorder recorder(file.path.c_str(), 1);
+		for (unsigned i = 0; i < 10; ++i) {
+			logger::logToFile<false>(recorder.stream(), "line ", i);
+		}
+		recorder.append("raw", 3);
+	}
+
+	const std::vector<std::string> records = readRecords(file.path);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(11), records.size());
+	for (unsigned i = 0; i < 10; ++i) {
+		CPPUNIT_ASSERT_EQUAL(line(i), records[i]);
+	}
+	CPPUNIT_ASSERT_EQUAL(std::string("raw"), records[10]);
+}
+
+void afc::FlightRecorderTest::testRecords_Wrapped()
+{
+	TempFile file;
+	const unsigned count = 10000;
+	{
+		logger::FlightRecorder recorder(file.path.c_str(), 1);
+		for (unsigned i = 0; i < count; ++i) {
+			logger::logToFile<false>(recorder.stream(), "line ", i);
+		}
+	}
+
+	const std::vector<std::string> records = readRecords(file.path);
+	// Only the most recent records are kept, in order.
+	CPPUNIT_ASSERT(records.size() > 10);
+	CPPUNIT_ASSERT(records.size() < count);
+	for (std::size_t i = 0; i < records.size(); ++i) {
+		CPPUNIT_ASSERT_EQUAL(line(count - records.size() + i), records[i]);
+	}
+}
+
+void afc::FlightRecorderTest::testRecords_Reopened()
+{
+	TempFile file;
+	{
+		logger::FlightRecorder recorder(file.path.c_str(), 1);
+		logger::logToFile<false>(recorder.stream(), "line ", 0);
+	}
+	{
+		logger::FlightRecorder recorder(file.path.c_str(), 1);
+		logger::logToFile<false>(recorder.stream(), "line ", 1);
+	}
+
+	const std::vector<std::string> records = readRecords(file.path);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), records.size());
+	CPPUNIT_ASSERT_EQUAL(line(0), records[0]);
+	CPPUNIT_ASSERT_EQUAL(line(1), records[1]);
+}
+
+void afc::FlightRecorderTest::testCrash()
+{
+	TempFile file;
+
+	const pid_t pid = ::fork();
+	CPPUNIT_ASSERT(pid != -1);
+	if (pid == 0) {
+		logger::FlightRecorder recorder(file.path.c_str(), 1);
+		logger::installFlightRecorderCrashHook(recorder);
+		for (unsigned i = 0; i < 5; ++i) {
+			logger::logToFile<false>(recorder.stream(), "line ", i);
+		}
+		std::abort();
+	}
+
+	int status;
+	CPPUNIT_ASSERT_EQUAL(pid, ::waitpid(pid, &status, 0));
+	CPPUNIT_ASSERT(WIFSIGNALED(status));
+	CPPUNIT_ASSERT_EQUAL(SIGABRT, WTERMSIG(status));
+
+	const std::vector<std::string> records = readRecords(file.path);
+	CPPUNIT_ASSERT(records.size() >= 6);
+	for (unsigned i = 0; i < 5; ++i) {
+		CPPUNIT_ASSERT_EQUAL(line(i), records[i]);
+	}
+	CPPUNIT_ASSERT_EQUAL(std::string("fatal signal ") + std::to_string(SIGABRT) + '\n', records[5]);
+}
+
+void afc::FlightRecorderTest::testCrash_PreviousHandler()
+{
+	TempFile file;
+	int fds[2];
+	CPPUNIT_ASSERT_EQUAL(0, ::pipe(fds));
+
+	const pid_t pid = ::fork();
+	CPPUNIT_ASSERT(pid != -1);
+	if (pid == 0) {
+		::close(fds[0]);
+		previousHandlerFd = fds[1];
+		struct sigaction action = {};
+		action.sa_handler = previousHandler;
+		action.sa_flags = SA_RESETHAND;
+		::sigaction(SIGABRT, &action, nullptr);
+
+		logger::FlightRecorder recorder(file.path.c_str(), 1);
+		logger::installFlightRecorderCrashHook(recorder);
+		std::abort();
+	}
+	::close(fds[1]);
+
+	char buf[16];
+	const ssize_t n = ::read(fds[0], buf, sizeof(buf));
+	::close(fds[0]);
+
+	int status;
+	CPPUNIT_ASSERT_EQUAL(pid, ::waitpid(pid, &status, 0));
+	CPPUNIT_ASSERT(WIFSIGNALED(status));
+	CPPUNIT_ASSERT_EQUAL(SIGABRT, WTERMSIG(status));
+
+	// Both the hook and the handler installed before it have handled the signal.
+	CPPUNIT_ASSERT_EQUAL(ssize_t(1), n);
+	CPPUNIT_ASSERT_EQUAL('p', buf[0]);
+	const std::vector<std::string> records = readRecords(file.path);
+	CPPUNIT_ASSERT(!records.empty());
+	CPPUNIT_ASSERT_EQUAL(std::string("fatal signal ") + std::to_string(SIGABRT) + '\n', records[0]);
+}
+
+void afc::FlightRecorderTest::testCrash_CrashHandler()
+{
+	TempFile file;
+	int fds[2];
+	CPPUNIT_ASSERT_EQUAL(0, ::pipe(fds));
+
+	const pid_t pid = ::fork();
+	CPPUNIT_ASSERT(pid != -1);
+	if (pid == 0) {
+		::close(fds[0]);
+		logger::FlightRecorder recorder(file.path.c_str(), 1);
+		logger::installFlightRecorderCrashHook(recorder);
+		installCrashHandler(fds[1]);
+		std::abort();
+	}
+	::close(fds[1]);
+
+	std::string report;
+	char buf[4096];
+	ssize_t n;
+	while ((n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+		report.append(buf, n);
+	}
+	::close(fds[0]);
+
+	int status;
+	CPPUNIT_ASSERT_EQUAL(pid, ::waitpid(pid, &status, 0));
+	CPPUNIT_ASSERT(WIFSIGNALED(status));
+	CPPUNIT_ASSERT_EQUAL(SIGABRT, WTERMSIG(status));
+
+	// The hook and the crash handler share the signal handler, so both of them handle the signal once.
+	const std::string header = "*** fatal signal " + std::to_string(SIGABRT) + " (SIGABRT)";
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), report.find(header));
+	CPPUNIT_ASSERT_EQUAL(std::string::npos, report.find(header, 1));
+	const std::vector<std::string> records = readRecords(file.path);
+	CPPUNIT_ASSERT(!records.empty());
+	CPPUNIT_ASSERT_EQUAL(std::string("fatal signal ") + std::to_string(SIGABRT) + '\n', records[0]);
+	CPPUNIT_ASSERT(std::count(records.begin(), records.end(), records[0]) == 1);
+}
@@ -0,0 +1,247 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "InternTableTest.hpp"
+#include "TestUtil.hpp"
+#include <afc/Exception.h>
+#include <afc/crc.hpp>
+#include <afc/intern_table.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::InternTableTest);
+
+using afc::test::TempFile;
+using std::string;
+using std::uint32_t;
+
+namespace
+{
+	afc::ConstStringRef toRef(const string &s)
+	{
+		return afc::stringRef(s.data(), s.size());
+	}
+
+	string str(const afc::ConstStringRef s)
+	{
+		return string(s.value(), s.size());
+	}
+
+	// Overwrites a single octet of the file at the offset given.
+	void corrupt(const string &file, const long offset)
+	{
+		std::FILE * const f = std::fopen(file.c_str(), "r+b");
+		std::fseek(f, offset, SEEK_SET);
+		const int c = std::fgetc(f);
+		std::fseek(f, offset, SEEK_SET);
+		std::fputc(c ^ 0x5a, f);
+		std::fclose(f);
+	}
+
+	void writeTable(const string &file, const std::vector<string> &strings)
+	{
+		afc::InternTableBuilder builder;
+		for (const string &s : strings) {
+			builder.add(toRef(s));
+		}
+		builder.write(file.c_str());
+	}
+}
+
+void afc::InternTableTest::testRoundTrip()
+{
+	TempFile file;
+	const std::vector<string> strings{"hello", "world", "libafc", "a", "hello world"};
+	writeTable(file.path, strings);
+
+	InternTable table(file.path.c_str(), true);
+
+	CPPUNIT_ASSERT_EQUAL(strings.size(), table.size());
+	CPPUNIT_ASSERT(table.verify());
+	for (uint32_t id = 0; id < strings.size(); ++id) {
+		CPPUNIT_ASSERT_EQUAL(id, table.find(toRef(strings[id])));
+		CPPUNIT_ASSERT_EQUAL(strings[id], str(table[id]));
+		CPPUNIT_ASSERT_EQUAL('\0', table[id].value()[table[id].size()]);
+	}
+	CPPUNIT_ASSERT_EQUAL(InternTable::notFound, table.find("hell"_s));
+	CPPUNIT_ASSERT_EQUAL(InternTable::notFound, table.find("worlds"_s));
+	CPPUNIT_ASSERT_EQUAL(InternTable::notFound, table.find(""_s));
+	CPPUNIT_ASSERT(table.contains("libafc"_s));
+	CPPUNIT_ASSERT(!table.contains("LIBAFC"_s));
+}
+
+void afc::InternTableTest::testDuplicates()
+{
+	InternTableBuilder builder;
+
+	CPPUNIT_ASSERT_EQUAL(uint32_t(0), builder.add("x"_s));
+	CPPUNIT_ASSERT_EQUAL(uint32_t(1), builder.add(""_s));
+	CPPUNIT_ASSERT_EQUAL(uint32_t(0), builder.add("x"_s));
+	CPPUNIT_ASSERT_EQUAL(uint32_t(2), builder.add("xx"_s));
+	CPPUNIT_ASSERT_EQUAL(uint32_t(1), builder.add(""_s));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(3), builder.size());
+
+	TempFile file;
+	builder.write(file.path.c_str());
+	InternTable table(file.path.c_str());
+
+	CPPUNIT_ASSERT_EQUAL(std::size_t(3), table.size());
+	CPPUNIT_ASSERT_EQUAL(uint32_t(1), table.find(""_s));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), table[1].size());
+	CPPUNIT_ASSERT_EQUAL(string("xx"), str(table[2]));
+}
+
+void afc::InternTableTest::testEmptyTable()
+{
+	TempFile file;
+	InternTableBuilder().write(file.path.c_str());
+
+	InternTable table(file.path.c_str(), true);
+
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), table.size());
+	CPPUNIT_ASSERT_EQUAL(InternTable::notFound, table.find(""_s));
+	CPPUNIT_ASSERT_EQUAL(InternTable::notFound, table.find("abc"_s));
+}
+
+void afc::InternTableTest::testManyStrings()
+{
+	const uint32_t count = 100000;
+	TempFile file;
+	{
+		InternTableBuilder builder;
+		for (uint32_t i = 0; i < count; ++i) {
+			CPPUNIT_ASSERT_EQUAL(i, builder.add(toRef("identifier_" + std::to_string(i))));
+		}
+		builder.write(file.path.c_str());
+	}
+
+	InternTable table(file.path.c_str(), true);
+
+	CPPUNIT_ASSERT_EQUAL(std::size_t(count), table.size());
+	for (uint32_t i = 0; i < count; ++i) {
+		const string s = "identifier_" + std::to_string(i);
+		CPPUNIT_ASSERT_EQUAL(i, table.find(toRef(s)));
+		CPPUNIT_ASSERT_EQUAL(s, str(table[i]));
+		CPPUNIT_ASSERT_EQUAL(InternTable::notFound, table.find(toRef("identifier-" + std::to_string(i))));
+	}
+}
+
+void afc::InternTableTest::testRewriteWhileOpen()
+{
+	TempFile file;
+	writeTable(file.path, {"alpha", "beta"});
+	InternTable oldTable(file.path.c_str());
+
+	writeTable(file.path, {"gamma", "delta", "epsilon"});
+	InternTable newTable(file.path.c_str(), true);
+
+	// The file is replaced, so the table open keeps the old data.
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), oldTable.size());
+	CPPUNIT_ASSERT(oldTable.verify());
+	CPPUNIT_ASSERT_EQUAL(string("beta"), str(oldTable[1]));
+	CPPUNIT_ASSERT_EQUAL(InternTable::notFound, oldTable.find("gamma"_s));
+
+	CPPUNIT_ASSERT_EQUAL(std::size_t(3), newTable.size());
+	CPPUNIT_ASSERT_EQUAL(uint32_t(0), newTable.find("gamma"_s));
+	CPPUNIT_ASSERT_EQUAL(InternTable::notFound, newTable.find("alpha"_s));
+}
+
+void afc::InternTableTest::testCorruptHeader()
+{
+	TempFile file;
+	writeTable(file.path, {"a", "b", "c"});
+
+	// The number of strings.
+	corrupt(file.path, 16);
+
+	CPPUNIT_ASSERT_THROW(InternTable(file.path.c_str()), afc::Exception);
+
+	// The magic.
+	writeTable(file.path, {"a", "b", "c"});
+	corrupt(file.path, 0);
+
+	CPPUNIT_ASSERT_THROW(InternTable(file.path.c_str()), afc::Exception);
+}
+
+void afc::InternTableTest::testWrappingHeapSize()
+{
+	TempFile file;
+	writeTable(file.path, {"a", "b", "c"});
+
+	// One more entry is claimed, and the heap size is reduced by the entry size so that the sum wraps around.
+	unsigned char header[64];
+	std::FILE * const f = std::fopen(file.path.c_str(), "r+b");
+	CPPUNIT_ASSERT_EQUAL(sizeof(header), std::fread(header, 1, sizeof(header), f));
+	std::uint64_t count, heapSize;
+	std::memcpy(&count, header + 16, 8);
+	std::memcpy(&heapSize, header + 32, 8);
+	CPPUNIT_ASSERT(heapSize < 16);
+	count += 1;
+	heapSize -= 16;
+	std::memcpy(header + 16, &count, 8);
+	std::memcpy(header + 32, &heapSize, 8);
+	const std::uint64_t checksum = afc::crc64Reversed(header, 48);
+	std::memcpy(header + 48, &checksum, 8);
+	std::fseek(f, 0, SEEK_SET);
+	std::fwrite(header, 1, sizeof(header), f);
+	std::fclose(f);
+
+	CPPUNIT_ASSERT_THROW(InternTable(file.path.c_str()), afc::Exception);
+}
+
+void afc::InternTableTest::testTruncatedFile()
+{
+	TempFile file;
+	writeTable(file.path, {"alpha", "beta", "gamma"});
+
+	CPPUNIT_ASSERT_EQUAL(0, ::truncate(file.path.c_str(), 100));
+
+	CPPUNIT_ASSERT_THROW(InternTable(file.path.c_str()), afc::Exception);
+
+	CPPUNIT_ASSERT_EQUAL(0, ::truncate(file.path.c_str(), 10));
+
+	CPPUNIT_ASSERT_THROW(InternTable(file.path.c_str()), afc::Exception);
+}
+
+void afc::InternTableTest::testCorruptData()
+{
+	TempFile file;
+	writeTable(file.path, {"alpha", "beta", "gamma"});
+	// The last octet of the heap is the terminator of "gamma".
+	std::FILE * const f = std::fopen(file.path.c_str(), "rb");
+	std::fseek(f, 0, SEEK_END);
+	const long size = std::ftell(f);
+	std::fclose(f);
+	corrupt(file.path, size - 2);
+
+	// The data is not verified by default.
+	InternTable table(file.path.c_str());
+
+	CPPUNIT_ASSERT(!table.verify());
+	CPPUNIT_ASSERT_EQUAL(uint32_t(0), table.find("alpha"_s));
+
+	CPPUNIT_ASSERT_THROW(InternTable(file.path.c_str(), true), afc::Exception);
+}
+
+void afc::InternTableTest::testMissingFile()
+{
+	CPPUNIT_ASSERT_THROW(InternTable("/nonexistent/libafc_intern_table"), afc::Exception);
+}
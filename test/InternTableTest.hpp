@@ -0,0 +1,52 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_INTERNTABLETEST_HPP_
+#define AFC_INTERNTABLETEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class InternTableTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(InternTableTest);
+		CPPUNIT_TEST(testRoundTrip);
+		CPPUNIT_TEST(testDuplicates);
+		CPPUNIT_TEST(testEmptyTable);
+		CPPUNIT_TEST(testManyStrings);
+		CPPUNIT_TEST(testRewriteWhileOpen);
+		CPPUNIT_TEST(testCorruptHeader);
+		CPPUNIT_TEST(testWrappingHeapSize);
+		CPPUNIT_TEST(testTruncatedFile);
+		CPPUNIT_TEST(testCorruptData);
+		CPPUNIT_TEST(testMissingFile);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testRoundTrip();
+		void testDuplicates();
+		void testEmptyTable();
+		void testManyStrings();
+		void testRewriteWhileOpen();
+		void testCorruptHeader();
+		void testWrappingHeapSize();
+		void testTruncatedFile();
+		void testCorruptData();
+		void testMissingFile();
+	};
+}
+
+#endif /* AFC_INTERNTABLETEST_HPP_ */
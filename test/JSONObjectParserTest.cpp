@@ -371,3 +371,34 @@ void afc::JSONObjectParserTest::testObjectWithBooleanProperty_False()
 	CPPUNIT_ASSERT_EQUAL(input.end(), result);
 	CPPUNIT_ASSERT(errorHandler.valid());
 }
+
+void afc::JSONObjectParserTest::testCharsWithUnicodeEscapes()
+{
+	afc::ConstStringRef input = u8"a\\u0041\\u00e9\\u20AC\\ud83d\\ude00\\u0000z\""_s;
+	string result;
+	ErrorHandler errorHandler;
+
+	const char * const i = afc::json::parseCharsToUTF8(input.begin(), input.end(),
+			[&](const char c) { result.push_back(c); }, errorHandler);
+
+	CPPUNIT_ASSERT(errorHandler.valid());
+	CPPUNIT_ASSERT_EQUAL(input.end() - 1, i);
+	CPPUNIT_ASSERT_EQUAL(string(u8"aA\u00e9\u20ac\U0001f600") + '\0' + 'z', result);
+}
+
+void afc::JSONObjectParserTest::testCharsWithMalformedUnicodeEscapes()
+{
+	const afc::ConstStringRef malformed[] = {u8"\\u00g0\""_s, u8"\\ude00\""_s, u8"\\ud83dx\""_s, u8"\\ud83d\\u0041\""_s};
+	for (const afc::ConstStringRef input : malformed) {
+		ErrorHandler errorHandler;
+		afc::json::parseCharsToUTF8(input.begin(), input.end(), [](const char) {}, errorHandler);
+		CPPUNIT_ASSERT(!errorHandler.valid());
+	}
+
+	const afc::ConstStringRef truncated[] = {u8"\\u00"_s, u8"\\ud83d"_s, u8"\\ud83d\\"_s, u8"\\ud83d\\ude0"_s};
+	for (const afc::ConstStringRef input : truncated) {
+		ErrorHandler errorHandler;
+		afc::json::parseCharsToUTF8(input.begin(), input.end(), [](const char) {}, errorHandler);
+		CPPUNIT_ASSERT(!errorHandler.valid());
+	}
+}
@@ -31,6 +31,8 @@ namespace afc
 		CPPUNIT_TEST(testObjectWithIntProperty);
 		CPPUNIT_TEST(testObjectWithBooleanProperty_True);
 		CPPUNIT_TEST(testObjectWithBooleanProperty_False);
+		CPPUNIT_TEST(testCharsWithUnicodeEscapes);
+		CPPUNIT_TEST(testCharsWithMalformedUnicodeEscapes);
 		CPPUNIT_TEST_SUITE_END();
 	public:
 		void testEmptyObject();
@@ -40,6 +42,8 @@ namespace afc
 		void testObjectWithIntProperty();
 		void testObjectWithBooleanProperty_True();
 		void testObjectWithBooleanProperty_False();
+		void testCharsWithUnicodeEscapes();
+		void testCharsWithMalformedUnicodeEscapes();
 	};
 }
 
@@ -0,0 +1,183 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "LogRateLimitTest.hpp"
+#include <afc/log_rate_limit.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <thread>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::LogRateLimitTest);
+
+namespace
+{
+	struct MemoryLog
+	{
+		MemoryLog() : data(nullptr), size(0) { file = ::open_memstream(&data, &size); }
+		~MemoryLog() { std::free(data); }
+
+		std::string text() { std::fclose(file); file = nullptr; return std::string(data, size); }
+
+		std::FILE *file;
+		char *data;
+		std::size_t size;
+	};
+
+	unsigned evaluations = 0;
+
+	int evaluated(const int i)
+	{
+		++evaluations;
+		return i;
+	}
+
+	unsigned countLines(const std::string &text, const std::string &prefix)
+	{
+		unsigned count = 0;
+		for (std::size_t pos = 0; (pos = text.find(prefix, pos)) != std::string::npos; pos += prefix.size()) {
+			++count;
+		}
+		return count;
+	}
+}
+
+void afc::LogRateLimitTest::testRateLimited()
+{
+	MemoryLog log;
+	evaluations = 0;
+	for (int i = 0; i < 100; ++i) {
+		AFC_LOG_RATE_LIMITED(log.file, 0.01, 3, "failure ", evaluated(i));
+	}
+	logger::logSuppressedCounts(log.file);
+	logger::logSuppressedCounts(log.file);
+
+	// The arguments of the lines suppressed are not evaluated.
+	CPPUNIT_ASSERT_EQUAL(3u, evaluations);
+	CPPUNIT_ASSERT_EQUAL(std::string("failure 0\nfailure 1\nfailure 2\nsuppressed 97 similar messages at " __FILE__ ":"),
+			log.text().substr(0, 64 + sizeof(__FILE__)));
+}
+
+void afc::LogRateLimitTest::testRateLimited_NonPositiveRate()
+{
+	MemoryLog log;
+	for (int i = 0; i < 10; ++i) {
+		AFC_LOG_RATE_LIMITED(log.file, 0, 3, "failure ", i);
+		AFC_LOG_RATE_LIMITED(log.file, -1, 3, "failure ", i);
+	}
+	logger::logSuppressedCounts(log.file);
+
+	const std::string text = log.text();
+	CPPUNIT_ASSERT_EQUAL(0u, countLines(text, "failure"));
+	CPPUNIT_ASSERT_EQUAL(2u, countLines(text, "suppressed 10 similar messages"));
+}
+
+void afc::LogRateLimitTest::testEveryN()
+{
+	MemoryLog log;
+	for (int i = 0; i < 25; ++i) {
+		AFC_LOG_EVERY_N(log.file, 10, "event ", i);
+	}
+	logger::logSuppressedCounts(log.file);
+
+	const std::string text = log.text();
+	CPPUNIT_ASSERT_EQUAL(0u, countLines(text, "event 1\n"));
+	const std::size_t first = text.find("event 0\n");
+	const std::size_t suppressed = text.find("suppressed 9 similar messages at ");
+	const std::size_t second = text.find("event 10\n");
+	const std::size_t third = text.find("event 20\n");
+	const std::size_t last = text.find("suppressed 4 similar messages at ");
+	CPPUNIT_ASSERT(first < suppressed && suppressed < second && second < third && third < last);
+	CPPUNIT_ASSERT(last != std::string::npos);
+}
+
+void afc::LogRateLimitTest::testSampled()
+{
+	MemoryLog log;
+	for (int i = 0; i < 1000; ++i) {
+		AFC_LOG_SAMPLED(log.file, 0.0, "never ", i);
+		AFC_LOG_SAMPLED(log.file, 1.0, "always ", i);
+		AFC_LOG_SAMPLED(log.file, 0.5, "half ", i);
+	}
+
+	const std::string text = log.text();
+	CPPUNIT_ASSERT_EQUAL(0u, countLines(text, "never "));
+	CPPUNIT_ASSERT_EQUAL(1000u, countLines(text, "always "));
+	const unsigned half = countLines(text, "half ");
+	CPPUNIT_ASSERT(half > 350 && half < 650);
+}
+
+void afc::LogRateLimitTest::testSampled_NonPositiveProbability()
+{
+	MemoryLog log;
+	for (int i = 0; i < 10; ++i) {
+		AFC_LOG_SAMPLED(log.file, 0.0, "sampled ", i);
+		AFC_LOG_SAMPLED(log.file, -0.5, "sampled ", i);
+		AFC_LOG_SAMPLED(log.file, std::numeric_limits<double>::quiet_NaN(), "sampled ", i);
+	}
+	logger::logSuppressedCounts(log.file);
+
+	const std::string text = log.text();
+	CPPUNIT_ASSERT_EQUAL(0u, countLines(text, "sampled "));
+	CPPUNIT_ASSERT_EQUAL(3u, countLines(text, "suppressed 10 similar messages"));
+}
+
+void afc::LogRateLimitTest::testDestinationEvaluatedOnce()
+{
+	MemoryLog log;
+	unsigned destEvaluations = 0;
+	const auto dest = [&]() { ++destEvaluations; return log.file; };
+	for (int i = 0; i < 3; ++i) {
+		AFC_LOG_EVERY_N(dest(), 2, "event ", i);
+	}
+
+	// The first call logs the line; the third one reports the suppressed line before logging its own one.
+	CPPUNIT_ASSERT_EQUAL(2u, destEvaluations);
+	CPPUNIT_ASSERT_EQUAL(1u, countLines(log.text(), "suppressed 1 similar messages"));
+}
+
+void afc::LogRateLimitTest::testSuppressedCountsReporter()
+{
+	{
+		// The counts left by other sites are reported by the reporter as well.
+		MemoryLog other;
+		logger::logSuppressedCounts(other.file);
+		other.text();
+	}
+	MemoryLog log;
+	{
+		logger::SuppressedCountsReporter reporter(log.file, std::chrono::milliseconds(10));
+		for (int i = 0; i < 5; ++i) {
+			AFC_LOG_EVERY_N(log.file, 100, "event ", i);
+		}
+		// The counts are reported without calling the site again.
+		bool reported = false;
+		for (int i = 0; i < 500 && !reported; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			::flockfile(log.file);
+			std::fflush(log.file);
+			reported = countLines(std::string(log.data, log.size), "suppressed") != 0;
+			::funlockfile(log.file);
+		}
+		CPPUNIT_ASSERT(reported);
+	}
+
+	const std::string text = log.text();
+	CPPUNIT_ASSERT_EQUAL(1u, countLines(text, "event "));
+	CPPUNIT_ASSERT_EQUAL(1u, countLines(text, "suppressed 4 similar messages"));
+}
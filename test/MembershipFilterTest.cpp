@@ -0,0 +1,258 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "MembershipFilterTest.hpp"
+#include "TestUtil.hpp"
+#include <afc/Exception.h>
+#include <afc/membership_filter.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::MembershipFilterTest);
+
+using afc::test::StringInputStream;
+using afc::test::StringOutputStream;
+using std::size_t;
+using std::string;
+using std::uint64_t;
+using std::vector;
+
+namespace
+{
+	// Hashes of the integers [from, from + n).
+	vector<uint64_t> hashes(const uint64_t from, const size_t n)
+	{
+		vector<uint64_t> result(n);
+		for (size_t i = 0; i < n; ++i) {
+			result[i] = afc::mixHash(from + i);
+		}
+		return result;
+	}
+
+	template<typename Filter>
+	double falsePositiveRate(const Filter &filter, const size_t n)
+	{
+		const vector<uint64_t> absent = hashes(uint64_t(1) << 40, n);
+		size_t positives = 0;
+		for (const uint64_t h : absent) {
+			positives += filter.contains(h);
+		}
+		return double(positives) / n;
+	}
+
+	afc::ConstStringRef toRef(const string &s)
+	{
+		return afc::stringRef(s.data(), s.size());
+	}
+}
+
+void afc::MembershipFilterTest::testFilterHash()
+{
+	const string s = "the quick brown fox jumps over the lazy dog";
+
+	// The hash is a part of the serialised form of filters built from strings.
+	CPPUNIT_ASSERT_EQUAL(filterHash(toRef(s)), filterHash(toRef(string(s))));
+	CPPUNIT_ASSERT(filterHash(""_s) != filterHash(toRef(string(1, '\0'))));
+	CPPUNIT_ASSERT(filterHash("a"_s) != filterHash("b"_s));
+	// All the positions of the tail matter.
+	for (size_t n = 1; n <= s.size(); ++n) {
+		string t = s.substr(0, n);
+		const uint64_t h = filterHash(toRef(t));
+		t[n - 1] ^= 1;
+		CPPUNIT_ASSERT(h != filterHash(toRef(t)));
+		CPPUNIT_ASSERT(h != filterHash(toRef(s.substr(0, n - 1))));
+	}
+}
+
+void afc::MembershipFilterTest::testBloomFilter()
+{
+	const size_t n = 100000;
+	const vector<uint64_t> present = hashes(0, n);
+	BlockedBloomFilter filter(n, 12);
+
+	CPPUNIT_ASSERT_EQUAL(size_t(0), size_t(falsePositiveRate(filter, 1000) * 1000));
+
+	for (const uint64_t h : present) {
+		filter.add(h);
+	}
+
+	for (const uint64_t h : present) {
+		CPPUNIT_ASSERT(filter.contains(h));
+	}
+	const double rate = falsePositiveRate(filter, n);
+	CPPUNIT_ASSERT(rate > 0.001);
+	CPPUNIT_ASSERT(rate < 0.01);
+
+	filter.clear();
+
+	CPPUNIT_ASSERT(!filter.contains(present[0]));
+}
+
+void afc::MembershipFilterTest::testBloomFilter_Batch()
+{
+	const vector<uint64_t> present = hashes(0, 5000);
+	BlockedBloomFilter filter(present.size(), 8);
+	for (const uint64_t h : present) {
+		filter.add(h);
+	}
+	vector<uint64_t> probes = hashes(3000, 5003);
+	std::unique_ptr<bool[]> results(new bool[probes.size()]);
+
+	filter.contains(probes.data(), probes.size(), results.get());
+
+	for (size_t i = 0; i < probes.size(); ++i) {
+		CPPUNIT_ASSERT_EQUAL(filter.contains(probes[i]), results[i]);
+	}
+	CPPUNIT_ASSERT(std::all_of(results.get(), results.get() + 2000, [](const bool x) { return x; }));
+}
+
+void afc::MembershipFilterTest::testBloomFilter_Serialisation()
+{
+	const vector<uint64_t> present = hashes(0, 10000);
+	BlockedBloomFilter filter(present.size());
+	for (const uint64_t h : present) {
+		filter.add(h);
+	}
+	StringOutputStream out;
+
+	filter.write(out);
+	StringInputStream in(out.data, 1000);
+	const BlockedBloomFilter copy = BlockedBloomFilter::read(in);
+
+	CPPUNIT_ASSERT_EQUAL(filter.sizeInBytes(), copy.sizeInBytes());
+	for (const uint64_t h : hashes(0, 20000)) {
+		CPPUNIT_ASSERT_EQUAL(filter.contains(h), copy.contains(h));
+	}
+}
+
+void afc::MembershipFilterTest::testBinaryFuseFilter()
+{
+	const size_t n = 100000;
+	vector<uint64_t> present = hashes(0, n);
+	// Duplicates are ignored.
+	present.insert(present.end(), present.begin(), present.begin() + 100);
+
+	const BinaryFuseFilter filter(present.data(), present.size());
+
+	CPPUNIT_ASSERT_EQUAL(n, filter.size());
+	CPPUNIT_ASSERT(filter.sizeInBytes() < n * 10 / 8);
+	for (const uint64_t h : present) {
+		CPPUNIT_ASSERT(filter.contains(h));
+	}
+	const double rate = falsePositiveRate(filter, n);
+	CPPUNIT_ASSERT(rate > 0.002);
+	CPPUNIT_ASSERT(rate < 0.006);
+
+	std::unique_ptr<bool[]> results(new bool[present.size()]);
+	filter.contains(present.data(), present.size(), results.get());
+
+	CPPUNIT_ASSERT(std::all_of(results.get(), results.get() + present.size(), [](const bool x) { return x; }));
+}
+
+void afc::MembershipFilterTest::testBinaryFuseFilter_SmallSets()
+{
+	const BinaryFuseFilter empty(nullptr, 0);
+
+	CPPUNIT_ASSERT_EQUAL(size_t(0), empty.size());
+	CPPUNIT_ASSERT_EQUAL(0.0, falsePositiveRate(empty, 1000));
+
+	for (size_t n = 1; n <= 100; ++n) {
+		const vector<uint64_t> present = hashes(n * 1000, n);
+		const BinaryFuseFilter filter(present.data(), present.size());
+		for (const uint64_t h : present) {
+			CPPUNIT_ASSERT(filter.contains(h));
+		}
+	}
+}
+
+void afc::MembershipFilterTest::testBinaryFuseFilter_Serialisation()
+{
+	const vector<uint64_t> present = hashes(0, 10000);
+	const BinaryFuseFilter filter(present.data(), present.size());
+	StringOutputStream out;
+
+	filter.write(out);
+	StringInputStream in(out.data, 777);
+	const BinaryFuseFilter copy = BinaryFuseFilter::read(in);
+
+	CPPUNIT_ASSERT_EQUAL(filter.size(), copy.size());
+	for (const uint64_t h : hashes(0, 20000)) {
+		CPPUNIT_ASSERT_EQUAL(filter.contains(h), copy.contains(h));
+	}
+}
+
+void afc::MembershipFilterTest::testCorruptData()
+{
+	const vector<uint64_t> present = hashes(0, 1000);
+	StringOutputStream bloom;
+	BlockedBloomFilter(1000).write(bloom);
+	StringOutputStream fuse;
+	BinaryFuseFilter(present.data(), present.size()).write(fuse);
+
+	// The type of the filter.
+	StringInputStream wrongType(fuse.data);
+	CPPUNIT_ASSERT_THROW(BlockedBloomFilter::read(wrongType), afc::Exception);
+	// The header.
+	string header = bloom.data;
+	header[20] ^= 1;
+	StringInputStream corruptHeader(header);
+	CPPUNIT_ASSERT_THROW(BlockedBloomFilter::read(corruptHeader), afc::Exception);
+	// The data.
+	string data = fuse.data;
+	data[data.size() - 1] ^= 1;
+	StringInputStream corruptData(data);
+	CPPUNIT_ASSERT_THROW(BinaryFuseFilter::read(corruptData), afc::Exception);
+	// Truncated data.
+	StringInputStream truncated(fuse.data.substr(0, fuse.data.size() - 1));
+	CPPUNIT_ASSERT_THROW(BinaryFuseFilter::read(truncated), afc::Exception);
+}
+
+void afc::MembershipFilterTest::testPrefilteredRepository()
+{
+	PrefilteredRepository<string> repository(4);
+
+	CPPUNIT_ASSERT(repository.find("a") == nullptr);
+
+	// The filter grows several times.
+	vector<const string *> values;
+	for (int i = 0; i < 100; ++i) {
+		values.push_back(&repository.get(std::to_string(i)));
+	}
+
+	CPPUNIT_ASSERT_EQUAL(size_t(100), repository.size());
+	for (int i = 0; i < 100; ++i) {
+		const string s = std::to_string(i);
+		CPPUNIT_ASSERT(&repository.get(s) == values[i]);
+		CPPUNIT_ASSERT(repository.find(s) == values[i]);
+		CPPUNIT_ASSERT_EQUAL(s, *values[i]);
+	}
+	CPPUNIT_ASSERT(repository.find("100") == nullptr);
+	CPPUNIT_ASSERT_EQUAL(size_t(100), repository.size());
+
+	CPPUNIT_ASSERT(repository.remove("7"));
+	CPPUNIT_ASSERT(!repository.remove("7"));
+
+	CPPUNIT_ASSERT(repository.find("7") == nullptr);
+	CPPUNIT_ASSERT_EQUAL(size_t(99), repository.size());
+
+	repository.clear();
+
+	CPPUNIT_ASSERT(repository.empty());
+	CPPUNIT_ASSERT(repository.find("1") == nullptr);
+}
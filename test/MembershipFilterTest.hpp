@@ -0,0 +1,50 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_MEMBERSHIPFILTERTEST_HPP_
+#define AFC_MEMBERSHIPFILTERTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class MembershipFilterTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(MembershipFilterTest);
+		CPPUNIT_TEST(testFilterHash);
+		CPPUNIT_TEST(testBloomFilter);
+		CPPUNIT_TEST(testBloomFilter_Batch);
+		CPPUNIT_TEST(testBloomFilter_Serialisation);
+		CPPUNIT_TEST(testBinaryFuseFilter);
+		CPPUNIT_TEST(testBinaryFuseFilter_SmallSets);
+		CPPUNIT_TEST(testBinaryFuseFilter_Serialisation);
+		CPPUNIT_TEST(testCorruptData);
+		CPPUNIT_TEST(testPrefilteredRepository);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testFilterHash();
+		void testBloomFilter();
+		void testBloomFilter_Batch();
+		void testBloomFilter_Serialisation();
+		void testBinaryFuseFilter();
+		void testBinaryFuseFilter_SmallSets();
+		void testBinaryFuseFilter_Serialisation();
+		void testCorruptData();
+		void testPrefilteredRepository();
+	};
+}
+
+#endif /* AFC_MEMBERSHIPFILTERTEST_HPP_ */
@@ -0,0 +1,187 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "MultiHashTest.hpp"
+#include <afc/multi_hash.h>
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// OpenSSL API.
+#include <openssl/evp.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::MultiHashTest);
+
+using afc::HashInput;
+using afc::md5DigestSize;
+using afc::sha256DigestSize;
+using std::size_t;
+using std::string;
+using std::vector;
+
+namespace
+{
+	// Covers messages that end within the first and the second padding block, and the 55/56/64 boundaries.
+	const size_t maxMessageSize = 300;
+
+	vector<unsigned char> message(const size_t size, const unsigned seed)
+	{
+		vector<unsigned char> result(size);
+		unsigned x = seed * 2654435761u + 1;
+		for (size_t i = 0; i < size; ++i) {
+			x = x * 1103515245 + 12345;
+			result[i] = static_cast<unsigned char>(x >> 16);
+		}
+		return result;
+	}
+
+	string toHex(const unsigned char * const digest, const size_t n)
+	{
+		string result;
+		for (size_t i = 0; i < n; ++i) {
+			afc::octetToHex(digest[i], std::back_inserter(result));
+		}
+		return result;
+	}
+
+	string digestHex(const vector<unsigned char> &data, const ::EVP_MD * const type)
+	{
+		unsigned char digest[EVP_MAX_MD_SIZE];
+		unsigned size;
+		::EVP_Digest(data.data(), data.size(), digest, &size, type, nullptr);
+		return toHex(digest, size);
+	}
+
+	string md5Hex(const vector<unsigned char> &data) { return digestHex(data, ::EVP_md5()); }
+
+	string sha256Hex(const vector<unsigned char> &data) { return digestHex(data, ::EVP_sha256()); }
+
+	/* Each group of lanes gets messages of different sizes so that lanes finish at different
+	 * blocks; each size is hashed in each lane position in turn.
+	 */
+	template<size_t lanes, size_t digestSize, typename Hash, typename Reference>
+	void checkLanes(Hash hash, Reference reference)
+	{
+		for (size_t size = 0; size <= maxMessageSize; ++size) {
+			vector<vector<unsigned char>> messages;
+			HashInput inputs[lanes];
+			for (size_t l = 0; l < lanes; ++l) {
+				messages.push_back(message((size + 37 * l) % (maxMessageSize + 1), unsigned(size + l)));
+			}
+			for (size_t l = 0; l < lanes; ++l) {
+				inputs[l] = HashInput{messages[l].data(), messages[l].size()};
+			}
+			unsigned char digests[lanes][digestSize];
+			hash(inputs, digests);
+			for (size_t l = 0; l < lanes; ++l) {
+				CPPUNIT_ASSERT_EQUAL(reference(messages[l]), toHex(digests[l], digestSize));
+			}
+		}
+	}
+
+	vector<vector<unsigned char>> mixedMessages(const size_t count)
+	{
+		vector<vector<unsigned char>> result;
+		for (size_t i = 0; i < count; ++i) {
+			result.push_back(message((i * 7919) % (maxMessageSize + 1), unsigned(i)));
+		}
+		return result;
+	}
+
+	vector<HashInput> inputsOf(const vector<vector<unsigned char>> &messages)
+	{
+		vector<HashInput> result;
+		for (const vector<unsigned char> &m : messages) {
+			result.push_back(HashInput{m.data(), m.size()});
+		}
+		return result;
+	}
+}
+
+void afc::MultiHashTest::testMd5Lanes()
+{
+	checkLanes<4, md5DigestSize>(md5x4, md5Hex);
+	checkLanes<8, md5DigestSize>(md5x8, md5Hex);
+	checkLanes<16, md5DigestSize>(md5x16, md5Hex);
+}
+
+void afc::MultiHashTest::testSha256Lanes()
+{
+	checkLanes<4, sha256DigestSize>(sha256x4, sha256Hex);
+	checkLanes<8, sha256DigestSize>(sha256x8, sha256Hex);
+	checkLanes<16, sha256DigestSize>(sha256x16, sha256Hex);
+}
+
+void afc::MultiHashTest::testMd5Batch()
+{
+	// Not a multiple of any lane count.
+	const vector<vector<unsigned char>> messages = mixedMessages(103);
+	const vector<HashInput> inputs = inputsOf(messages);
+	vector<unsigned char> digests(messages.size() * md5DigestSize);
+
+	md5Batch(inputs.data(), inputs.size(), reinterpret_cast<unsigned char (*)[md5DigestSize]>(digests.data()));
+
+	for (size_t i = 0; i < messages.size(); ++i) {
+		CPPUNIT_ASSERT_EQUAL(md5Hex(messages[i]), toHex(digests.data() + i * md5DigestSize, md5DigestSize));
+	}
+}
+
+void afc::MultiHashTest::testSha256Batch()
+{
+	const vector<vector<unsigned char>> messages = mixedMessages(103);
+	const vector<HashInput> inputs = inputsOf(messages);
+	vector<unsigned char> digests(messages.size() * sha256DigestSize);
+
+	sha256Batch(inputs.data(), inputs.size(), reinterpret_cast<unsigned char (*)[sha256DigestSize]>(digests.data()));
+
+	for (size_t i = 0; i < messages.size(); ++i) {
+		CPPUNIT_ASSERT_EQUAL(sha256Hex(messages[i]), toHex(digests.data() + i * sha256DigestSize, sha256DigestSize));
+	}
+}
+
+void afc::MultiHashTest::testHexBatch()
+{
+	// More than a single chunk of the hex batch.
+	const vector<vector<unsigned char>> messages = mixedMessages(600);
+	const vector<HashInput> inputs = inputsOf(messages);
+
+	string md5Result;
+	md5HexBatch(inputs.data(), inputs.size(), std::back_inserter(md5Result));
+	string sha256Result;
+	sha256HexBatch(inputs.data(), inputs.size(), std::back_inserter(sha256Result));
+
+	string md5Expected;
+	string sha256Expected;
+	for (const vector<unsigned char> &m : messages) {
+		md5Expected += md5Hex(m);
+		sha256Expected += sha256Hex(m);
+	}
+	CPPUNIT_ASSERT_EQUAL(md5Expected, md5Result);
+	CPPUNIT_ASSERT_EQUAL(sha256Expected, sha256Result);
+	CPPUNIT_ASSERT_EQUAL(string("d41d8cd98f00b204e9800998ecf8427e"), md5Expected.substr(0, 32));
+}
+
+void afc::MultiHashTest::testEmptyBatch()
+{
+	string result;
+	md5HexBatch(nullptr, 0, std::back_inserter(result));
+	sha256HexBatch(nullptr, 0, std::back_inserter(result));
+
+	CPPUNIT_ASSERT(result.empty());
+	CPPUNIT_ASSERT(multiBufferLanes() == 4 || multiBufferLanes() == 8 || multiBufferLanes() == 16);
+}
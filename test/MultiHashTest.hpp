@@ -0,0 +1,44 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_MULTIHASHTEST_HPP_
+#define AFC_MULTIHASHTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class MultiHashTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(MultiHashTest);
+		CPPUNIT_TEST(testMd5Lanes);
+		CPPUNIT_TEST(testSha256Lanes);
+		CPPUNIT_TEST(testMd5Batch);
+		CPPUNIT_TEST(testSha256Batch);
+		CPPUNIT_TEST(testHexBatch);
+		CPPUNIT_TEST(testEmptyBatch);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testMd5Lanes();
+		void testSha256Lanes();
+		void testMd5Batch();
+		void testSha256Batch();
+		void testHexBatch();
+		void testEmptyBatch();
+	};
+}
+
+#endif /* AFC_MULTIHASHTEST_HPP_ */
@@ -0,0 +1,148 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "ProfilerTest.hpp"
+#include <afc/profiler.h>
+
+#include <atomic>
+#include <csignal>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <thread>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::ProfilerTest);
+
+namespace
+{
+	double cpuSeconds()
+	{
+		timespec t;
+		::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+		return t.tv_sec + t.tv_nsec / 1e9;
+	}
+
+	// Consumes the given amount of CPU time of the calling thread.
+	unsigned long spin(const double seconds)
+	{
+		volatile unsigned long x = 1;
+		const double end = cpuSeconds() + seconds;
+		while (cpuSeconds() < end) {
+			for (int i = 0; i < 10000; ++i) {
+				x = x * 6364136223846793005UL + 1442695040888963407UL;
+			}
+		}
+		return x;
+	}
+
+	std::atomic<unsigned> previousHandlerCalls(0);
+
+	void previousHandler(int)
+	{
+		previousHandlerCalls.fetch_add(1);
+	}
+}
+
+void afc::ProfilerTest::testFoldedStacks()
+{
+	ProfilerOptions options;
+	options.frequency = 1000;
+	Profiler profiler(options);
+	profiler.registerThread();
+
+	spin(0.3);
+
+	CPPUNIT_ASSERT(profiler.sampleCount() > 10);
+
+	std::ostringstream out;
+	profiler.writeFoldedStacks(out);
+	const std::string folded = out.str();
+	CPPUNIT_ASSERT(!folded.empty());
+
+	std::istringstream lines(folded);
+	std::string line;
+	unsigned long total = 0;
+	while (std::getline(lines, line)) {
+		const std::size_t space = line.rfind(' ');
+		CPPUNIT_ASSERT(space != std::string::npos && space > 0);
+		total += std::stoul(line.substr(space + 1));
+	}
+	CPPUNIT_ASSERT_EQUAL(static_cast<unsigned long>(profiler.sampleCount()), total);
+
+	profiler.reset();
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), profiler.sampleCount());
+}
+
+void afc::ProfilerTest::testSuspendedSampling()
+{
+	ProfilerOptions options;
+	options.frequency = 1000;
+	Profiler profiler(options);
+	profiler.registerThread();
+	profiler.setFrequency(0);
+	CPPUNIT_ASSERT_EQUAL(0u, profiler.frequency());
+
+	spin(0.1);
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), profiler.sampleCount());
+
+	profiler.setFrequency(1000);
+	spin(0.1);
+	CPPUNIT_ASSERT(profiler.sampleCount() > 0);
+
+	profiler.unregisterThread();
+	profiler.reset();
+	spin(0.05);
+	CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), profiler.sampleCount());
+}
+
+void afc::ProfilerTest::testOtherThread()
+{
+	ProfilerOptions options;
+	options.frequency = 1000;
+	Profiler profiler(options);
+
+	std::thread worker([&profiler]()
+	{
+		profiler.registerThread();
+		spin(0.2);
+		// The thread is unregistered on exit.
+	});
+	worker.join();
+
+	CPPUNIT_ASSERT(profiler.sampleCount() > 0);
+	std::ostringstream out;
+	profiler.writeFoldedStacks(out);
+	CPPUNIT_ASSERT(!out.str().empty());
+}
+
+void afc::ProfilerTest::testPreviousHandlerRestored()
+{
+	std::signal(SIGPROF, previousHandler);
+	{
+		ProfilerOptions options;
+		options.frequency = 1000;
+		Profiler profiler(options);
+		profiler.registerThread();
+		spin(0.05);
+	}
+
+	struct sigaction action;
+	CPPUNIT_ASSERT_EQUAL(0, ::sigaction(SIGPROF, nullptr, &action));
+	CPPUNIT_ASSERT(action.sa_handler == previousHandler);
+	// The profiling signals are not passed to the previous handler.
+	CPPUNIT_ASSERT_EQUAL(0u, previousHandlerCalls.load());
+
+	std::signal(SIGPROF, SIG_DFL);
+}
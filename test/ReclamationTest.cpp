@@ -0,0 +1,299 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "ReclamationTest.hpp"
+#include <afc/reclamation.h>
+
+#include <afc/Exception.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::ReclamationTest);
+
+using std::uint64_t;
+
+namespace
+{
+	const uint64_t liveMagic = 0x1122334455667788;
+
+	struct Object
+	{
+		explicit Object(const uint64_t value) : magic(liveMagic), value(value) {}
+
+		uint64_t magic;
+		uint64_t value;
+	};
+
+	/* Objects retired in the stress tests are poisoned rather than freed, so that a premature
+	 * reclamation is detected by readers (and reported by ThreadSanitizer as a data race).
+	 */
+	struct Graveyard
+	{
+		~Graveyard()
+		{
+			for (Object * const object : objects) {
+				delete object;
+			}
+		}
+
+		static void bury(void * const p)
+		{
+			Object * const object = static_cast<Object *>(p);
+			object->magic = 0;
+			Graveyard &g = instance();
+			std::lock_guard<std::mutex> lock(g.mutex);
+			g.objects.push_back(object);
+		}
+
+		static Graveyard &instance()
+		{
+			static Graveyard graveyard;
+			return graveyard;
+		}
+
+		std::mutex mutex;
+		std::vector<Object *> objects;
+	};
+
+	std::atomic<unsigned> deleted(0);
+
+	void countDeletion(void * const p)
+	{
+		delete static_cast<Object *>(p);
+		deleted.fetch_add(1);
+	}
+
+	afc::EpochDomain *otherDomain;
+
+	// Retires another object into otherDomain.
+	void deleteAndRetireOther(void * const p)
+	{
+		countDeletion(p);
+		otherDomain->retire(new Object(0), countDeletion);
+	}
+
+	const unsigned writerCount = 2;
+	const unsigned readerCount = 3;
+	const unsigned updateCount = 5000;
+
+	/* Writers replace the shared object and retire the old one while readers check that
+	 * the object they see is alive.
+	 */
+	template<typename Domain, typename Read>
+	void stress(Domain &domain, Read read)
+	{
+		std::atomic<Object *> shared(new Object(0));
+		std::atomic<unsigned> writersDone(0);
+		std::atomic<bool> deadObjectSeen(false);
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < writerCount; ++t) {
+			threads.emplace_back([&]()
+			{
+				for (unsigned i = 0; i < updateCount; ++i) {
+					Object * const old = shared.exchange(new Object(i));
+					domain.retire(old, Graveyard::bury);
+					if (i % 256 == 0) {
+						std::this_thread::yield();
+					}
+				}
+				writersDone.fetch_add(1);
+			});
+		}
+		for (unsigned t = 0; t < readerCount; ++t) {
+			threads.emplace_back([&]()
+			{
+				while (writersDone.load() != writerCount) {
+					if (!read(shared)) {
+						deadObjectSeen = true;
+					}
+				}
+			});
+		}
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+		domain.retire(shared.load(), Graveyard::bury);
+
+		CPPUNIT_ASSERT(!deadObjectSeen);
+	}
+}
+
+void afc::ReclamationTest::testEpoch_RetiredObjectKeptWhilePinned()
+{
+	EpochDomain domain;
+	deleted = 0;
+	{
+		EpochGuard guard(domain);
+		domain.retire(new Object(1), countDeletion);
+		for (int i = 0; i < 5; ++i) {
+			domain.collect();
+		}
+		CPPUNIT_ASSERT_EQUAL(0u, deleted.load());
+	}
+	domain.collect();
+	CPPUNIT_ASSERT_EQUAL(1u, deleted.load());
+}
+
+void afc::ReclamationTest::testEpoch_NestedGuards()
+{
+	EpochDomain domain;
+	deleted = 0;
+	{
+		EpochGuard guard(domain);
+		{
+			EpochGuard nested(domain);
+			domain.retire(new Object(1), countDeletion);
+		}
+		domain.collect();
+		CPPUNIT_ASSERT_EQUAL(0u, deleted.load());
+	}
+	domain.collect();
+	CPPUNIT_ASSERT_EQUAL(1u, deleted.load());
+}
+
+void afc::ReclamationTest::testEpoch_ThreadExit()
+{
+	deleted = 0;
+	{
+		EpochDomain domain;
+		std::thread([&]()
+		{
+			EpochGuard guard(domain);
+			domain.retire(new Object(1), countDeletion);
+		}).join();
+		CPPUNIT_ASSERT_EQUAL(1u, deleted.load());
+
+		// The objects that cannot be reclaimed at thread exit are kept by the record released.
+		std::atomic<bool> pinned(false), done(false);
+		std::thread pinnedThread([&]()
+		{
+			EpochGuard guard(domain);
+			pinned = true;
+			while (!done) {
+				std::this_thread::yield();
+			}
+		});
+		while (!pinned) {
+			std::this_thread::yield();
+		}
+		std::thread([&]() { domain.retire(new Object(2), countDeletion); }).join();
+		CPPUNIT_ASSERT_EQUAL(1u, deleted.load());
+		done = true;
+		pinnedThread.join();
+	}
+	CPPUNIT_ASSERT_EQUAL(2u, deleted.load());
+}
+
+void afc::ReclamationTest::testEpoch_ThreadExit_RetireFromDeleter()
+{
+	deleted = 0;
+	{
+		EpochDomain domain, other;
+		otherDomain = &other;
+		// The deleter run when the thread releases its record acquires a record of the other domain.
+		std::thread([&]() { domain.retire(new Object(1), deleteAndRetireOther); }).join();
+		CPPUNIT_ASSERT_EQUAL(2u, deleted.load());
+	}
+	otherDomain = nullptr;
+}
+
+void afc::ReclamationTest::testEpoch_DomainDestruction()
+{
+	deleted = 0;
+	{
+		EpochDomain domain;
+		EpochGuard guard(domain);
+		domain.retire(new Object(1), countDeletion);
+		domain.retire(new Object(2), countDeletion);
+	}
+	CPPUNIT_ASSERT_EQUAL(2u, deleted.load());
+}
+
+void afc::ReclamationTest::testEpoch_Stress()
+{
+	EpochDomain domain;
+	stress(domain, [&](const std::atomic<Object *> &shared)
+	{
+		EpochGuard guard(domain);
+		const Object * const object = shared.load(std::memory_order_acquire);
+		return object->magic == liveMagic;
+	});
+}
+
+void afc::ReclamationTest::testHazard_ProtectedObjectKept()
+{
+	HazardDomain domain;
+	deleted = 0;
+	std::atomic<Object *> shared(new Object(1));
+	HazardPointer hazard(domain);
+
+	Object * const object = hazard.protect(shared);
+	CPPUNIT_ASSERT_EQUAL(uint64_t(1), object->value);
+	shared.store(new Object(2));
+	domain.retire(object, countDeletion);
+	domain.collect();
+	CPPUNIT_ASSERT_EQUAL(0u, deleted.load());
+
+	hazard.reset();
+	domain.collect();
+	CPPUNIT_ASSERT_EQUAL(1u, deleted.load());
+	delete shared.load();
+}
+
+void afc::ReclamationTest::testHazard_TooManyHazardPointers()
+{
+	HazardDomain domain;
+	std::vector<std::unique_ptr<HazardPointer>> hazards;
+	for (unsigned i = 0; i < HazardDomain::slotsPerThread; ++i) {
+		hazards.emplace_back(new HazardPointer(domain));
+	}
+	try {
+		HazardPointer hazard(domain);
+		CPPUNIT_FAIL("afc::Exception is expected");
+	}
+	catch (Exception &ex) {
+		// Expected.
+	}
+	hazards.pop_back();
+	HazardPointer hazard(domain);
+}
+
+void afc::ReclamationTest::testHazard_BoundedRetiredObjects()
+{
+	HazardDomain domain;
+	deleted = 0;
+	const unsigned count = 1000;
+	for (unsigned i = 0; i < count; ++i) {
+		domain.retire(new Object(i), countDeletion);
+	}
+	// Retiring triggers the reclamation without explicit collect() calls.
+	CPPUNIT_ASSERT(count - deleted.load() <= 2 * HazardDomain::slotsPerThread + 16);
+}
+
+void afc::ReclamationTest::testHazard_Stress()
+{
+	HazardDomain domain;
+	stress(domain, [&](const std::atomic<Object *> &shared)
+	{
+		HazardPointer hazard(domain);
+		const Object * const object = hazard.protect(shared);
+		return object->magic == liveMagic;
+	});
+}
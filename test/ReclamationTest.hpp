@@ -0,0 +1,52 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_RECLAMATIONTEST_HPP_
+#define AFC_RECLAMATIONTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class ReclamationTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(ReclamationTest);
+		CPPUNIT_TEST(testEpoch_RetiredObjectKeptWhilePinned);
+		CPPUNIT_TEST(testEpoch_NestedGuards);
+		CPPUNIT_TEST(testEpoch_ThreadExit);
+		CPPUNIT_TEST(testEpoch_ThreadExit_RetireFromDeleter);
+		CPPUNIT_TEST(testEpoch_DomainDestruction);
+		CPPUNIT_TEST(testEpoch_Stress);
+		CPPUNIT_TEST(testHazard_ProtectedObjectKept);
+		CPPUNIT_TEST(testHazard_TooManyHazardPointers);
+		CPPUNIT_TEST(testHazard_BoundedRetiredObjects);
+		CPPUNIT_TEST(testHazard_Stress);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testEpoch_RetiredObjectKeptWhilePinned();
+		void testEpoch_NestedGuards();
+		void testEpoch_ThreadExit();
+		void testEpoch_ThreadExit_RetireFromDeleter();
+		void testEpoch_DomainDestruction();
+		void testEpoch_Stress();
+		void testHazard_ProtectedObjectKept();
+		void testHazard_TooManyHazardPointers();
+		void testHazard_BoundedRetiredObjects();
+		void testHazard_Stress();
+	};
+}
+
+#endif /* AFC_RECLAMATIONTEST_HPP_ */
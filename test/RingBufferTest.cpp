@@ -0,0 +1,167 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "RingBufferTest.hpp"
+#include <afc/ring_buffer.h>
+#include <afc/Exception.h>
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::RingBufferTest);
+
+void afc::RingBufferTest::testCapacity()
+{
+	const std::size_t pageSize = ::sysconf(_SC_PAGESIZE);
+
+	MirroredRingBuffer buf(1);
+	CPPUNIT_ASSERT_EQUAL(pageSize, buf.capacity());
+	CPPUNIT_ASSERT(buf.empty());
+	CPPUNIT_ASSERT_EQUAL(pageSize, buf.freeSpace());
+
+	MirroredRingBuffer buf2(3 * pageSize + 1);
+	CPPUNIT_ASSERT_EQUAL(4 * pageSize, buf2.capacity());
+}
+
+void afc::RingBufferTest::testContiguousAcrossWrapPoint()
+{
+	MirroredRingBuffer buf(1);
+	const std::size_t capacity = buf.capacity();
+
+	// Moving the read and write positions close to the end of the storage.
+	std::vector<unsigned char> data(capacity - 10, 'x');
+	CPPUNIT_ASSERT_EQUAL(data.size(), buf.write(data.data(), data.size()));
+	buf.consume(data.size());
+	CPPUNIT_ASSERT(buf.empty());
+
+	const std::string text("0123456789abcdefghij");
+	buf.append(text.data(), text.size());
+	CPPUNIT_ASSERT_EQUAL(text.size(), buf.size());
+	// The data read wraps around the end of the storage but is seen as a single region.
+	CPPUNIT_ASSERT_EQUAL(text, std::string(buf.readData(), buf.size()));
+	CPPUNIT_ASSERT_EQUAL(capacity - text.size(), buf.freeSpace());
+
+	unsigned char out[32];
+	CPPUNIT_ASSERT_EQUAL(std::size_t(15), buf.read(out, 15));
+	CPPUNIT_ASSERT_EQUAL(std::string("0123456789abcde"), std::string(out, out + 15));
+	CPPUNIT_ASSERT_EQUAL(std::size_t(5), buf.read(out, sizeof(out)));
+	CPPUNIT_ASSERT_EQUAL(std::string("fghij"), std::string(out, out + 5));
+	CPPUNIT_ASSERT(buf.empty());
+}
+
+void afc::RingBufferTest::testStreams()
+{
+	MirroredRingBuffer buf(1);
+	RingBufferOutputStream out(buf);
+	RingBufferInputStream in(buf);
+
+	std::vector<unsigned char> data(buf.capacity() / 3);
+	for (std::size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<unsigned char>(i * 7);
+	}
+
+	// Several rounds so that the positions wrap around many times.
+	for (int round = 0; round < 10; ++round) {
+		out.write(data.data(), data.size());
+		out.write(data.data(), data.size());
+
+		std::vector<unsigned char> result(data.size());
+		CPPUNIT_ASSERT_EQUAL(data.size(), in.read(result.data(), result.size()));
+		CPPUNIT_ASSERT(data == result);
+		CPPUNIT_ASSERT_EQUAL(std::size_t(3), in.skip(3));
+		CPPUNIT_ASSERT_EQUAL(data.size() - 3, in.read(result.data(), result.size()));
+		CPPUNIT_ASSERT(std::equal(result.begin(), result.end() - 3, data.begin() + 3));
+		CPPUNIT_ASSERT_EQUAL(std::size_t(0), in.read(result.data(), result.size()));
+	}
+}
+
+void afc::RingBufferTest::testStreams_Overflow()
+{
+	MirroredRingBuffer buf(1);
+	RingBufferOutputStream out(buf);
+
+	std::vector<unsigned char> data(buf.capacity() - 1);
+	out.write(data.data(), data.size());
+
+	try {
+		out.write(data.data(), 2);
+		CPPUNIT_FAIL("Exception is expected");
+	}
+	catch (afc::Exception &ex) {
+		// Expected.
+	}
+	CPPUNIT_ASSERT_EQUAL(data.size(), buf.size());
+
+	out.write(data.data(), 1);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(0), buf.freeSpace());
+}
+
+void afc::RingBufferTest::testAppend()
+{
+	MirroredRingBuffer buf(1);
+	buf.append(std::string(buf.capacity() - 3, ' ').c_str(), buf.capacity() - 3);
+	buf.consume(buf.size());
+
+	buf.reserve(8);
+	buf.append("ab"_s).append('c');
+
+	MirroredRingBuffer::Tail tail = buf.borrowTail();
+	*tail++ = 'd';
+	*tail++ = 'e';
+	// Not committed yet.
+	CPPUNIT_ASSERT_EQUAL(std::size_t(3), buf.size());
+	buf.returnTail(tail);
+
+	CPPUNIT_ASSERT_EQUAL(std::string("abcde"), std::string(buf.readData(), buf.size()));
+}
+
+void afc::RingBufferTest::testProducerConsumerThreads()
+{
+	MirroredRingBuffer buf(1);
+	const std::size_t total = 16 * buf.capacity() + 13;
+
+	std::thread producer([&buf, total]()
+	{
+		std::size_t i = 0;
+		while (i < total) {
+			const std::size_t n = std::min(buf.freeSpace(), total - i);
+			char * const dest = buf.writeData();
+			for (std::size_t j = 0; j < n; ++j) {
+				dest[j] = static_cast<char>((i + j) % 251);
+			}
+			buf.commit(n);
+			i += n;
+		}
+	});
+
+	bool valid = true;
+	std::size_t i = 0;
+	while (i < total) {
+		const std::size_t n = buf.size();
+		const char * const src = buf.readData();
+		for (std::size_t j = 0; j < n; ++j) {
+			valid &= src[j] == static_cast<char>((i + j) % 251);
+		}
+		buf.consume(n);
+		i += n;
+	}
+	producer.join();
+
+	CPPUNIT_ASSERT(valid);
+	CPPUNIT_ASSERT(buf.empty());
+}
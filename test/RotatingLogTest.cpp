@@ -0,0 +1,294 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "RotatingLogTest.hpp"
+#include "TestUtil.hpp"
+#include <afc/logger.hpp>
+#include <afc/rotating_log.h>
+#include <afc/stream.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::RotatingLogTest);
+
+using afc::test::TempDir;
+
+namespace
+{
+	// Logging threads wait for the next segment, so the segments are switched at the limits exactly.
+	afc::logger::RotationOptions rotationOptions()
+	{
+		afc::logger::RotationOptions options;
+		options.nextSegmentTimeout = std::chrono::seconds(10);
+		return options;
+	}
+
+	// The clock of the rotating log in the tests that depend on time.
+	std::atomic<std::time_t> currentTime(0);
+
+	std::time_t testClock()
+	{
+		return currentTime.load();
+	}
+
+	// Segment files ordered by their sequence numbers ('log.YYYYMMDDThhmmss.N[.gz]').
+	std::vector<std::string> segments(const TempDir &dir)
+	{
+		std::vector<std::pair<unsigned long, std::string>> numbered;
+		for (const std::string &file : dir.files()) {
+			const std::size_t start = file.find('.', std::string("log.").size()) + 1;
+			numbered.emplace_back(std::stoul(file.substr(start)), file);
+		}
+		std::sort(numbered.begin(), numbered.end());
+
+		std::vector<std::string> result;
+		for (const auto &segment : numbered) {
+			result.push_back(segment.second);
+		}
+		return result;
+	}
+
+	std::string readAll(const std::string &file)
+	{
+		std::unique_ptr<afc::InputStream> in;
+		if (file.size() > 3 && file.compare(file.size() - 3, 3, ".gz") == 0) {
+			in.reset(new afc::GZipFileInputStream(file.c_str()));
+		} else {
+			in.reset(new afc::FileInputStream(file.c_str()));
+		}
+		std::string result;
+		unsigned char buf[4096];
+		std::size_t n;
+		while ((n = in->read(buf, sizeof(buf))) > 0) {
+			result.append(reinterpret_cast<const char *>(buf), n);
+		}
+		return result;
+	}
+
+	std::string writeLines(afc::logger::RotatingLogFile &log, const unsigned count)
+	{
+		std::string expected;
+		for (unsigned i = 0; i < count; ++i) {
+			afc::logger::logToFile<true>(log.stream(), "line ", i);
+			expected += "line " + std::to_string(i) + '\n';
+		}
+		return expected;
+	}
+
+	void checkRotation(const bool compress)
+	{
+		TempDir dir;
+		afc::logger::RotationOptions options = rotationOptions();
+		options.maxSegmentSize = 200;
+		options.preallocationSize = 4096;
+		options.compress = compress;
+
+		std::string expected;
+		{
+			afc::logger::RotatingLogFile log((dir.path + "/log").c_str(), options);
+			expected = writeLines(log, 300);
+		}
+
+		const std::vector<std::string> files = segments(dir);
+		CPPUNIT_ASSERT(files.size() > 3);
+		std::string actual;
+		for (const std::string &file : files) {
+			CPPUNIT_ASSERT_EQUAL(compress, file.compare(file.size() - 3, 3, ".gz") == 0);
+			const std::string content = readAll(dir.path + '/' + file);
+			// Segments are switched only at line boundaries.
+			CPPUNIT_ASSERT(content.empty() || content.back() == '\n');
+			actual += content;
+		}
+		CPPUNIT_ASSERT(expected == actual);
+	}
+}
+
+void afc::RotatingLogTest::testRotation()
+{
+	checkRotation(true);
+}
+
+void afc::RotatingLogTest::testRotation_Uncompressed()
+{
+	checkRotation(false);
+}
+
+void afc::RotatingLogTest::testRotation_BufferedStream()
+{
+	TempDir dir;
+	logger::RotationOptions options = rotationOptions();
+	// Larger than the buffer of the stream, so the records that reach the limit are split between flushes.
+	options.maxSegmentSize = 100 * 1024;
+	options.preallocationSize = 0;
+	options.compress = false;
+
+	std::string expected;
+	{
+		logger::RotatingLogFile log((dir.path + "/log").c_str(), options);
+		for (unsigned i = 0; i < 50000; ++i) {
+			logger::logToFile<false>(log.stream(), "buffered line ", i);
+			expected += "buffered line " + std::to_string(i) + '\n';
+		}
+	}
+
+	const std::vector<std::string> files = segments(dir);
+	CPPUNIT_ASSERT(files.size() > 5);
+	std::string actual;
+	for (const std::string &file : files) {
+		const std::string content = readAll(dir.path + '/' + file);
+		// Each segment is closed by the first record that reaches the limit.
+		CPPUNIT_ASSERT(content.size() < options.maxSegmentSize + 32);
+		actual += content;
+	}
+	for (std::size_t i = 0; i + 1 < files.size(); ++i) {
+		const std::string content = readAll(dir.path + '/' + files[i]);
+		CPPUNIT_ASSERT(content.size() >= options.maxSegmentSize);
+		CPPUNIT_ASSERT_EQUAL('\n', content.back());
+	}
+	CPPUNIT_ASSERT(expected == actual);
+}
+
+void afc::RotatingLogTest::testRetention_TotalSize()
+{
+	TempDir dir;
+	logger::RotationOptions options = rotationOptions();
+	options.maxSegmentSize = 200;
+	options.preallocationSize = 0;
+	options.compress = false;
+	options.maxTotalSize = 1000;
+
+	std::string expected;
+	{
+		logger::RotatingLogFile log((dir.path + "/log").c_str(), options);
+		expected = writeLines(log, 300);
+	}
+
+	const std::vector<std::string> files = segments(dir);
+	CPPUNIT_ASSERT(!files.empty());
+	std::string actual;
+	for (const std::string &file : files) {
+		actual += readAll(dir.path + '/' + file);
+	}
+	// Only the most recent segments are kept.
+	CPPUNIT_ASSERT(actual.size() <= 1000);
+	CPPUNIT_ASSERT(actual.size() >= 200);
+	CPPUNIT_ASSERT(expected.compare(expected.size() - actual.size(), actual.size(), actual) == 0);
+}
+
+void afc::RotatingLogTest::testRotation_SegmentAge()
+{
+	TempDir dir;
+	logger::RotationOptions options = rotationOptions();
+	options.maxSegmentSize = 0;
+	options.maxSegmentAge = 1;
+	options.preallocationSize = 0;
+	options.compress = false;
+	options.clock = testClock;
+	currentTime = 1552653045;
+
+	{
+		logger::RotatingLogFile log((dir.path + "/log").c_str(), options);
+		logger::logToFile<true>(log.stream(), "line 0");
+		++currentTime;
+		// The segment is closed after this line.
+		logger::logToFile<true>(log.stream(), "line 1");
+		// The age of the next segment is counted from the rotation, so it is not closed immediately.
+		logger::logToFile<true>(log.stream(), "line 2");
+		logger::logToFile<true>(log.stream(), "line 3");
+	}
+
+	const std::vector<std::string> files = segments(dir);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), files.size());
+	CPPUNIT_ASSERT_EQUAL(std::string("line 0\nline 1\n"), readAll(dir.path + '/' + files[0]));
+	CPPUNIT_ASSERT_EQUAL(std::string("line 2\nline 3\n"), readAll(dir.path + '/' + files[1]));
+}
+
+void afc::RotatingLogTest::testExistingSegments()
+{
+	TempDir dir;
+	logger::RotationOptions options = rotationOptions();
+	options.maxSegmentSize = 0;
+	options.preallocationSize = 0;
+	options.compress = false;
+	options.clock = testClock;
+	// 2019-03-15T12:30:45Z.
+	currentTime = 1552653045;
+
+	// Segments written by a previous run within the same second.
+	{
+		logger::RotatingLogFile log((dir.path + "/log").c_str(), options);
+		logger::logToFile<true>(log.stream(), "previous run");
+	}
+	{
+		logger::RotatingLogFile log((dir.path + "/log").c_str(), options);
+		logger::logToFile<true>(log.stream(), "this run");
+	}
+
+	const std::vector<std::string> files = segments(dir);
+	CPPUNIT_ASSERT_EQUAL(std::size_t(2), files.size());
+	CPPUNIT_ASSERT_EQUAL(std::string("log.20190315T123045.1"), files[0]);
+	CPPUNIT_ASSERT_EQUAL(std::string("previous run\n"), readAll(dir.path + '/' + files[0]));
+	CPPUNIT_ASSERT_EQUAL(std::string("this run\n"), readAll(dir.path + '/' + files[1]));
+}
+
+void afc::RotatingLogTest::testRetention_Age()
+{
+	TempDir dir;
+	// Segments left by previous runs: one is two hours old, the other one is recent.
+	const std::string oldSegment = dir.path + "/log.20000101T000000.100";
+	const std::string recentSegment = dir.path + "/log.20000101T000000.101";
+	for (const std::string &file : {oldSegment, recentSegment}) {
+		::close(::open(file.c_str(), O_WRONLY | O_CREAT, 0644));
+	}
+	// Old files that share the prefix but are not segments.
+	const std::vector<std::string> otherFiles{"log.1", "log.bak", "log.conf", "log.20000101T000000.1.bak", "log.20000101T0000.1"};
+	const struct timespec times[2] = {{std::time(nullptr) - 7200, 0}, {std::time(nullptr) - 7200, 0}};
+	CPPUNIT_ASSERT_EQUAL(0, ::utimensat(AT_FDCWD, oldSegment.c_str(), times, 0));
+	for (const std::string &file : otherFiles) {
+		const std::string path = dir.path + '/' + file;
+		::close(::open(path.c_str(), O_WRONLY | O_CREAT, 0644));
+		CPPUNIT_ASSERT_EQUAL(0, ::utimensat(AT_FDCWD, path.c_str(), times, 0));
+	}
+
+	logger::RotationOptions options = rotationOptions();
+	options.maxSegmentSize = 200;
+	options.preallocationSize = 0;
+	options.compress = false;
+	options.maxRetentionAge = 3600;
+	{
+		logger::RotatingLogFile log((dir.path + "/log").c_str(), options);
+		// Retention is enforced when a segment is closed.
+		writeLines(log, 100);
+	}
+
+	const std::vector<std::string> files = dir.files();
+	CPPUNIT_ASSERT(std::find(files.begin(), files.end(), "log.20000101T000000.100") == files.end());
+	CPPUNIT_ASSERT(std::find(files.begin(), files.end(), "log.20000101T000000.101") != files.end());
+	for (const std::string &file : otherFiles) {
+		CPPUNIT_ASSERT(std::find(files.begin(), files.end(), file) != files.end());
+	}
+	CPPUNIT_ASSERT(files.size() > 2 + otherFiles.size());
+}
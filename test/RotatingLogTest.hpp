@@ -0,0 +1,46 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_ROTATINGLOGTEST_HPP_
+#define AFC_ROTATINGLOGTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class RotatingLogTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(RotatingLogTest);
+		CPPUNIT_TEST(testRotation);
+		CPPUNIT_TEST(testRotation_Uncompressed);
+		CPPUNIT_TEST(testRotation_BufferedStream);
+		CPPUNIT_TEST(testRetention_TotalSize);
+		CPPUNIT_TEST(testRotation_SegmentAge);
+		CPPUNIT_TEST(testExistingSegments);
+		CPPUNIT_TEST(testRetention_Age);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testRotation();
+		void testRotation_Uncompressed();
+		void testRotation_BufferedStream();
+		void testRetention_TotalSize();
+		void testRotation_SegmentAge();
+		void testExistingSegments();
+		void testRetention_Age();
+	};
+}
+
+#endif /* AFC_ROTATINGLOGTEST_HPP_ */
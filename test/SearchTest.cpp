@@ -0,0 +1,163 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "SearchTest.hpp"
+#include <afc/algo/search.h>
+
+#include <cstdlib>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::SearchTest);
+
+using std::vector;
+
+namespace
+{
+	/* -sum((x[d] - target[d])^2): the maximum is at the target. The value() calls and
+	 * the batches passed to values() are counted.
+	 */
+	class Paraboloid : public afc::SearchSpace<int, int>
+	{
+	public:
+		Paraboloid(const vector<int> &target, const int lowerBound, const int upperBound)
+			: target(target), lb(lowerBound), ub(upperBound), valueCalls(0), batchCalls(0) {}
+
+		virtual unsigned dimensionCount() const throw() { return target.size(); }
+		virtual int lowerBound(unsigned) const throw() { return lb; }
+		virtual int upperBound(unsigned) const throw() { return ub; }
+
+		virtual int value(const vector<int> &state) const throw()
+		{
+			++valueCalls;
+			int result = 0;
+			for (unsigned d = 0; d < target.size(); ++d) {
+				CPPUNIT_ASSERT(state[d] >= lb && state[d] <= ub);
+				result -= (state[d] - target[d]) * (state[d] - target[d]);
+			}
+			return result;
+		}
+
+		virtual void values(const afc::StateBatch<int> &states, int * const result) const
+		{
+			++batchCalls;
+			afc::SearchSpace<int, int>::values(states, result);
+		}
+
+		const vector<int> target;
+		const int lb;
+		const int ub;
+		mutable unsigned valueCalls;
+		mutable unsigned batchCalls;
+	};
+
+	// Evaluates batches dimension by dimension without calling value().
+	class BatchedParaboloid : public Paraboloid
+	{
+	public:
+		BatchedParaboloid(const vector<int> &target, const int lowerBound, const int upperBound)
+			: Paraboloid(target, lowerBound, upperBound) {}
+
+		virtual void values(const afc::StateBatch<int> &states, int * const result) const
+		{
+			++batchCalls;
+			CPPUNIT_ASSERT(states.size > 0 && states.size <= afc::searchBatchSize);
+			std::fill_n(result, states.size, 0);
+			for (unsigned d = 0; d < target.size(); ++d) {
+				const int * const x = states.dimension(d);
+				for (std::size_t i = 0; i < states.size; ++i) {
+					result[i] -= (x[i] - target[d]) * (x[i] - target[d]);
+				}
+			}
+		}
+	};
+}
+
+void afc::SearchTest::testDefaultBatchEvaluation()
+{
+	const Paraboloid space({1, 2}, -5, 5);
+	// Three states: (0, 0), (1, 2), (-5, 5).
+	const int coordinates[] = {0, 1, -5, 99, 0, 2, 5, 99};
+	const StateBatch<int> batch{coordinates, 4, 3};
+	int result[3];
+
+	space.values(batch, result);
+
+	CPPUNIT_ASSERT_EQUAL(-5, result[0]);
+	CPPUNIT_ASSERT_EQUAL(0, result[1]);
+	CPPUNIT_ASSERT_EQUAL(-45, result[2]);
+	CPPUNIT_ASSERT_EQUAL(3u, space.valueCalls);
+	CPPUNIT_ASSERT_EQUAL(2, batch(1, 1));
+}
+
+void afc::SearchTest::testExhaustiveSearch()
+{
+	const vector<int> target{3, -2, 0};
+	const Paraboloid scalar(target, -4, 4);
+	const BatchedParaboloid batched(target, -4, 4);
+	for (const Paraboloid *space : {&scalar, static_cast<const Paraboloid *>(&batched)}) {
+		vector<int> solution;
+
+		ExhaustiveSearch<int, int>().solve(*space, solution);
+
+		CPPUNIT_ASSERT(solution == target);
+		// 9^3 states in batches.
+		CPPUNIT_ASSERT_EQUAL((729u + searchBatchSize - 1) / searchBatchSize, std::size_t(space->batchCalls));
+	}
+	// Only the initial state is evaluated with value().
+	CPPUNIT_ASSERT_EQUAL(1u, batched.valueCalls);
+}
+
+void afc::SearchTest::testExhaustiveSearch_SingleDimension()
+{
+	const BatchedParaboloid space({7}, 0, 10);
+	vector<int> solution;
+
+	ExhaustiveSearch<int, int>().solve(space, solution);
+
+	CPPUNIT_ASSERT(solution == vector<int>{7});
+	CPPUNIT_ASSERT_EQUAL(1u, space.batchCalls);
+}
+
+void afc::SearchTest::testRandomStartHillClimbing()
+{
+	const Paraboloid space({5, -3, 8, 0}, -10, 10);
+	vector<int> solution;
+	std::srand(1);
+
+	RandomStartHillClimbing<int, int>(3, 20).solve(space, solution);
+
+	CPPUNIT_ASSERT(solution == space.target);
+	// 4 * 21 neighbours per step.
+	CPPUNIT_ASSERT_EQUAL(3u * 20u * 2u, space.batchCalls);
+}
+
+void afc::SearchTest::testRandomStartHillClimbing_BatchedObjective()
+{
+	const vector<int> target{2, 2, -7, 4, 1};
+	const Paraboloid scalar(target, -8, 8);
+	const BatchedParaboloid batched(target, -8, 8);
+	vector<int> scalarSolution, batchedSolution;
+
+	// Equal values are chosen at random, so the same seed must lead to the same solution.
+	std::srand(7);
+	RandomStartHillClimbing<int, int>(2, 3).solve(scalar, scalarSolution);
+	std::srand(7);
+	RandomStartHillClimbing<int, int>(2, 3).solve(batched, batchedSolution);
+
+	CPPUNIT_ASSERT(scalarSolution == batchedSolution);
+	CPPUNIT_ASSERT_EQUAL(scalar.batchCalls, batched.batchCalls);
+	// Only the initial state of each attempt is evaluated with value().
+	CPPUNIT_ASSERT_EQUAL(2u, batched.valueCalls);
+}
@@ -0,0 +1,238 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "SlabTest.hpp"
+#include <afc/slab.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::SlabTest);
+
+using std::size_t;
+using std::string;
+using std::vector;
+
+namespace
+{
+	struct Counted
+	{
+		explicit Counted(const int value) : value(value) { ++liveCount; }
+		~Counted() { --liveCount; }
+
+		static int liveCount;
+
+		int value;
+	};
+
+	int Counted::liveCount = 0;
+
+	struct Throwing
+	{
+		Throwing() { throw std::runtime_error("test"); }
+	};
+
+	struct Large
+	{
+		char data[4096];
+	};
+
+	// Checks that the objects do not overlap by filling each of them with its own pattern.
+	void checkDistinct(const vector<void *> &objects, const size_t size)
+	{
+		for (size_t i = 0; i < objects.size(); ++i) {
+			std::memset(objects[i], int(i & 0xff), size);
+		}
+		for (size_t i = 0; i < objects.size(); ++i) {
+			const unsigned char *p = static_cast<const unsigned char *>(objects[i]);
+			CPPUNIT_ASSERT(std::all_of(p, p + size, [i](const unsigned char c) { return c == (i & 0xff); }));
+			CPPUNIT_ASSERT_EQUAL(std::uintptr_t(0), reinterpret_cast<std::uintptr_t>(objects[i]) % 16);
+		}
+	}
+}
+
+void afc::SlabTest::testAllocateDeallocate()
+{
+	for (const size_t size : {size_t(1), size_t(16), size_t(17), size_t(100), maxSlabObjectSize}) {
+		vector<void *> objects;
+		for (int i = 0; i < 1000; ++i) {
+			objects.push_back(slabAllocate(size));
+		}
+		checkDistinct(objects, size);
+		for (void * const p : objects) {
+			slabDeallocate(p, size);
+		}
+
+		// Objects are reused.
+		void * const p = slabAllocate(size);
+		CPPUNIT_ASSERT(std::find(objects.begin(), objects.end(), p) != objects.end());
+		slabDeallocate(p, size);
+	}
+}
+
+void afc::SlabTest::testBatchDeallocate()
+{
+	vector<void *> objects;
+	for (int i = 0; i < 500; ++i) {
+		objects.push_back(slabAllocate(48));
+	}
+	checkDistinct(objects, 48);
+	slabDeallocate(objects.data(), objects.size(), 48);
+	slabDeallocate(objects.data(), 0, 48);
+
+	vector<void *> reallocated;
+	for (int i = 0; i < 500; ++i) {
+		reallocated.push_back(slabAllocate(48));
+	}
+	checkDistinct(reallocated, 48);
+	slabDeallocate(reallocated.data(), reallocated.size(), 48);
+}
+
+void afc::SlabTest::testObjectPool()
+{
+	Counted::liveCount = 0;
+	Counted * const c = ObjectPool<Counted>::create(5);
+	CPPUNIT_ASSERT_EQUAL(5, c->value);
+	CPPUNIT_ASSERT_EQUAL(1, Counted::liveCount);
+	ObjectPool<Counted>::destroy(c);
+	CPPUNIT_ASSERT_EQUAL(0, Counted::liveCount);
+	ObjectPool<Counted>::destroy(nullptr);
+
+	vector<Counted *> objects;
+	for (int i = 0; i < 100; ++i) {
+		objects.push_back(ObjectPool<Counted>::create(i));
+	}
+	CPPUNIT_ASSERT_EQUAL(100, Counted::liveCount);
+	ObjectPool<Counted>::destroy(objects.data(), objects.size());
+	CPPUNIT_ASSERT_EQUAL(0, Counted::liveCount);
+
+	{
+		std::unique_ptr<Counted, ObjectPool<Counted>::Deleter> p(ObjectPool<Counted>::create(1));
+		CPPUNIT_ASSERT_EQUAL(1, Counted::liveCount);
+	}
+	CPPUNIT_ASSERT_EQUAL(0, Counted::liveCount);
+}
+
+void afc::SlabTest::testObjectPool_ConstructorThrows()
+{
+	try {
+		ObjectPool<Throwing>::create();
+		CPPUNIT_FAIL("std::runtime_error is expected");
+	}
+	catch (std::runtime_error &ex) {
+		// Expected.
+	}
+}
+
+void afc::SlabTest::testObjectPool_LargeObjects()
+{
+	vector<Large *> objects;
+	for (int i = 0; i < 10; ++i) {
+		objects.push_back(ObjectPool<Large>::create());
+		objects.back()->data[4095] = char(i);
+	}
+	for (int i = 0; i < 10; ++i) {
+		CPPUNIT_ASSERT_EQUAL(char(i), objects[i]->data[4095]);
+	}
+	ObjectPool<Large>::destroy(objects[0]);
+	ObjectPool<Large>::destroy(objects.data() + 1, objects.size() - 1);
+}
+
+void afc::SlabTest::testSlabAllocator()
+{
+	std::map<int, string, std::less<int>, SlabAllocator<std::pair<const int, string>>> map;
+	for (int i = 0; i < 1000; ++i) {
+		map[i] = std::to_string(i);
+	}
+	CPPUNIT_ASSERT_EQUAL(size_t(1000), map.size());
+	CPPUNIT_ASSERT_EQUAL(string("999"), map[999]);
+
+	std::list<int, SlabAllocator<int>> list(100, 7);
+	CPPUNIT_ASSERT_EQUAL(size_t(100), list.size());
+
+	// Big arrays are allocated by the global operator new.
+	vector<int, SlabAllocator<int>> v;
+	for (int i = 0; i < 10000; ++i) {
+		v.push_back(i);
+	}
+	CPPUNIT_ASSERT_EQUAL(9999, v.back());
+	CPPUNIT_ASSERT(SlabAllocator<int>() == SlabAllocator<string>());
+}
+
+void afc::SlabTest::testCrossThreadDeallocation()
+{
+	// Objects allocated by one thread are freed by another one, and threads exit with objects cached.
+	const size_t count = 10000;
+	vector<void *> objects(count);
+	std::thread([&]()
+	{
+		for (size_t i = 0; i < count; ++i) {
+			objects[i] = slabAllocate(64);
+		}
+	}).join();
+	checkDistinct(objects, 64);
+	vector<std::thread> threads;
+	for (size_t t = 0; t < 4; ++t) {
+		threads.emplace_back([&, t]()
+		{
+			for (size_t i = t; i < count; i += 4) {
+				slabDeallocate(objects[i], 64);
+			}
+			for (int i = 0; i < 1000; ++i) {
+				slabDeallocate(slabAllocate(64), 64);
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		objects[i] = slabAllocate(64);
+	}
+	checkDistinct(objects, 64);
+	slabDeallocate(objects.data(), count, 64);
+}
+
+void afc::SlabTest::testDeallocationOnlyThread()
+{
+	// A size class no other test uses.
+	const size_t size = 464;
+	void * const p = slabAllocate(size);
+	// The thread frees a single object and exits without allocating anything.
+	std::thread([p, size]() { slabDeallocate(p, size); }).join();
+
+	// The object is returned to the pool, so a new thread gets it before new slabs are carved.
+	bool found = false;
+	std::thread([p, size, &found]()
+	{
+		vector<void *> objects;
+		for (int i = 0; i < 2000 && !found; ++i) {
+			objects.push_back(slabAllocate(size));
+			found = objects.back() == p;
+		}
+		slabDeallocate(objects.data(), objects.size(), size);
+	}).join();
+
+	CPPUNIT_ASSERT(found);
+}
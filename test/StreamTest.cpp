@@ -0,0 +1,133 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "StreamTest.hpp"
+#include "TestUtil.hpp"
+#include <afc/stream.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::StreamTest);
+
+using afc::test::TempFile;
+
+namespace
+{
+	std::vector<unsigned char> testData(const std::size_t n)
+	{
+		static const char text[] = "2019-03-01 12:00:00 INFO request served in 12 ms\n";
+		std::vector<unsigned char> data(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			data[i] = static_cast<unsigned char>(text[i % (sizeof(text) - 1)] ^ ((i >> 10) & 1));
+		}
+		return data;
+	}
+
+	// Writes data in a few chunks and reads it back, including skip() and reset().
+	template<typename Output, typename Input, typename OutputArg>
+	void checkRoundTrip(const OutputArg &outputArg)
+	{
+		TempFile file;
+		const std::vector<unsigned char> data = testData(300 * 1024 + 17);
+
+		{
+			Output out(file.path.c_str(), outputArg);
+			out.write(data.data(), 1);
+			out.write(data.data() + 1, 100000);
+			out.write(data.data() + 100001, data.size() - 100001);
+			out.close();
+		}
+
+		Input in(file.path.c_str());
+		std::vector<unsigned char> result(data.size() + 10);
+		std::size_t count = 0, n;
+		while ((n = in.read(result.data() + count, result.size() - count)) > 0) {
+			count += n;
+		}
+		CPPUNIT_ASSERT_EQUAL(data.size(), count);
+		result.resize(count);
+		CPPUNIT_ASSERT(data == result);
+
+		in.reset();
+		CPPUNIT_ASSERT_EQUAL(std::size_t(12345), in.skip(12345));
+		unsigned char c;
+		CPPUNIT_ASSERT_EQUAL(std::size_t(1), in.read(&c, 1));
+		CPPUNIT_ASSERT_EQUAL(data[12345], c);
+		in.close();
+	}
+}
+
+void afc::StreamTest::testGZip_DefaultLevel()
+{
+	checkRoundTrip<GZipFileOutputStream, GZipFileInputStream>(Z_DEFAULT_COMPRESSION);
+}
+
+void afc::StreamTest::testGZip_FastestLevel()
+{
+	checkRoundTrip<GZipFileOutputStream, GZipFileInputStream>(1);
+}
+
+void afc::StreamTest::testGZip_BestLevel()
+{
+	checkRoundTrip<GZipFileOutputStream, GZipFileInputStream>(9);
+}
+
+#ifdef AFC_USE_LZ4
+void afc::StreamTest::testLZ4()
+{
+	checkRoundTrip<LZ4FrameOutputStream, LZ4FrameInputStream>(0);
+}
+
+void afc::StreamTest::testLZ4_HighCompression()
+{
+	checkRoundTrip<LZ4FrameOutputStream, LZ4FrameInputStream>(9);
+}
+#endif
+
+#ifdef AFC_USE_ZSTD
+void afc::StreamTest::testZstd()
+{
+	ZstdOptions options;
+	options.level = 3;
+	checkRoundTrip<ZstdOutputStream, ZstdInputStream>(options);
+}
+
+void afc::StreamTest::testZstd_Dictionary()
+{
+	static const unsigned char dictionary[] = "2019-03-01 12:00:00 INFO request served in 12 ms\n"
+			"2019-03-01 12:00:00 WARN cache miss\n";
+	const std::vector<unsigned char> data = testData(1000);
+	TempFile file;
+
+	ZstdOptions options;
+	options.dictionary = dictionary;
+	options.dictionarySize = sizeof(dictionary) - 1;
+	{
+		ZstdOutputStream out(file.path.c_str(), options);
+		out.write(data.data(), data.size());
+		out.close();
+	}
+
+	ZstdInputStream in(file.path.c_str(), dictionary, sizeof(dictionary) - 1);
+	std::vector<unsigned char> result(data.size());
+	CPPUNIT_ASSERT_EQUAL(data.size(), in.read(result.data(), result.size()));
+	CPPUNIT_ASSERT(data == result);
+	in.close();
+}
+#endif
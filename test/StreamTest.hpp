@@ -0,0 +1,54 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_STREAMTEST_HPP_
+#define AFC_STREAMTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class StreamTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(StreamTest);
+		CPPUNIT_TEST(testGZip_DefaultLevel);
+		CPPUNIT_TEST(testGZip_FastestLevel);
+		CPPUNIT_TEST(testGZip_BestLevel);
+#ifdef AFC_USE_LZ4
+		CPPUNIT_TEST(testLZ4);
+		CPPUNIT_TEST(testLZ4_HighCompression);
+#endif
+#ifdef AFC_USE_ZSTD
+		CPPUNIT_TEST(testZstd);
+		CPPUNIT_TEST(testZstd_Dictionary);
+#endif
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testGZip_DefaultLevel();
+		void testGZip_FastestLevel();
+		void testGZip_BestLevel();
+#ifdef AFC_USE_LZ4
+		void testLZ4();
+		void testLZ4_HighCompression();
+#endif
+#ifdef AFC_USE_ZSTD
+		void testZstd();
+		void testZstd_Dictionary();
+#endif
+	};
+}
+
+#endif /* AFC_STREAMTEST_HPP_ */
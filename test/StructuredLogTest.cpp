@@ -0,0 +1,163 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "StructuredLogTest.hpp"
+#include <afc/structured_log.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <locale.h>
+#include <string>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::StructuredLogTest);
+
+namespace
+{
+	std::string escape(const std::string &s)
+	{
+		std::vector<char> buf(afc::json::maxEscapedSize(s.size()));
+		char * const end = afc::json::escape(s.data(), s.data() + s.size(), buf.data());
+		return std::string(buf.data(), end);
+	}
+
+	// Captures the lines logged to a memory stream.
+	struct MemoryLog
+	{
+		MemoryLog() : data(nullptr), size(0) { file = ::open_memstream(&data, &size); }
+		~MemoryLog() { std::free(data); }
+
+		std::string text() { std::fclose(file); file = nullptr; return std::string(data, size); }
+
+		std::FILE *file;
+		char *data;
+		std::size_t size;
+	};
+}
+
+void afc::StructuredLogTest::testJsonEscape()
+{
+	CPPUNIT_ASSERT_EQUAL(std::string(), escape(""));
+	CPPUNIT_ASSERT_EQUAL(std::string("hello"), escape("hello"));
+	CPPUNIT_ASSERT_EQUAL(std::string("a\\\"b\\\\c"), escape("a\"b\\c"));
+	CPPUNIT_ASSERT_EQUAL(std::string("\\n\\r\\t\\b\\f"), escape("\n\r\t\b\f"));
+	CPPUNIT_ASSERT_EQUAL(std::string("\\u0001\\u001f"), escape("\x01\x1f"));
+	CPPUNIT_ASSERT_EQUAL(std::string("\xd0\xb6\x7f"), escape("\xd0\xb6\x7f"));
+}
+
+void afc::StructuredLogTest::testJsonEscape_Long()
+{
+	// Special characters at different positions within and across 16-character blocks.
+	std::string s, expected;
+	for (unsigned i = 0; i < 100; ++i) {
+		s += "abcdefghijklmnopqrstuvwxyz0123456789\xd0\xb6";
+		expected += "abcdefghijklmnopqrstuvwxyz0123456789\xd0\xb6";
+		if (i % 3 == 0) {
+			s += '"';
+			expected += "\\\"";
+		}
+		s.append(i % 17, 'x');
+		expected.append(i % 17, 'x');
+		if (i % 5 == 0) {
+			s += '\n';
+			expected += "\\n";
+		}
+	}
+	CPPUNIT_ASSERT_EQUAL(expected, escape(s));
+}
+
+void afc::StructuredLogTest::testLogKV_Json()
+{
+	MemoryLog log;
+	logger::logKV(log.file, "request"_s, "user", 12, "latency_us", std::uint64_t(340), "ok", true,
+			"path"_s, "/a\"b", "ratio", 0.5, "none", nullptr, "grade", 'A');
+	logger::logKV(log.file, "empty"_s);
+
+	CPPUNIT_ASSERT_EQUAL(std::string(
+			"{\"event\":\"request\",\"user\":12,\"latency_us\":340,\"ok\":true,\"path\":\"/a\\\"b\","
+			"\"ratio\":0.5,\"none\":null,\"grade\":\"A\"}\n"
+			"{\"event\":\"empty\"}\n"), log.text());
+}
+
+void afc::StructuredLogTest::testLogKV_Logfmt()
+{
+	MemoryLog log;
+	logger::logKV<logger::LogFormat::logfmt>(log.file, "request"_s, "user", -12, "name", "John Smith",
+			"path", "/a", "empty", "", "ok", false);
+
+	CPPUNIT_ASSERT_EQUAL(std::string("event=request user=-12 name=\"John Smith\" path=/a empty=\"\" ok=false\n"),
+			log.text());
+}
+
+void afc::StructuredLogTest::testLogKV_Logfmt_QuotedKeys()
+{
+	MemoryLog log;
+	logger::logKV<logger::LogFormat::logfmt>(log.file, "request"_s, "user name", "John", "a=b", 1, "q\"", 2, "", 3);
+
+	CPPUNIT_ASSERT_EQUAL(std::string("event=request \"user name\"=John \"a=b\"=1 \"q\\\"\"=2 \"\"=3\n"), log.text());
+}
+
+void afc::StructuredLogTest::testLogKV_Double_Locale()
+{
+	::locale_t locale = ::locale_t(0);
+	for (const char *name : {"de_DE.UTF-8", "ru_RU.UTF-8", "fr_FR.UTF-8", "de_DE", "ru_RU", "fr_FR"}) {
+		locale = ::newlocale(LC_NUMERIC_MASK, name, ::locale_t(0));
+		if (locale != ::locale_t(0)) {
+			break;
+		}
+	}
+	if (locale == ::locale_t(0)) {
+		// No locale with a decimal comma is installed.
+		return;
+	}
+	const ::locale_t prevLocale = ::uselocale(locale);
+
+	MemoryLog log;
+	logger::logKV(log.file, "tick"_s, "x", 1.5);
+	logger::logKV<logger::LogFormat::logfmt>(log.file, "tick"_s, "x", 0.25f);
+
+	::uselocale(prevLocale);
+	::freelocale(locale);
+
+	CPPUNIT_ASSERT_EQUAL(std::string("{\"event\":\"tick\",\"x\":1.5}\nevent=tick x=0.25\n"), log.text());
+}
+
+void afc::StructuredLogTest::testLogKV_Timestamp()
+{
+	TimestampTZ time;
+	time.setMillis(1552212000000); // 2019-03-10T10:00:00Z
+	time.setGmtOffset(3 * 3600);
+
+	MemoryLog log;
+	logger::logKV(log.file, "tick"_s, "at", time);
+
+	CPPUNIT_ASSERT_EQUAL(std::string("{\"event\":\"tick\",\"at\":\"2019-03-10T13:00:00+0300\"}\n"), log.text());
+}
+
+void afc::StructuredLogTest::testLogKV_LongValue()
+{
+	const std::string value(10000, '\t');
+
+	MemoryLog log;
+	logger::logKV(log.file, "long"_s, "value", value.c_str());
+
+	std::string expected("{\"event\":\"long\",\"value\":\"");
+	for (std::size_t i = 0; i < value.size(); ++i) {
+		expected += "\\t";
+	}
+	expected += "\"}\n";
+	CPPUNIT_ASSERT_EQUAL(expected, log.text());
+}
@@ -0,0 +1,48 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_STRUCTUREDLOGTEST_HPP_
+#define AFC_STRUCTUREDLOGTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class StructuredLogTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(StructuredLogTest);
+		CPPUNIT_TEST(testJsonEscape);
+		CPPUNIT_TEST(testJsonEscape_Long);
+		CPPUNIT_TEST(testLogKV_Json);
+		CPPUNIT_TEST(testLogKV_Logfmt);
+		CPPUNIT_TEST(testLogKV_Logfmt_QuotedKeys);
+		CPPUNIT_TEST(testLogKV_Double_Locale);
+		CPPUNIT_TEST(testLogKV_Timestamp);
+		CPPUNIT_TEST(testLogKV_LongValue);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testJsonEscape();
+		void testJsonEscape_Long();
+		void testLogKV_Json();
+		void testLogKV_Logfmt();
+		void testLogKV_Logfmt_QuotedKeys();
+		void testLogKV_Double_Locale();
+		void testLogKV_Timestamp();
+		void testLogKV_LongValue();
+	};
+}
+
+#endif /* AFC_STRUCTUREDLOGTEST_HPP_ */
@@ -0,0 +1,219 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "SyncTest.hpp"
+#include <afc/sync.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::SyncTest);
+
+using std::uint64_t;
+
+namespace
+{
+	const unsigned threadCount = 4;
+	const unsigned iterationCount = 5000;
+
+	template<typename Lock>
+	void checkMutualExclusion()
+	{
+		Lock lock;
+		// Non-atomic updates are lost if the lock does not exclude the writers.
+		uint64_t counter = 0;
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < threadCount; ++t) {
+			threads.emplace_back([&]()
+			{
+				for (unsigned i = 0; i < iterationCount; ++i) {
+					std::lock_guard<Lock> guard(lock);
+					const uint64_t value = counter;
+					if (i % 64 == 0) {
+						std::this_thread::yield();
+					}
+					counter = value + 1;
+				}
+			});
+		}
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(threadCount) * iterationCount, counter);
+	}
+
+	struct Snapshot
+	{
+		uint64_t a;
+		uint64_t b;
+		char c[13];
+	};
+}
+
+void afc::SyncTest::testSpinLock_TryLock()
+{
+	SpinLock lock;
+
+	CPPUNIT_ASSERT(lock.try_lock());
+	CPPUNIT_ASSERT(!lock.try_lock());
+	lock.unlock();
+	CPPUNIT_ASSERT(lock.try_lock());
+	lock.unlock();
+}
+
+void afc::SyncTest::testSpinLock_MutualExclusion()
+{
+	checkMutualExclusion<SpinLock>();
+}
+
+void afc::SyncTest::testTicketLock_TryLock()
+{
+	TicketLock lock;
+
+	CPPUNIT_ASSERT(lock.try_lock());
+	CPPUNIT_ASSERT(!lock.try_lock());
+	lock.unlock();
+	lock.lock();
+	CPPUNIT_ASSERT(!lock.try_lock());
+	lock.unlock();
+	CPPUNIT_ASSERT(lock.try_lock());
+	lock.unlock();
+}
+
+void afc::SyncTest::testTicketLock_MutualExclusion()
+{
+	checkMutualExclusion<TicketLock>();
+}
+
+void afc::SyncTest::testRWSpinLock_TryLock()
+{
+	RWSpinLock lock;
+
+	CPPUNIT_ASSERT(lock.try_lock_shared());
+	CPPUNIT_ASSERT(lock.try_lock_shared());
+	CPPUNIT_ASSERT(!lock.try_lock());
+	lock.unlock_shared();
+	CPPUNIT_ASSERT(!lock.try_lock());
+	lock.unlock_shared();
+
+	CPPUNIT_ASSERT(lock.try_lock());
+	CPPUNIT_ASSERT(!lock.try_lock_shared());
+	CPPUNIT_ASSERT(!lock.try_lock());
+	lock.unlock();
+
+	{
+		SharedLockGuard<RWSpinLock> guard(lock);
+		CPPUNIT_ASSERT(!lock.try_lock());
+	}
+	CPPUNIT_ASSERT(lock.try_lock());
+	lock.unlock();
+}
+
+void afc::SyncTest::testRWSpinLock_MutualExclusion()
+{
+	checkMutualExclusion<RWSpinLock>();
+
+	RWSpinLock lock;
+	uint64_t a = 0, b = 0;
+	std::atomic<bool> inconsistent(false);
+	std::vector<std::thread> threads;
+	threads.emplace_back([&]()
+	{
+		for (unsigned i = 0; i < iterationCount; ++i) {
+			std::lock_guard<RWSpinLock> guard(lock);
+			++a;
+			std::this_thread::yield();
+			++b;
+		}
+	});
+	for (unsigned t = 1; t < threadCount; ++t) {
+		threads.emplace_back([&]()
+		{
+			for (unsigned i = 0; i < iterationCount; ++i) {
+				SharedLockGuard<RWSpinLock> guard(lock);
+				if (a != b) {
+					inconsistent = true;
+				}
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	CPPUNIT_ASSERT(!inconsistent);
+	CPPUNIT_ASSERT_EQUAL(uint64_t(iterationCount), b);
+}
+
+void afc::SyncTest::testSeqLock_LoadStore()
+{
+	SeqLock<Snapshot> snapshot(Snapshot{1, 2, "abc"});
+	const std::uint32_t version = snapshot.version();
+
+	Snapshot value = snapshot.load();
+	CPPUNIT_ASSERT_EQUAL(uint64_t(1), value.a);
+	CPPUNIT_ASSERT_EQUAL(uint64_t(2), value.b);
+	CPPUNIT_ASSERT_EQUAL(std::string("abc"), std::string(value.c));
+
+	snapshot.store(Snapshot{3, 4, "defghijklmno"});
+	value = snapshot.load();
+	CPPUNIT_ASSERT(snapshot.version() != version);
+	CPPUNIT_ASSERT_EQUAL(uint64_t(3), value.a);
+	CPPUNIT_ASSERT_EQUAL(uint64_t(4), value.b);
+	CPPUNIT_ASSERT_EQUAL(std::string("defghijklmno"), std::string(value.c));
+
+	snapshot.update([](Snapshot s) { s.a *= 10; return s; });
+	CPPUNIT_ASSERT_EQUAL(uint64_t(30), snapshot.load().a);
+}
+
+void afc::SyncTest::testSeqLock_ConsistentSnapshots()
+{
+	SeqLock<Snapshot> snapshot(Snapshot{0, 0, ""});
+	std::atomic<bool> inconsistent(false);
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < 2; ++t) {
+		threads.emplace_back([&]()
+		{
+			for (unsigned i = 0; i < iterationCount; ++i) {
+				snapshot.update([](Snapshot s) { ++s.a; s.b = ~s.a; s.c[0] = char(s.a); return s; });
+			}
+		});
+	}
+	for (unsigned t = 2; t < threadCount; ++t) {
+		threads.emplace_back([&]()
+		{
+			for (unsigned i = 0; i < iterationCount; ++i) {
+				const Snapshot s = snapshot.load();
+				if (s.b != ~s.a && s.a != 0) {
+					inconsistent = true;
+				}
+				if (s.a != 0 && s.c[0] != char(s.a)) {
+					inconsistent = true;
+				}
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	CPPUNIT_ASSERT(!inconsistent);
+	CPPUNIT_ASSERT_EQUAL(uint64_t(2) * iterationCount, snapshot.load().a);
+}
@@ -0,0 +1,48 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_SYNCTEST_HPP_
+#define AFC_SYNCTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class SyncTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(SyncTest);
+		CPPUNIT_TEST(testSpinLock_TryLock);
+		CPPUNIT_TEST(testSpinLock_MutualExclusion);
+		CPPUNIT_TEST(testTicketLock_TryLock);
+		CPPUNIT_TEST(testTicketLock_MutualExclusion);
+		CPPUNIT_TEST(testRWSpinLock_TryLock);
+		CPPUNIT_TEST(testRWSpinLock_MutualExclusion);
+		CPPUNIT_TEST(testSeqLock_LoadStore);
+		CPPUNIT_TEST(testSeqLock_ConsistentSnapshots);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testSpinLock_TryLock();
+		void testSpinLock_MutualExclusion();
+		void testTicketLock_TryLock();
+		void testTicketLock_MutualExclusion();
+		void testRWSpinLock_TryLock();
+		void testRWSpinLock_MutualExclusion();
+		void testSeqLock_LoadStore();
+		void testSeqLock_ConsistentSnapshots();
+	};
+}
+
+#endif /* AFC_SYNCTEST_HPP_ */
@@ -0,0 +1,131 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_TESTUTIL_HPP_
+#define AFC_TESTUTIL_HPP_
+
+#include <afc/stream.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// POSIX API.
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Fixtures shared by the test suites.
+namespace afc
+{
+	namespace test
+	{
+		// An empty temporary file that is deleted when the fixture is destroyed.
+		struct TempFile
+		{
+			TempFile() { char name[] = "/tmp/libafc_test_XXXXXX"; ::close(::mkstemp(name)); path = name; }
+			TempFile(const TempFile &) = delete;
+			~TempFile() { ::unlink(path.c_str()); }
+
+			TempFile &operator=(const TempFile &) = delete;
+
+			std::string path;
+		};
+
+		// An empty temporary directory that is deleted with its files when the fixture is destroyed.
+		struct TempDir
+		{
+			TempDir() { char name[] = "/tmp/libafc_test_XXXXXX"; path = ::mkdtemp(name); }
+			TempDir(const TempDir &) = delete;
+			~TempDir()
+			{
+				for (const std::string &file : files()) {
+					::unlink((path + '/' + file).c_str());
+				}
+				::rmdir(path.c_str());
+			}
+
+			TempDir &operator=(const TempDir &) = delete;
+
+			// The names of the files in the directory.
+			std::vector<std::string> files() const
+			{
+				std::vector<std::string> result;
+				DIR * const dir = ::opendir(path.c_str());
+				for (const dirent *entry; (entry = ::readdir(dir)) != nullptr;) {
+					if (entry->d_name[0] != '.') {
+						result.emplace_back(entry->d_name);
+					}
+				}
+				::closedir(dir);
+				return result;
+			}
+
+			std::string path;
+		};
+
+		// An output stream that collects the octets written.
+		struct StringOutputStream : public afc::OutputStream
+		{
+			std::string data;
+
+			virtual void write(const unsigned char * const buf, const std::size_t n)
+			{
+				data.append(reinterpret_cast<const char *>(buf), n);
+			}
+		};
+
+		// Returns at most maxChunk octets per read() to exercise data split between reads.
+		struct StringInputStream : public afc::InputStream
+		{
+			explicit StringInputStream(const std::string &s, const std::size_t maxChunk = ~std::size_t(0))
+				: data(s), pos(0), chunk(maxChunk) {}
+
+			virtual std::size_t read(unsigned char * const buf, const std::size_t n)
+			{
+				const std::size_t count = std::min(std::min(n, chunk), data.size() - pos);
+				std::copy_n(data.data() + pos, count, buf);
+				pos += count;
+				return count;
+			}
+			virtual void reset() { pos = 0; }
+			virtual std::size_t skip(const std::size_t n)
+			{
+				const std::size_t count = std::min(n, data.size() - pos);
+				pos += count;
+				return count;
+			}
+			virtual void close() {}
+
+			const std::string data;
+			std::size_t pos;
+			const std::size_t chunk;
+		};
+
+		// Pseudo-random octets that are the same for the same seed.
+		inline std::string randomOctets(const std::size_t n, unsigned seed)
+		{
+			std::string result(n, '\0');
+			for (std::size_t i = 0; i < n; ++i) {
+				seed = seed * 1103515245 + 12345;
+				result[i] = static_cast<char>(seed >> 16);
+			}
+			return result;
+		}
+	}
+}
+
+#endif /* AFC_TESTUTIL_HPP_ */
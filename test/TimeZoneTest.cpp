@@ -0,0 +1,315 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "TimeZoneTest.hpp"
+#include <afc/timezone.h>
+
+#include <afc/Exception.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+// POSIX API.
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::TimeZoneTest);
+
+using afc::Timestamp;
+using afc::TimeZone;
+using std::int64_t;
+using std::string;
+using std::vector;
+
+namespace
+{
+	struct LocalTimeType
+	{
+		std::int32_t gmtOffset;
+		bool isDst;
+		unsigned char abbreviation;
+	};
+
+	// Builds TZif data (without leap seconds and UT/standard indicators).
+	class TZifBuilder
+	{
+	public:
+		TZifBuilder &transition(const int64_t time, const unsigned char type)
+				{ m_times.push_back(time); m_transitionTypes.push_back(type); return *this; }
+		TZifBuilder &type(const std::int32_t gmtOffset, const bool isDst, const char * const abbreviation)
+		{
+			m_types.push_back(LocalTimeType{gmtOffset, isDst, static_cast<unsigned char>(m_chars.size())});
+			m_chars.append(abbreviation);
+			m_chars.push_back('\0');
+			return *this;
+		}
+
+		vector<unsigned char> build(const char version, const char * const footer) const
+		{
+			vector<unsigned char> data;
+			block(data, version, false);
+			if (version != '\0') {
+				block(data, version, true);
+				data.push_back('\n');
+				data.insert(data.end(), footer, footer + std::strlen(footer));
+				data.push_back('\n');
+			}
+			return data;
+		}
+	private:
+		static void put(vector<unsigned char> &data, const std::uint64_t value, const unsigned size)
+		{
+			for (unsigned i = size; i > 0; --i) {
+				data.push_back(static_cast<unsigned char>(value >> (8 * (i - 1))));
+			}
+		}
+
+		void block(vector<unsigned char> &data, const char version, const bool wide) const
+		{
+			data.insert(data.end(), {'T', 'Z', 'i', 'f', static_cast<unsigned char>(version)});
+			data.insert(data.end(), 15, 0);
+			put(data, 0, 4);
+			put(data, 0, 4);
+			put(data, 0, 4);
+			put(data, m_times.size(), 4);
+			put(data, m_types.size(), 4);
+			put(data, m_chars.size(), 4);
+			for (const int64_t time : m_times) {
+				put(data, static_cast<std::uint64_t>(time), wide ? 8 : 4);
+			}
+			data.insert(data.end(), m_transitionTypes.begin(), m_transitionTypes.end());
+			for (const LocalTimeType &type : m_types) {
+				put(data, static_cast<std::uint32_t>(type.gmtOffset), 4);
+				data.push_back(type.isDst);
+				data.push_back(type.abbreviation);
+			}
+			data.insert(data.end(), m_chars.begin(), m_chars.end());
+		}
+
+		vector<int64_t> m_times;
+		vector<unsigned char> m_transitionTypes;
+		vector<LocalTimeType> m_types;
+		string m_chars;
+	};
+
+	Timestamp utc(const int year, const int month, const int day, const int hour, const int minute)
+	{
+		std::tm t = {};
+		t.tm_year = year - 1900;
+		t.tm_mon = month - 1;
+		t.tm_mday = day;
+		t.tm_hour = hour;
+		t.tm_min = minute;
+		return Timestamp(static_cast<Timestamp::time_type>(::timegm(&t)) * 1000);
+	}
+
+	std::unique_ptr<TimeZone> zone(const vector<unsigned char> &data)
+	{
+		return std::unique_ptr<TimeZone>(new TimeZone("Test/Zone", data.data(), data.size()));
+	}
+}
+
+void afc::TimeZoneTest::testVersion1Data()
+{
+	const vector<unsigned char> data = TZifBuilder()
+			.type(3600, false, "AAA").type(7200, true, "BBBB")
+			.transition(1000000000, 1).transition(1100000000, 0)
+			.build('\0', "");
+	const std::unique_ptr<TimeZone> tz = zone(data);
+
+	CPPUNIT_ASSERT_EQUAL(string("Test/Zone"), tz->name());
+	CPPUNIT_ASSERT_EQUAL(3600L, tz->gmtOffset(Timestamp(999999999999)));
+	CPPUNIT_ASSERT_EQUAL(7200L, tz->gmtOffset(Timestamp(1000000000000)));
+	CPPUNIT_ASSERT_EQUAL(7200L, tz->gmtOffset(Timestamp(1099999999999)));
+	CPPUNIT_ASSERT_EQUAL(3600L, tz->gmtOffset(Timestamp(2000000000000)));
+
+	// 2001-09-09T01:46:40Z
+	const std::tm t = tz->localTime(Timestamp(1000000000123));
+	CPPUNIT_ASSERT_EQUAL(101, t.tm_year);
+	CPPUNIT_ASSERT_EQUAL(8, t.tm_mon);
+	CPPUNIT_ASSERT_EQUAL(9, t.tm_mday);
+	CPPUNIT_ASSERT_EQUAL(3, t.tm_hour);
+	CPPUNIT_ASSERT_EQUAL(46, t.tm_min);
+	CPPUNIT_ASSERT_EQUAL(40, t.tm_sec);
+	CPPUNIT_ASSERT_EQUAL(0, t.tm_wday);
+	CPPUNIT_ASSERT_EQUAL(251, t.tm_yday);
+	CPPUNIT_ASSERT_EQUAL(1, t.tm_isdst);
+	CPPUNIT_ASSERT_EQUAL(7200L, t.tm_gmtoff);
+	CPPUNIT_ASSERT_EQUAL(string("BBBB"), string(t.tm_zone));
+
+	const afc::TimestampTZ ts = tz->toTimestampTZ(Timestamp(1000000000123));
+	CPPUNIT_ASSERT_EQUAL(Timestamp::time_type(1000000000123), ts.millis());
+	CPPUNIT_ASSERT_EQUAL(7200L, ts.getGmtOffset());
+}
+
+void afc::TimeZoneTest::testFooterRule()
+{
+	// A single transition in the past; the rule applies afterwards.
+	const vector<unsigned char> data = TZifBuilder()
+			.type(7200, false, "OLD").type(3600, false, "CET")
+			.transition(0, 1)
+			.build('2', "CET-1CEST,M3.5.0,M10.5.0/3");
+	const std::unique_ptr<TimeZone> tz = zone(data);
+
+	CPPUNIT_ASSERT_EQUAL(7200L, tz->gmtOffset(Timestamp(-1000)));
+	// In 2030 DST is from 2030-03-31T01:00Z to 2030-10-27T01:00Z.
+	CPPUNIT_ASSERT_EQUAL(3600L, tz->gmtOffset(utc(2030, 3, 31, 0, 59)));
+	CPPUNIT_ASSERT_EQUAL(7200L, tz->gmtOffset(utc(2030, 3, 31, 1, 0)));
+	CPPUNIT_ASSERT_EQUAL(7200L, tz->gmtOffset(utc(2030, 10, 27, 0, 59)));
+	CPPUNIT_ASSERT_EQUAL(3600L, tz->gmtOffset(utc(2030, 10, 27, 1, 0)));
+
+	const std::tm summer = tz->localTime(utc(2100, 7, 1, 12, 0));
+	CPPUNIT_ASSERT_EQUAL(14, summer.tm_hour);
+	CPPUNIT_ASSERT_EQUAL(1, summer.tm_isdst);
+	CPPUNIT_ASSERT_EQUAL(string("CEST"), string(summer.tm_zone));
+
+	const std::tm winter = tz->localTime(utc(2100, 12, 31, 23, 30));
+	CPPUNIT_ASSERT_EQUAL(201, winter.tm_year);
+	CPPUNIT_ASSERT_EQUAL(0, winter.tm_mon);
+	CPPUNIT_ASSERT_EQUAL(1, winter.tm_mday);
+	CPPUNIT_ASSERT_EQUAL(0, winter.tm_hour);
+	CPPUNIT_ASSERT_EQUAL(0, winter.tm_isdst);
+	CPPUNIT_ASSERT_EQUAL(string("CET"), string(winter.tm_zone));
+}
+
+void afc::TimeZoneTest::testFooterRule_SouthernHemisphere()
+{
+	const vector<unsigned char> data = TZifBuilder()
+			.type(36000, false, "AEST")
+			.build('3', "AEST-10AEDT,M10.1.0,M4.1.0/3");
+	const std::unique_ptr<TimeZone> tz = zone(data);
+
+	// In 2031 DST ends on 2031-04-06T16:00Z and starts on 2031-10-04T16:00Z.
+	CPPUNIT_ASSERT_EQUAL(39600L, tz->gmtOffset(utc(2031, 1, 15, 0, 0)));
+	CPPUNIT_ASSERT_EQUAL(39600L, tz->gmtOffset(utc(2031, 4, 5, 15, 59)));
+	CPPUNIT_ASSERT_EQUAL(36000L, tz->gmtOffset(utc(2031, 4, 5, 16, 0)));
+	CPPUNIT_ASSERT_EQUAL(36000L, tz->gmtOffset(utc(2031, 10, 4, 15, 59)));
+	CPPUNIT_ASSERT_EQUAL(39600L, tz->gmtOffset(utc(2031, 10, 4, 16, 0)));
+	CPPUNIT_ASSERT_EQUAL(39600L, tz->gmtOffset(utc(2031, 12, 31, 23, 0)));
+}
+
+void afc::TimeZoneTest::testFooterRule_NoDst()
+{
+	const vector<unsigned char> data = TZifBuilder()
+			.type(19800, false, "IST")
+			.build('2', "<+0530>-5:30");
+	const std::unique_ptr<TimeZone> tz = zone(data);
+
+	CPPUNIT_ASSERT_EQUAL(19800L, tz->gmtOffset(utc(2200, 6, 1, 0, 0)));
+	const std::tm t = tz->localTime(utc(2200, 6, 1, 0, 0));
+	CPPUNIT_ASSERT_EQUAL(5, t.tm_hour);
+	CPPUNIT_ASSERT_EQUAL(30, t.tm_min);
+	CPPUNIT_ASSERT_EQUAL(string("+0530"), string(t.tm_zone));
+}
+
+void afc::TimeZoneTest::testNegativeTimestamp()
+{
+	const vector<unsigned char> data = TZifBuilder().type(0, false, "UTC").build('2', "UTC0");
+	const std::unique_ptr<TimeZone> tz = zone(data);
+
+	// 1969-12-31T23:59:59.999Z
+	const std::tm t = tz->localTime(Timestamp(-1));
+	CPPUNIT_ASSERT_EQUAL(69, t.tm_year);
+	CPPUNIT_ASSERT_EQUAL(11, t.tm_mon);
+	CPPUNIT_ASSERT_EQUAL(31, t.tm_mday);
+	CPPUNIT_ASSERT_EQUAL(23, t.tm_hour);
+	CPPUNIT_ASSERT_EQUAL(59, t.tm_sec);
+	CPPUNIT_ASSERT_EQUAL(3, t.tm_wday);
+	CPPUNIT_ASSERT_EQUAL(364, t.tm_yday);
+}
+
+void afc::TimeZoneTest::testMalformedData()
+{
+	const vector<unsigned char> valid = TZifBuilder()
+			.type(3600, false, "AAA").transition(0, 0).build('2', "AAA-1");
+
+	vector<vector<unsigned char>> malformed;
+	malformed.push_back(vector<unsigned char>(valid.begin(), valid.begin() + 60));
+	malformed.push_back(valid);
+	malformed.back()[0] = 'X';
+	malformed.push_back(TZifBuilder().type(3600, false, "AAA").transition(0, 1).build('2', "AAA-1"));
+	malformed.push_back(TZifBuilder().type(3600, false, "AAA").transition(10, 0).transition(0, 0).build('2', "AAA-1"));
+	malformed.push_back(TZifBuilder().type(3600, false, "AAA").build('2', "AAA-1BBB,M3"));
+	malformed.push_back(TZifBuilder().type(3600, false, "AAA").build('2', "-1"));
+
+	for (const vector<unsigned char> &data : malformed) {
+		try {
+			TimeZone("Test/Zone", data.data(), data.size());
+			CPPUNIT_FAIL("Exception is expected.");
+		} catch (afc::Exception &) {
+			// Expected.
+		}
+	}
+}
+
+void afc::TimeZoneTest::testInvalidZoneName()
+{
+	afc::TimeZoneDatabase database("/nonexistent");
+	const char * const names[] = {"", "/etc/passwd", "../etc/passwd", "Europe/../../x", "Europe/Minsk"};
+	for (const char * const name : names) {
+		try {
+			database.get(name);
+			CPPUNIT_FAIL("Exception is expected.");
+		} catch (afc::Exception &) {
+			// Expected.
+		}
+	}
+}
+
+void afc::TimeZoneTest::testSystemDatabaseMatchesLibc()
+{
+	const char * const zones[] = {"Europe/Berlin", "America/New_York", "Australia/Sydney", "Asia/Kolkata",
+			"America/Sao_Paulo", "Pacific/Chatham", "America/St_Johns"};
+	const char * const tzBackup = std::getenv("TZ");
+	const string tzValue = tzBackup == nullptr ? string() : string(tzBackup);
+
+	for (const char * const zoneName : zones) {
+		const string file = string("/usr/share/zoneinfo/") + zoneName;
+		if (::access(file.c_str(), R_OK) != 0) {
+			continue;
+		}
+		const TimeZone &tz = afc::TimeZoneDatabase::system().get(zoneName);
+		CPPUNIT_ASSERT(&tz == &afc::TimeZoneDatabase::system().get(zoneName));
+
+		::setenv("TZ", (string(":") + zoneName).c_str(), true);
+		::tzset();
+		// From 1901 to 2099 in steps that are not multiples of a day.
+		for (int64_t t = -2100000000; t < 4000000000; t += 9876543) {
+			const std::time_t time = static_cast<std::time_t>(t);
+			std::tm expected;
+			::localtime_r(&time, &expected);
+			const std::tm actual = tz.localTime(Timestamp(t * 1000));
+
+			CPPUNIT_ASSERT_EQUAL(expected.tm_gmtoff, actual.tm_gmtoff);
+			CPPUNIT_ASSERT_EQUAL(expected.tm_isdst, actual.tm_isdst);
+			CPPUNIT_ASSERT_EQUAL(string(expected.tm_zone), string(actual.tm_zone));
+			CPPUNIT_ASSERT_EQUAL(expected.tm_year, actual.tm_year);
+			CPPUNIT_ASSERT_EQUAL(expected.tm_yday, actual.tm_yday);
+			CPPUNIT_ASSERT_EQUAL(expected.tm_hour, actual.tm_hour);
+			CPPUNIT_ASSERT_EQUAL(expected.tm_min, actual.tm_min);
+		}
+	}
+
+	if (tzBackup != nullptr) {
+		::setenv("TZ", tzValue.c_str(), true);
+	} else {
+		::unsetenv("TZ");
+	}
+	::tzset();
+}
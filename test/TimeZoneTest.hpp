@@ -0,0 +1,48 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_TIMEZONETEST_HPP_
+#define AFC_TIMEZONETEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class TimeZoneTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(TimeZoneTest);
+		CPPUNIT_TEST(testVersion1Data);
+		CPPUNIT_TEST(testFooterRule);
+		CPPUNIT_TEST(testFooterRule_SouthernHemisphere);
+		CPPUNIT_TEST(testFooterRule_NoDst);
+		CPPUNIT_TEST(testNegativeTimestamp);
+		CPPUNIT_TEST(testMalformedData);
+		CPPUNIT_TEST(testInvalidZoneName);
+		CPPUNIT_TEST(testSystemDatabaseMatchesLibc);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testVersion1Data();
+		void testFooterRule();
+		void testFooterRule_SouthernHemisphere();
+		void testFooterRule_NoDst();
+		void testNegativeTimestamp();
+		void testMalformedData();
+		void testInvalidZoneName();
+		void testSystemDatabaseMatchesLibc();
+	};
+}
+
+#endif /* AFC_TIMEZONETEST_HPP_ */
@@ -23,10 +23,12 @@ CPPUNIT_TEST_SUITE_REGISTRATION(UrlBuilderTest);
 #include <algorithm>
 #include <cstddef>
 #include <string>
+#include <vector>
 
 using namespace std;
 
 using namespace afc::url;
+using afc::operator"" _s;
 
 void UrlBuilderTest::testUrlWithNoQuery()
 {
@@ -394,3 +396,68 @@ void UrlBuilderTest::testCapacityComputation_ParamsAppended()
 	CPPUNIT_ASSERT_EQUAL(expectedResult, string(result));
 	CPPUNIT_ASSERT_EQUAL(size_t(130), builder.size());
 }
+
+void UrlBuilderTest::testBatch_CommonParams()
+{
+	UrlBatchBuilder batch("http://hello/items"_s, UrlPart<>("sort"), UrlPart<>("a b"));
+
+	CPPUNIT_ASSERT_EQUAL(string("http://hello/items?sort=a%20b"), string(batch.prefix().value(), batch.prefix().size()));
+
+	const afc::ConstStringRef url1 = batch.add(UrlPart<>("page"), UrlPart<>("1"));
+	const afc::ConstStringRef url2 = batch.add(UrlPart<>("page"), UrlPart<raw>("2"), UrlPart<>("x"), UrlPart<>("&"));
+	const afc::ConstStringRef url3 = batch.add();
+
+	CPPUNIT_ASSERT_EQUAL(string("http://hello/items?sort=a%20b&page=1"), string(url1.value(), url1.size()));
+	CPPUNIT_ASSERT_EQUAL(string("http://hello/items?sort=a%20b&page=2&x=%26"), string(url2.value(), url2.size()));
+	CPPUNIT_ASSERT_EQUAL(string("http://hello/items?sort=a%20b"), string(url3.value(), url3.size()));
+	// URLs are null-terminated.
+	CPPUNIT_ASSERT_EQUAL(string("http://hello/items?sort=a%20b&page=1"), string(url1.value()));
+	CPPUNIT_ASSERT_EQUAL(size_t(3), batch.urlCount());
+}
+
+void UrlBuilderTest::testBatch_NoCommonParams()
+{
+	UrlBatchBuilder batch("http://hello/items", 18);
+
+	const afc::ConstStringRef url1 = batch.add(UrlPart<>("page"), UrlPart<>("1"), UrlPart<>("size"), UrlPart<>("10"));
+	const afc::ConstStringRef url2 = batch.add();
+
+	CPPUNIT_ASSERT_EQUAL(string("http://hello/items?page=1&size=10"), string(url1.value(), url1.size()));
+	CPPUNIT_ASSERT_EQUAL(string("http://hello/items"), string(url2.value(), url2.size()));
+}
+
+void UrlBuilderTest::testBatch_ManyUrls()
+{
+	UrlBatchBuilder batch("http://hello/items"_s, UrlPart<>("sort"), UrlPart<>("asc"));
+	vector<afc::ConstStringRef> urls;
+	for (int i = 0; i < 10000; ++i) {
+		const string page = to_string(i);
+		urls.push_back(batch.add(UrlPart<>(page.c_str()), UrlPart<>(string(i % 300, 'v').c_str())));
+	}
+
+	// URLs built before the arena grows are not moved.
+	for (int i = 0; i < 10000; ++i) {
+		const string expected = "http://hello/items?sort=asc&" + to_string(i) + "=" + string(i % 300, 'v');
+		CPPUNIT_ASSERT_EQUAL(expected, string(urls[i].value(), urls[i].size()));
+	}
+
+	const string longValue(200000, 'z');
+	const afc::ConstStringRef longUrl = batch.add(UrlPart<>("long"), UrlPart<>(longValue.c_str()));
+	CPPUNIT_ASSERT_EQUAL(size_t(27 + 6 + 200000), longUrl.size());
+	CPPUNIT_ASSERT_EQUAL(string("http://hello/items?sort=asc&2=vv"), string(urls[2].value(), urls[2].size()));
+}
+
+void UrlBuilderTest::testBatch_Clear()
+{
+	UrlBatchBuilder batch("http://hello/items"_s);
+	const afc::ConstStringRef url1 = batch.add(UrlPart<>("a"), UrlPart<>("1"));
+	const char * const firstUrlAddress = url1.value();
+
+	batch.clear();
+	CPPUNIT_ASSERT_EQUAL(size_t(0), batch.urlCount());
+
+	const afc::ConstStringRef url2 = batch.add(UrlPart<>("b"), UrlPart<>("2"));
+	CPPUNIT_ASSERT_EQUAL(string("http://hello/items?b=2"), string(url2.value(), url2.size()));
+	// The arena memory is reused.
+	CPPUNIT_ASSERT(url2.value() == firstUrlAddress);
+}
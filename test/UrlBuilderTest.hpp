@@ -58,6 +58,11 @@ class UrlBuilderTest : public CppUnit::TestFixture
 	CPPUNIT_TEST(testCapacityComputation_UrlWithQuery);
 	CPPUNIT_TEST(testCapacityComputation_ParamsAppended);
 
+	CPPUNIT_TEST(testBatch_CommonParams);
+	CPPUNIT_TEST(testBatch_NoCommonParams);
+	CPPUNIT_TEST(testBatch_ManyUrls);
+	CPPUNIT_TEST(testBatch_Clear);
+
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void testUrlWithNoQuery();
@@ -94,6 +99,11 @@ public:
 	void testCapacityComputation_QueryOnly_RawParams();
 	void testCapacityComputation_UrlWithQuery();
 	void testCapacityComputation_ParamsAppended();
+
+	void testBatch_CommonParams();
+	void testBatch_NoCommonParams();
+	void testBatch_ManyUrls();
+	void testBatch_Clear();
 };
 
 #endif /* URLBUILDERTEST_HPP_ */
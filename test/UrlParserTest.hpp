@@ -0,0 +1,50 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_URLPARSERTEST_HPP_
+#define AFC_URLPARSERTEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class UrlParserTest : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(UrlParserTest);
+		CPPUNIT_TEST(testAbsoluteUrl);
+		CPPUNIT_TEST(testIPv6Host);
+		CPPUNIT_TEST(testRelativeReference);
+		CPPUNIT_TEST(testEmptyQueryAndFragment);
+		CPPUNIT_TEST(testNoPath);
+		CPPUNIT_TEST(testInvalidPort);
+		CPPUNIT_TEST(testUnterminatedIPv6Host);
+		CPPUNIT_TEST(testQueryParser);
+		CPPUNIT_TEST(testPercentDecode);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testAbsoluteUrl();
+		void testIPv6Host();
+		void testRelativeReference();
+		void testEmptyQueryAndFragment();
+		void testNoPath();
+		void testInvalidPort();
+		void testUnterminatedIPv6Host();
+		void testQueryParser();
+		void testPercentDecode();
+	};
+}
+
+#endif /* AFC_URLPARSERTEST_HPP_ */
@@ -0,0 +1,216 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#include "Utf8Test.hpp"
+#include <afc/utf8.h>
+
+#include <afc/FastStringBuffer.hpp>
+#include <afc/StringRef.hpp>
+
+#include <cstddef>
+#include <string>
+
+CPPUNIT_TEST_SUITE_REGISTRATION(afc::Utf8Test);
+
+using afc::operator"" _s;
+using std::size_t;
+using std::string;
+
+namespace
+{
+	// 1-, 2-, 3- and 4-octet characters.
+	const string mixed = u8"aé€\U0001f600";
+
+	// Places s at each offset within long ASCII text so that it is checked by both vector and scalar code.
+	template<typename Check>
+	void atEachOffset(const string &s, Check check)
+	{
+		for (size_t offset = 0; offset < 70; ++offset) {
+			string text(offset, 'x');
+			text += s;
+			text.append(offset % 37, 'y');
+			check(text, offset);
+		}
+	}
+
+	size_t invalidOffset(const string &s)
+	{
+		return size_t(afc::utf8::validate(s.data(), s.data() + s.size()) - s.data());
+	}
+}
+
+void afc::Utf8Test::testValidate_WellFormed()
+{
+	const char * const inputs[] = {"", "hello", u8"\u0080", u8"߿", u8"ࠀ", u8"퟿", u8"", u8"￿",
+			u8"\U00010000", u8"\U0010ffff", u8"Najvialikšaje bahaćcie", "\xef\xbb\xbf"};
+	for (const char * const input : inputs) {
+		atEachOffset(input, [](const string &text, size_t) {
+			CPPUNIT_ASSERT(afc::utf8::isValid(text.data(), text.data() + text.size()));
+		});
+	}
+
+	string longText;
+	for (int i = 0; i < 100; ++i) {
+		longText += mixed;
+	}
+	CPPUNIT_ASSERT(afc::utf8::isValid(afc::stringRef(longText.data(), longText.size())));
+}
+
+void afc::Utf8Test::testValidate_IllFormed()
+{
+	const char * const inputs[] = {
+			"\x80", // A lone continuation octet.
+			"\xbf",
+			"\xc0\xaf", // Overlong forms.
+			"\xc1\xbf",
+			"\xe0\x9f\xbf",
+			"\xf0\x8f\xbf\xbf",
+			"\xed\xa0\x80", // Surrogates.
+			"\xed\xbf\xbf",
+			"\xf4\x90\x80\x80", // Beyond U+10FFFF.
+			"\xf5\x80\x80\x80",
+			"\xff",
+			"\xc3" "a", // Too short.
+			"\xe2\x82" "a",
+			"\xf0\x9f\x98" "a",
+			"a\xc3\xa9\xa9", // Too long.
+			"\xe2\x82\xac\x80"};
+	for (const char * const input : inputs) {
+		atEachOffset(input, [](const string &text, size_t) {
+			CPPUNIT_ASSERT(!afc::utf8::isValid(text.data(), text.data() + text.size()));
+		});
+	}
+}
+
+void afc::Utf8Test::testValidate_ErrorPosition()
+{
+	atEachOffset(mixed + "\xe2\x82" "a", [](const string &text, const size_t offset) {
+		CPPUNIT_ASSERT_EQUAL(offset + 10, invalidOffset(text));
+	});
+	atEachOffset("\xed\xa0\x80", [](const string &text, const size_t offset) {
+		CPPUNIT_ASSERT_EQUAL(offset, invalidOffset(text));
+	});
+	atEachOffset(mixed + "\x80", [](const string &text, const size_t offset) {
+		CPPUNIT_ASSERT_EQUAL(offset + 10, invalidOffset(text));
+	});
+}
+
+void afc::Utf8Test::testValidate_TruncatedAtEnd()
+{
+	const string prefixes[] = {"", string(15, 'x'), string(29, 'x'), string(100, 'x')};
+	for (const string &prefix : prefixes) {
+		for (size_t n = 1; n < 4; ++n) {
+			const string text = prefix + string(u8"\U0001f600").substr(0, n);
+			CPPUNIT_ASSERT_EQUAL(prefix.size(), invalidOffset(text));
+		}
+	}
+}
+
+void afc::Utf8Test::testCountCodePoints()
+{
+	CPPUNIT_ASSERT_EQUAL(size_t(0), afc::utf8::countCodePoints(""_s));
+	CPPUNIT_ASSERT_EQUAL(size_t(4), afc::utf8::countCodePoints(afc::stringRef(mixed.data(), mixed.size())));
+
+	string text;
+	for (size_t i = 0; i < 100; ++i) {
+		CPPUNIT_ASSERT_EQUAL(4 * i, afc::utf8::countCodePoints(text.data(), text.data() + text.size()));
+		text += mixed;
+	}
+}
+
+void afc::Utf8Test::testAdvance()
+{
+	string text;
+	for (size_t i = 0; i < 20; ++i) {
+		text += mixed;
+	}
+	const char * const begin = text.data();
+	const char * const end = begin + text.size();
+	const size_t offsets[] = {0, 1, 3, 6};
+	for (size_t n = 0; n < 80; ++n) {
+		CPPUNIT_ASSERT_EQUAL(begin + (n / 4) * 10 + offsets[n % 4], afc::utf8::advance(begin, end, n));
+	}
+	CPPUNIT_ASSERT_EQUAL(end, afc::utf8::advance(begin, end, 80));
+	CPPUNIT_ASSERT_EQUAL(end, afc::utf8::advance(begin, end, 1000));
+	CPPUNIT_ASSERT_EQUAL(end, afc::utf8::advance(end, end, 1));
+}
+
+void afc::Utf8Test::testTruncate()
+{
+	const afc::ConstStringRef s = u8"aé€\U0001f600"_s;
+
+	CPPUNIT_ASSERT_EQUAL(size_t(0), afc::utf8::truncate(s, 0).size());
+	CPPUNIT_ASSERT_EQUAL(size_t(1), afc::utf8::truncate(s, 1).size());
+	CPPUNIT_ASSERT_EQUAL(size_t(3), afc::utf8::truncate(s, 2).size());
+	CPPUNIT_ASSERT_EQUAL(size_t(6), afc::utf8::truncate(s, 3).size());
+	CPPUNIT_ASSERT_EQUAL(size_t(10), afc::utf8::truncate(s, 4).size());
+	CPPUNIT_ASSERT_EQUAL(size_t(10), afc::utf8::truncate(s, 5).size());
+	CPPUNIT_ASSERT_EQUAL(s.begin(), afc::utf8::truncate(s, 2).begin());
+}
+
+void afc::Utf8Test::testTruncateBytes()
+{
+	const afc::ConstStringRef s = u8"aé€\U0001f600"_s;
+	const size_t expected[] = {0, 1, 1, 3, 3, 3, 6, 6, 6, 6, 10, 10};
+	for (size_t maxBytes = 0; maxBytes < 12; ++maxBytes) {
+		CPPUNIT_ASSERT_EQUAL(expected[maxBytes], afc::utf8::truncateBytes(s, maxBytes).size());
+	}
+
+	// Ill-formed input is cut in some position, still within the limit.
+	const afc::ConstStringRef continuations = "a\x80\x80\x80\x80\x80"_s;
+	CPPUNIT_ASSERT(afc::utf8::truncateBytes(continuations, 5).size() <= 5);
+}
+
+void afc::Utf8Test::testSlice()
+{
+	const afc::ConstStringRef s = u8"aé€\U0001f600"_s;
+
+	const afc::ConstStringRef middle = afc::utf8::slice(s, 1, 2);
+	CPPUNIT_ASSERT_EQUAL(string(u8"é€"), string(middle.begin(), middle.end()));
+
+	const afc::ConstStringRef tail = afc::utf8::slice(s, 3, 10);
+	CPPUNIT_ASSERT_EQUAL(string(u8"\U0001f600"), string(tail.begin(), tail.end()));
+
+	CPPUNIT_ASSERT_EQUAL(size_t(0), afc::utf8::slice(s, 4, 1).size());
+	CPPUNIT_ASSERT_EQUAL(s.end(), afc::utf8::slice(s, 10, 1).begin());
+}
+
+void afc::Utf8Test::testFastStringBufferTruncation()
+{
+	afc::FastStringBuffer<char> buf(64);
+	buf.append(u8"šać"_s);
+
+	afc::utf8::truncateBytes(buf, 4);
+	CPPUNIT_ASSERT_EQUAL(string(u8"ša"), string(buf.data(), buf.size()));
+
+	afc::utf8::truncate(buf, 1);
+	CPPUNIT_ASSERT_EQUAL(string(u8"š"), string(buf.data(), buf.size()));
+
+	afc::utf8::truncate(buf, 5);
+	CPPUNIT_ASSERT_EQUAL(string(u8"š"), string(buf.data(), buf.size()));
+}
+
+void afc::Utf8Test::testEncode()
+{
+	const char32_t codePoints[] = {0x0, 0x7f, 0x80, 0x7ff, 0x800, 0xffff, 0x10000, 0x10ffff};
+	const char * const expected[] = {"", "\x7f", u8"\u0080", u8"߿", u8"ࠀ", u8"￿", u8"\U00010000", u8"\U0010ffff"};
+	for (size_t i = 0; i < sizeof(codePoints) / sizeof(codePoints[0]); ++i) {
+		char buf[afc::utf8::maxCharSize];
+		const char * const end = afc::utf8::encode(codePoints[i], buf);
+		const string expectedChar = i == 0 ? string(1, '\0') : string(expected[i]);
+		CPPUNIT_ASSERT_EQUAL(expectedChar, string(static_cast<const char *>(buf), end));
+		CPPUNIT_ASSERT(afc::utf8::isValid(buf, end));
+	}
+}
@@ -0,0 +1,54 @@
+/* libafc - utils to facilitate C++ development.
+Copyright (C) 2019 Dźmitry Laŭčuk
+
+libafc is free software: you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>. */
+#ifndef AFC_UTF8TEST_HPP_
+#define AFC_UTF8TEST_HPP_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace afc
+{
+	class Utf8Test : public CppUnit::TestFixture
+	{
+		CPPUNIT_TEST_SUITE(Utf8Test);
+		CPPUNIT_TEST(testValidate_WellFormed);
+		CPPUNIT_TEST(testValidate_IllFormed);
+		CPPUNIT_TEST(testValidate_ErrorPosition);
+		CPPUNIT_TEST(testValidate_TruncatedAtEnd);
+		CPPUNIT_TEST(testCountCodePoints);
+		CPPUNIT_TEST(testAdvance);
+		CPPUNIT_TEST(testTruncate);
+		CPPUNIT_TEST(testTruncateBytes);
+		CPPUNIT_TEST(testSlice);
+		CPPUNIT_TEST(testFastStringBufferTruncation);
+		CPPUNIT_TEST(testEncode);
+		CPPUNIT_TEST_SUITE_END();
+	public:
+		void testValidate_WellFormed();
+		void testValidate_IllFormed();
+		void testValidate_ErrorPosition();
+		void testValidate_TruncatedAtEnd();
+		void testCountCodePoints();
+		void testAdvance();
+		void testTruncate();
+		void testTruncateBytes();
+		void testSlice();
+		void testFastStringBufferTruncation();
+		void testEncode();
+	};
+}
+
+#endif /* AFC_UTF8TEST_HPP_ */